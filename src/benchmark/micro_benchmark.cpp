@@ -0,0 +1,121 @@
+#include "micro_benchmark.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+	std::vector<std::unique_ptr<Benchmark>>& benchmarks()
+	{
+		static std::vector<std::unique_ptr<Benchmark>> registered{};
+		return registered;
+	}
+
+	struct Result
+	{
+		std::string name{};
+		std::uint64_t iterations{};
+		double nanosecondsPerIteration{};
+		double itemsPerSecond{};
+	};
+
+	Result run(const Benchmark& benchmark, const std::vector<std::int64_t>& args, double minTimeSeconds)
+	{
+		Result result{ benchmark.name() };
+		for (std::int64_t arg : args)
+		{
+			result.name += '/' + std::to_string(arg);
+		}
+
+		std::uint64_t iterations{ 1 };
+		while (true)
+		{
+			BenchmarkState state{ iterations, args };
+			benchmark.function()(state);
+			const auto end{ std::chrono::steady_clock::now() };
+
+			const double seconds{ std::chrono::duration<double>(end - state.startTime()).count() };
+
+			if (seconds >= minTimeSeconds || iterations >= (1ull << 40))
+			{
+				result.iterations = iterations;
+				result.nanosecondsPerIteration = seconds * 1e9 / iterations;
+				result.itemsPerSecond = state.itemsProcessed() / seconds;
+				return result;
+			}
+
+			// Aim a bit past the minimum time so the final run usually sticks
+			const double scale{ seconds > 0.0 ? (minTimeSeconds * 1.4) / seconds : 10.0 };
+			iterations = static_cast<std::uint64_t>(iterations * std::min(std::max(scale, 2.0), 10.0));
+		}
+	}
+}
+
+Benchmark* registerBenchmark(const std::string& name, Benchmark::Function function)
+{
+	benchmarks().push_back(std::make_unique<Benchmark>(name, std::move(function)));
+	return benchmarks().back().get();
+}
+
+int runBenchmarks(const std::string& filter, double minTimeSeconds, const std::string& jsonPath)
+{
+	std::vector<Result> results{};
+
+	std::cout << std::left << std::setw(48) << "Benchmark" << std::right
+		<< std::setw(16) << "Time (ns)" << std::setw(14) << "Iterations" << std::setw(16) << "Items/s" << '\n';
+
+	for (const auto& benchmark : benchmarks())
+	{
+		if (benchmark->name().find(filter) == std::string::npos)
+		{
+			continue;
+		}
+
+		std::vector<std::vector<std::int64_t>> argSets{ benchmark->argSets() };
+		if (argSets.empty())
+		{
+			argSets.push_back({});
+		}
+
+		for (const auto& args : argSets)
+		{
+			const Result result{ run(*benchmark, args, minTimeSeconds) };
+			results.push_back(result);
+
+			std::cout << std::left << std::setw(48) << result.name << std::right << std::fixed << std::setprecision(1)
+				<< std::setw(16) << result.nanosecondsPerIteration << std::setw(14) << result.iterations
+				<< std::setw(16) << std::setprecision(0) << result.itemsPerSecond << '\n';
+		}
+	}
+
+	if (!jsonPath.empty())
+	{
+		std::ofstream out{ jsonPath };
+		if (!out)
+		{
+			std::cerr << "BENCHMARK: ERROR: Could not open " << jsonPath << " for writing\n";
+			return 1;
+		}
+
+		out << "{\n  \"benchmarks\": [\n";
+		for (std::size_t i{ 0 }; i < results.size(); ++i)
+		{
+			out << "    { \"name\": \"" << results[i].name
+				<< "\", \"iterations\": " << results[i].iterations
+				<< ", \"ns_per_iteration\": " << results[i].nanosecondsPerIteration
+				<< ", \"items_per_second\": " << results[i].itemsPerSecond << " }"
+				<< (i + 1 < results.size() ? ",\n" : "\n");
+		}
+		out << "  ]\n}\n";
+	}
+
+	return 0;
+}
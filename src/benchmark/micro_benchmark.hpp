@@ -0,0 +1,176 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional> // for std::function
+#include <string>
+#include <utility>
+#include <vector>
+
+// Minimal Google Benchmark-style harness. Benchmarks are plain functions
+// registered with BENCHMARK(), optionally parameterised with ->arg(), and
+// time their hot loop with `for (auto _ : state)`:
+//
+//   void BM_thing(BenchmarkState& state)
+//   {
+//       Input input{ makeInput(state.range(0)) };
+//       for (auto _ : state)
+//       {
+//           doNotOptimize(thing(input));
+//       }
+//   }
+//   BENCHMARK(BM_thing)->arg(16)->arg(64);
+//
+// The runner grows the iteration count until a run takes at least the
+// minimum time, then reports the time per iteration.
+class BenchmarkState final
+{
+public:
+
+	class Iterator final
+	{
+	public:
+
+		explicit Iterator(std::uint64_t remaining)
+			: m_remaining{ remaining }
+		{}
+
+		int operator*() const
+		{
+			return 0;
+		}
+
+		Iterator& operator++()
+		{
+			--m_remaining;
+			return *this;
+		}
+
+		bool operator!=(const Iterator& other) const
+		{
+			return m_remaining != other.m_remaining;
+		}
+
+	private:
+
+		std::uint64_t m_remaining{};
+	};
+
+	BenchmarkState(std::uint64_t iterations, const std::vector<std::int64_t>& args)
+		: m_iterations{ iterations }
+		, m_args{ args }
+	{}
+
+	Iterator begin()
+	{
+		m_start = std::chrono::steady_clock::now();
+		return Iterator{ m_iterations };
+	}
+
+	Iterator end()
+	{
+		return Iterator{ 0 };
+	}
+
+	std::int64_t range(std::size_t index) const
+	{
+		return m_args.at(index);
+	}
+
+	std::uint64_t iterations() const
+	{
+		return m_iterations;
+	}
+
+	// Reported as items per second, e.g. joints or vertices processed
+	void setItemsProcessed(std::uint64_t items)
+	{
+		m_itemsProcessed = items;
+	}
+
+	std::uint64_t itemsProcessed() const
+	{
+		return m_itemsProcessed;
+	}
+
+	std::chrono::steady_clock::time_point startTime() const
+	{
+		return m_start;
+	}
+
+private:
+
+	std::uint64_t m_iterations{};
+	std::vector<std::int64_t> m_args{};
+	std::uint64_t m_itemsProcessed{};
+
+	std::chrono::steady_clock::time_point m_start{};
+};
+
+class Benchmark final
+{
+public:
+
+	using Function = std::function<void(BenchmarkState&)>;
+
+	Benchmark(std::string name, Function function)
+		: m_name{ std::move(name) }
+		, m_function{ std::move(function) }
+	{}
+
+	Benchmark* arg(std::int64_t value)
+	{
+		m_argSets.push_back({ value });
+		return this;
+	}
+
+	Benchmark* args(std::vector<std::int64_t> values)
+	{
+		m_argSets.push_back(std::move(values));
+		return this;
+	}
+
+	const std::string& name() const
+	{
+		return m_name;
+	}
+	const Function& function() const
+	{
+		return m_function;
+	}
+	const std::vector<std::vector<std::int64_t>>& argSets() const
+	{
+		return m_argSets;
+	}
+
+private:
+
+	std::string m_name{};
+	Function m_function{};
+	std::vector<std::vector<std::int64_t>> m_argSets{};
+};
+
+Benchmark* registerBenchmark(const std::string& name, Benchmark::Function function);
+
+// Runs every registered benchmark whose name contains filter. Results are
+// printed as a table and, if jsonPath is not empty, written as JSON so runs
+// can be diffed across commits.
+int runBenchmarks(const std::string& filter, double minTimeSeconds, const std::string& jsonPath);
+
+// Keeps the compiler from optimising away a result
+template <typename T>
+inline void doNotOptimize(const T& value)
+{
+#if defined(_MSC_VER)
+	static_cast<void>(*static_cast<const volatile char*>(static_cast<const volatile void*>(&value)));
+#else
+	asm volatile("" : : "r,m"(value) : "memory");
+#endif
+}
+
+#define BENCHMARK_CONCAT_INNER(a, b) a##b
+#define BENCHMARK_CONCAT(a, b) BENCHMARK_CONCAT_INNER(a, b)
+#define BENCHMARK(function) \
+	static Benchmark* BENCHMARK_CONCAT(benchmarkRegistration, __LINE__) [[maybe_unused]] \
+		= registerBenchmark(#function, function)
@@ -0,0 +1,544 @@
+// CPU microbenchmarks for the asset, animation, lighting, entity and crowd paths. None of these need a
+// GL context, so they run anywhere and isolate the code from the driver.
+//
+//   iklob_microbench [--filter substring] [--min-time seconds] [--json file]
+
+#include "micro_benchmark.hpp"
+
+#include "../crowd/crowd.hpp"
+#include "../entity_system/components.hpp"
+#include "../entity_system/registry.hpp"
+#include "../entity_system/transform_hierarchy.hpp"
+#include "../hitboxes/hitbox_scene.hpp"
+#include "../jobs/job_system.hpp"
+#include "../navigation/flow_field.hpp"
+#include "../navigation/nav_grid.hpp"
+#include "../renderer/animation.hpp"
+#include "../renderer/cooked_model.hpp"
+#include "../renderer/glb_file.hpp"
+#include "../renderer/light_clusters.hpp"
+#include "../renderer/model_loader.hpp"
+#include "../renderer/renderer.hpp"
+
+#include "glad/glad.h"
+#include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+#include "glm/gtc/quaternion.hpp"
+#include "tinygltf/json.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	const char* const modelPath{ "assets/zombie.glb" };
+
+	Renderer::AnimationSampler makeSampler(Renderer::AnimationSampler::Path path, int keyframeCount, int seed)
+	{
+		Renderer::AnimationSampler sampler{ path };
+		sampler.input.reserve(keyframeCount);
+		sampler.output.reserve(keyframeCount);
+
+		for (int i{ 0 }; i < keyframeCount; ++i)
+		{
+			const float t{ static_cast<float>(i) / (keyframeCount - 1) };
+			sampler.input.push_back(t);
+
+			const float phase{ t * 6.2831853f + seed * 0.37f };
+			switch (path)
+			{
+			case Renderer::AnimationSampler::TRANSLATION:
+				sampler.output.push_back({ 0.0f, 0.1f * std::sin(phase), 0.0f, 0.0f });
+				break;
+
+			case Renderer::AnimationSampler::ROTATION:
+			{
+				const glm::quat quat{ glm::angleAxis(0.5f * std::sin(phase), glm::vec3{ 0.0f, 0.0f, 1.0f }) };
+				sampler.output.push_back({ quat.x, quat.y, quat.z, quat.w });
+				break;
+			}
+
+			case Renderer::AnimationSampler::SCALE:
+				sampler.output.push_back({ 1.0f, 1.0f, 1.0f, 0.0f });
+				break;
+			}
+		}
+
+		return sampler;
+	}
+
+	// Binary tree of joints, each animated on all three paths, which is roughly
+	// the shape of an exported humanoid skeleton
+	Renderer::Mesh makeSkeleton(int jointCount, int keyframeCount)
+	{
+		Renderer::Mesh mesh{};
+		mesh.joints.resize(jointCount);
+		mesh.maxTime = 1.0;
+
+		for (int i{ 0 }; i < jointCount; ++i)
+		{
+			Renderer::Joint& joint{ mesh.joints[i] };
+			joint.nodeIndex = i;
+			joint.transform = glm::mat4{ 1.0f };
+			joint.inverseBindMatrix = glm::translate(glm::mat4{ 1.0f }, glm::vec3{ 0.0f, -0.1f * i, 0.0f });
+
+			if (i > 0)
+			{
+				joint.hasJointParent = true;
+				mesh.joints[(i - 1) / 2].children.push_back(i);
+			}
+
+			for (auto path : { Renderer::AnimationSampler::TRANSLATION,
+				Renderer::AnimationSampler::ROTATION, Renderer::AnimationSampler::SCALE })
+			{
+				joint.animationSamplers.insert({ path, makeSampler(path, keyframeCount, i) });
+			}
+		}
+
+		return mesh;
+	}
+
+	// Steps the time by an amount that doesn't line up with keyframes, so the
+	// interpolating branch is what gets measured
+	double nextTime(double time, double maxTime)
+	{
+		time += 0.0173;
+		return time > maxTime ? time - maxTime : time;
+	}
+
+
+	void BM_determineSamplerOutput(BenchmarkState& state)
+	{
+		const auto keyframeCount{ static_cast<int>(state.range(0)) };
+		const Renderer::AnimationSampler sampler{ makeSampler(Renderer::AnimationSampler::ROTATION, keyframeCount, 0) };
+
+		double time{ 0.0 };
+		for (auto _ : state)
+		{
+			doNotOptimize(determineSamplerOutput(sampler, time, 1.0));
+			time = nextTime(time, 1.0);
+		}
+
+		state.setItemsProcessed(state.iterations());
+	}
+	BENCHMARK(BM_determineSamplerOutput)->arg(8)->arg(32)->arg(128)->arg(512);
+
+	void BM_calculateJointLocalTransform(BenchmarkState& state)
+	{
+		const Renderer::Mesh mesh{ makeSkeleton(1, static_cast<int>(state.range(0))) };
+
+		double time{ 0.0 };
+		for (auto _ : state)
+		{
+			doNotOptimize(calculateJointLocalTransform(mesh.joints[0], time, mesh.maxTime));
+			time = nextTime(time, mesh.maxTime);
+		}
+
+		state.setItemsProcessed(state.iterations());
+	}
+	BENCHMARK(BM_calculateJointLocalTransform)->arg(8)->arg(32)->arg(128);
+
+	// Whole palette: local transforms, hierarchy walk and inverse bind matrices
+	void BM_calculateJointMatrix(BenchmarkState& state)
+	{
+		const auto jointCount{ static_cast<int>(state.range(0)) };
+		Renderer::Mesh mesh{ makeSkeleton(jointCount, static_cast<int>(state.range(1))) };
+		std::vector<glm::mat4> palette(mesh.joints.size());
+
+		for (auto _ : state)
+		{
+			calculateJointMatrix(mesh, palette.data());
+			doNotOptimize(palette);
+			mesh.time = nextTime(mesh.time, mesh.maxTime);
+		}
+
+		state.setItemsProcessed(state.iterations() * jointCount);
+	}
+	BENCHMARK(BM_calculateJointMatrix)
+		->args({ 16, 32 })->args({ 64, 32 })->args({ 128, 32 })
+		->args({ 64, 8 })->args({ 64, 128 });
+
+	// Full file load: parse, geometry, skin, animation and image decode
+	void BM_loadModel(BenchmarkState& state)
+	{
+		std::uint64_t vertexCount{};
+
+		for (auto _ : state)
+		{
+			std::vector<Renderer::Vertex> vertices{};
+			std::vector<GLuint> indices{};
+			std::vector<StagedTexture> textures{};
+
+			doNotOptimize(loadModel(modelPath, vertices, indices, textures));
+			vertexCount += vertices.size();
+		}
+
+		state.setItemsProcessed(vertexCount);
+	}
+	BENCHMARK(BM_loadModel);
+
+	// Vertex and index conversion only, from an already mapped and parsed file
+	void BM_loadPrimitive(BenchmarkState& state)
+	{
+		const GlbFile file{ modelPath };
+		if (!file.valid())
+		{
+			std::cerr << "BENCHMARK: ERROR: Could not load " << modelPath << '\n';
+			for (auto _ : state) {}
+			return;
+		}
+
+		std::vector<Renderer::Vertex> vertices{};
+		std::vector<GLuint> indices{};
+		std::uint64_t vertexCount{};
+
+		for (auto _ : state)
+		{
+			vertices.clear();
+			indices.clear();
+
+			for (const auto& mesh : jsonArray(file.json(), "meshes"))
+			{
+				for (const auto& primitive : jsonArray(mesh, "primitives"))
+				{
+					doNotOptimize(loadPrimitive(file, primitive, glm::mat4{ 1.0f }, vertices, indices));
+				}
+			}
+
+			vertexCount += vertices.size();
+		}
+
+		state.setItemsProcessed(vertexCount);
+	}
+	BENCHMARK(BM_loadPrimitive);
+
+	// Mapping a cooked package and rebuilding its tables; the geometry itself
+	// is only copied later, by the GL upload
+	void BM_loadCookedModel(BenchmarkState& state)
+	{
+		const std::string cookedPath{ (std::filesystem::temp_directory_path() / "iklob_microbench.ikmesh").string() };
+		if (!cookModel(modelPath, cookedPath))
+		{
+			for (auto _ : state) {}
+			return;
+		}
+
+		std::uint64_t vertexCount{};
+
+		for (auto _ : state)
+		{
+			const CookedModel model{ cookedPath };
+
+			doNotOptimize(model.mesh());
+			doNotOptimize(model.textures());
+			vertexCount += model.vertices().size();
+		}
+
+		state.setItemsProcessed(vertexCount);
+
+		std::filesystem::remove(cookedPath);
+	}
+	BENCHMARK(BM_loadCookedModel);
+
+	// The CPU phase of Renderer::loadScene for several models, one after
+	// another (second argument 0) or fanned out over the job system (1)
+	void BM_stageModels(BenchmarkState& state)
+	{
+		const auto modelCount{ static_cast<int>(state.range(0)) };
+		const bool parallel{ state.range(1) != 0 };
+
+		JobSystem jobSystem{};
+		std::vector<StagedModel> models(modelCount);
+
+		for (auto _ : state)
+		{
+			if (parallel)
+			{
+				JobCounter counter{};
+				for (int i{ 0 }; i < modelCount; ++i)
+				{
+					jobSystem.schedule([&models, &jobSystem, i]() {
+						models[i] = stageModel(modelPath, &jobSystem);
+					}, &counter);
+				}
+				jobSystem.wait(counter);
+			}
+			else
+			{
+				for (int i{ 0 }; i < modelCount; ++i)
+				{
+					models[i] = stageModel(modelPath);
+				}
+			}
+
+			doNotOptimize(models);
+		}
+
+		state.setItemsProcessed(state.iterations() * modelCount);
+	}
+	BENCHMARK(BM_stageModels)->args({ 1, 0 })->args({ 1, 1 })->args({ 4, 0 })->args({ 4, 1 });
+
+	// Light binning for a camera looking into a field of small lights, on
+	// the calling thread (second argument 0) or on the job system (1)
+	void BM_assignLights(BenchmarkState& state)
+	{
+		const auto lightCount{ static_cast<int>(state.range(0)) };
+		const bool parallel{ state.range(1) != 0 };
+
+		std::vector<PointLight> lights{};
+		for (int i{ 0 }; i < lightCount; ++i)
+		{
+			// Deterministic scatter over a 100 x 10 x 100 box in front of
+			// the camera
+			const float u{ std::fmod(i * 0.618034f, 1.0f) };
+			const float v{ std::fmod(i * 0.754878f, 1.0f) };
+			const float w{ std::fmod(i * 0.569840f, 1.0f) };
+			lights.push_back(PointLight{ { (u - 0.5f) * 100.0f, v * 10.0f, -w * 100.0f }, 3.0f });
+		}
+
+		const glm::mat4 view{ glm::lookAt(glm::vec3{ 0.0f, 2.0f, 5.0f }, glm::vec3{ 0.0f, 2.0f, 0.0f },
+			glm::vec3{ 0.0f, 1.0f, 0.0f }) };
+
+		JobSystem jobSystem{};
+		LightClusters clusters{};
+
+		for (auto _ : state)
+		{
+			assignLights(clusters, lights, view, 90.0f, 16.0f / 9.0f, 0.1f, 500.0f, parallel ? &jobSystem : nullptr);
+			doNotOptimize(clusters);
+		}
+
+		state.setItemsProcessed(state.iterations() * lightCount);
+	}
+	BENCHMARK(BM_assignLights)->args({ 64, 0 })->args({ 1024, 0 })->args({ 1024, 1 })->args({ 8192, 1 });
+
+	// Stand-in for a component systems update every tick
+	struct Motion
+	{
+		glm::vec3 position{};
+		glm::vec3 velocity{};
+	};
+
+	// A system walking entities with a mesh and motion, where every second
+	// entity has no mesh
+	void BM_registryEach(BenchmarkState& state)
+	{
+		const auto entityCount{ static_cast<int>(state.range(0)) };
+
+		Registry registry{};
+		for (int i{ 0 }; i < entityCount; ++i)
+		{
+			const Entity entity{ registry.create() };
+			registry.add(entity, Motion{ glm::vec3{ static_cast<float>(i) }, glm::vec3{ 1.0f } });
+			if (i % 2 == 0)
+			{
+				registry.add(entity, MeshRenderer{ MeshHandle{ 0, 1 } });
+			}
+		}
+
+		for (auto _ : state)
+		{
+			registry.each<MeshRenderer, Motion>([&](Entity, const MeshRenderer&, Motion& motion)
+				{
+					motion.position += motion.velocity * (1.0f / 60.0f);
+				});
+			doNotOptimize(registry);
+		}
+
+		state.setItemsProcessed(state.iterations() * (entityCount + 1) / 2);
+	}
+	BENCHMARK(BM_registryEach)->arg(1024)->arg(16384)->arg(65536);
+
+	// World matrix update for roots with 7 children each, moving one root
+	// per iteration (second argument 0) or all of them (1)
+	void BM_transformHierarchy(BenchmarkState& state)
+	{
+		const auto nodeCount{ static_cast<int>(state.range(0)) };
+		const bool moveAll{ state.range(1) != 0 };
+
+		Registry registry{};
+		TransformHierarchy transforms{};
+		std::vector<Entity> roots{};
+
+		for (int i{ 0 }; i < nodeCount / 8; ++i)
+		{
+			const Entity root{ registry.create() };
+			transforms.add(root, {}, glm::vec3{ static_cast<float>(i), 0.0f, 0.0f });
+			roots.push_back(root);
+
+			for (int child{ 0 }; child < 7; ++child)
+			{
+				transforms.add(registry.create(), root, glm::vec3{ 0.0f, static_cast<float>(child), 0.0f },
+					glm::angleAxis(0.1f * child, glm::vec3{ 0.0f, 1.0f, 0.0f }), glm::vec3{ 0.5f });
+			}
+		}
+		transforms.update();
+
+		std::size_t next{};
+		for (auto _ : state)
+		{
+			if (moveAll)
+			{
+				for (const Entity root : roots)
+				{
+					transforms.setTranslation(root, transforms.translation(root) + glm::vec3{ 0.0f, 0.0f, 0.01f });
+				}
+			}
+			else
+			{
+				const Entity root{ roots[next++ % roots.size()] };
+				transforms.setTranslation(root, transforms.translation(root) + glm::vec3{ 0.0f, 0.0f, 0.01f });
+			}
+
+			transforms.update();
+			doNotOptimize(transforms.worlds());
+		}
+
+		state.setItemsProcessed(state.iterations() * transforms.size());
+	}
+	BENCHMARK(BM_transformHierarchy)->args({ 16384, 0 })->args({ 16384, 1 })->args({ 65536, 1 });
+
+	// One steering step of a horde packed around a target it is converging
+	// on, on the calling thread (second argument 0) or on the job system (1)
+	void BM_crowdUpdate(BenchmarkState& state)
+	{
+		const auto agentCount{ static_cast<int>(state.range(0)) };
+		const bool parallel{ state.range(1) != 0 };
+
+		Crowd crowd{};
+		for (int i{ 0 }; i < agentCount; ++i)
+		{
+			const float angle{ i * 2.3999632f };
+			const float distance{ 0.8f * std::sqrt(static_cast<float>(i)) };
+			crowd.spawn(glm::vec3{ std::cos(angle) * distance, 0.0f, std::sin(angle) * distance });
+		}
+
+		JobSystem jobSystem{};
+
+		for (auto _ : state)
+		{
+			crowd.update(glm::vec3{ 0.0f }, 1.0f / 60.0f, parallel ? &jobSystem : nullptr);
+			doNotOptimize(crowd);
+		}
+
+		state.setItemsProcessed(state.iterations() * agentCount);
+	}
+	BENCHMARK(BM_crowdUpdate)->args({ 1024, 0 })->args({ 8192, 0 })->args({ 8192, 1 })->args({ 32768, 1 });
+
+	// A full flow field search on a square grid of the given side, walled
+	// into corridors with a gap at alternating ends, towards targets in
+	// opposite corners by turns
+	void BM_flowField(BenchmarkState& state)
+	{
+		const auto side{ static_cast<int>(state.range(0)) };
+
+		NavGrid grid{};
+		grid.reset(side, side, glm::vec2{ 0.0f }, 0.5f, 0.4f);
+		for (int z{ 0 }; z < side; ++z)
+		{
+			for (int x{ 0 }; x < side; ++x)
+			{
+				const bool wall{ x % 8 == 7 && (x / 8 % 2 == 0 ? z < side - 2 : z > 1) };
+				grid.setCell(x, z, !wall, 0.0f);
+			}
+		}
+
+		FlowField flowField{ grid };
+		const glm::vec3 targets[2]{ grid.cellCentre(0, 0), grid.cellCentre(side - 1, side - 1) };
+
+		std::size_t turn{};
+		for (auto _ : state)
+		{
+			flowField.setTarget(targets[turn++ % 2]);
+			flowField.update(grid.cellCount());
+			doNotOptimize(flowField);
+		}
+
+		state.setItemsProcessed(state.iterations() * grid.cellCount());
+	}
+	BENCHMARK(BM_flowField)->arg(64)->arg(256)->arg(512);
+
+	// A batch of shots (second argument) from around the edge of a square
+	// packed with instances (first argument), each with a skeleton's worth
+	// of hitboxes, towards random points inside it
+	void BM_hitboxRaycast(BenchmarkState& state)
+	{
+		const auto instanceCount{ static_cast<std::size_t>(state.range(0)) };
+		const auto rayCount{ static_cast<std::size_t>(state.range(1)) };
+
+		// Limbs of a standing figure, one joint each
+		std::vector<Renderer::Hitbox> hitboxes{};
+		std::vector<glm::mat4> palette{};
+		for (int i{ 0 }; i < 16; ++i)
+		{
+			const float side{ i % 2 == 0 ? -1.0f : 1.0f };
+			hitboxes.push_back(Renderer::Hitbox{ i, glm::vec3{ side * 0.05f * (i / 2), 0.2f * (i / 2), 0.0f },
+				glm::vec3{ side * 0.05f * (i / 2 + 1), 0.2f * (i / 2 + 1), 0.0f }, 0.12f });
+			palette.push_back(glm::rotate(glm::mat4{ 1.0f }, 0.1f * i, glm::vec3{ 1.0f, 0.0f, 0.0f }));
+		}
+
+		HitboxScene scene{};
+		scene.pose(hitboxes, palette.data(), palette.size());
+
+		const float extent{ std::sqrt(static_cast<float>(instanceCount)) * 1.5f };
+
+		std::vector<glm::mat4> transforms(instanceCount);
+		std::uint32_t seed{ 1 };
+		const auto random{ [&seed]() {
+			seed = seed * 1664525u + 1013904223u;
+			return static_cast<float>(seed >> 8) / 16777216.0f;
+			} };
+		for (glm::mat4& transform : transforms)
+		{
+			transform = glm::rotate(glm::translate(glm::mat4{ 1.0f }, glm::vec3{ random() * extent, 0.0f, random() * extent }),
+				random() * 6.2831853f, glm::vec3{ 0.0f, 1.0f, 0.0f });
+		}
+		scene.setInstances(transforms.data(), transforms.size());
+
+		std::vector<HitboxScene::Ray> rays(rayCount);
+		for (HitboxScene::Ray& ray : rays)
+		{
+			const float angle{ random() * 6.2831853f };
+			ray.origin = glm::vec3{ extent * 0.5f + std::cos(angle) * extent, 1.0f, extent * 0.5f + std::sin(angle) * extent };
+			ray.direction = glm::normalize(glm::vec3{ random() * extent, 0.2f + random(), random() * extent } - ray.origin);
+			ray.maxDistance = 4.0f * extent;
+		}
+
+		std::vector<HitboxScene::Hit> hits(rayCount);
+
+		for (auto _ : state)
+		{
+			scene.raycast(rays.data(), hits.data(), rays.size());
+			doNotOptimize(hits);
+		}
+
+		state.setItemsProcessed(state.iterations() * rayCount);
+	}
+	BENCHMARK(BM_hitboxRaycast)->args({ 100, 64 })->args({ 1000, 64 })->args({ 10000, 64 });
+}
+
+
+int main(int argc, char* argv[])
+{
+	std::string filter{};
+	double minTime{ 0.5 };
+	std::string json{};
+
+	for (int i{ 1 }; i + 1 < argc; i += 2)
+	{
+		const std::string argument{ argv[i] };
+		const std::string value{ argv[i + 1] };
+
+		if (argument == "--filter")        filter = value;
+		else if (argument == "--min-time") minTime = std::atof(value.c_str());
+		else if (argument == "--json")     json = value;
+		else std::cerr << "BENCHMARK: WARNING: Ignoring unknown argument " << argument << '\n';
+	}
+
+	return runBenchmarks(filter, minTime, json);
+}
@@ -0,0 +1,229 @@
+#include "offscreen_context.hpp"
+
+#include "glad/glad.h"
+
+#if defined(IKLOB_USE_EGL)
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#else
+#define SDL_MAIN_HANDLED
+#include "SDL/SDL.h"
+#endif
+
+#include <cstring>
+#include <iostream>
+
+#if defined(IKLOB_USE_EGL)
+
+namespace
+{
+	void* eglLoadProc(const char* name)
+	{
+		return reinterpret_cast<void*>(eglGetProcAddress(name));
+	}
+
+	bool hasExtension(const char* extensions, const char* extension)
+	{
+		return extensions && std::strstr(extensions, extension);
+	}
+}
+
+OffscreenContext::OffscreenContext(int width, int height)
+	: m_width{ width }
+	, m_height{ height }
+{
+	EGLDisplay display{ EGL_NO_DISPLAY };
+
+	const char* clientExtensions{ eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS) };
+	if (hasExtension(clientExtensions, "EGL_MESA_platform_surfaceless"))
+	{
+		auto getPlatformDisplay{ reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+			eglGetProcAddress("eglGetPlatformDisplayEXT")) };
+		if (getPlatformDisplay)
+		{
+			display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+		}
+	}
+	if (display == EGL_NO_DISPLAY)
+	{
+		display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr))
+	{
+		std::cerr << "OFFSCREEN CONTEXT: ERROR: No EGL display\n";
+		return;
+	}
+	m_display = display;
+
+	eglBindAPI(EGL_OPENGL_API);
+
+	const EGLint configAttributes[]
+	{
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE, 8,
+		EGL_GREEN_SIZE, 8,
+		EGL_BLUE_SIZE, 8,
+		EGL_NONE,
+	};
+	EGLConfig config{};
+	EGLint configCount{};
+	if (!eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0)
+	{
+		// Surfaceless displays may expose no pbuffer configs at all
+		const EGLint anyConfig[]{ EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+		eglChooseConfig(display, anyConfig, &config, 1, &configCount);
+	}
+
+	// Prefer 4.6, but llvmpipe tops out at 4.5
+	for (EGLint minor : { 6, 5 })
+	{
+		const EGLint contextAttributes[]
+		{
+			EGL_CONTEXT_MAJOR_VERSION, 4,
+			EGL_CONTEXT_MINOR_VERSION, minor,
+			EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+			EGL_NONE,
+		};
+
+		EGLContext context{ eglCreateContext(display, configCount > 0 ? config : nullptr,
+			EGL_NO_CONTEXT, contextAttributes) };
+		if (context != EGL_NO_CONTEXT)
+		{
+			m_context = context;
+			break;
+		}
+	}
+	if (!m_context)
+	{
+		std::cerr << "OFFSCREEN CONTEXT: ERROR: Could not create a GL 4.5 core context\n";
+		return;
+	}
+
+	EGLSurface surface{ EGL_NO_SURFACE };
+	if (!hasExtension(eglQueryString(display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context"))
+	{
+		const EGLint pbufferAttributes[]{ EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+		surface = eglCreatePbufferSurface(display, config, pbufferAttributes);
+	}
+	m_surface = surface;
+
+	m_valid = eglMakeCurrent(display, surface, surface, static_cast<EGLContext>(m_context));
+	if (!m_valid)
+	{
+		std::cerr << "OFFSCREEN CONTEXT: ERROR: eglMakeCurrent failed\n";
+	}
+}
+
+OffscreenContext::~OffscreenContext()
+{
+	if (m_valid && m_framebuffer)
+	{
+		glDeleteFramebuffers(1, &m_framebuffer);
+		glDeleteRenderbuffers(1, &m_colorBuffer);
+		glDeleteRenderbuffers(1, &m_depthBuffer);
+	}
+
+	if (m_display)
+	{
+		eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		if (m_surface)
+		{
+			eglDestroySurface(m_display, m_surface);
+		}
+		if (m_context)
+		{
+			eglDestroyContext(m_display, m_context);
+		}
+		eglTerminate(m_display);
+	}
+}
+
+GLADloadproc OffscreenContext::loadProc() const
+{
+	return eglLoadProc;
+}
+
+#else
+
+OffscreenContext::OffscreenContext(int width, int height)
+	: m_width{ width }
+	, m_height{ height }
+{
+	SDL_Init(SDL_INIT_VIDEO);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 6);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+
+	SDL_Window* window{ SDL_CreateWindow("iklob benchmark", 0, 0, 1, 1, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN) };
+	if (!window)
+	{
+		std::cerr << "OFFSCREEN CONTEXT: ERROR: " << SDL_GetError() << '\n';
+		return;
+	}
+	m_surface = window;
+
+	m_context = SDL_GL_CreateContext(window);
+	if (!m_context)
+	{
+		std::cerr << "OFFSCREEN CONTEXT: ERROR: " << SDL_GetError() << '\n';
+		return;
+	}
+
+	m_valid = (SDL_GL_MakeCurrent(window, m_context) == 0);
+
+	// Measure the renderer, not the display's refresh rate
+	SDL_GL_SetSwapInterval(0);
+}
+
+OffscreenContext::~OffscreenContext()
+{
+	if (m_valid && m_framebuffer)
+	{
+		glDeleteFramebuffers(1, &m_framebuffer);
+		glDeleteRenderbuffers(1, &m_colorBuffer);
+		glDeleteRenderbuffers(1, &m_depthBuffer);
+	}
+
+	if (m_context)
+	{
+		SDL_GL_DeleteContext(m_context);
+	}
+	if (m_surface)
+	{
+		SDL_DestroyWindow(static_cast<SDL_Window*>(m_surface));
+	}
+
+	SDL_Quit();
+}
+
+GLADloadproc OffscreenContext::loadProc() const
+{
+	return SDL_GL_GetProcAddress;
+}
+
+#endif
+
+void OffscreenContext::createFramebuffer()
+{
+	glCreateRenderbuffers(1, &m_colorBuffer);
+	glNamedRenderbufferStorage(m_colorBuffer, GL_RGBA8, m_width, m_height);
+
+	glCreateRenderbuffers(1, &m_depthBuffer);
+	glNamedRenderbufferStorage(m_depthBuffer, GL_DEPTH_COMPONENT24, m_width, m_height);
+
+	glCreateFramebuffers(1, &m_framebuffer);
+	glNamedFramebufferRenderbuffer(m_framebuffer, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_colorBuffer);
+	glNamedFramebufferRenderbuffer(m_framebuffer, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthBuffer);
+
+	if (glCheckNamedFramebufferStatus(m_framebuffer, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cerr << "OFFSCREEN CONTEXT: ERROR: Framebuffer incomplete\n";
+	}
+}
+
+void OffscreenContext::bindFramebuffer()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "glad/glad.h"
+
+// A GL 4.5+ core context with no visible window, plus a framebuffer to
+// render into since such contexts have no usable default framebuffer.
+//
+// With IKLOB_USE_EGL defined the context comes from EGL, preferring a
+// surfaceless display and falling back to a 1x1 pbuffer, which is what
+// Mesa's llvmpipe offers on headless CI machines. Otherwise a hidden SDL
+// window is used.
+class OffscreenContext final
+{
+public:
+
+	OffscreenContext(int width, int height);
+	~OffscreenContext();
+
+	OffscreenContext(const OffscreenContext&) = delete;
+	OffscreenContext& operator=(const OffscreenContext&) = delete;
+
+	bool valid() const
+	{
+		return m_valid;
+	}
+
+	GLADloadproc loadProc() const;
+
+	// Creates the render target. Needs GL functions, so call it after
+	// they have been loaded through loadProc().
+	void createFramebuffer();
+	void bindFramebuffer();
+
+	int width() const
+	{
+		return m_width;
+	}
+	int height() const
+	{
+		return m_height;
+	}
+
+private:
+
+	int m_width{};
+	int m_height{};
+
+	bool m_valid{ false };
+
+	// EGLDisplay/EGLSurface/EGLContext or SDL_Window*/SDL_GLContext,
+	// kept opaque so this header doesn't drag in either API
+	void* m_display{};
+	void* m_surface{};
+	void* m_context{};
+
+	GLuint m_framebuffer{};
+	GLuint m_colorBuffer{};
+	GLuint m_depthBuffer{};
+};
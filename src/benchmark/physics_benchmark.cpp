@@ -0,0 +1,339 @@
+// Headless PhysX scalability benchmark. Fills a scene with static level
+// colliders, dynamic bodies dropped onto them and character controllers
+// walking in circles, steps it a fixed number of ticks under each broadphase
+// and prints per-tick timings and PhysX memory as JSON. The fastest broadphase goes into the
+// engine's --broadphase.
+//
+//   iklob_physbench [--statics N] [--dynamics N] [--controllers N]
+//                   [--ticks N] [--warmup N] [--workers N]
+//                   [--broadphase sap|mbp|abp|all] [--mbp-subdivisions N]
+//                   [--output file]
+//
+// Every broadphase sees exactly the same scene, generated from a fixed seed.
+
+#include "statistics.hpp"
+
+#include "../jobs/job_system.hpp"
+#include "../memory/memory_tracker.hpp"
+#include "../physics/broadphase.hpp"
+#include "../physics/job_cpu_dispatcher.hpp"
+#include "../physics/tracking_allocator.hpp"
+
+#include "PxPhysicsAPI.h"
+
+#include <algorithm> // for std::max
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <numeric> // for std::accumulate
+#include <ostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+	struct Options
+	{
+		int statics{ 2000 };
+		int dynamics{ 2000 };
+		int controllers{ 100 };
+		int ticks{ 600 };
+		int warmup{ 60 };
+		// 0 sizes the pool to the machine, like the engine
+		int workers{ 0 };
+		// Every broadphase unless --broadphase names one
+		std::vector<Broadphase> broadphases{ Broadphase::sap, Broadphase::mbp, Broadphase::abp };
+		std::uint32_t mbpSubdivisions{ BroadphaseSettings{}.mbpSubdivisions };
+		std::string output{};
+	};
+
+	Options parseOptions(int argc, char* argv[])
+	{
+		Options options{};
+
+		for (int i{ 1 }; i + 1 < argc; i += 2)
+		{
+			const std::string argument{ argv[i] };
+			const std::string value{ argv[i + 1] };
+
+			if (argument == "--statics")          options.statics = std::atoi(value.c_str());
+			else if (argument == "--dynamics")    options.dynamics = std::atoi(value.c_str());
+			else if (argument == "--controllers") options.controllers = std::atoi(value.c_str());
+			else if (argument == "--ticks")       options.ticks = std::atoi(value.c_str());
+			else if (argument == "--warmup")      options.warmup = std::atoi(value.c_str());
+			else if (argument == "--workers")     options.workers = std::atoi(value.c_str());
+			else if (argument == "--mbp-subdivisions")
+			{
+				options.mbpSubdivisions = static_cast<std::uint32_t>(std::max(std::atoi(value.c_str()), 1));
+			}
+			else if (argument == "--broadphase")
+			{
+				Broadphase broadphase{};
+				if (parseBroadphase(value, broadphase))
+				{
+					options.broadphases = { broadphase };
+				}
+				else if (value != "all")
+				{
+					std::cerr << "PHYSICS BENCHMARK: WARNING: Unknown broadphase " << value << ", running all\n";
+				}
+			}
+			else if (argument == "--output") options.output = value;
+			else std::cerr << "PHYSICS BENCHMARK: WARNING: Ignoring unknown argument " << argument << '\n';
+		}
+
+		return options;
+	}
+
+	struct RunResult
+	{
+		Broadphase broadphase{};
+		std::uint32_t regions{};
+		double setupMs{};
+		// PhysX heap held by the scene after the last tick
+		std::int64_t sceneBytes{};
+		std::vector<double> stepTimes{};
+		std::vector<double> controllerTimes{};
+		std::vector<double> activeActors{};
+	};
+
+	double millisecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	double mean(const std::vector<double>& samples)
+	{
+		return samples.empty() ? 0.0 : std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+	}
+
+	// Static boxes on a square grid stand in for the level: walls, crates and
+	// pillars of assorted sizes on a ground slab. Dynamic boxes and spheres
+	// rain down over the same area, so the run covers bodies settling and
+	// going to sleep. Controllers start scattered above the ground.
+	void populate(physx::PxPhysics& physics, physx::PxScene& scene, physx::PxMaterial& material,
+		const Options& options, float areaSide)
+	{
+		std::mt19937 random{ 1 };
+		const auto uniform{ [&](float min, float max) {
+			return std::uniform_real_distribution<float>{ min, max }(random);
+			} };
+
+		const float halfArea{ areaSide * 0.5f };
+
+		physx::PxRigidStatic* ground{ physics.createRigidStatic(physx::PxTransform{ physx::PxVec3{ 0.0f, -1.0f, 0.0f } }) };
+		physx::PxRigidActorExt::createExclusiveShape(*ground,
+			physx::PxBoxGeometry{ halfArea + 10.0f, 1.0f, halfArea + 10.0f }, material);
+		scene.addActor(*ground);
+
+		const int gridSide{ static_cast<int>(std::ceil(std::sqrt(static_cast<double>(std::max(options.statics, 1))))) };
+		const float spacing{ areaSide / gridSide };
+
+		for (int i{ 0 }; i < options.statics; ++i)
+		{
+			const physx::PxVec3 halfExtents{ uniform(0.3f, 1.2f), uniform(0.3f, 2.0f), uniform(0.3f, 1.2f) };
+			const physx::PxTransform pose{
+				physx::PxVec3{
+					(i % gridSide + 0.5f) * spacing - halfArea,
+					halfExtents.y,
+					(i / gridSide + 0.5f) * spacing - halfArea },
+				physx::PxQuat{ uniform(0.0f, physx::PxTwoPi), physx::PxVec3{ 0.0f, 1.0f, 0.0f } } };
+
+			physx::PxRigidStatic* actor{ physics.createRigidStatic(pose) };
+			physx::PxRigidActorExt::createExclusiveShape(*actor, physx::PxBoxGeometry{ halfExtents }, material);
+			scene.addActor(*actor);
+		}
+
+		for (int i{ 0 }; i < options.dynamics; ++i)
+		{
+			const physx::PxTransform pose{ physx::PxVec3{
+				uniform(-halfArea, halfArea), uniform(3.0f, 23.0f), uniform(-halfArea, halfArea) } };
+
+			physx::PxRigidDynamic* actor{ physics.createRigidDynamic(pose) };
+			if (i % 2 == 0)
+			{
+				const float halfExtent{ uniform(0.2f, 0.5f) };
+				physx::PxRigidActorExt::createExclusiveShape(*actor, physx::PxBoxGeometry{ physx::PxVec3{ halfExtent } }, material);
+			}
+			else
+			{
+				physx::PxRigidActorExt::createExclusiveShape(*actor, physx::PxSphereGeometry{ uniform(0.2f, 0.5f) }, material);
+			}
+			physx::PxRigidBodyExt::updateMassAndInertia(*actor, 1.0f);
+			scene.addActor(*actor);
+		}
+	}
+
+	RunResult run(physx::PxPhysics& physics, physx::PxCpuDispatcher& dispatcher, physx::PxMaterial& material,
+		const Options& options, Broadphase broadphase)
+	{
+		RunResult result{ .broadphase{ broadphase } };
+
+		const BroadphaseSettings settings{ .type{ broadphase }, .mbpSubdivisions{ options.mbpSubdivisions } };
+
+		// Same as the engine's scene, plus the active actor list
+		physx::PxSceneDesc sceneDesc{ physics.getTolerancesScale() };
+		sceneDesc.gravity = physx::PxVec3(0.0f, -9.81f, 0.0f);
+		sceneDesc.cpuDispatcher = &dispatcher;
+		sceneDesc.filterShader = physx::PxDefaultSimulationFilterShader;
+		sceneDesc.flags |= physx::PxSceneFlag::eENABLE_ACTIVE_ACTORS;
+		applyBroadphase(sceneDesc, settings);
+
+		const std::int64_t bytesBefore{ MemoryTracker::stats(MemoryTracker::PHYSICS).liveBytes };
+		physx::PxScene* scene{ physics.createScene(sceneDesc) };
+		physx::PxControllerManager* controllerManager{ PxCreateControllerManager(*scene) };
+
+		// Keep the density of statics roughly constant as their count grows
+		const float areaSide{ std::max(std::sqrt(static_cast<float>(options.statics)) * 4.0f, 20.0f) };
+
+		const auto setupStart{ std::chrono::steady_clock::now() };
+
+		populate(physics, *scene, material, options, areaSide);
+		result.regions = addBroadphaseRegions(*scene, settings);
+
+		std::mt19937 random{ 2 };
+		std::uniform_real_distribution<float> coordinate{ -areaSide * 0.5f, areaSide * 0.5f };
+
+		std::vector<physx::PxController*> controllers{};
+		for (int i{ 0 }; i < options.controllers; ++i)
+		{
+			// Same shape as the player's
+			physx::PxCapsuleControllerDesc controllerDesc{};
+			controllerDesc.radius = 0.5f;
+			controllerDesc.height = 1.5f;
+			controllerDesc.position = physx::PxExtendedVec3{ coordinate(random), 3.0f, coordinate(random) };
+			controllerDesc.material = &material;
+			controllers.push_back(controllerManager->createController(controllerDesc));
+		}
+
+		result.setupMs = millisecondsSince(setupStart);
+
+		constexpr float deltaTime{ 1.0f / 60.0f };
+		const physx::PxControllerFilters filters{};
+
+		for (int tick{ 0 }; tick < options.warmup + options.ticks; ++tick)
+		{
+			const auto controllerStart{ std::chrono::steady_clock::now() };
+
+			// Walk in circles at running speed, each on its own phase
+			for (std::size_t i{ 0 }; i < controllers.size(); ++i)
+			{
+				const float angle{ tick * deltaTime + i * 2.3999632f };
+				const physx::PxVec3 displacement{
+					std::cos(angle) * 4.0f * deltaTime, -9.81f * deltaTime, std::sin(angle) * 4.0f * deltaTime };
+				controllers[i]->move(displacement, 0.01f, deltaTime, filters);
+			}
+
+			const double controllerMs{ millisecondsSince(controllerStart) };
+
+			const auto stepStart{ std::chrono::steady_clock::now() };
+			scene->simulate(deltaTime);
+			scene->fetchResults(true);
+			const double stepMs{ millisecondsSince(stepStart) };
+
+			physx::PxU32 activeActorCount{};
+			scene->getActiveActors(activeActorCount);
+
+			if (tick >= options.warmup)
+			{
+				result.controllerTimes.push_back(controllerMs);
+				result.stepTimes.push_back(stepMs);
+				result.activeActors.push_back(activeActorCount);
+			}
+		}
+
+		result.sceneBytes = MemoryTracker::stats(MemoryTracker::PHYSICS).liveBytes - bytesBefore;
+
+		controllerManager->release();
+		scene->release();
+
+		return result;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const Options options{ parseOptions(argc, argv) };
+
+	TrackingAllocator allocator{};
+	physx::PxDefaultErrorCallback errorCallback{};
+
+	physx::PxFoundation* foundation{ PxCreateFoundation(PX_PHYSICS_VERSION, allocator, errorCallback) };
+	if (!foundation)
+	{
+		std::cerr << "PHYSICS BENCHMARK: ERROR: PxCreateFoundation failed\n";
+		return 1;
+	}
+
+	physx::PxTolerancesScale toleranceScale{};
+	toleranceScale.length = 1.0f;
+	toleranceScale.speed = 9.81f;
+
+	physx::PxPhysics* physics{ PxCreatePhysics(PX_PHYSICS_VERSION, *foundation, toleranceScale) };
+	physx::PxMaterial* material{ physics->createMaterial(0.5f, 0.5f, 0.6f) };
+
+	auto jobSystem{ options.workers > 0
+		? std::make_unique<JobSystem>(static_cast<unsigned>(options.workers)) : std::make_unique<JobSystem>() };
+	JobCpuDispatcher dispatcher{ *jobSystem };
+
+	std::vector<RunResult> results{};
+	for (Broadphase broadphase : options.broadphases)
+	{
+		results.push_back(run(*physics, dispatcher, *material, options, broadphase));
+	}
+
+	std::ofstream file{};
+	if (!options.output.empty())
+	{
+		file.open(options.output);
+	}
+	std::ostream& out{ file.is_open() ? file : std::cout };
+
+	// Controllers move serially between steps, so both count towards a tick
+	const RunResult* fastest{ nullptr };
+	for (const RunResult& result : results)
+	{
+		if (!fastest || mean(result.stepTimes) + mean(result.controllerTimes)
+			< mean(fastest->stepTimes) + mean(fastest->controllerTimes))
+		{
+			fastest = &result;
+		}
+	}
+
+	out << "{\n"
+		<< "  \"statics\": " << options.statics << ",\n"
+		<< "  \"dynamics\": " << options.dynamics << ",\n"
+		<< "  \"controllers\": " << options.controllers << ",\n"
+		<< "  \"ticks\": " << options.ticks << ",\n"
+		<< "  \"workers\": " << dispatcher.getWorkerCount() << ",\n"
+		<< "  \"mbpSubdivisions\": " << options.mbpSubdivisions << ",\n";
+
+	for (const RunResult& result : results)
+	{
+		const std::string name{ broadphaseName(result.broadphase) };
+
+		out << "  \"" << name << "Regions\": " << result.regions << ",\n"
+			<< "  \"" << name << "SetupMs\": " << result.setupMs << ",\n"
+			<< "  \"" << name << "SceneBytes\": " << result.sceneBytes << ",\n";
+		writeStatistics(out, (name + "StepMs").c_str(), result.stepTimes);
+		out << ",\n";
+		writeStatistics(out, (name + "ControllerMs").c_str(), result.controllerTimes);
+		out << ",\n";
+		writeStatistics(out, (name + "ActiveActors").c_str(), result.activeActors);
+		out << ",\n";
+	}
+
+	out << "  \"fastest\": \"" << (fastest ? broadphaseName(fastest->broadphase) : "") << "\"\n}\n";
+
+	material->release();
+	physics->release();
+	foundation->release();
+
+	return 0;
+}
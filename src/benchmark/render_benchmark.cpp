@@ -0,0 +1,234 @@
+// Headless end-to-end renderer benchmark. Loads a model, spawns a grid of
+// animated instances, flies a fixed camera path around them and prints
+// CPU and GPU frame time statistics as JSON.
+//
+//   iklob_bench [--instances N] [--frames N] [--warmup N] [--lights N]
+//               [--width W] [--height H] [--msaa N] [--target-frame-ms T]
+//               [--model path] [--output file]
+//
+// Dynamic resolution is off unless a target frame time is given, so runs
+// stay comparable.
+
+#include "offscreen_context.hpp"
+#include "statistics.hpp"
+
+#include "../io/json.hpp"
+#include "../jobs/job_system.hpp"
+#include "../memory/frame_arena.hpp"
+#include "../memory/memory_tracker.hpp"
+#include "../profiler/profiler.hpp"
+#include "../renderer/gl_resource_tracker.hpp"
+#include "../renderer/light_clusters.hpp"
+#include "../renderer/render_snapshot.hpp"
+#include "../renderer/renderer.hpp"
+
+#include "glad/glad.h"
+#include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+
+#include <algorithm> // for std::max
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	struct Options
+	{
+		int instances{ 64 };
+		int frames{ 600 };
+		int warmup{ 60 };
+		int lights{ 0 };
+		int width{ 1600 };
+		int height{ 900 };
+		int msaa{ 1 };
+		double targetFrameMs{ 0.0 };
+		std::string model{ "assets/zombie.glb" };
+		std::string output{};
+	};
+
+	Options parseOptions(int argc, char* argv[])
+	{
+		Options options{};
+
+		for (int i{ 1 }; i + 1 < argc; i += 2)
+		{
+			const std::string argument{ argv[i] };
+			const std::string value{ argv[i + 1] };
+
+			if (argument == "--instances")   options.instances = std::atoi(value.c_str());
+			else if (argument == "--frames") options.frames = std::atoi(value.c_str());
+			else if (argument == "--warmup") options.warmup = std::atoi(value.c_str());
+			else if (argument == "--lights") options.lights = std::atoi(value.c_str());
+			else if (argument == "--width")  options.width = std::atoi(value.c_str());
+			else if (argument == "--height") options.height = std::atoi(value.c_str());
+			else if (argument == "--msaa")   options.msaa = std::atoi(value.c_str());
+			else if (argument == "--target-frame-ms") options.targetFrameMs = std::atof(value.c_str());
+			else if (argument == "--model")  options.model = value;
+			else if (argument == "--output") options.output = value;
+			else std::cerr << "BENCHMARK: WARNING: Ignoring unknown argument " << argument << '\n';
+		}
+
+		return options;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const Options options{ parseOptions(argc, argv) };
+
+	OffscreenContext context{ options.width, options.height };
+	if (!context.valid())
+	{
+		return 1;
+	}
+
+	Renderer renderer{};
+	// No program cache, so runs neither reuse nor overwrite the game's binaries
+	renderer.init(context.loadProc(), "");
+	renderer.setViewport(options.width, options.height);
+	renderer.setMsaaSamples(options.msaa);
+	renderer.setDynamicResolution(options.targetFrameMs, 0.25f);
+
+	context.createFramebuffer();
+	context.bindFramebuffer();
+
+	JobSystem jobSystem{};
+	const MeshHandle meshHandle{ renderer.loadScene({ { options.model, "model" } }, jobSystem).front() };
+
+	Renderer::Mesh& mesh{ renderer.mesh(meshHandle) };
+
+	// Square grid centered on the origin
+	const int gridSide{ static_cast<int>(std::ceil(std::sqrt(static_cast<double>(options.instances)))) };
+	constexpr float spacing{ 2.5f };
+	const float gridExtent{ gridSide * spacing };
+
+	std::vector<glm::mat4> instanceTransforms{};
+	std::vector<double> instancePhases{};
+	for (int i{ 0 }; i < options.instances; ++i)
+	{
+		const glm::vec3 position{
+			(i % gridSide - (gridSide - 1) * 0.5f) * spacing,
+			0.0f,
+			(i / gridSide - (gridSide - 1) * 0.5f) * spacing };
+		instanceTransforms.push_back(glm::translate(glm::mat4{ 1.0f }, position));
+
+		// Desynchronise the instances so every palette is different
+		instancePhases.push_back(mesh.maxTime * i / std::max(options.instances, 1));
+	}
+
+	RenderSnapshot snapshot{};
+	snapshot.aspectRatio = static_cast<float>(options.width) / options.height;
+
+	std::vector<double> cpuFrameTimes{};
+	std::vector<double> gpuFrameTimes{};
+	std::vector<double> renderScales{};
+	std::uint64_t draws{};
+	std::uint64_t triangles{};
+
+	constexpr double deltaTime{ 1.0 / 60.0 };
+	const int totalFrames{ options.warmup + options.frames };
+
+	for (int frame{ 0 }; frame < totalFrames; ++frame)
+	{
+		const auto frameStart{ std::chrono::steady_clock::now() };
+
+		// One orbit around the grid over the measured frames
+		const float angle{ 6.2831853f * frame / std::max(options.frames, 1) };
+		const float radius{ gridExtent * 0.75f + 4.0f };
+		snapshot.clear();
+		snapshot.cameraPosition = { std::cos(angle) * radius, 3.0f + gridExtent * 0.25f, std::sin(angle) * radius };
+		snapshot.cameraLook = glm::normalize(glm::vec3{ 0.0f, 1.0f, 0.0f } - snapshot.cameraPosition);
+
+		for (int i{ 0 }; i < options.instances; ++i)
+		{
+			mesh.time = std::fmod(frame * deltaTime + instancePhases[i], mesh.maxTime);
+			renderer.addDraw(snapshot, meshHandle, instanceTransforms[i]);
+		}
+
+		// Lights circle over the grid at their own speeds
+		for (int i{ 0 }; i < options.lights; ++i)
+		{
+			const float phase{ i * 2.3999632f + static_cast<float>(frame * deltaTime) * (0.5f + (i % 7) * 0.1f) };
+			const float distance{ gridExtent * 0.5f * std::sqrt((i + 0.5f) / options.lights) };
+			const glm::vec3 color{ 0.5f + 0.5f * std::cos(i * 1.1f), 0.5f + 0.5f * std::cos(i * 1.7f), 0.5f + 0.5f * std::cos(i * 2.3f) };
+			snapshot.lights.push_back(PointLight{
+				{ std::cos(phase) * distance, 1.0f, std::sin(phase) * distance }, spacing * 1.5f, color, 4.0f });
+		}
+		assignLights(snapshot.lightClusters, snapshot.lights, snapshot.viewMatrix(), snapshot.fieldOfView,
+			snapshot.aspectRatio, snapshot.nearPlane, snapshot.farPlane, &jobSystem);
+
+		renderer.renderSnapshot(snapshot);
+		glFlush();
+
+		const auto frameEnd{ std::chrono::steady_clock::now() };
+		Profiler::endFrame();
+		FrameArena::local().reset();
+
+		if (frame >= options.warmup)
+		{
+			cpuFrameTimes.push_back(std::chrono::duration<double, std::milli>(frameEnd - frameStart).count());
+			renderScales.push_back(renderer.renderScale());
+
+			// GPU results arrive a few frames late; the first ones are zero
+			if (renderer.gpuTimer().lastFrameTimeMs() > 0.0)
+			{
+				gpuFrameTimes.push_back(renderer.gpuTimer().lastFrameTimeMs());
+			}
+
+			const Profiler::FrameCounters counters{ Profiler::lastFrameCounters() };
+			draws = counters.values[Profiler::DRAWS];
+			triangles = counters.values[Profiler::TRIANGLES];
+		}
+	}
+
+	glFinish();
+
+	std::ofstream file{};
+	if (!options.output.empty())
+	{
+		file.open(options.output);
+	}
+	std::ostream& out{ file.is_open() ? file : std::cout };
+
+	out << "{\n"
+		<< "  \"renderer\": \"";
+	writeJsonEscaped(out, reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+	out << "\",\n"
+		<< "  \"model\": \"";
+	writeJsonEscaped(out, options.model.c_str());
+	out << "\",\n"
+		<< "  \"instances\": " << options.instances << ",\n"
+		<< "  \"lights\": " << options.lights << ",\n"
+		<< "  \"frames\": " << options.frames << ",\n"
+		<< "  \"width\": " << options.width << ",\n"
+		<< "  \"height\": " << options.height << ",\n"
+		<< "  \"msaa\": " << options.msaa << ",\n"
+		<< "  \"targetFrameMs\": " << options.targetFrameMs << ",\n"
+		<< "  \"drawsPerFrame\": " << draws << ",\n"
+		<< "  \"trianglesPerFrame\": " << triangles << ",\n"
+		<< "  \"gpuBufferPeakBytes\": " << GlResourceTracker::stats(GlResourceTracker::BUFFER).peakBytes << ",\n"
+		<< "  \"gpuTexturePeakBytes\": " << GlResourceTracker::stats(GlResourceTracker::TEXTURE).peakBytes << ",\n";
+	// Heap peaks are only tracked when tracked_new.cpp is linked in
+	for (const MemoryTracker::Tag tag : { MemoryTracker::RENDERER, MemoryTracker::LOADER, MemoryTracker::ANIMATION })
+	{
+		out << "  \"" << MemoryTracker::tagName(tag) << "PeakBytes\": " << MemoryTracker::stats(tag).peakBytes << ",\n";
+	}
+	writeStatistics(out, "cpuFrameMs", cpuFrameTimes);
+	out << ",\n";
+	writeStatistics(out, "gpuFrameMs", gpuFrameTimes);
+	out << ",\n";
+	writeStatistics(out, "renderScale", renderScales);
+	out << "\n}\n";
+
+	renderer.cleanup();
+
+	return 0;
+}
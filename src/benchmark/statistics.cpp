@@ -0,0 +1,33 @@
+#include "statistics.hpp"
+
+#include <algorithm> // for std::sort
+#include <cstddef>
+#include <numeric> // for std::accumulate
+#include <ostream>
+#include <vector>
+
+void writeStatistics(std::ostream& out, const char* name, std::vector<double> samples)
+{
+	out << "  \"" << name << "\": { ";
+
+	if (samples.empty())
+	{
+		out << "\"samples\": 0 }";
+		return;
+	}
+
+	std::sort(samples.begin(), samples.end());
+
+	const auto percentile{ [&](double p) {
+		const auto index{ static_cast<std::size_t>(p * (samples.size() - 1) + 0.5) };
+		return samples[index];
+		} };
+
+	out << "\"samples\": " << samples.size()
+		<< ", \"mean\": " << std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size()
+		<< ", \"min\": " << samples.front()
+		<< ", \"p50\": " << percentile(0.50)
+		<< ", \"p90\": " << percentile(0.90)
+		<< ", \"p99\": " << percentile(0.99)
+		<< ", \"max\": " << samples.back() << " }";
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <ostream>
+#include <vector>
+
+// Writes `  "name": { "samples": n, "mean": ..., "min": ..., "p50": ... }`,
+// the summary the headless benchmarks print per measured quantity
+void writeStatistics(std::ostream& out, const char* name, std::vector<double> samples);
@@ -0,0 +1,91 @@
+#include "config.hpp"
+
+#include "../physics/broadphase.hpp"
+
+#include <algorithm> // for std::max
+#include <cstdint>
+#include <cstdlib> // for std::atoi, std::atof
+#include <iostream>
+#include <string>
+
+Config parseCommandLine(int argc, char* argv[])
+{
+	Config config{};
+
+	for (int i{ 1 }; i < argc; ++i)
+	{
+		const std::string argument{ argv[i] };
+
+		if (argument == "--pvd")
+		{
+			config.pvd = true;
+		}
+		else if (argument == "--sync-physics")
+		{
+			config.asyncPhysics = false;
+		}
+		else if (argument == "--profile" && i + 1 < argc)
+		{
+			config.profileOutput = argv[++i];
+		}
+		else if (argument == "--shader-cache" && i + 1 < argc)
+		{
+			config.shaderCache = argv[++i];
+		}
+		else if (argument == "--msaa" && i + 1 < argc)
+		{
+			config.msaa = std::atoi(argv[++i]);
+		}
+		else if (argument == "--target-frame-ms" && i + 1 < argc)
+		{
+			config.targetFrameMs = std::atof(argv[++i]);
+		}
+		else if (argument == "--min-render-scale" && i + 1 < argc)
+		{
+			config.minRenderScale = static_cast<float>(std::atof(argv[++i]));
+		}
+		else if (argument == "--zombies" && i + 1 < argc)
+		{
+			config.zombies = std::atoi(argv[++i]);
+		}
+		else if (argument == "--nav-cache" && i + 1 < argc)
+		{
+			config.navCache = argv[++i];
+		}
+		else if (argument == "--collision-cache" && i + 1 < argc)
+		{
+			config.collisionCache = argv[++i];
+		}
+		else if (argument == "--broadphase" && i + 1 < argc)
+		{
+			const std::string name{ argv[++i] };
+			if (!parseBroadphase(name, config.broadphase.type))
+			{
+				std::cerr << "CONFIG: WARNING: Unknown broadphase " << name << ", using "
+					<< broadphaseName(config.broadphase.type) << '\n';
+			}
+		}
+		else if (argument == "--record" && i + 1 < argc)
+		{
+			config.recordInput = argv[++i];
+		}
+		else if (argument == "--replay" && i + 1 < argc)
+		{
+			config.replayInput = argv[++i];
+		}
+		else if (argument == "--memory-dump" && i + 1 < argc)
+		{
+			config.memoryDumpSeconds = std::atof(argv[++i]);
+		}
+		else if (argument == "--mbp-subdivisions" && i + 1 < argc)
+		{
+			config.broadphase.mbpSubdivisions = static_cast<std::uint32_t>(std::max(std::atoi(argv[++i]), 1));
+		}
+		else
+		{
+			std::cerr << "CONFIG: WARNING: Ignoring unknown argument " << argument << '\n';
+		}
+	}
+
+	return config;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "../physics/broadphase.hpp"
+
+#include <string>
+
+// Engine settings that can be changed per launch from the command line
+struct Config
+{
+	// Connect to PhysX Visual Debugger on localhost
+	bool pvd{ false };
+
+	// Overlap PhysX with the rest of the frame instead of blocking on it
+	bool asyncPhysics{ true };
+
+	// Chrome trace written on exit. Empty disables the export.
+	std::string profileOutput{};
+
+	// Directory for linked shader program binaries, reused by later launches.
+	// Empty disables the cache.
+	std::string shaderCache{ "shader_cache" };
+
+	// Samples per pixel of the scene, clamped to what the driver supports
+	int msaa{ 16 };
+
+	// The render resolution follows GPU load to hold this frame time. 0
+	// always renders at the window's resolution.
+	double targetFrameMs{ 1000.0 / 60.0 };
+	// Lowest fraction of the window's resolution it may drop to
+	float minRenderScale{ 0.5f };
+
+	// Size of the horde chasing the player
+	int zombies{ 100 };
+
+	// Directory for navigation grids built from level collision, reused by
+	// later launches. Empty disables the cache.
+	std::string navCache{ "nav_cache" };
+
+	// Directory for cooked level collision meshes, reused by later launches.
+	// Empty disables the cache.
+	std::string collisionCache{ "collision_cache" };
+
+	// Pick with iklob_physbench, which times each on a scene like the game's
+	BroadphaseSettings broadphase{};
+
+	// File to record every tick's input to, for replaying the session later
+	std::string recordInput{};
+	// Recording to replay instead of reading input. Nothing is drawn and
+	// ticks run back to back, so the run can be profiled offline.
+	std::string replayInput{};
+
+	// Seconds between printing the memory statistics of every subsystem.
+	// 0 only prints them on exit.
+	double memoryDumpSeconds{ 0.0 };
+};
+
+// --pvd                 connect to PVD
+// --sync-physics        block on every physics step
+// --profile <file>      write a Chrome trace to <file> on exit
+// --shader-cache <dir>  keep program binaries in <dir>, "" disables caching
+// --msaa <n>            MSAA samples, 1 disables MSAA
+// --target-frame-ms <t> GPU frame time dynamic resolution aims for, 0 disables it
+// --min-render-scale <s> lowest render scale dynamic resolution may use
+// --zombies <n>         zombies spawned at startup
+// --nav-cache <dir>     keep navigation grids in <dir>, "" disables caching
+// --collision-cache <dir> keep cooked collision meshes in <dir>, "" disables caching
+// --broadphase <name>   sap, mbp or abp
+// --mbp-subdivisions <n> MBP splits the level into n x n regions
+// --record <file>       record input to <file>
+// --replay <file>       replay a recording headless, as fast as possible
+// --memory-dump <s>     print memory statistics every <s> seconds
+Config parseCommandLine(int argc, char* argv[]);
@@ -0,0 +1,336 @@
+#include "crowd.hpp"
+
+#include "../jobs/job_system.hpp"
+#include "../navigation/flow_field.hpp"
+#include "../profiler/profiler.hpp"
+
+#include "glm/glm.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IKLOB_CROWD_SSE
+#include <emmintrin.h>
+#endif
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace
+{
+	// Agents per job. Each one reads its neighbours from the spatial hash's
+	// own copy of the positions, so chunks can move their agents right away.
+	constexpr std::size_t stepGrainSize{ 256 };
+
+#ifdef IKLOB_CROWD_SSE
+	float horizontalSum(__m128 v)
+	{
+		const __m128 pairs{ _mm_add_ps(v, _mm_movehl_ps(v, v)) };
+		return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, 1)));
+	}
+#endif
+}
+
+
+
+Crowd::Crowd(const CrowdSettings& settings)
+	: m_settings{ settings }
+{}
+
+std::uint32_t Crowd::spawn(const glm::vec3& position)
+{
+	m_positionX.push_back(position.x);
+	m_positionY.push_back(position.y);
+	m_positionZ.push_back(position.z);
+	m_velocityX.push_back(0.0f);
+	m_velocityZ.push_back(0.0f);
+	m_heading.push_back(0.0f);
+	m_groundY.push_back(position.y);
+	m_dying.push_back(0);
+	m_ids.push_back(m_nextId++);
+
+	return static_cast<std::uint32_t>(m_positionX.size() - 1);
+}
+
+void Crowd::kill(std::uint32_t agent)
+{
+	m_dying[agent] = 1;
+	m_velocityX[agent] = 0.0f;
+	m_velocityZ[agent] = 0.0f;
+}
+
+void Crowd::clear()
+{
+	m_positionX.clear();
+	m_positionY.clear();
+	m_positionZ.clear();
+	m_velocityX.clear();
+	m_velocityZ.clear();
+	m_heading.clear();
+	m_groundY.clear();
+	m_dying.clear();
+	m_ids.clear();
+}
+
+void Crowd::remove(std::uint32_t agent)
+{
+	const std::size_t last{ m_positionX.size() - 1 };
+
+	m_positionX[agent] = m_positionX[last];
+	m_positionY[agent] = m_positionY[last];
+	m_positionZ[agent] = m_positionZ[last];
+	m_velocityX[agent] = m_velocityX[last];
+	m_velocityZ[agent] = m_velocityZ[last];
+	m_heading[agent] = m_heading[last];
+	m_groundY[agent] = m_groundY[last];
+	m_dying[agent] = m_dying[last];
+	m_ids[agent] = m_ids[last];
+
+	m_positionX.pop_back();
+	m_positionY.pop_back();
+	m_positionZ.pop_back();
+	m_velocityX.pop_back();
+	m_velocityZ.pop_back();
+	m_heading.pop_back();
+	m_groundY.pop_back();
+	m_dying.pop_back();
+	m_ids.pop_back();
+}
+
+
+
+void Crowd::update(const glm::vec3& target, float deltaTime, JobSystem* jobSystem, const FlowField* flowField)
+{
+	PROFILE_ZONE("Crowd");
+
+	// Backwards, so the agent moved into a removed slot was already checked
+	for (std::size_t i{ m_positionX.size() }; i > 0; --i)
+	{
+		const auto agent{ static_cast<std::uint32_t>(i - 1) };
+		if (m_dying[agent] && m_positionY[agent] < m_groundY[agent] - m_settings.sinkDepth)
+		{
+			remove(agent);
+		}
+	}
+
+	m_neighbours.build(m_positionX.data(), m_positionZ.data(), m_positionX.size(), m_settings.separationRadius);
+
+	const auto step{ [this, &target, deltaTime, flowField](std::size_t begin, std::size_t end) {
+		steer(begin, end, target, flowField);
+
+		for (std::size_t i{ begin }; i < end; ++i)
+		{
+			if (m_dying[i])
+			{
+				m_positionY[i] -= m_settings.sinkSpeed * deltaTime;
+				continue;
+			}
+
+			m_positionX[i] += m_velocityX[i] * deltaTime;
+			m_positionZ[i] += m_velocityZ[i] * deltaTime;
+
+			if (m_velocityX[i] != 0.0f || m_velocityZ[i] != 0.0f)
+			{
+				m_heading[i] = std::atan2(m_velocityX[i], m_velocityZ[i]);
+			}
+		}
+		} };
+
+	if (jobSystem)
+	{
+		jobSystem->parallelFor(m_positionX.size(), stepGrainSize, step);
+	}
+	else
+	{
+		step(0, m_positionX.size());
+	}
+}
+
+void Crowd::steer(std::size_t begin, std::size_t end, const glm::vec3& target, const FlowField* flowField)
+{
+	const float maxSpeed{ m_settings.maxSpeed };
+	const float arrivalRadius{ m_settings.arrivalRadius };
+	const float radius{ m_settings.separationRadius };
+	const float inverseRadius{ 1.0f / radius };
+
+	// Seek: full speed at the target, along the flow field if there is one,
+	// until within arrivalRadius
+	std::size_t i{ begin };
+	if (flowField)
+	{
+		// A lookup per agent, so no SIMD. Where the field has no route,
+		// including the target's own cell, agents keep seeking straight.
+		for (; i < end; ++i)
+		{
+			const float dx{ target.x - m_positionX[i] };
+			const float dz{ target.z - m_positionZ[i] };
+			const float distanceSquared{ dx * dx + dz * dz };
+
+			if (distanceSquared <= arrivalRadius * arrivalRadius)
+			{
+				m_velocityX[i] = 0.0f;
+				m_velocityZ[i] = 0.0f;
+				continue;
+			}
+
+			glm::vec2 direction{ glm::vec2{ dx, dz } / std::sqrt(distanceSquared) };
+			flowField->sample(glm::vec3{ m_positionX[i], m_positionY[i], m_positionZ[i] }, direction);
+
+			m_velocityX[i] = direction.x * maxSpeed;
+			m_velocityZ[i] = direction.y * maxSpeed;
+		}
+	}
+#ifdef IKLOB_CROWD_SSE
+	const __m128 targetX{ _mm_set1_ps(target.x) };
+	const __m128 targetZ{ _mm_set1_ps(target.z) };
+	const __m128 arrivalSquared{ _mm_set1_ps(arrivalRadius * arrivalRadius) };
+	const __m128 speed{ _mm_set1_ps(maxSpeed) };
+
+	for (; i + 4 <= end; i += 4)
+	{
+		const __m128 dx{ _mm_sub_ps(targetX, _mm_loadu_ps(&m_positionX[i])) };
+		const __m128 dz{ _mm_sub_ps(targetZ, _mm_loadu_ps(&m_positionZ[i])) };
+		const __m128 distanceSquared{ _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dz, dz)) };
+
+		const __m128 outside{ _mm_cmpgt_ps(distanceSquared, arrivalSquared) };
+		// Masked before the divide's result is used, so arrived agents
+		// never see the infinity
+		const __m128 scale{ _mm_and_ps(outside, _mm_div_ps(speed, _mm_sqrt_ps(distanceSquared))) };
+
+		_mm_storeu_ps(&m_velocityX[i], _mm_mul_ps(dx, scale));
+		_mm_storeu_ps(&m_velocityZ[i], _mm_mul_ps(dz, scale));
+	}
+#endif
+	for (; i < end; ++i)
+	{
+		const float dx{ target.x - m_positionX[i] };
+		const float dz{ target.z - m_positionZ[i] };
+		const float distanceSquared{ dx * dx + dz * dz };
+
+		const float scale{ distanceSquared > arrivalRadius * arrivalRadius ? maxSpeed / std::sqrt(distanceSquared) : 0.0f };
+		m_velocityX[i] = dx * scale;
+		m_velocityZ[i] = dz * scale;
+	}
+
+	// Separation: every neighbour within radius pushes by 1 / d - 1 / r, so
+	// the push fades out at the edge and grows as agents overlap
+	const std::vector<float>& neighbourX{ m_neighbours.sortedX() };
+	const std::vector<float>& neighbourZ{ m_neighbours.sortedZ() };
+
+	for (std::size_t agent{ begin }; agent < end; ++agent)
+	{
+		if (m_dying[agent])
+		{
+			m_velocityX[agent] = 0.0f;
+			m_velocityZ[agent] = 0.0f;
+			continue;
+		}
+
+		const float x{ m_positionX[agent] };
+		const float z{ m_positionZ[agent] };
+
+		float pushX{};
+		float pushZ{};
+
+		m_neighbours.forEachBucket(x, z, radius, [&](std::uint32_t first, std::uint32_t last) {
+			std::uint32_t j{ first };
+#ifdef IKLOB_CROWD_SSE
+			const __m128 agentX{ _mm_set1_ps(x) };
+			const __m128 agentZ{ _mm_set1_ps(z) };
+			const __m128 radiusSquared{ _mm_set1_ps(radius * radius) };
+			// Skips the agent itself, and anyone standing exactly on it
+			const __m128 epsilon{ _mm_set1_ps(1e-8f) };
+			const __m128 inverseRadius4{ _mm_set1_ps(inverseRadius) };
+			const __m128 one{ _mm_set1_ps(1.0f) };
+
+			__m128 sumX{ _mm_setzero_ps() };
+			__m128 sumZ{ _mm_setzero_ps() };
+
+			for (; j + 4 <= last; j += 4)
+			{
+				const __m128 dx{ _mm_sub_ps(agentX, _mm_loadu_ps(&neighbourX[j])) };
+				const __m128 dz{ _mm_sub_ps(agentZ, _mm_loadu_ps(&neighbourZ[j])) };
+				const __m128 distanceSquared{ _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dz, dz)) };
+
+				const __m128 inRange{ _mm_and_ps(_mm_cmplt_ps(distanceSquared, radiusSquared),
+					_mm_cmpgt_ps(distanceSquared, epsilon)) };
+				// Far lanes take the square root of 1 instead of their
+				// distance, then drop out through the mask
+				const __m128 safeSquared{ _mm_or_ps(_mm_and_ps(inRange, distanceSquared), _mm_andnot_ps(inRange, one)) };
+				const __m128 weight{ _mm_and_ps(inRange,
+					_mm_sub_ps(_mm_div_ps(one, _mm_sqrt_ps(safeSquared)), inverseRadius4)) };
+
+				sumX = _mm_add_ps(sumX, _mm_mul_ps(dx, weight));
+				sumZ = _mm_add_ps(sumZ, _mm_mul_ps(dz, weight));
+			}
+
+			pushX += horizontalSum(sumX);
+			pushZ += horizontalSum(sumZ);
+#endif
+			for (; j < last; ++j)
+			{
+				const float dx{ x - neighbourX[j] };
+				const float dz{ z - neighbourZ[j] };
+				const float distanceSquared{ dx * dx + dz * dz };
+
+				if (distanceSquared < radius * radius && distanceSquared > 1e-8f)
+				{
+					const float weight{ 1.0f / std::sqrt(distanceSquared) - inverseRadius };
+					pushX += dx * weight;
+					pushZ += dz * weight;
+				}
+			}
+			});
+
+		float velocityX{ m_velocityX[agent] + pushX * m_settings.separationWeight };
+		float velocityZ{ m_velocityZ[agent] + pushZ * m_settings.separationWeight };
+
+		const float speedSquared{ velocityX * velocityX + velocityZ * velocityZ };
+		if (speedSquared > maxSpeed * maxSpeed)
+		{
+			const float scale{ maxSpeed / std::sqrt(speedSquared) };
+			velocityX *= scale;
+			velocityZ *= scale;
+		}
+
+		m_velocityX[agent] = velocityX;
+		m_velocityZ[agent] = velocityZ;
+	}
+}
+
+
+
+bool Crowd::anyWithin(const glm::vec3& point, float radius) const
+{
+	for (std::size_t i{ 0 }; i < m_positionX.size(); ++i)
+	{
+		const float dx{ m_positionX[i] - point.x };
+		const float dy{ m_positionY[i] - point.y };
+		const float dz{ m_positionZ[i] - point.z };
+
+		if (!m_dying[i] && dx * dx + dy * dy + dz * dz < radius * radius)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void Crowd::writeTransforms(std::vector<glm::mat4>& transforms) const
+{
+	transforms.resize(m_positionX.size());
+
+	for (std::size_t i{ 0 }; i < m_positionX.size(); ++i)
+	{
+		// Rotation about +Y by the heading, then the position
+		const float c{ std::cos(m_heading[i]) };
+		const float s{ std::sin(m_heading[i]) };
+
+		transforms[i] = glm::mat4{
+			glm::vec4{ c, 0.0f, -s, 0.0f },
+			glm::vec4{ 0.0f, 1.0f, 0.0f, 0.0f },
+			glm::vec4{ s, 0.0f, c, 0.0f },
+			glm::vec4{ m_positionX[i], m_positionY[i], m_positionZ[i], 1.0f } };
+	}
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "spatial_hash.hpp"
+
+#include "glm/glm.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class FlowField;
+class JobSystem;
+
+struct CrowdSettings
+{
+	// Metres per second
+	float maxSpeed{ 1.0f };
+
+	// Agents closer than this push each other apart. Also the cell size of
+	// the neighbour grid.
+	float separationRadius{ 1.0f };
+	float separationWeight{ 1.5f };
+
+	// Agents stop seeking this close to the target
+	float arrivalRadius{ 1.0f };
+
+	// Killed agents sink at this speed and are removed this far down
+	float sinkSpeed{ 1.0f };
+	float sinkDepth{ 3.0f };
+};
+
+// Agents chasing a common target across the XZ plane. State is kept as
+// parallel arrays indexed by agent, so steering streams through memory and
+// runs four agents or four neighbours per SSE instruction. Neighbours come
+// from a SpatialHash rebuilt every update, and the steering pass is split
+// across the job system.
+//
+// Removing an agent moves the last one into its index, so indices are only
+// stable until the next update().
+class Crowd final
+{
+public:
+
+	explicit Crowd(const CrowdSettings& settings = {});
+
+	Crowd(const Crowd&) = delete;
+	Crowd& operator=(const Crowd&) = delete;
+
+	// Position of the agent's feet
+	std::uint32_t spawn(const glm::vec3& position);
+
+	// The agent stops, sinks and is removed by a later update()
+	void kill(std::uint32_t agent);
+
+	void clear();
+
+	// With a flow field, agents follow it towards the target wherever it has
+	// a route, and only head straight for the target where it has none
+	void update(const glm::vec3& target, float deltaTime, JobSystem* jobSystem = nullptr,
+		const FlowField* flowField = nullptr);
+
+	// Whether a living agent's feet are within radius of the point
+	bool anyWithin(const glm::vec3& point, float radius) const;
+
+	// One model matrix per agent, facing the way it walks, for
+	// Renderer::addInstancedDraw()
+	void writeTransforms(std::vector<glm::mat4>& transforms) const;
+
+	std::size_t size() const
+	{
+		return m_positionX.size();
+	}
+
+	glm::vec3 position(std::uint32_t agent) const
+	{
+		return { m_positionX[agent], m_positionY[agent], m_positionZ[agent] };
+	}
+
+	// Unique per spawn and kept when remove() moves the agent to another
+	// index, to tell whether an index still holds the same agent
+	std::uint32_t id(std::uint32_t agent) const
+	{
+		return m_ids[agent];
+	}
+
+	bool dying(std::uint32_t agent) const
+	{
+		return m_dying[agent] != 0;
+	}
+
+	const CrowdSettings& settings() const
+	{
+		return m_settings;
+	}
+
+private:
+
+	CrowdSettings m_settings{};
+
+	std::vector<float> m_positionX{};
+	std::vector<float> m_positionY{};
+	std::vector<float> m_positionZ{};
+	std::vector<float> m_velocityX{};
+	std::vector<float> m_velocityZ{};
+	// Radians about +Y, 0 facing +Z
+	std::vector<float> m_heading{};
+	// Height the agent was spawned at, to know when it has sunk far enough
+	std::vector<float> m_groundY{};
+	std::vector<std::uint8_t> m_dying{};
+	std::vector<std::uint32_t> m_ids{};
+	std::uint32_t m_nextId{};
+
+	SpatialHash m_neighbours{};
+
+	void steer(std::size_t begin, std::size_t end, const glm::vec3& target, const FlowField* flowField);
+	void remove(std::uint32_t agent);
+};
@@ -0,0 +1,54 @@
+#include "spatial_hash.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+void SpatialHash::build(const float* x, const float* z, std::size_t count, float cellSize)
+{
+	m_inverseCellSize = 1.0f / cellSize;
+
+	std::size_t bucketCount{ 16 };
+	while (bucketCount < count * 2)
+	{
+		bucketCount *= 2;
+	}
+	m_bucketMask = static_cast<std::uint32_t>(bucketCount - 1);
+
+	m_bucketStarts.assign(bucketCount + 1, 0);
+	m_pointBuckets.resize(count);
+
+	for (std::size_t i{ 0 }; i < count; ++i)
+	{
+		const std::uint32_t bucket{ bucketOf(cellCoordinate(x[i]), cellCoordinate(z[i])) };
+		m_pointBuckets[i] = bucket;
+		++m_bucketStarts[bucket + 1];
+	}
+
+	for (std::size_t bucket{ 0 }; bucket < bucketCount; ++bucket)
+	{
+		m_bucketStarts[bucket + 1] += m_bucketStarts[bucket];
+	}
+
+	m_sortedX.resize(count);
+	m_sortedZ.resize(count);
+	m_sortedIndices.resize(count);
+
+	// Each start doubles as its bucket's write cursor. Input order is kept
+	// inside a bucket, so the result only depends on the input.
+	for (std::size_t i{ 0 }; i < count; ++i)
+	{
+		const std::uint32_t position{ m_bucketStarts[m_pointBuckets[i]]++ };
+		m_sortedX[position] = x[i];
+		m_sortedZ[position] = z[i];
+		m_sortedIndices[position] = static_cast<std::uint32_t>(i);
+	}
+
+	// The cursors moved every start to the end of its bucket, which is the
+	// start of the next one
+	for (std::size_t bucket{ bucketCount }; bucket > 0; --bucket)
+	{
+		m_bucketStarts[bucket] = m_bucketStarts[bucket - 1];
+	}
+	m_bucketStarts[0] = 0;
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Uniform grid over the XZ plane for neighbour queries, rebuilt from scratch
+// whenever the points move. Cells are hashed into a table twice the size of
+// the point count, and the points are counting sorted by bucket, so each
+// bucket's coordinates sit contiguous and can be scanned with SIMD.
+class SpatialHash final
+{
+public:
+
+	SpatialHash() = default;
+
+	SpatialHash(const SpatialHash&) = delete;
+	SpatialHash& operator=(const SpatialHash&) = delete;
+
+	// Queries should use a radius of at most cellSize, so they only have to
+	// visit the 3 x 3 cells around the point
+	void build(const float* x, const float* z, std::size_t count, float cellSize);
+
+	// Calls function(begin, end) for each bucket overlapping the square of
+	// radius around (x, z), as a range into sortedX(), sortedZ() and
+	// sortedIndices(). Buckets hold points of other cells too, whenever
+	// cells collide in the table, so callers still test the distance.
+	template <typename Function>
+	void forEachBucket(float x, float z, float radius, Function&& function) const
+	{
+		if (m_bucketStarts.empty())
+		{
+			return;
+		}
+
+		const int minX{ cellCoordinate(x - radius) };
+		const int maxX{ cellCoordinate(x + radius) };
+		const int minZ{ cellCoordinate(z - radius) };
+		const int maxZ{ cellCoordinate(z + radius) };
+
+		// Distinct cells can share a bucket, which must only be visited once
+		std::uint32_t visited[9]{};
+		int visitedCount{};
+
+		for (int cellX{ minX }; cellX <= maxX; ++cellX)
+		{
+			for (int cellZ{ minZ }; cellZ <= maxZ; ++cellZ)
+			{
+				const std::uint32_t bucket{ bucketOf(cellX, cellZ) };
+
+				bool seen{ false };
+				for (int i{ 0 }; i < visitedCount; ++i)
+				{
+					seen = seen || visited[i] == bucket;
+				}
+				if (seen)
+				{
+					continue;
+				}
+				if (visitedCount < 9)
+				{
+					visited[visitedCount++] = bucket;
+				}
+
+				const std::uint32_t begin{ m_bucketStarts[bucket] };
+				const std::uint32_t end{ m_bucketStarts[bucket + 1] };
+				if (begin != end)
+				{
+					function(begin, end);
+				}
+			}
+		}
+	}
+
+	const std::vector<float>& sortedX() const
+	{
+		return m_sortedX;
+	}
+
+	const std::vector<float>& sortedZ() const
+	{
+		return m_sortedZ;
+	}
+
+	// Index passed to build() of each sorted point
+	const std::vector<std::uint32_t>& sortedIndices() const
+	{
+		return m_sortedIndices;
+	}
+
+private:
+
+	float m_inverseCellSize{ 1.0f };
+	std::uint32_t m_bucketMask{};
+
+	// One past the last bucket too, so bucket b is [starts[b], starts[b + 1])
+	std::vector<std::uint32_t> m_bucketStarts{};
+	std::vector<std::uint32_t> m_pointBuckets{};
+
+	std::vector<float> m_sortedX{};
+	std::vector<float> m_sortedZ{};
+	std::vector<std::uint32_t> m_sortedIndices{};
+
+	int cellCoordinate(float coordinate) const
+	{
+		return static_cast<int>(std::floor(coordinate * m_inverseCellSize));
+	}
+
+	std::uint32_t bucketOf(int cellX, int cellZ) const
+	{
+		return (static_cast<std::uint32_t>(cellX) * 73856093u ^ static_cast<std::uint32_t>(cellZ) * 19349663u)
+			& m_bucketMask;
+	}
+};
@@ -60,10 +60,23 @@ void Camera::update(const Input& input, float deltaTime)
 	// Gravity
 	m_vel.y -= 9.8f * deltaTime;
 
-	physx::PxVec3 disp{ m_vel.x * deltaTime, m_vel.y * deltaTime, m_vel.z * deltaTime };
+	m_pendingDisp += glm::vec3{ m_vel.x * deltaTime, m_vel.y * deltaTime, m_vel.z * deltaTime };
+	m_pendingDeltaTime += deltaTime;
+}
+
+// Controller moves write to the scene, so they are batched up in update() and
+// applied here while PhysX is not simulating.
+void Camera::applyPendingMove()
+{
+	if (m_pendingDeltaTime == 0.0f)
+	{
+		return;
+	}
+
+	physx::PxVec3 disp{ m_pendingDisp.x, m_pendingDisp.y, m_pendingDisp.z };
 
 	physx::PxControllerFilters filters{};
-	auto collisionFlags{ m_controller->move(disp, 0.01f, deltaTime, filters) };
+	auto collisionFlags{ m_controller->move(disp, 0.01f, m_pendingDeltaTime, filters) };
 
 	if (collisionFlags & physx::PxControllerCollisionFlag::eCOLLISION_DOWN
 		|| collisionFlags & physx::PxControllerCollisionFlag::eCOLLISION_UP)
@@ -72,5 +85,8 @@ void Camera::update(const Input& input, float deltaTime)
 		airTime = 0.0f;
 	}
 
-	airTime += deltaTime;
+	airTime += m_pendingDeltaTime;
+
+	m_pendingDisp = glm::vec3{ 0.0f };
+	m_pendingDeltaTime = 0.0f;
 }
@@ -68,6 +68,7 @@ public:
 
 	void calculateFrontVec();
 	void update(const Input& input, float deltaTime);
+	void applyPendingMove();
 
 private:
 
@@ -78,5 +79,8 @@ private:
 
 	glm::vec3 m_vel{ 0.0f, 0.0f, 0.0f };
 
+	glm::vec3 m_pendingDisp{ 0.0f, 0.0f, 0.0f };
+	float m_pendingDeltaTime{ 0.0f };
+
 	float airTime{ 0.3f };
 };
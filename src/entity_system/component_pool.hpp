@@ -0,0 +1,122 @@
+#pragma once
+
+#include "entity.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <utility> // for std::move
+#include <vector>
+
+class ComponentPoolBase
+{
+public:
+
+	virtual ~ComponentPoolBase() = default;
+
+	virtual void remove(Entity entity) = 0;
+};
+
+// Sparse set. Components of one type sit packed in a dense array, in the
+// same order as the entities owning them, so systems stream through memory
+// instead of chasing pointers. The sparse array maps an entity index to its
+// dense position; removal moves the last component into the hole.
+template <typename Component>
+class ComponentPool final : public ComponentPoolBase
+{
+public:
+
+	Component& add(Entity entity, Component component)
+	{
+		if (entity.index >= m_sparse.size())
+		{
+			m_sparse.resize(entity.index + 1, invalidPosition);
+		}
+
+		if (contains(entity))
+		{
+			Component& existing{ m_components[m_sparse[entity.index]] };
+			existing = std::move(component);
+			return existing;
+		}
+
+		m_sparse[entity.index] = static_cast<std::uint32_t>(m_entities.size());
+		m_entities.push_back(entity);
+		m_components.push_back(std::move(component));
+
+		return m_components.back();
+	}
+
+	void remove(Entity entity) override
+	{
+		if (!contains(entity))
+		{
+			return;
+		}
+
+		const std::uint32_t position{ m_sparse[entity.index] };
+		const std::uint32_t last{ static_cast<std::uint32_t>(m_entities.size() - 1) };
+
+		if (position != last)
+		{
+			m_entities[position] = m_entities[last];
+			m_components[position] = std::move(m_components[last]);
+			m_sparse[m_entities[position].index] = position;
+		}
+
+		m_entities.pop_back();
+		m_components.pop_back();
+		m_sparse[entity.index] = invalidPosition;
+	}
+
+	bool contains(Entity entity) const
+	{
+		return entity.index < m_sparse.size()
+			&& m_sparse[entity.index] != invalidPosition
+			&& m_entities[m_sparse[entity.index]] == entity;
+	}
+
+	// nullptr when the entity has no such component
+	Component* find(Entity entity)
+	{
+		return contains(entity) ? &m_components[m_sparse[entity.index]] : nullptr;
+	}
+
+	const Component* find(Entity entity) const
+	{
+		return contains(entity) ? &m_components[m_sparse[entity.index]] : nullptr;
+	}
+
+	std::size_t size() const
+	{
+		return m_components.size();
+	}
+
+	// Dense arrays, index i of one belongs to index i of the other
+	std::vector<Entity>& entities()
+	{
+		return m_entities;
+	}
+
+	const std::vector<Entity>& entities() const
+	{
+		return m_entities;
+	}
+
+	std::vector<Component>& components()
+	{
+		return m_components;
+	}
+
+	const std::vector<Component>& components() const
+	{
+		return m_components;
+	}
+
+private:
+
+	static constexpr std::uint32_t invalidPosition{ 0xFFFFFFFF };
+
+	std::vector<std::uint32_t> m_sparse{};
+	std::vector<Entity> m_entities{};
+	std::vector<Component> m_components{};
+};
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "../renderer/resource_pool.hpp"
+
+// Plain data components stored in the Registry. Behaviour lives in the
+// systems iterating them. Transforms live in the TransformHierarchy.
+
+// Draws a renderer mesh at the entity's world transform
+struct MeshRenderer
+{
+	MeshHandle mesh{};
+};
@@ -1,9 +0,0 @@
-#include "entity.hpp"
-
-void Entity::render(std::function<void(MeshID, const glm::mat4&)> renderPolicy) const
-{
-	for (const auto& mesh : m_meshes)
-	{
-		renderPolicy(mesh, m_transform);
-	}
-}
\ No newline at end of file
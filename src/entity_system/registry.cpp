@@ -0,0 +1,49 @@
+#include "registry.hpp"
+
+#include "entity.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+Entity Registry::create()
+{
+	if (!m_freeIndices.empty())
+	{
+		const std::uint32_t index{ m_freeIndices.back() };
+		m_freeIndices.pop_back();
+		return Entity{ index, m_generations[index] };
+	}
+
+	m_generations.push_back(1);
+	return Entity{ static_cast<std::uint32_t>(m_generations.size() - 1), 1 };
+}
+
+void Registry::destroy(Entity entity)
+{
+	if (!valid(entity))
+	{
+		return;
+	}
+
+	for (const std::unique_ptr<ComponentPoolBase>& pool : m_pools)
+	{
+		if (pool)
+		{
+			pool->remove(entity);
+		}
+	}
+
+	// Skips 0 on wrap around, so default handles stay invalid
+	std::uint32_t& generation{ m_generations[entity.index] };
+	generation = generation + 1 != 0 ? generation + 1 : 1;
+
+	m_freeIndices.push_back(entity.index);
+}
+
+std::size_t Registry::nextComponentTypeId()
+{
+	static std::atomic<std::size_t> nextId{ 0 };
+	return nextId++;
+}
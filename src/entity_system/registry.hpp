@@ -0,0 +1,161 @@
+#pragma once
+
+#include "component_pool.hpp"
+#include "entity.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <tuple>
+#include <utility> // for std::move
+#include <vector>
+
+// Owns the entities and one ComponentPool per component type. Handles are
+// plain integers, so systems find components with array indexing instead of
+// hashing names, and iterating a component type touches one packed array.
+// Destroyed slots are reused with the next generation.
+class Registry final
+{
+public:
+
+	Registry() = default;
+
+	Registry(const Registry&) = delete;
+	Registry& operator=(const Registry&) = delete;
+
+	Entity create();
+
+	// Removes every component of the entity. Stale handles are ignored.
+	void destroy(Entity entity);
+
+	bool valid(Entity entity) const
+	{
+		return entity.index < m_generations.size() && m_generations[entity.index] == entity.generation;
+	}
+
+	// Live entities
+	std::size_t size() const
+	{
+		return m_generations.size() - m_freeIndices.size();
+	}
+
+	// Replaces the component if the entity already has one
+	template <typename Component>
+	Component& add(Entity entity, Component component = {})
+	{
+		return pool<Component>().add(entity, std::move(component));
+	}
+
+	template <typename Component>
+	void remove(Entity entity)
+	{
+		pool<Component>().remove(entity);
+	}
+
+	// nullptr when the entity has no such component
+	template <typename Component>
+	Component* find(Entity entity)
+	{
+		return pool<Component>().find(entity);
+	}
+
+	template <typename Component>
+	const Component* find(Entity entity) const
+	{
+		const ComponentPool<Component>* componentPool{ existingPool<Component>() };
+		return componentPool ? componentPool->find(entity) : nullptr;
+	}
+
+	// The entity must have the component
+	template <typename Component>
+	Component& get(Entity entity)
+	{
+		return *find<Component>(entity);
+	}
+
+	template <typename Component>
+	const Component& get(Entity entity) const
+	{
+		return *find<Component>(entity);
+	}
+
+	template <typename Component>
+	bool has(Entity entity) const
+	{
+		return find<Component>(entity) != nullptr;
+	}
+
+	// Calls function(entity, first&, others&...) for every entity that has
+	// all of the components. Walks the packed array of First and looks the
+	// others up by index, so the rarest component should come first.
+	// Components must not be added or removed from inside the function.
+	template <typename First, typename... Others, typename Function>
+	void each(Function&& function)
+	{
+		ComponentPool<First>& firstPool{ pool<First>() };
+		std::tuple<ComponentPool<Others>&...> otherPools{ pool<Others>()... };
+
+		std::vector<Entity>& entities{ firstPool.entities() };
+		std::vector<First>& components{ firstPool.components() };
+
+		for (std::size_t i{ 0 }; i < entities.size(); ++i)
+		{
+			const Entity entity{ entities[i] };
+
+			if constexpr (sizeof...(Others) == 0)
+			{
+				function(entity, components[i]);
+			}
+			else
+			{
+				const std::tuple<Others*...> others{ std::get<ComponentPool<Others>&>(otherPools).find(entity)... };
+				if ((std::get<Others*>(others) && ...))
+				{
+					function(entity, components[i], *std::get<Others*>(others)...);
+				}
+			}
+		}
+	}
+
+	template <typename Component>
+	ComponentPool<Component>& pool()
+	{
+		const std::size_t id{ componentTypeId<Component>() };
+		if (id >= m_pools.size())
+		{
+			m_pools.resize(id + 1);
+		}
+
+		if (!m_pools[id])
+		{
+			m_pools[id] = std::make_unique<ComponentPool<Component>>();
+		}
+
+		return static_cast<ComponentPool<Component>&>(*m_pools[id]);
+	}
+
+private:
+
+	std::vector<std::uint32_t> m_generations{};
+	std::vector<std::uint32_t> m_freeIndices{};
+
+	// Indexed by componentTypeId()
+	std::vector<std::unique_ptr<ComponentPoolBase>> m_pools{};
+
+	template <typename Component>
+	const ComponentPool<Component>* existingPool() const
+	{
+		const std::size_t id{ componentTypeId<Component>() };
+		return id < m_pools.size() ? static_cast<const ComponentPool<Component>*>(m_pools[id].get()) : nullptr;
+	}
+
+	// Dense ids shared by every registry, handed out on first use of a type
+	static std::size_t nextComponentTypeId();
+
+	template <typename Component>
+	static std::size_t componentTypeId()
+	{
+		static const std::size_t id{ nextComponentTypeId() };
+		return id;
+	}
+};
@@ -0,0 +1,228 @@
+#include "transform_hierarchy.hpp"
+
+#include "entity.hpp"
+#include "../profiler/profiler.hpp"
+
+#include "glm/glm.hpp"
+#include "glm/gtc/quaternion.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IKLOB_TRANSFORM_HIERARCHY_SSE
+#include <xmmintrin.h>
+#endif
+
+#include <algorithm> // for std::upper_bound, std::fill
+#include <cstddef>
+#include <cstdint>
+#include <iterator> // for std::distance
+#include <vector>
+
+namespace
+{
+	glm::mat4 composeLocal(const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale)
+	{
+		const glm::mat3 rotationMatrix{ glm::mat3_cast(rotation) };
+
+		return glm::mat4{
+			glm::vec4{ rotationMatrix[0] * scale.x, 0.0f },
+			glm::vec4{ rotationMatrix[1] * scale.y, 0.0f },
+			glm::vec4{ rotationMatrix[2] * scale.z, 0.0f },
+			glm::vec4{ translation, 1.0f } };
+	}
+
+	// parent * local, a column at a time
+	void multiply(const glm::mat4& parent, const glm::mat4& local, glm::mat4& world)
+	{
+#ifdef IKLOB_TRANSFORM_HIERARCHY_SSE
+		const __m128 parent0{ _mm_loadu_ps(&parent[0][0]) };
+		const __m128 parent1{ _mm_loadu_ps(&parent[1][0]) };
+		const __m128 parent2{ _mm_loadu_ps(&parent[2][0]) };
+		const __m128 parent3{ _mm_loadu_ps(&parent[3][0]) };
+
+		for (int column{ 0 }; column < 4; ++column)
+		{
+			__m128 result{ _mm_mul_ps(parent0, _mm_set1_ps(local[column][0])) };
+			result = _mm_add_ps(result, _mm_mul_ps(parent1, _mm_set1_ps(local[column][1])));
+			result = _mm_add_ps(result, _mm_mul_ps(parent2, _mm_set1_ps(local[column][2])));
+			result = _mm_add_ps(result, _mm_mul_ps(parent3, _mm_set1_ps(local[column][3])));
+			_mm_storeu_ps(&world[column][0], result);
+		}
+#else
+		world = parent * local;
+#endif
+	}
+}
+
+
+
+void TransformHierarchy::add(Entity entity, Entity parent, const glm::vec3& translation,
+	const glm::quat& rotation, const glm::vec3& scale)
+{
+	const std::uint32_t parentPosition{ contains(parent) ? m_sparse[parent.index] : invalidPosition };
+	const std::uint32_t depth{ parentPosition != invalidPosition ? m_depths[parentPosition] + 1 : 0 };
+
+	// After every node at the same depth or above
+	const auto position{ static_cast<std::uint32_t>(
+		std::distance(m_depths.begin(), std::upper_bound(m_depths.begin(), m_depths.end(), depth))) };
+
+	for (std::uint32_t& parentOf : m_parents)
+	{
+		if (parentOf != invalidPosition && parentOf >= position)
+		{
+			++parentOf;
+		}
+	}
+
+	m_entities.insert(m_entities.begin() + position, entity);
+	m_parents.insert(m_parents.begin() + position, parentPosition);
+	m_depths.insert(m_depths.begin() + position, depth);
+	m_translations.insert(m_translations.begin() + position, translation);
+	m_rotations.insert(m_rotations.begin() + position, rotation);
+	m_scales.insert(m_scales.begin() + position, scale);
+	m_dirty.insert(m_dirty.begin() + position, 1);
+	m_worlds.insert(m_worlds.begin() + position, glm::mat4{ 1.0f });
+	m_anyDirty = true;
+
+	if (entity.index >= m_sparse.size())
+	{
+		m_sparse.resize(entity.index + 1, invalidPosition);
+	}
+
+	for (std::size_t i{ position }; i < m_entities.size(); ++i)
+	{
+		m_sparse[m_entities[i].index] = static_cast<std::uint32_t>(i);
+	}
+}
+
+void TransformHierarchy::remove(Entity entity)
+{
+	if (!contains(entity))
+	{
+		return;
+	}
+
+	// Descendants always come later, so one pass finds the whole subtree
+	std::vector<std::uint32_t> newPositions(m_entities.size(), invalidPosition);
+	std::vector<std::uint8_t> removed(m_entities.size(), 0);
+	removed[m_sparse[entity.index]] = 1;
+
+	std::uint32_t kept{};
+	for (std::size_t i{ 0 }; i < m_entities.size(); ++i)
+	{
+		if (m_parents[i] != invalidPosition && removed[m_parents[i]])
+		{
+			removed[i] = 1;
+		}
+
+		if (removed[i])
+		{
+			m_sparse[m_entities[i].index] = invalidPosition;
+			continue;
+		}
+
+		newPositions[i] = kept;
+
+		m_entities[kept] = m_entities[i];
+		m_parents[kept] = m_parents[i] != invalidPosition ? newPositions[m_parents[i]] : invalidPosition;
+		m_depths[kept] = m_depths[i];
+		m_translations[kept] = m_translations[i];
+		m_rotations[kept] = m_rotations[i];
+		m_scales[kept] = m_scales[i];
+		m_dirty[kept] = m_dirty[i];
+		m_worlds[kept] = m_worlds[i];
+		m_sparse[m_entities[kept].index] = kept;
+
+		++kept;
+	}
+
+	m_entities.resize(kept);
+	m_parents.resize(kept);
+	m_depths.resize(kept);
+	m_translations.resize(kept);
+	m_rotations.resize(kept);
+	m_scales.resize(kept);
+	m_dirty.resize(kept);
+	m_worlds.resize(kept);
+}
+
+bool TransformHierarchy::contains(Entity entity) const
+{
+	return entity.index < m_sparse.size()
+		&& m_sparse[entity.index] != invalidPosition
+		&& m_entities[m_sparse[entity.index]] == entity;
+}
+
+
+
+void TransformHierarchy::setTranslation(Entity entity, const glm::vec3& translation)
+{
+	m_translations[m_sparse[entity.index]] = translation;
+	markDirty(entity);
+}
+
+void TransformHierarchy::setRotation(Entity entity, const glm::quat& rotation)
+{
+	m_rotations[m_sparse[entity.index]] = rotation;
+	markDirty(entity);
+}
+
+void TransformHierarchy::setScale(Entity entity, const glm::vec3& scale)
+{
+	m_scales[m_sparse[entity.index]] = scale;
+	markDirty(entity);
+}
+
+void TransformHierarchy::setLocal(Entity entity, const glm::vec3& translation, const glm::quat& rotation,
+	const glm::vec3& scale)
+{
+	const std::uint32_t position{ m_sparse[entity.index] };
+	m_translations[position] = translation;
+	m_rotations[position] = rotation;
+	m_scales[position] = scale;
+	markDirty(entity);
+}
+
+void TransformHierarchy::markDirty(Entity entity)
+{
+	m_dirty[m_sparse[entity.index]] = 1;
+	m_anyDirty = true;
+}
+
+
+
+void TransformHierarchy::update()
+{
+	if (!m_anyDirty)
+	{
+		return;
+	}
+
+	PROFILE_ZONE("Transform hierarchy");
+
+	for (std::size_t i{ 0 }; i < m_entities.size(); ++i)
+	{
+		const std::uint32_t parent{ m_parents[i] };
+		if (parent != invalidPosition && m_dirty[parent])
+		{
+			m_dirty[i] = 1;
+		}
+
+		if (!m_dirty[i])
+		{
+			continue;
+		}
+
+		const glm::mat4 local{ composeLocal(m_translations[i], m_rotations[i], m_scales[i]) };
+		if (parent != invalidPosition)
+		{
+			multiply(m_worlds[parent], local, m_worlds[i]);
+		}
+		else
+		{
+			m_worlds[i] = local;
+		}
+	}
+
+	std::fill(m_dirty.begin(), m_dirty.end(), 0);
+	m_anyDirty = false;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "entity.hpp"
+
+#include "glm/glm.hpp"
+#include "glm/gtc/quaternion.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Scene graph of local translation, rotation and scale. Nodes are stored
+// breadth first, in parallel arrays, so every parent comes before its
+// children and update() rebuilds world matrices in one linear pass: a node
+// is recomputed when it or any ancestor was changed since the last update,
+// and untouched subtrees keep last frame's matrices.
+//
+// Entities are added here separately from the Registry, and have to be
+// removed here too when they are destroyed.
+class TransformHierarchy final
+{
+public:
+
+	TransformHierarchy() = default;
+
+	TransformHierarchy(const TransformHierarchy&) = delete;
+	TransformHierarchy& operator=(const TransformHierarchy&) = delete;
+
+	// The parent must already be in the hierarchy; a default Entity makes a
+	// root. Shifts later nodes to keep the breadth first order, so this is
+	// meant for load time.
+	void add(Entity entity, Entity parent = {}, const glm::vec3& translation = glm::vec3{ 0.0f },
+		const glm::quat& rotation = glm::quat{ 1.0f, 0.0f, 0.0f, 0.0f }, const glm::vec3& scale = glm::vec3{ 1.0f });
+
+	// Removes the entity and everything below it
+	void remove(Entity entity);
+
+	bool contains(Entity entity) const;
+
+	// The entity must be in the hierarchy
+	void setTranslation(Entity entity, const glm::vec3& translation);
+	void setRotation(Entity entity, const glm::quat& rotation);
+	void setScale(Entity entity, const glm::vec3& scale);
+	void setLocal(Entity entity, const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale);
+
+	const glm::vec3& translation(Entity entity) const
+	{
+		return m_translations[m_sparse[entity.index]];
+	}
+
+	const glm::quat& rotation(Entity entity) const
+	{
+		return m_rotations[m_sparse[entity.index]];
+	}
+
+	const glm::vec3& scale(Entity entity) const
+	{
+		return m_scales[m_sparse[entity.index]];
+	}
+
+	// Recomputes the world matrices of changed nodes and their descendants
+	void update();
+
+	// As of the last update()
+	const glm::mat4& world(Entity entity) const
+	{
+		return m_worlds[m_sparse[entity.index]];
+	}
+
+	// Parallel arrays in breadth first order, for systems walking every node
+	const std::vector<Entity>& entities() const
+	{
+		return m_entities;
+	}
+
+	const std::vector<glm::mat4>& worlds() const
+	{
+		return m_worlds;
+	}
+
+	std::size_t size() const
+	{
+		return m_entities.size();
+	}
+
+private:
+
+	static constexpr std::uint32_t invalidPosition{ 0xFFFFFFFF };
+
+	// Entity index to position in the arrays below
+	std::vector<std::uint32_t> m_sparse{};
+
+	std::vector<Entity> m_entities{};
+	// Position of the parent, invalidPosition for roots
+	std::vector<std::uint32_t> m_parents{};
+	std::vector<std::uint32_t> m_depths{};
+
+	std::vector<glm::vec3> m_translations{};
+	std::vector<glm::quat> m_rotations{};
+	std::vector<glm::vec3> m_scales{};
+
+	// Set when the local transform changes; spread to descendants and
+	// cleared by update()
+	std::vector<std::uint8_t> m_dirty{};
+	bool m_anyDirty{ false };
+
+	std::vector<glm::mat4> m_worlds{};
+
+	void markDirty(Entity entity);
+};
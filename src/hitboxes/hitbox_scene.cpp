@@ -0,0 +1,544 @@
+#include "hitbox_scene.hpp"
+
+#include "../jobs/job_system.hpp"
+#include "../memory/frame_arena.hpp"
+#include "../profiler/profiler.hpp"
+#include "../renderer/renderer.hpp"
+
+#include "glm/glm.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IKLOB_HITBOX_SCENE_SSE
+#include <emmintrin.h>
+#endif
+
+#include <algorithm> // for std::sort, std::find_if, std::max, std::min
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility> // for std::pair
+#include <vector>
+
+namespace
+{
+	// Rays per job
+	constexpr std::size_t rayGrainSize{ 16 };
+
+	// Cells along either side of the instance grid at most, so a few far
+	// flung instances can't make it huge
+	constexpr int maxGridSide{ 256 };
+
+	std::size_t paddedToFour(std::size_t count)
+	{
+		return (count + 3) & ~std::size_t{ 3 };
+	}
+
+	// Largest factor the matrix scales any axis by, so spheres and capsule
+	// radii still cover what they did after a non-uniform scale
+	float maxScale(const glm::mat4& matrix)
+	{
+		return std::sqrt(std::max({ glm::dot(glm::vec3{ matrix[0] }, glm::vec3{ matrix[0] }),
+			glm::dot(glm::vec3{ matrix[1] }, glm::vec3{ matrix[1] }),
+			glm::dot(glm::vec3{ matrix[2] }, glm::vec3{ matrix[2] }) }));
+	}
+
+	// Distance along the ray to the sphere, with offset = origin - centre,
+	// for a direction of squared length directionSquared. 0 when starting
+	// inside, negative for a miss.
+	float raySphere(const glm::vec3& offset, const glm::vec3& direction, float directionSquared, float radius)
+	{
+		const float b{ glm::dot(direction, offset) };
+		const float c{ glm::dot(offset, offset) - radius * radius };
+		const float discriminant{ b * b - directionSquared * c };
+
+		if (c <= 0.0f)
+		{
+			return 0.0f;
+		}
+		return discriminant >= 0.0f ? (-b - std::sqrt(discriminant)) / directionSquared : -1.0f;
+	}
+
+#ifdef IKLOB_HITBOX_SCENE_SSE
+	__m128 dot3(__m128 ax, __m128 ay, __m128 az, __m128 bx, __m128 by, __m128 bz)
+	{
+		return _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)), _mm_mul_ps(az, bz));
+	}
+
+	// raySphere() for four spheres, with misses as infinity
+	__m128 raySphere4(__m128 offsetX, __m128 offsetY, __m128 offsetZ, __m128 directionX, __m128 directionY,
+		__m128 directionZ, __m128 directionSquared, __m128 radiusSquared)
+	{
+		const __m128 b{ dot3(directionX, directionY, directionZ, offsetX, offsetY, offsetZ) };
+		const __m128 c{ _mm_sub_ps(dot3(offsetX, offsetY, offsetZ, offsetX, offsetY, offsetZ), radiusSquared) };
+		const __m128 discriminant{ _mm_sub_ps(_mm_mul_ps(b, b), _mm_mul_ps(directionSquared, c)) };
+
+		const __m128 nearRoot{ _mm_div_ps(_mm_sub_ps(_mm_setzero_ps(),
+			_mm_add_ps(b, _mm_sqrt_ps(_mm_max_ps(discriminant, _mm_setzero_ps())))), directionSquared) };
+		// A ray starting inside has c <= 0 and hits at 0
+		const __m128 t{ _mm_max_ps(nearRoot, _mm_setzero_ps()) };
+		const __m128 valid{ _mm_and_ps(_mm_cmpge_ps(discriminant, _mm_setzero_ps()),
+			_mm_or_ps(_mm_cmpge_ps(nearRoot, _mm_setzero_ps()), _mm_cmple_ps(c, _mm_setzero_ps()))) };
+
+		return _mm_or_ps(_mm_and_ps(valid, t),
+			_mm_andnot_ps(valid, _mm_set1_ps(std::numeric_limits<float>::infinity())));
+	}
+#endif
+}
+
+
+
+void HitboxScene::pose(const std::vector<Renderer::Hitbox>& hitboxes, const glm::mat4* palette,
+	std::size_t paletteCount)
+{
+	m_hitboxCount = hitboxes.size();
+
+	const std::size_t padded{ paddedToFour(m_hitboxCount) };
+	m_startX.resize(padded);
+	m_startY.resize(padded);
+	m_startZ.resize(padded);
+	m_endX.resize(padded);
+	m_endY.resize(padded);
+	m_endZ.resize(padded);
+	m_radii.resize(padded);
+
+	glm::vec3 minimum{ std::numeric_limits<float>::max() };
+	glm::vec3 maximum{ -std::numeric_limits<float>::max() };
+
+	for (std::size_t i{ 0 }; i < padded; ++i)
+	{
+		if (m_hitboxCount == 0)
+		{
+			// Never hit
+			m_radii[i] = -1.0f;
+			continue;
+		}
+
+		const Renderer::Hitbox& hitbox{ hitboxes[std::min(i, m_hitboxCount - 1)] };
+		const glm::mat4 joint{ static_cast<std::size_t>(hitbox.joint) < paletteCount ? palette[hitbox.joint]
+			: glm::mat4{ 1.0f } };
+
+		const glm::vec3 start{ joint * glm::vec4{ hitbox.start, 1.0f } };
+		const glm::vec3 end{ joint * glm::vec4{ hitbox.end, 1.0f } };
+
+		m_startX[i] = start.x;
+		m_startY[i] = start.y;
+		m_startZ[i] = start.z;
+		m_endX[i] = end.x;
+		m_endY[i] = end.y;
+		m_endZ[i] = end.z;
+		m_radii[i] = hitbox.radius * maxScale(joint);
+
+		minimum = glm::min(minimum, glm::min(start, end) - m_radii[i]);
+		maximum = glm::max(maximum, glm::max(start, end) + m_radii[i]);
+	}
+
+	m_poseCentre = m_hitboxCount != 0 ? (minimum + maximum) * 0.5f : glm::vec3{ 0.0f };
+	m_poseRadius = 0.0f;
+	for (std::size_t i{ 0 }; i < m_hitboxCount; ++i)
+	{
+		const float toStart{ glm::length(glm::vec3{ m_startX[i], m_startY[i], m_startZ[i] } - m_poseCentre) };
+		const float toEnd{ glm::length(glm::vec3{ m_endX[i], m_endY[i], m_endZ[i] } - m_poseCentre) };
+		m_poseRadius = std::max(m_poseRadius, std::max(toStart, toEnd) + m_radii[i]);
+	}
+}
+
+void HitboxScene::setInstances(const glm::mat4* transforms, std::size_t count)
+{
+	m_transforms.assign(transforms, transforms + count);
+	m_centres.resize(count);
+	m_boundRadii.resize(count);
+
+	glm::vec2 minimum{ std::numeric_limits<float>::max() };
+	glm::vec2 maximum{ -std::numeric_limits<float>::max() };
+	float largestRadius{};
+
+	for (std::size_t i{ 0 }; i < count; ++i)
+	{
+		m_centres[i] = transforms[i] * glm::vec4{ m_poseCentre, 1.0f };
+		m_boundRadii[i] = m_hitboxCount != 0 ? m_poseRadius * maxScale(transforms[i]) : -1.0f;
+
+		minimum = glm::min(minimum, glm::vec2{ m_centres[i].x, m_centres[i].z } - m_boundRadii[i]);
+		maximum = glm::max(maximum, glm::vec2{ m_centres[i].x, m_centres[i].z } + m_boundRadii[i]);
+		largestRadius = std::max(largestRadius, m_boundRadii[i]);
+	}
+
+	if (count == 0 || m_hitboxCount == 0)
+	{
+		m_gridWidth = 0;
+		m_gridDepth = 0;
+		m_cellStarts.assign(1, 0);
+		m_cellInstances.clear();
+		return;
+	}
+
+	// About one instance per cell, but no smaller than a sphere, so each
+	// lands in at most four cells
+	const glm::vec2 extent{ maximum - minimum };
+	m_cellSize = std::max({ 2.0f * largestRadius, std::sqrt(extent.x * extent.y / static_cast<float>(count)),
+		std::max(extent.x, extent.y) / static_cast<float>(maxGridSide), 1e-3f });
+	m_gridOrigin = minimum;
+	m_gridWidth = std::max(1, static_cast<int>(std::ceil(extent.x / m_cellSize)));
+	m_gridDepth = std::max(1, static_cast<int>(std::ceil(extent.y / m_cellSize)));
+
+	// Counting sort into cells, as in SpatialHash
+	const auto cellRange{ [this](std::size_t instance, glm::ivec2& first, glm::ivec2& last) {
+		const glm::vec2 centre{ m_centres[instance].x, m_centres[instance].z };
+		first = glm::clamp(glm::ivec2{ glm::floor((centre - m_boundRadii[instance] - m_gridOrigin) / m_cellSize) },
+			glm::ivec2{ 0 }, glm::ivec2{ m_gridWidth - 1, m_gridDepth - 1 });
+		last = glm::clamp(glm::ivec2{ glm::floor((centre + m_boundRadii[instance] - m_gridOrigin) / m_cellSize) },
+			glm::ivec2{ 0 }, glm::ivec2{ m_gridWidth - 1, m_gridDepth - 1 });
+		} };
+
+	m_cellStarts.assign(static_cast<std::size_t>(m_gridWidth) * m_gridDepth + 1, 0);
+	for (std::size_t i{ 0 }; i < count; ++i)
+	{
+		glm::ivec2 first{};
+		glm::ivec2 last{};
+		cellRange(i, first, last);
+		for (int z{ first.y }; z <= last.y; ++z)
+		{
+			for (int x{ first.x }; x <= last.x; ++x)
+			{
+				++m_cellStarts[static_cast<std::size_t>(z) * m_gridWidth + x + 1];
+			}
+		}
+	}
+
+	for (std::size_t cell{ 1 }; cell < m_cellStarts.size(); ++cell)
+	{
+		m_cellStarts[cell] += m_cellStarts[cell - 1];
+	}
+
+	m_cellInstances.resize(m_cellStarts.back());
+	FrameArenaScope scratch{};
+	FrameVector<std::uint32_t> cursors(m_cellStarts.begin(), m_cellStarts.end() - 1);
+	for (std::size_t i{ 0 }; i < count; ++i)
+	{
+		glm::ivec2 first{};
+		glm::ivec2 last{};
+		cellRange(i, first, last);
+		for (int z{ first.y }; z <= last.y; ++z)
+		{
+			for (int x{ first.x }; x <= last.x; ++x)
+			{
+				m_cellInstances[cursors[static_cast<std::size_t>(z) * m_gridWidth + x]++] = static_cast<std::uint32_t>(i);
+			}
+		}
+	}
+}
+
+void HitboxScene::setEnabled(std::size_t instance, bool enabled)
+{
+	if (m_hitboxCount == 0)
+	{
+		return;
+	}
+
+	// The grid keeps the instance either way; only its radius changes
+	m_boundRadii[instance] = enabled ? m_poseRadius * maxScale(m_transforms[instance]) : -1.0f;
+}
+
+
+
+void HitboxScene::raycast(const Ray* rays, Hit* hits, std::size_t count, JobSystem* jobSystem) const
+{
+	PROFILE_ZONE("Hitbox raycasts");
+
+	const auto cast{ [this, rays, hits](std::size_t begin, std::size_t end) {
+		Scratch scratch{};
+		for (std::size_t i{ begin }; i < end; ++i)
+		{
+			hits[i] = raycast(rays[i], scratch);
+		}
+		} };
+
+	if (jobSystem)
+	{
+		jobSystem->parallelFor(count, rayGrainSize, cast);
+	}
+	else
+	{
+		cast(0, count);
+	}
+}
+
+HitboxScene::Hit HitboxScene::raycast(const Ray& ray, Scratch& scratch) const
+{
+	Hit ret{};
+	if (m_gridWidth == 0)
+	{
+		return ret;
+	}
+
+	// The part of the ray over the grid, by the slab method on X and Z
+	const glm::vec2 origin{ ray.origin.x, ray.origin.z };
+	const glm::vec2 direction{ ray.direction.x, ray.direction.z };
+	const glm::vec2 gridEnd{ m_gridOrigin + glm::vec2{ m_gridWidth, m_gridDepth } * m_cellSize };
+
+	float enter{ 0.0f };
+	float leave{ ray.maxDistance };
+	for (int axis{ 0 }; axis < 2; ++axis)
+	{
+		if (std::fabs(direction[axis]) < 1e-12f)
+		{
+			if (origin[axis] < m_gridOrigin[axis] || origin[axis] > gridEnd[axis])
+			{
+				return ret;
+			}
+			continue;
+		}
+
+		const float first{ (m_gridOrigin[axis] - origin[axis]) / direction[axis] };
+		const float second{ (gridEnd[axis] - origin[axis]) / direction[axis] };
+		enter = std::max(enter, std::min(first, second));
+		leave = std::min(leave, std::max(first, second));
+	}
+
+	if (enter > leave)
+	{
+		return ret;
+	}
+
+	// Walk the cells in the order the ray crosses them
+	const glm::vec2 start{ origin + direction * enter };
+	glm::ivec2 cell{ glm::clamp(glm::ivec2{ glm::floor((start - m_gridOrigin) / m_cellSize) }, glm::ivec2{ 0 },
+		glm::ivec2{ m_gridWidth - 1, m_gridDepth - 1 }) };
+
+	glm::ivec2 step{};
+	glm::vec2 nextBoundary{};
+	glm::vec2 boundaryInterval{};
+	for (int axis{ 0 }; axis < 2; ++axis)
+	{
+		if (std::fabs(direction[axis]) < 1e-12f)
+		{
+			step[axis] = 0;
+			nextBoundary[axis] = std::numeric_limits<float>::infinity();
+			boundaryInterval[axis] = std::numeric_limits<float>::infinity();
+			continue;
+		}
+
+		step[axis] = direction[axis] > 0.0f ? 1 : -1;
+		const float boundary{ m_gridOrigin[axis] + (cell[axis] + (step[axis] > 0 ? 1 : 0)) * m_cellSize };
+		nextBoundary[axis] = (boundary - origin[axis]) / direction[axis];
+		boundaryInterval[axis] = m_cellSize / std::fabs(direction[axis]);
+	}
+
+	scratch.tested.clear();
+	float nearest{ ray.maxDistance };
+
+	for (std::uint32_t walked{ 0 }; ; ++walked)
+	{
+		const std::size_t cellIndex{ static_cast<std::size_t>(cell.y) * m_gridWidth + cell.x };
+
+		// Cells are at least a sphere wide, so an instance covers at most 2 x
+		// 2 of them, and the walk passes through those within three steps
+		std::erase_if(scratch.tested, [walked](const std::pair<std::uint32_t, std::uint32_t>& tested) {
+			return tested.first + 2 < walked;
+			});
+
+		scratch.candidates.clear();
+		for (std::uint32_t entry{ m_cellStarts[cellIndex] }; entry < m_cellStarts[cellIndex + 1]; ++entry)
+		{
+			const std::uint32_t instance{ m_cellInstances[entry] };
+			const float radius{ m_boundRadii[instance] };
+
+			// Instances spanning several cells only need testing once
+			if (radius < 0.0f || std::find_if(scratch.tested.begin(), scratch.tested.end(),
+				[instance](const std::pair<std::uint32_t, std::uint32_t>& tested) { return tested.second == instance; })
+				!= scratch.tested.end())
+			{
+				continue;
+			}
+			scratch.tested.emplace_back(walked, instance);
+
+			const glm::vec3 offset{ ray.origin - m_centres[instance] };
+			const float b{ glm::dot(ray.direction, offset) };
+			const float discriminant{ b * b - glm::dot(offset, offset) + radius * radius };
+			if (discriminant < 0.0f)
+			{
+				continue;
+			}
+
+			const float root{ std::sqrt(discriminant) };
+			const float sphereEnter{ std::max(-b - root, 0.0f) };
+			if (root - b >= 0.0f && sphereEnter <= nearest)
+			{
+				scratch.candidates.emplace_back(sphereEnter, instance);
+			}
+		}
+
+		// Nearest sphere first, until the next one starts beyond the nearest
+		// capsule hit so far
+		std::sort(scratch.candidates.begin(), scratch.candidates.end());
+		for (const auto& [sphereEnter, instance] : scratch.candidates)
+		{
+			if (sphereEnter > nearest)
+			{
+				break;
+			}
+
+			// Distances along the moved ray match the original's, since the
+			// direction keeps whatever length the transform gives it
+			const glm::mat4 inverse{ glm::inverse(m_transforms[instance]) };
+			const glm::vec3 localOrigin{ inverse * glm::vec4{ ray.origin, 1.0f } };
+			const glm::vec3 localDirection{ inverse * glm::vec4{ ray.direction, 0.0f } };
+
+			const Hit hit{ raycastPose(localOrigin, localDirection, nearest) };
+			if (hit.hitbox >= 0)
+			{
+				ret = Hit{ static_cast<int>(instance), hit.hitbox, hit.distance };
+				nearest = hit.distance;
+			}
+		}
+
+		// Every instance reaching a point before the cell's far side is
+		// binned in a cell already visited
+		const int axis{ nextBoundary.x < nextBoundary.y ? 0 : 1 };
+		const float cellLeave{ std::min(nextBoundary[axis], leave) };
+		if (nearest <= cellLeave || nextBoundary[axis] > leave)
+		{
+			break;
+		}
+
+		cell[axis] += step[axis];
+		if (cell[axis] < 0 || cell[axis] >= (axis == 0 ? m_gridWidth : m_gridDepth))
+		{
+			break;
+		}
+		nextBoundary[axis] += boundaryInterval[axis];
+	}
+
+	return ret;
+}
+
+HitboxScene::Hit HitboxScene::raycastPose(const glm::vec3& origin, const glm::vec3& direction, float maxDistance) const
+{
+	// A capsule is the cylinder between its end points plus a sphere on
+	// each, so the nearest of the three hits is where the ray enters it. The
+	// cylinder only counts between the end points, where the spheres don't
+	// poke out of it.
+	Hit ret{};
+	float nearest{ maxDistance };
+
+	const float directionSquared{ glm::dot(direction, direction) };
+
+	std::size_t i{ 0 };
+#ifdef IKLOB_HITBOX_SCENE_SSE
+	const __m128 originX{ _mm_set1_ps(origin.x) };
+	const __m128 originY{ _mm_set1_ps(origin.y) };
+	const __m128 originZ{ _mm_set1_ps(origin.z) };
+	const __m128 directionX{ _mm_set1_ps(direction.x) };
+	const __m128 directionY{ _mm_set1_ps(direction.y) };
+	const __m128 directionZ{ _mm_set1_ps(direction.z) };
+	const __m128 directionSquared4{ _mm_set1_ps(directionSquared) };
+	const __m128 zero{ _mm_setzero_ps() };
+	const __m128 infinity{ _mm_set1_ps(std::numeric_limits<float>::infinity()) };
+
+	for (; i + 4 <= m_radii.size(); i += 4)
+	{
+		const __m128 startX{ _mm_loadu_ps(&m_startX[i]) };
+		const __m128 startY{ _mm_loadu_ps(&m_startY[i]) };
+		const __m128 startZ{ _mm_loadu_ps(&m_startZ[i]) };
+		const __m128 radius{ _mm_loadu_ps(&m_radii[i]) };
+		const __m128 radiusSquared{ _mm_mul_ps(radius, radius) };
+
+		const __m128 axisX{ _mm_sub_ps(_mm_loadu_ps(&m_endX[i]), startX) };
+		const __m128 axisY{ _mm_sub_ps(_mm_loadu_ps(&m_endY[i]), startY) };
+		const __m128 axisZ{ _mm_sub_ps(_mm_loadu_ps(&m_endZ[i]), startZ) };
+		const __m128 offsetX{ _mm_sub_ps(originX, startX) };
+		const __m128 offsetY{ _mm_sub_ps(originY, startY) };
+		const __m128 offsetZ{ _mm_sub_ps(originZ, startZ) };
+
+		const __m128 axisAxis{ dot3(axisX, axisY, axisZ, axisX, axisY, axisZ) };
+		const __m128 axisDirection{ dot3(axisX, axisY, axisZ, directionX, directionY, directionZ) };
+		const __m128 axisOffset{ dot3(axisX, axisY, axisZ, offsetX, offsetY, offsetZ) };
+		const __m128 directionOffset{ dot3(directionX, directionY, directionZ, offsetX, offsetY, offsetZ) };
+		const __m128 offsetOffset{ dot3(offsetX, offsetY, offsetZ, offsetX, offsetY, offsetZ) };
+
+		// The infinite cylinder, scaled through by axisAxis
+		const __m128 a{ _mm_sub_ps(_mm_mul_ps(axisAxis, directionSquared4), _mm_mul_ps(axisDirection, axisDirection)) };
+		const __m128 b{ _mm_sub_ps(_mm_mul_ps(axisAxis, directionOffset), _mm_mul_ps(axisOffset, axisDirection)) };
+		const __m128 c{ _mm_sub_ps(_mm_sub_ps(_mm_mul_ps(axisAxis, offsetOffset), _mm_mul_ps(axisOffset, axisOffset)),
+			_mm_mul_ps(radiusSquared, axisAxis)) };
+		const __m128 discriminant{ _mm_sub_ps(_mm_mul_ps(b, b), _mm_mul_ps(a, c)) };
+
+		// Rays along the axis divide by a == 0 and drop out below, leaving
+		// the spheres to catch them. Starting inside, c <= 0, hits at 0.
+		const __m128 inside{ _mm_cmple_ps(c, zero) };
+		const __m128 nearRoot{ _mm_div_ps(_mm_sub_ps(zero,
+			_mm_add_ps(b, _mm_sqrt_ps(_mm_max_ps(discriminant, zero)))), a) };
+		const __m128 cylinderT{ _mm_andnot_ps(inside, nearRoot) };
+		const __m128 along{ _mm_add_ps(axisOffset, _mm_mul_ps(cylinderT, axisDirection)) };
+		const __m128 onCylinder{ _mm_and_ps(
+			_mm_or_ps(inside, _mm_and_ps(_mm_cmpge_ps(discriminant, zero), _mm_cmpgt_ps(a, zero))),
+			_mm_and_ps(_mm_and_ps(_mm_cmpgt_ps(along, zero), _mm_cmplt_ps(along, axisAxis)),
+				_mm_cmpge_ps(cylinderT, zero))) };
+
+		__m128 t{ _mm_or_ps(_mm_and_ps(onCylinder, cylinderT), _mm_andnot_ps(onCylinder, infinity)) };
+
+		t = _mm_min_ps(t, raySphere4(offsetX, offsetY, offsetZ, directionX, directionY, directionZ,
+			directionSquared4, radiusSquared));
+		t = _mm_min_ps(t, raySphere4(_mm_sub_ps(offsetX, axisX), _mm_sub_ps(offsetY, axisY),
+			_mm_sub_ps(offsetZ, axisZ), directionX, directionY, directionZ, directionSquared4, radiusSquared));
+
+		// Padding and empty poses have negative radii
+		t = _mm_or_ps(_mm_and_ps(_mm_cmpge_ps(radius, zero), t), _mm_andnot_ps(_mm_cmpge_ps(radius, zero), infinity));
+
+		alignas(16) float distances[4];
+		_mm_store_ps(distances, t);
+		for (int lane{ 0 }; lane < 4; ++lane)
+		{
+			if (distances[lane] < nearest && i + lane < m_hitboxCount)
+			{
+				ret = Hit{ 0, static_cast<int>(i + lane), distances[lane] };
+				nearest = distances[lane];
+			}
+		}
+	}
+#endif
+	for (; i < m_hitboxCount; ++i)
+	{
+		const glm::vec3 start{ m_startX[i], m_startY[i], m_startZ[i] };
+		const glm::vec3 axis{ glm::vec3{ m_endX[i], m_endY[i], m_endZ[i] } - start };
+		const glm::vec3 offset{ origin - start };
+		const float radius{ m_radii[i] };
+
+		const float axisAxis{ glm::dot(axis, axis) };
+		const float axisDirection{ glm::dot(axis, direction) };
+		const float axisOffset{ glm::dot(axis, offset) };
+
+		const float a{ axisAxis * directionSquared - axisDirection * axisDirection };
+		const float b{ axisAxis * glm::dot(direction, offset) - axisOffset * axisDirection };
+		const float c{ axisAxis * glm::dot(offset, offset) - axisOffset * axisOffset - radius * radius * axisAxis };
+		const float discriminant{ b * b - a * c };
+
+		float t{ std::numeric_limits<float>::infinity() };
+		if (c <= 0.0f || (discriminant >= 0.0f && a > 0.0f))
+		{
+			const float cylinderT{ c <= 0.0f ? 0.0f : (-b - std::sqrt(discriminant)) / a };
+			const float along{ axisOffset + cylinderT * axisDirection };
+			if (along > 0.0f && along < axisAxis && cylinderT >= 0.0f)
+			{
+				t = cylinderT;
+			}
+		}
+
+		for (const glm::vec3& sphereOffset : { offset, offset - axis })
+		{
+			const float sphereT{ raySphere(sphereOffset, direction, directionSquared, radius) };
+			if (sphereT >= 0.0f)
+			{
+				t = std::min(t, sphereT);
+			}
+		}
+
+		if (t < nearest)
+		{
+			ret = Hit{ 0, static_cast<int>(i), t };
+			nearest = t;
+		}
+	}
+
+	return ret;
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "../renderer/renderer.hpp"
+
+#include "glm/glm.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <utility> // for std::pair
+#include <vector>
+
+class JobSystem;
+
+// Ray queries against the hitboxes of many instances of one skinned mesh,
+// every instance in the same pose, as drawn by Renderer::addInstancedDraw().
+//
+// The hitboxes are posed once per pose() into the mesh's space. Instances
+// are bounded by spheres, binned into a grid over the XZ plane. A ray walks
+// the grid cells it crosses in order and tests the instances in each one,
+// first their spheres and then, nearest first, their capsules four at a
+// time, with the ray moved into the instance's space. It stops at the first
+// cell that ends past its nearest hit, so a ray costs about the same however
+// many instances are around.
+class HitboxScene final
+{
+public:
+
+	// The direction must be normalised
+	struct Ray
+	{
+		glm::vec3 origin{};
+		glm::vec3 direction{};
+		float maxDistance{};
+	};
+
+	// instance and hitbox are -1 for a miss. hitbox indexes the hitboxes
+	// passed to pose().
+	struct Hit
+	{
+		int instance{ -1 };
+		int hitbox{ -1 };
+		float distance{};
+	};
+
+	HitboxScene() = default;
+
+	HitboxScene(const HitboxScene&) = delete;
+	HitboxScene& operator=(const HitboxScene&) = delete;
+
+	// palette as produced by calculateJointMatrix()
+	void pose(const std::vector<Renderer::Hitbox>& hitboxes, const glm::mat4* palette, std::size_t paletteCount);
+
+	// Model matrices of the instances; every instance starts enabled. Call
+	// after pose(), since the bounds depend on it.
+	void setInstances(const glm::mat4* transforms, std::size_t count);
+
+	// Rays pass through disabled instances
+	void setEnabled(std::size_t instance, bool enabled);
+
+	// One hit per ray, the nearest within its maxDistance. Rays are split
+	// across the job system when one is given.
+	void raycast(const Ray* rays, Hit* hits, std::size_t count, JobSystem* jobSystem = nullptr) const;
+
+private:
+
+	// Posed capsules in the mesh's space, padded with copies of the last one
+	// to a multiple of four
+	std::vector<float> m_startX{};
+	std::vector<float> m_startY{};
+	std::vector<float> m_startZ{};
+	std::vector<float> m_endX{};
+	std::vector<float> m_endY{};
+	std::vector<float> m_endZ{};
+	std::vector<float> m_radii{};
+	std::size_t m_hitboxCount{};
+
+	// Sphere around every posed capsule, in the mesh's space
+	glm::vec3 m_poseCentre{};
+	float m_poseRadius{};
+
+	std::vector<glm::mat4> m_transforms{};
+
+	// Bounding sphere per instance. Disabled instances get a negative
+	// radius, which no ray passes.
+	std::vector<glm::vec3> m_centres{};
+	std::vector<float> m_boundRadii{};
+
+	// Instances per cell, as [starts[c], starts[c + 1]) into
+	// m_cellInstances. An instance is in every cell its sphere overlaps.
+	glm::vec2 m_gridOrigin{};
+	float m_cellSize{ 1.0f };
+	int m_gridWidth{};
+	int m_gridDepth{};
+	std::vector<std::uint32_t> m_cellStarts{};
+	std::vector<std::uint32_t> m_cellInstances{};
+
+	// Per job, reused across its rays
+	struct Scratch
+	{
+		std::vector<std::pair<float, std::uint32_t>> candidates{};
+		// Instances tested in the last few cells, with the step they were
+		// tested at
+		std::vector<std::pair<std::uint32_t, std::uint32_t>> tested{};
+	};
+
+	Hit raycast(const Ray& ray, Scratch& scratch) const;
+
+	// Nearest capsule the ray hits before maxDistance, in the mesh's space;
+	// the direction need not be normalised
+	Hit raycastPose(const glm::vec3& origin, const glm::vec3& direction, float maxDistance) const;
+};
@@ -3,32 +3,68 @@
 #define SDL_MAIN_HANDLED
 #include "SDL/SDL.h"
 
-void Input::update(const SDL_Event& e)
+bool Input::translate(const SDL_Event& e, InputEvent& event)
 {
-	if (e.type == SDL_KEYDOWN || e.type == SDL_KEYUP)
+	switch (e.type)
 	{
-		switch (e.key.keysym.sym)
-		{
-		case SDLK_a:
-			keyStates[A] = (e.type == SDL_KEYDOWN);
-			break;
-		case SDLK_d:
-			keyStates[D] = (e.type == SDL_KEYDOWN);
-			break;
-		case SDLK_s:
-			keyStates[S] = (e.type == SDL_KEYDOWN);
-			break;
-		case SDLK_w:
-			keyStates[W] = (e.type == SDL_KEYDOWN);
-			break;
-		case SDLK_SPACE:
-			keyStates[SPACE] = (e.type == SDL_KEYDOWN);
-			break;
-		}
+	case SDL_QUIT:
+		event = InputEvent{ InputEvent::QUIT };
+		return true;
+	case SDL_MOUSEMOTION:
+		event = InputEvent{ InputEvent::LOOK, e.motion.xrel, e.motion.yrel };
+		return true;
+	case SDL_MOUSEBUTTONDOWN:
+		event = InputEvent{ InputEvent::SHOOT };
+		return true;
+	case SDL_KEYDOWN:
+	case SDL_KEYUP:
+		break;
+	default:
+		return false;
+	}
+
+	KeyCode key{};
+	switch (e.key.keysym.sym)
+	{
+	case SDLK_a:
+		key = A;
+		break;
+	case SDLK_d:
+		key = D;
+		break;
+	case SDLK_s:
+		key = S;
+		break;
+	case SDLK_w:
+		key = W;
+		break;
+	case SDLK_SPACE:
+		key = SPACE;
+		break;
+	default:
+		return false;
+	}
+
+	// Auto-repeat doesn't change any key state
+	if (e.key.repeat)
+	{
+		return false;
+	}
+
+	event = InputEvent{ e.type == SDL_KEYDOWN ? InputEvent::KEY_DOWN : InputEvent::KEY_UP, key };
+	return true;
+}
+
+void Input::apply(const InputEvent& event)
+{
+	if ((event.type == InputEvent::KEY_DOWN || event.type == InputEvent::KEY_UP)
+		&& event.x >= 0 && event.x < KEY_COUNT)
+	{
+		keyStates[event.x] = (event.type == InputEvent::KEY_DOWN);
 	}
 }
 
 bool Input::getKeyDown(KeyCode key) const
 {
 	return keyStates[key];
-}
\ No newline at end of file
+}
@@ -3,6 +3,28 @@
 #define SDL_MAIN_HANDLED
 #include "SDL/SDL.h"
 
+#include <cstdint>
+
+// The part of an SDL event gameplay reacts to. Ticks only ever see these,
+// so a session's input can be recorded and replayed without SDL.
+struct InputEvent
+{
+	enum Type : std::uint8_t
+	{
+		QUIT,
+		// Relative mouse motion in x and y
+		LOOK,
+		SHOOT,
+		// Input::KeyCode in x
+		KEY_DOWN,
+		KEY_UP,
+	};
+
+	Type type{ QUIT };
+	std::int32_t x{};
+	std::int32_t y{};
+};
+
 class Input
 {
 public:
@@ -14,13 +36,18 @@ public:
 		S,
 		W,
 		SPACE,
+		KEY_COUNT,
 	};
 
-	void update(const SDL_Event& e);
+	// False for events gameplay ignores
+	static bool translate(const SDL_Event& e, InputEvent& event);
+
+	// Tracks key state; other events pass through untouched
+	void apply(const InputEvent& event);
 
 	bool getKeyDown(KeyCode key) const;
 
 private:
 
-	bool keyStates[5]{};
-};
\ No newline at end of file
+	bool keyStates[KEY_COUNT]{};
+};
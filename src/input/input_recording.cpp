@@ -0,0 +1,310 @@
+#include "input_recording.hpp"
+
+#include "input.hpp"
+#include "../physics/broadphase.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator> // for std::istreambuf_iterator
+#include <string>
+#include <vector>
+
+namespace
+{
+	constexpr char recordingMagic[4]{ 'I', 'K', 'I', 'R' };
+	constexpr std::uint32_t recordingVersion{ 1 };
+
+	// Record kinds past the InputEvent types
+	constexpr std::uint8_t checksumKind{ 0x80 };
+	constexpr std::uint8_t endKind{ 0x81 };
+
+	// Small magnitudes of either sign become small varints
+	std::uint64_t zigZag(std::int32_t value)
+	{
+		return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(value)) << 1)
+			^ static_cast<std::uint64_t>(static_cast<std::int64_t>(value) >> 63);
+	}
+
+	std::int32_t unZigZag(std::uint64_t value)
+	{
+		return static_cast<std::int32_t>(static_cast<std::uint32_t>(value >> 1) ^ (0u - static_cast<std::uint32_t>(value & 1)));
+	}
+
+	// Reads the recording front to back; any read past the end clears ok
+	// and returns zeroes, so a truncated file just stops early
+	struct RecordingReader
+	{
+		const std::vector<unsigned char>& data;
+		std::size_t offset{};
+		bool ok{ true };
+
+		template <typename T>
+		T read()
+		{
+			T value{};
+			if (offset + sizeof(T) > data.size())
+			{
+				ok = false;
+				return value;
+			}
+			std::memcpy(&value, data.data() + offset, sizeof(T));
+			offset += sizeof(T);
+			return value;
+		}
+
+		std::uint64_t readVarint()
+		{
+			std::uint64_t value{};
+			for (int shift{ 0 }; shift < 64; shift += 7)
+			{
+				const auto byte{ read<std::uint8_t>() };
+				value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+				if (!(byte & 0x80))
+				{
+					return value;
+				}
+			}
+			ok = false;
+			return 0;
+		}
+	};
+}
+
+
+
+InputRecorder::InputRecorder(const std::string& path, const RecordingHeader& header)
+	: m_file{ path, std::ios::binary }
+{
+	if (!m_file)
+	{
+		std::cerr << "INPUT RECORDER: ERROR: Could not create " << path << '\n';
+		m_file.close();
+		return;
+	}
+
+	m_file.write(recordingMagic, sizeof(recordingMagic));
+	m_file.write(reinterpret_cast<const char*>(&recordingVersion), sizeof(recordingVersion));
+	m_file.write(reinterpret_cast<const char*>(&header.tickSeconds), sizeof(header.tickSeconds));
+	m_file.write(reinterpret_cast<const char*>(&header.zombies), sizeof(header.zombies));
+	m_file.write(reinterpret_cast<const char*>(&header.broadphase), sizeof(header.broadphase));
+	m_file.write(reinterpret_cast<const char*>(&header.mbpSubdivisions), sizeof(header.mbpSubdivisions));
+}
+
+InputRecorder::~InputRecorder()
+{
+	if (valid() && !m_finished)
+	{
+		finish(m_tick);
+	}
+}
+
+void InputRecorder::record(std::uint32_t tick, const InputEvent& event)
+{
+	if (!valid())
+	{
+		return;
+	}
+
+	writeRecord(tick, event.type);
+
+	switch (event.type)
+	{
+	case InputEvent::LOOK:
+		writeVarint(zigZag(event.x));
+		writeVarint(zigZag(event.y));
+		break;
+	case InputEvent::KEY_DOWN:
+	case InputEvent::KEY_UP:
+	{
+		const auto key{ static_cast<std::uint8_t>(event.x) };
+		m_file.write(reinterpret_cast<const char*>(&key), sizeof(key));
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+void InputRecorder::recordChecksum(std::uint32_t tick, std::uint64_t checksum)
+{
+	if (!valid())
+	{
+		return;
+	}
+
+	writeRecord(tick, checksumKind);
+	m_file.write(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+	m_file.flush();
+}
+
+void InputRecorder::finish(std::uint32_t tick)
+{
+	if (!valid() || m_finished)
+	{
+		return;
+	}
+
+	writeRecord(tick, endKind);
+	m_file.flush();
+	m_finished = true;
+}
+
+void InputRecorder::writeRecord(std::uint32_t tick, std::uint8_t kind)
+{
+	writeVarint(tick - m_tick);
+	m_file.write(reinterpret_cast<const char*>(&kind), sizeof(kind));
+	m_tick = tick;
+}
+
+void InputRecorder::writeVarint(std::uint64_t value)
+{
+	char bytes[10]{};
+	int count{};
+	do
+	{
+		bytes[count] = static_cast<char>(value & 0x7f);
+		value >>= 7;
+		if (value != 0)
+		{
+			bytes[count] = static_cast<char>(bytes[count] | 0x80);
+		}
+		++count;
+	} while (value != 0);
+
+	m_file.write(bytes, count);
+}
+
+
+
+InputReplay::InputReplay(const std::string& path)
+{
+	std::ifstream inputStream{ path, std::ios::binary };
+	if (!inputStream)
+	{
+		std::cerr << "INPUT REPLAY: ERROR: Could not open " << path << '\n';
+		return;
+	}
+
+	const std::vector<unsigned char> data{ std::istreambuf_iterator<char>{ inputStream }, std::istreambuf_iterator<char>{} };
+	RecordingReader reader{ data };
+
+	char magic[4]{};
+	for (char& character : magic)
+	{
+		character = reader.read<char>();
+	}
+	const auto version{ reader.read<std::uint32_t>() };
+	m_header.tickSeconds = reader.read<double>();
+	m_header.zombies = reader.read<std::int32_t>();
+	m_header.broadphase = reader.read<std::uint8_t>();
+	m_header.mbpSubdivisions = reader.read<std::uint32_t>();
+
+	if (!reader.ok || std::memcmp(magic, recordingMagic, sizeof(magic)) != 0 || version != recordingVersion)
+	{
+		std::cerr << "INPUT REPLAY: ERROR: " << path << " is not a version " << recordingVersion << " recording\n";
+		return;
+	}
+	if (m_header.broadphase > static_cast<std::uint8_t>(Broadphase::abp))
+	{
+		std::cerr << "INPUT REPLAY: ERROR: " << path << " names unknown broadphase " << +m_header.broadphase << '\n';
+		return;
+	}
+
+	std::uint32_t tick{};
+	bool ended{ false };
+	while (!ended && reader.offset < data.size())
+	{
+		tick += static_cast<std::uint32_t>(reader.readVarint());
+		const auto kind{ reader.read<std::uint8_t>() };
+
+		TimedEvent event{ tick };
+		bool isEvent{ true };
+
+		switch (kind)
+		{
+		case InputEvent::QUIT:
+		case InputEvent::SHOOT:
+			event.event = InputEvent{ static_cast<InputEvent::Type>(kind) };
+			break;
+		case InputEvent::LOOK:
+		{
+			const std::int32_t x{ unZigZag(reader.readVarint()) };
+			const std::int32_t y{ unZigZag(reader.readVarint()) };
+			event.event = InputEvent{ InputEvent::LOOK, x, y };
+			break;
+		}
+		case InputEvent::KEY_DOWN:
+		case InputEvent::KEY_UP:
+			event.event = InputEvent{ static_cast<InputEvent::Type>(kind), reader.read<std::uint8_t>() };
+			break;
+		case checksumKind:
+		{
+			const auto checksum{ reader.read<std::uint64_t>() };
+			if (reader.ok)
+			{
+				m_checksums.push_back({ tick, checksum });
+			}
+			isEvent = false;
+			break;
+		}
+		case endKind:
+			ended = true;
+			isEvent = false;
+			break;
+		default:
+			reader.ok = false;
+			break;
+		}
+
+		// A record cut off by a crash is dropped along with everything after
+		if (!reader.ok)
+		{
+			break;
+		}
+
+		if (isEvent)
+		{
+			m_events.push_back(event);
+		}
+
+		m_tickCount = tick + 1;
+	}
+
+	if (!ended)
+	{
+		std::cerr << "INPUT REPLAY: WARNING: " << path << " ends early, replaying " << m_tickCount << " ticks\n";
+	}
+
+	m_valid = true;
+}
+
+void InputReplay::tickEvents(std::uint32_t tick, std::vector<InputEvent>& events)
+{
+	while (m_nextEvent < m_events.size() && m_events[m_nextEvent].tick <= tick)
+	{
+		if (m_events[m_nextEvent].tick == tick)
+		{
+			events.push_back(m_events[m_nextEvent].event);
+		}
+		++m_nextEvent;
+	}
+}
+
+bool InputReplay::checksum(std::uint32_t tick, std::uint64_t& checksum)
+{
+	while (m_nextChecksum < m_checksums.size() && m_checksums[m_nextChecksum].tick < tick)
+	{
+		++m_nextChecksum;
+	}
+
+	if (m_nextChecksum < m_checksums.size() && m_checksums[m_nextChecksum].tick == tick)
+	{
+		checksum = m_checksums[m_nextChecksum].checksum;
+		return true;
+	}
+
+	return false;
+}
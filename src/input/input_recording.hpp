@@ -0,0 +1,115 @@
+#pragma once
+
+#include "input.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Launch settings that change what a tick computes, so a replay can run
+// with the same ones as the recorded session
+struct RecordingHeader
+{
+	double tickSeconds{};
+	std::int32_t zombies{};
+	std::uint8_t broadphase{};
+	std::uint32_t mbpSubdivisions{};
+};
+
+// Writes the input every fixed-step tick consumed to a file, together with
+// a checksum of the simulation state now and then, so the session can be
+// replayed tick for tick and checked for divergence. Records are varint
+// coded against the previous tick and are a few bytes each; a still player
+// costs nothing but the checksums.
+//
+// The file is flushed at every checksum, so a crashed session still leaves
+// a replayable capture up to the last one.
+class InputRecorder final
+{
+public:
+
+	InputRecorder(const std::string& path, const RecordingHeader& header);
+	~InputRecorder();
+
+	InputRecorder(const InputRecorder&) = delete;
+	InputRecorder& operator=(const InputRecorder&) = delete;
+
+	bool valid() const
+	{
+		return m_file.is_open();
+	}
+
+	// Ticks must not go backwards
+	void record(std::uint32_t tick, const InputEvent& event);
+	void recordChecksum(std::uint32_t tick, std::uint64_t checksum);
+
+	// Marks the last tick of the session, which may have seen no input
+	void finish(std::uint32_t tick);
+
+private:
+
+	std::ofstream m_file{};
+	std::uint32_t m_tick{};
+	bool m_finished{ false };
+
+	void writeRecord(std::uint32_t tick, std::uint8_t kind);
+	void writeVarint(std::uint64_t value);
+};
+
+// A recording read back in full, handed out tick by tick
+class InputReplay final
+{
+public:
+
+	explicit InputReplay(const std::string& path);
+
+	InputReplay(const InputReplay&) = delete;
+	InputReplay& operator=(const InputReplay&) = delete;
+
+	bool valid() const
+	{
+		return m_valid;
+	}
+
+	const RecordingHeader& header() const
+	{
+		return m_header;
+	}
+
+	// Number of ticks the session ran for
+	std::uint32_t tickCount() const
+	{
+		return m_tickCount;
+	}
+
+	// Appends the events the tick consumed, in order. Ticks must be asked
+	// for in increasing order.
+	void tickEvents(std::uint32_t tick, std::vector<InputEvent>& events);
+
+	// Checksum recorded after the tick, if there is one
+	bool checksum(std::uint32_t tick, std::uint64_t& checksum);
+
+private:
+
+	struct TimedEvent
+	{
+		std::uint32_t tick{};
+		InputEvent event{};
+	};
+
+	struct TimedChecksum
+	{
+		std::uint32_t tick{};
+		std::uint64_t checksum{};
+	};
+
+	RecordingHeader m_header{};
+	std::vector<TimedEvent> m_events{};
+	std::vector<TimedChecksum> m_checksums{};
+	std::size_t m_nextEvent{};
+	std::size_t m_nextChecksum{};
+	std::uint32_t m_tickCount{};
+	bool m_valid{ false };
+};
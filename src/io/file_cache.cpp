@@ -0,0 +1,126 @@
+#include "file_cache.hpp"
+
+#include <algorithm> // for std::copy
+#include <cstddef>
+#include <cstdint>
+#include <cstdio> // for std::snprintf
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator> // for std::begin, std::end
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace
+{
+	constexpr char cacheMagic[4]{ 'I', 'K', 'F', 'C' };
+
+	struct CacheHeader
+	{
+		char magic[4]{};
+		std::uint32_t version{};
+		std::uint64_t key{};
+		std::uint64_t size{};
+	};
+}
+
+
+
+FileCache::FileCache(const std::string& directory, const std::string& extension, std::uint32_t version)
+	: m_directory{ directory }
+	, m_extension{ extension }
+	, m_version{ version }
+{
+	if (m_directory.empty())
+	{
+		return;
+	}
+
+	std::error_code error{};
+	std::filesystem::create_directories(m_directory, error);
+	if (error)
+	{
+		std::cerr << "FILE CACHE: ERROR: Could not create " << m_directory << ": " << error.message() << '\n';
+		m_directory.clear();
+	}
+}
+
+bool FileCache::load(std::uint64_t key, std::vector<unsigned char>& data) const
+{
+	if (m_directory.empty())
+	{
+		return false;
+	}
+
+	std::ifstream inputStream{ path(key), std::ios::binary };
+	if (!inputStream)
+	{
+		return false;
+	}
+
+	CacheHeader header{};
+	inputStream.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (!inputStream || std::string(header.magic, 4) != std::string(cacheMagic, 4)
+		|| header.version != m_version || header.key != key)
+	{
+		return false;
+	}
+
+	// The stored size is only trusted once it matches what follows the
+	// header, so a corrupt entry can't ask for a huge allocation
+	const std::streamoff dataStart{ inputStream.tellg() };
+	inputStream.seekg(0, std::ios::end);
+	const std::streamoff dataLength{ inputStream.tellg() - dataStart };
+	if (!inputStream || dataLength < 0 || header.size != static_cast<std::uint64_t>(dataLength))
+	{
+		return false;
+	}
+	inputStream.seekg(dataStart);
+
+	data.resize(static_cast<std::size_t>(header.size));
+	inputStream.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size()));
+	return static_cast<bool>(inputStream);
+}
+
+void FileCache::store(std::uint64_t key, const void* data, std::size_t size) const
+{
+	if (m_directory.empty())
+	{
+		return;
+	}
+
+	CacheHeader header{};
+	std::copy(std::begin(cacheMagic), std::end(cacheMagic), header.magic);
+	header.version = m_version;
+	header.key = key;
+	header.size = size;
+
+	const std::string finalPath{ path(key) };
+	const std::string temporaryPath{ finalPath + ".tmp" };
+	{
+		std::ofstream outputStream{ temporaryPath, std::ios::binary | std::ios::trunc };
+		outputStream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		outputStream.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+		if (!outputStream)
+		{
+			std::cerr << "FILE CACHE: ERROR: Could not write " << temporaryPath << '\n';
+			return;
+		}
+	}
+
+	std::error_code error{};
+	std::filesystem::rename(temporaryPath, finalPath, error);
+	if (error)
+	{
+		std::cerr << "FILE CACHE: ERROR: Could not write " << finalPath << ": " << error.message() << '\n';
+		std::filesystem::remove(temporaryPath, error);
+	}
+}
+
+std::string FileCache::path(std::uint64_t key) const
+{
+	char name[32]{};
+	std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(key));
+	return (std::filesystem::path{ m_directory } / (name + m_extension)).string();
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Blobs that are expensive to rebuild, one file per 64 bit content key in a
+// directory. The key is stored in the file too, along with a version, so a
+// stale or foreign file is a miss rather than garbage. An empty directory
+// disables the cache: every load misses and stores do nothing.
+class FileCache final
+{
+public:
+
+	// Files are named <key in hex><extension>. Bump version whenever the
+	// blob layout changes.
+	FileCache(const std::string& directory, const std::string& extension, std::uint32_t version);
+
+	bool load(std::uint64_t key, std::vector<unsigned char>& data) const;
+
+	// Written next to the final name and renamed, so a second instance
+	// starting at the same time never reads half a file
+	void store(std::uint64_t key, const void* data, std::size_t size) const;
+
+private:
+
+	std::string m_directory{};
+	std::string m_extension{};
+	std::uint32_t m_version{};
+
+	std::string path(std::uint64_t key) const;
+};
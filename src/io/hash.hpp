@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// FNV-1a over raw bytes, for content keys of on-disk caches. Not meant to
+// resist anyone crafting collisions, only to tell revisions apart.
+constexpr std::uint64_t hashSeed{ 0xcbf29ce484222325ull };
+
+inline std::uint64_t hashBytes(std::uint64_t hash, const void* data, std::size_t size)
+{
+	const auto* bytes{ static_cast<const unsigned char*>(data) };
+	for (std::size_t i{ 0 }; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+// The value's object representation, so only for plain data without
+// padding. Standard layout rather than trivially copyable, since PhysX's
+// vector types declare their own copy constructors.
+template <typename T>
+std::uint64_t hashValue(std::uint64_t hash, const T& value)
+{
+	static_assert(std::is_standard_layout_v<T> && !std::is_pointer_v<T>);
+	return hashBytes(hash, &value, sizeof(T));
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdio> // for std::snprintf
+#include <ostream>
+
+// Writes string as the inside of a JSON string literal, without the quotes
+inline void writeJsonEscaped(std::ostream& out, const char* string)
+{
+	for (const char* c{ string }; *c != '\0'; ++c)
+	{
+		if (*c == '"' || *c == '\\')
+		{
+			out << '\\' << *c;
+		}
+		else if (static_cast<unsigned char>(*c) < 0x20)
+		{
+			char escaped[8]{};
+			std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned char>(*c));
+			out << escaped;
+		}
+		else
+		{
+			out << *c;
+		}
+	}
+}
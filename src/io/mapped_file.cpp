@@ -0,0 +1,117 @@
+#include "mapped_file.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& path)
+{
+	m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (m_file == INVALID_HANDLE_VALUE)
+	{
+		m_file = nullptr;
+		std::cerr << "MAPPED FILE: ERROR: Could not open " << path << '\n';
+		return;
+	}
+
+	LARGE_INTEGER size{};
+	GetFileSizeEx(m_file, &size);
+	m_size = static_cast<std::size_t>(size.QuadPart);
+
+	// Nothing to map; valid() stays false
+	if (m_size == 0)
+	{
+		return;
+	}
+
+	m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (m_mapping)
+	{
+		m_data = static_cast<const unsigned char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+	}
+
+	if (!m_data)
+	{
+		std::cerr << "MAPPED FILE: ERROR: Could not map " << path << '\n';
+		m_size = 0;
+	}
+}
+
+MappedFile::~MappedFile()
+{
+	if (m_data)
+	{
+		UnmapViewOfFile(m_data);
+	}
+	if (m_mapping)
+	{
+		CloseHandle(m_mapping);
+	}
+	if (m_file)
+	{
+		CloseHandle(m_file);
+	}
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& path)
+{
+	m_file = open(path.c_str(), O_RDONLY);
+	if (m_file == -1)
+	{
+		std::cerr << "MAPPED FILE: ERROR: Could not open " << path << '\n';
+		return;
+	}
+
+	struct stat status{};
+	fstat(m_file, &status);
+	m_size = static_cast<std::size_t>(status.st_size);
+
+	// Nothing to map; valid() stays false
+	if (m_size == 0)
+	{
+		return;
+	}
+
+	void* data{ mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_file, 0) };
+	if (data == MAP_FAILED)
+	{
+		std::cerr << "MAPPED FILE: ERROR: Could not map " << path << '\n';
+		m_size = 0;
+		return;
+	}
+
+	// Loaders read front to back
+	madvise(data, m_size, MADV_SEQUENTIAL);
+
+	m_data = static_cast<const unsigned char*>(data);
+}
+
+MappedFile::~MappedFile()
+{
+	if (m_data)
+	{
+		munmap(const_cast<unsigned char*>(m_data), m_size);
+	}
+	if (m_file != -1)
+	{
+		close(m_file);
+	}
+}
+
+#endif
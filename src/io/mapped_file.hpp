@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file. The contents stay valid for the
+// lifetime of the object; pages are faulted in by the OS on first touch, so
+// nothing is copied up front.
+class MappedFile final
+{
+public:
+
+	explicit MappedFile(const std::string& path);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool valid() const
+	{
+		return m_data != nullptr;
+	}
+
+	const unsigned char* data() const
+	{
+		return m_data;
+	}
+	std::size_t size() const
+	{
+		return m_size;
+	}
+
+private:
+
+	const unsigned char* m_data{ nullptr };
+	std::size_t m_size{};
+
+#ifdef _WIN32
+	void* m_file{};
+	void* m_mapping{};
+#else
+	int m_file{ -1 };
+#endif
+};
@@ -0,0 +1,199 @@
+#include "job_system.hpp"
+
+#include "../memory/frame_arena.hpp"
+#include "../memory/memory_tracker.hpp"
+#include "../profiler/profiler.hpp"
+
+#include <algorithm> // for std::max
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility> // for std::move
+
+namespace
+{
+	// Which queue the current thread owns in which pool. Threads that are
+	// not part of a pool share queue 0.
+	thread_local const JobSystem* t_jobSystem{ nullptr };
+	thread_local unsigned t_queueIndex{ 0 };
+}
+
+JobSystem::JobSystem()
+	: JobSystem{ std::max(std::thread::hardware_concurrency(), 2u) - 1u }
+{}
+
+JobSystem::JobSystem(unsigned workerCount)
+{
+	// PhysX blocks the main thread in fetchResults(), so at least one worker
+	// must exist to drain queue 0.
+	workerCount = std::max(workerCount, 1u);
+
+	for (unsigned i{ 0 }; i < workerCount + 1; ++i)
+	{
+		m_queues.push_back(std::make_unique<WorkQueue>());
+	}
+
+	t_jobSystem = this;
+	t_queueIndex = 0;
+
+	for (unsigned i{ 0 }; i < workerCount; ++i)
+	{
+		m_workers.emplace_back(&JobSystem::workerLoop, this, i + 1);
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard lock{ m_sleepMutex };
+		m_quit = true;
+	}
+	m_wake.notify_all();
+
+	for (auto& worker : m_workers)
+	{
+		worker.join();
+	}
+
+	if (t_jobSystem == this)
+	{
+		t_jobSystem = nullptr;
+	}
+}
+
+
+
+void JobSystem::schedule(Job job, JobCounter* counter)
+{
+	if (counter)
+	{
+		counter->value.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	WorkQueue& queue{ *m_queues[currentQueueIndex()] };
+	{
+		std::lock_guard lock{ queue.mutex };
+		queue.entries.push_back(Entry{ std::move(job), counter, MemoryTracker::currentTag() });
+	}
+
+	{
+		std::lock_guard lock{ m_sleepMutex };
+		m_pendingJobs.fetch_add(1, std::memory_order_release);
+	}
+	m_wake.notify_one();
+}
+
+void JobSystem::wait(JobCounter& counter)
+{
+	const unsigned queueIndex{ currentQueueIndex() };
+
+	while (counter.value.load(std::memory_order_acquire) > 0)
+	{
+		if (!runOne(queueIndex))
+		{
+			// Whatever is left is already running on another thread
+			std::this_thread::yield();
+		}
+	}
+}
+
+
+
+bool JobSystem::popOwn(unsigned queueIndex, Entry& entry)
+{
+	WorkQueue& queue{ *m_queues[queueIndex] };
+
+	std::lock_guard lock{ queue.mutex };
+	if (queue.entries.empty())
+	{
+		return false;
+	}
+
+	entry = std::move(queue.entries.back());
+	queue.entries.pop_back();
+
+	return true;
+}
+
+bool JobSystem::steal(unsigned thiefIndex, Entry& entry)
+{
+	const auto queueCount{ static_cast<unsigned>(m_queues.size()) };
+
+	// Start at the neighbour so thieves don't all hammer the same victim
+	for (unsigned i{ 1 }; i < queueCount; ++i)
+	{
+		WorkQueue& victim{ *m_queues[(thiefIndex + i) % queueCount] };
+
+		std::unique_lock lock{ victim.mutex, std::try_to_lock };
+		if (!lock.owns_lock() || victim.entries.empty())
+		{
+			continue;
+		}
+
+		entry = std::move(victim.entries.front());
+		victim.entries.pop_front();
+
+		return true;
+	}
+
+	return false;
+}
+
+bool JobSystem::runOne(unsigned queueIndex)
+{
+	Entry entry{};
+	if (!popOwn(queueIndex, entry) && !steal(queueIndex, entry))
+	{
+		return false;
+	}
+
+	m_pendingJobs.fetch_sub(1, std::memory_order_relaxed);
+
+	{
+		MemoryTracker::Scope memoryScope{ entry.memoryTag };
+		entry.job();
+	}
+
+	if (entry.counter)
+	{
+		entry.counter->value.fetch_sub(1, std::memory_order_release);
+	}
+
+	return true;
+}
+
+unsigned JobSystem::currentQueueIndex() const
+{
+	return (t_jobSystem == this) ? t_queueIndex : 0u;
+}
+
+
+
+void JobSystem::workerLoop(unsigned queueIndex)
+{
+	t_jobSystem = this;
+	t_queueIndex = queueIndex;
+
+	Profiler::setThreadName("Worker " + std::to_string(queueIndex));
+
+	while (true)
+	{
+		if (runOne(queueIndex))
+		{
+			// Jobs only get scratch memory from the arena
+			FrameArena::local().reset();
+			continue;
+		}
+
+		std::unique_lock lock{ m_sleepMutex };
+		m_wake.wait(lock, [this]() {
+			return m_quit || m_pendingJobs.load(std::memory_order_acquire) > 0; });
+
+		if (m_quit)
+		{
+			break;
+		}
+	}
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "../memory/memory_tracker.hpp"
+
+#include <algorithm> // for std::min
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional> // for std::function
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fork/join counter. Every job scheduled against a counter increments it and
+// decrements it when finished, so wait() returns once all of them are done.
+struct JobCounter
+{
+	std::atomic<int> value{ 0 };
+};
+
+// Work-stealing thread pool shared by physics, animation, culling and asset
+// loading. Every worker owns a deque: it pushes and pops at the back (so hot
+// data stays in cache) and other threads steal from the front when they run
+// dry. The thread that created the pool owns queue 0 and participates in the
+// work whenever it waits on a counter. Threads outside the pool (PhysX
+// callbacks, the render thread) push onto queue 0 as well and are stolen from.
+class JobSystem final
+{
+public:
+
+	using Job = std::function<void()>;
+
+	// The pool is sized to the machine by default: one worker per hardware
+	// thread, minus the creating thread which helps out in wait().
+	JobSystem();
+	explicit JobSystem(unsigned workerCount);
+
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	void schedule(Job job, JobCounter* counter = nullptr);
+
+	// Runs queued jobs on the calling thread until the counter reaches zero
+	void wait(JobCounter& counter);
+
+	// Splits [0, count) into chunks of grainSize and calls
+	// function(begin, end) for each chunk across the pool. Blocks until done.
+	template <typename Function>
+	void parallelFor(std::size_t count, std::size_t grainSize, Function&& function)
+	{
+		if (count == 0)
+		{
+			return;
+		}
+
+		grainSize = std::max<std::size_t>(grainSize, 1);
+
+		// Not worth the scheduling overhead
+		if (count <= grainSize)
+		{
+			function(std::size_t{ 0 }, count);
+			return;
+		}
+
+		JobCounter counter{};
+		for (std::size_t begin{ 0 }; begin < count; begin += grainSize)
+		{
+			const std::size_t end{ std::min(begin + grainSize, count) };
+			schedule([&function, begin, end]() { function(begin, end); }, &counter);
+		}
+
+		wait(counter);
+	}
+
+	unsigned workerCount() const
+	{
+		return static_cast<unsigned>(m_workers.size());
+	}
+
+private:
+
+	struct Entry
+	{
+		Job job{};
+		JobCounter* counter{};
+		// Of the scheduling thread, so jobs allocate on behalf of whoever
+		// scheduled them
+		MemoryTracker::Tag memoryTag{ MemoryTracker::UNTAGGED };
+	};
+
+	struct WorkQueue
+	{
+		std::mutex mutex{};
+		std::deque<Entry> entries{};
+	};
+
+	// Queue 0 belongs to the creating thread, queue i + 1 to worker i
+	std::vector<std::unique_ptr<WorkQueue>> m_queues{};
+	std::vector<std::thread> m_workers{};
+
+	std::atomic<int> m_pendingJobs{ 0 };
+	std::atomic<bool> m_quit{ false };
+
+	std::mutex m_sleepMutex{};
+	std::condition_variable m_wake{};
+
+	bool popOwn(unsigned queueIndex, Entry& entry);
+	bool steal(unsigned thiefIndex, Entry& entry);
+	bool runOne(unsigned queueIndex);
+
+	unsigned currentQueueIndex() const;
+
+	void workerLoop(unsigned queueIndex);
+};
@@ -1,29 +1,59 @@
-#include "entity_system/entity.hpp"
+#include "config/config.hpp"
+#include "crowd/crowd.hpp"
+#include "entity_system/components.hpp"
+#include "entity_system/registry.hpp"
+#include "entity_system/transform_hierarchy.hpp"
+#include "hitboxes/hitbox_scene.hpp"
+#include "renderer/animation.hpp"
+#include "renderer/gl_resource_tracker.hpp"
+#include "renderer/light_clusters.hpp"
+#include "renderer/render_snapshot.hpp"
+#include "renderer/render_thread.hpp"
 #include "renderer/renderer.hpp"
 #include "input/input.hpp"
+#include "input/input_recording.hpp"
 #include "entity_system/camera.hpp"
+#include "io/hash.hpp"
+#include "jobs/job_system.hpp"
+#include "memory/frame_arena.hpp"
+#include "memory/memory_tracker.hpp"
+#include "navigation/flow_field.hpp"
+#include "navigation/nav_grid.hpp"
+#include "physics/broadphase.hpp"
+#include "physics/crowd_bodies.hpp"
+#include "physics/job_cpu_dispatcher.hpp"
+#include "physics/level_collision.hpp"
+#include "physics/nav_grid_builder.hpp"
+#include "physics/physics_stepper.hpp"
+#include "physics/tracking_allocator.hpp"
+#include "profiler/profiler.hpp"
 
 #include "glm/glm.hpp"
-#include "glm/gtc/matrix_transform.hpp"
+#include "glm/gtc/quaternion.hpp"
 #include <PxPhysicsAPI.h>
 #define SDL_MAIN_HANDLED
 #include "SDL/sdl.h"
 
+#include <algorithm> // for std::sort
+#include <chrono>
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
+#include <memory>
 #include <string>
-#include <unordered_map>
-#include <utility> // for std::pair
+#include <thread>
+#include <vector>
 
 //temp
 //#include "glm/gtx/string_cast.hpp"
 
 struct PhysicsState
 {
-	physx::PxDefaultAllocator defaultAllocatorCallback{};
+	TrackingAllocator allocatorCallback{};
 	physx::PxDefaultErrorCallback defaultErrorCallback{};
 
-	physx::PxDefaultCpuDispatcher* dispatcher{};
+	std::unique_ptr<JobCpuDispatcher> dispatcher{};
 	physx::PxTolerancesScale toleranceScale{};
 	physx::PxCooking* cooking{};
 
@@ -40,19 +70,24 @@ struct PhysicsState
 };
 
 // Verify no temps are created here that should be in PhysicsState
-void initPhysicsState(PhysicsState& physicsState)
+void initPhysicsState(PhysicsState& physicsState, JobSystem& jobSystem, const Config& config)
 {
 	physicsState.foundation = PxCreateFoundation(PX_PHYSICS_VERSION, 
-		physicsState.defaultAllocatorCallback, physicsState.defaultErrorCallback);
+		physicsState.allocatorCallback, physicsState.defaultErrorCallback);
 	if (!physicsState.foundation)
 	{
 		// Todo: standardize errors
 		std::cerr << "Error: PxCreateFoundation failed\n";
 	}
 
-	physicsState.pvd = physx::PxCreatePvd(*physicsState.foundation);
-	physicsState.transport = physx::PxDefaultPvdSocketTransportCreate("", 5425, 10);
-	physicsState.pvd->connect(*physicsState.transport, physx::PxPvdInstrumentationFlag::eALL);
+	// PVD is opt-in; trying to connect costs startup time and instrumenting
+	// everything costs frame time even when nothing is listening
+	if (config.pvd)
+	{
+		physicsState.pvd = physx::PxCreatePvd(*physicsState.foundation);
+		physicsState.transport = physx::PxDefaultPvdSocketTransportCreate("", 5425, 10);
+		physicsState.pvd->connect(*physicsState.transport, physx::PxPvdInstrumentationFlag::eALL);
+	}
 
 	physicsState.toleranceScale.length = 1.0f;
 	physicsState.toleranceScale.speed = 9.81f;
@@ -60,15 +95,16 @@ void initPhysicsState(PhysicsState& physicsState)
 	physicsState.physics = PxCreatePhysics(PX_PHYSICS_VERSION, *physicsState.foundation, 
 		physicsState.toleranceScale, true, physicsState.pvd);
 
-	physicsState.dispatcher = physx::PxDefaultCpuDispatcherCreate(1);
+	physicsState.dispatcher = std::make_unique<JobCpuDispatcher>(jobSystem);
 
 	physicsState.cooking = PxCreateCooking(PX_PHYSICS_VERSION, *physicsState.foundation, 
 		physx::PxCookingParams{ physicsState.toleranceScale });
 
 	physx::PxSceneDesc sceneDesc{ physicsState.physics->getTolerancesScale() };
 	sceneDesc.gravity = physx::PxVec3(0.0f, -9.81f, 0.0f);
-	sceneDesc.cpuDispatcher = physicsState.dispatcher;
+	sceneDesc.cpuDispatcher = physicsState.dispatcher.get();
 	sceneDesc.filterShader = physx::PxDefaultSimulationFilterShader;
+	applyBroadphase(sceneDesc, config.broadphase);
 	physicsState.scene = physicsState.physics->createScene(sceneDesc);
 
 	physicsState.controllerManager = PxCreateControllerManager(*physicsState.scene);
@@ -84,123 +120,259 @@ void initPhysicsState(PhysicsState& physicsState)
 	physicsState.defaultMaterial = physicsState.physics->createMaterial(0.5f, 0.5f, 0.6f);
 }
 
-int main()
+// Where the player and every zombie stand, to catch a replay drifting from
+// its recording
+std::uint64_t hashSimulation(const Camera& camera, const Crowd& crowd)
+{
+	std::uint64_t hash{ hashValue(hashSeed, camera.getPos()) };
+	for (std::uint32_t agent{ 0 }; agent < crowd.size(); ++agent)
+	{
+		hash = hashValue(hash, crowd.position(agent));
+	}
+	return hash;
+}
+
+// Heap per subsystem, GL memory and the frame arenas
+void dumpMemory()
 {
+	MemoryTracker::dump(std::cout);
+	GlResourceTracker::dump(std::cout);
+
+	const FrameArena::Stats arenaStats{ FrameArena::totalStats() };
+	std::cout << "FRAME ARENA: high water " << arenaStats.highWater / 1024 << " KiB of "
+		<< arenaStats.capacity / 1024 << " KiB reserved, " << arenaStats.spills << " spills\n";
+}
+
+int main(int argc, char* argv[])
+{
+	Config config{ parseCommandLine(argc, argv) };
+
+	constexpr double deltaTime{ 1.0 / 60.0 };
+
+	// A replay runs with the settings it was recorded with
+	std::unique_ptr<InputReplay> replay{};
+	if (!config.replayInput.empty())
+	{
+		replay = std::make_unique<InputReplay>(config.replayInput);
+		if (!replay->valid())
+		{
+			return 1;
+		}
+		if (replay->header().tickSeconds != deltaTime)
+		{
+			std::cerr << "INPUT REPLAY: ERROR: Recorded at a tick of " << replay->header().tickSeconds << " s\n";
+			return 1;
+		}
+
+		config.zombies = replay->header().zombies;
+		config.broadphase.type = static_cast<Broadphase>(replay->header().broadphase);
+		config.broadphase.mbpSubdivisions = replay->header().mbpSubdivisions;
+	}
+
+	Profiler::setEnabled(!config.profileOutput.empty());
+	Profiler::setThreadName("Main");
+
+	// The renderer and loader tag their own allocations; the rest of what
+	// this thread allocates is the game's
+	MemoryTracker::Scope memoryScope{ MemoryTracker::GAMEPLAY };
+
 	SDL_Init(SDL_INIT_VIDEO);
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 6);
 	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
-	SDL_GL_SetAttribute(SDL_GL_MULTISAMPLEBUFFERS, 1);
-	SDL_GL_SetAttribute(SDL_GL_MULTISAMPLESAMPLES, 16);
-	SDL_Window* window{ SDL_CreateWindow("iklob", 100, 100, 1600, 900, SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE) };
+	// The renderer multisamples its own offscreen target and only blits
+	// the result into the window
+	SDL_GL_SetAttribute(SDL_GL_MULTISAMPLEBUFFERS, 0);
+	SDL_Window* window{ SDL_CreateWindow("iklob", 100, 100, 1600, 900, 
+		SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE | (replay ? SDL_WINDOW_HIDDEN : 0)) };
 	SDL_GLContext glContext{ SDL_GL_CreateContext(window) };
 	SDL_GL_MakeCurrent(window, glContext);
 
 	Input input{};
 
+	// One pool for the whole engine, sized to the machine
+	JobSystem jobSystem{};
+
 	Renderer renderer{};
-	renderer.init();
+	renderer.init(config.shaderCache);
 	renderer.setViewport(window);
+	renderer.setMsaaSamples(config.msaa);
+	renderer.setDynamicResolution(config.targetFrameMs, config.minRenderScale);
 
-	constexpr int modelCount{ 3 };
-	std::pair<std::string, std::string> modelPaths[modelCount]
-	{
-		{ "assets/demo.glb", "level" },
-		{ "assets/zombie.glb", "zombie" },
-		{ "assets/gun.glb", "gun" }
-	};
+	const std::vector<MeshHandle> meshes{ renderer.loadScene(
+		{
+			{ "assets/demo.glb", "level" },
+			{ "assets/zombie.glb", "zombie" },
+			{ "assets/gun.glb", "gun" }
+		}, jobSystem) };
 
-	renderer.loadScene(modelCount, modelPaths);
+	Registry registry{};
+	TransformHierarchy transforms{};
 
-	glm::mat4 zombieTransform = glm::translate(glm::mat4{ 1.0f }, glm::vec3{0.0f, 1.0f, 0.0f});
+	const Entity level{ registry.create() };
+	transforms.add(level);
+	registry.add(level, MeshRenderer{ meshes[0] });
 
-	glm::mat4 gunTransform = glm::translate(glm::mat4{ 1.0f }, glm::vec3{0.0f, 2.0f, 0.0f});
-	gunTransform = glm::scale(gunTransform, glm::vec3{ 0.2f });
+	// The gun hangs off the camera, so it only needs its offset in the
+	// camera's space; the model itself sits 2 units up at a fifth of its size
+	const Entity cameraNode{ registry.create() };
+	transforms.add(cameraNode);
 
-	std::unordered_map<std::string, Entity> entities
-	{
-		{ "level", Entity{ { Entity::MeshID{ glm::mat4{ 1.0f }, "level" }}}},
-		{ "zombie", Entity{ zombieTransform, { Entity::MeshID{ glm::mat4{ 1.0f }, "zombie" } } } },
-		{ "gun", Entity{ glm::mat4{ 1.0f }, { Entity::MeshID{ gunTransform, "gun" } } } },
-	};
+	const Entity gunHand{ registry.create() };
+	transforms.add(gunHand, cameraNode, glm::vec3{ -0.15f, -0.55f, 0.1f }, glm::quat{ 1.0f, 0.0f, 0.0f, 0.0f },
+		glm::vec3{ 0.2f }); // Put gun in left hand
+
+	const Entity gun{ registry.create() };
+	transforms.add(gun, gunHand, glm::vec3{ 0.0f, 2.0f, 0.0f }, glm::quat{ 1.0f, 0.0f, 0.0f, 0.0f }, glm::vec3{ 0.2f });
+	registry.add(gun, MeshRenderer{ meshes[2] });
 
 	PhysicsState physicsState{};
-	initPhysicsState(physicsState);
-
-	physx::PxShape* groundBox{ physicsState.physics->createShape(
-		physx::PxBoxGeometry{ 6.0f, 1.0f, 6.0f }, *physicsState.defaultMaterial) };
-	physx::PxRigidStatic* groundRigid{ 
-		physicsState.physics->createRigidStatic(physx::PxTransform{ physx::PxVec3{ 0.0f, 0.0f, 0.0f } }) };
-	groundRigid->attachShape(*groundBox);
-	physicsState.scene->addActor(*groundRigid);
-	
-	physx::PxShape* boxBox{ physicsState.physics->createShape(physx::PxBoxGeometry{ 1.0f, 1.0f, 1.0f }, 
-		*physicsState.defaultMaterial) };
-	physx::PxRigidStatic* boxRigid{ physicsState.physics->createRigidStatic(
-		physx::PxTransform{ physx::PxVec3{ 4.0f, 2.0f, -4.0f } }) };
-	boxRigid->attachShape(*boxBox);
-	physicsState.scene->addActor(*boxRigid);
-	
+	initPhysicsState(physicsState, jobSystem, config);
+
+	// Collides with the same level the renderer draws, cooked once and then
+	// read back from the cache on later launches
+	auto levelCollision{ std::make_unique<LevelCollision>(*physicsState.physics, *physicsState.cooking,
+		*physicsState.scene, *physicsState.defaultMaterial, "assets/demo.glb", config.collisionCache) };
+	addBroadphaseRegions(*physicsState.scene, config.broadphase);
+
 	Camera camera{ { 0.0f, 6.0f, 2.0f, }, physicsState.controllerManager, physicsState.defaultMaterial };
 
-	glm::vec3 zombiePos{ 0.0f, 1.0f, 0.0f };
-	float zombieAngle{ 0.0f };
-	bool zombieDead{ false };
+	// The horde paths around the level through one field shared by every
+	// zombie, recomputed a slice per tick as the player moves
+	NavGrid navGrid{};
+	buildNavGrid(navGrid, *physicsState.scene, NavGridSettings{}, config.navCache, &jobSystem);
+	FlowField flowField{ navGrid };
+	constexpr std::size_t flowFieldCellBudget{ 4096 };
+
+	// Spiral out from the origin, so any horde size stays evenly packed
+	Crowd crowd{};
+	for (int i{ 0 }; i < config.zombies; ++i)
+	{
+		const float angle{ i * 2.3999632f };
+		const float distance{ 1.5f * std::sqrt(static_cast<float>(i)) };
+		crowd.spawn(glm::vec3{ std::cos(angle) * distance, 1.0f, std::sin(angle) * distance });
+	}
+	std::vector<glm::mat4> crowdTransforms{};
+
+	// Shots are collected over a tick's events and resolved in one batch
+	HitboxScene crowdHitboxes{};
+	std::vector<HitboxScene::Ray> shots{};
+	std::vector<HitboxScene::Hit> shotHits{};
+
+	// Released before the scene
+	auto crowdBodies{ std::make_unique<CrowdBodies>(*physicsState.physics, *physicsState.scene,
+		*physicsState.defaultMaterial, 0.4f, 0.6f) };
 
 	float shootTime{ -10000.0 };
+	float hurtTime{ -10000.0 };
 
 	bool quit{ false };
 
+	std::unique_ptr<InputRecorder> recorder{};
+	if (!config.recordInput.empty())
+	{
+		recorder = std::make_unique<InputRecorder>(config.recordInput, RecordingHeader{ deltaTime, config.zombies,
+			static_cast<std::uint8_t>(config.broadphase.type), config.broadphase.mbpSubdivisions });
+	}
+
+	std::uint32_t tick{};
+	std::vector<InputEvent> tickEvents{};
+
+	// Checksums are cheap, but there's no need for one every tick
+	constexpr std::uint32_t checksumInterval{ 60 };
+	std::int64_t divergedTick{ -1 };
+	std::vector<double> replayTickTimes{};
+
+	// From here on the GL context belongs to the render thread
+	RenderThread renderThread{ window, glContext, renderer };
+
 	double accumulator{ 0.0 };
 	double lastTime{ SDL_GetTicks64() * 0.001 };
+	double lastMemoryDump{ lastTime };
 	bool drawn{ false };
 
-	constexpr double deltaTime{ 1.0 / 60.0 };
+	PhysicsStepper physicsStepper{ physicsState.scene, config.asyncPhysics };
 
 	while (!quit)
 	{
+		physicsStepper.poll();
+
+		if (replay && tick >= replay->tickCount())
+		{
+			break;
+		}
+
 		double currentTime{ SDL_GetTicks64() * 0.001 };
-		accumulator += currentTime - lastTime;
+		if (replay)
+		{
+			// Replays ignore the clock and run exactly one tick per iteration,
+			// as fast as the tick allows
+			accumulator = deltaTime * 1.5;
+		}
+		else
+		{
+			accumulator += currentTime - lastTime;
+		}
 		lastTime = currentTime;
 
 		glm::vec3 lightColor{ 1.0f, 1.0f, 0.71f };
-		if (currentTime - shootTime < 0.25f)
+		if (currentTime - hurtTime < 0.25f)
 		{
-			// Lazy muzzle flash/blood effect
+			// Lazy blood effect
 			lightColor = glm::mix(glm::vec3{ 1.0f, 0.5f, 0.0f }, glm::vec3{ 1.0f, 1.0f, 0.71f }, 
-				static_cast<float>(currentTime - shootTime) * 4.0f);
+				static_cast<float>(currentTime - hurtTime) * 4.0f);
 		}
 
 		while (accumulator > deltaTime)
 		{
-			for (auto& mesh : renderer.meshes)
+			PROFILE_ZONE("Tick");
+
+			const auto tickStart{ std::chrono::steady_clock::now() };
+
+			renderer.eachMesh([&](MeshHandle, Renderer::Mesh& mesh)
+				{
+					mesh.time += deltaTime;
+					if (mesh.time > mesh.maxTime)
+					{
+						mesh.time = 0.0;
+					}
+				});
+
+			tickEvents.clear();
+			if (replay)
+			{
+				replay->tickEvents(tick, tickEvents);
+			}
+			else
 			{
-				// Only play animations if the zombie is still alive.
-				// This is fine since the zombie is the only animated
-				// mesh.
-				if (!zombieDead)
+				SDL_SetRelativeMouseMode(SDL_TRUE);
+
+				SDL_Event e{};
+				while (SDL_PollEvent(&e) != 0)
 				{
-					mesh.second.time += accumulator;
-					if (mesh.second.time > mesh.second.maxTime)
+					InputEvent event{};
+					if (Input::translate(e, event))
 					{
-						mesh.second.time = 0.0;
+						tickEvents.push_back(event);
+						if (recorder)
+						{
+							recorder->record(tick, event);
+						}
 					}
 				}
 			}
 
-			SDL_SetRelativeMouseMode(SDL_TRUE);
-
-			SDL_Event e{};
-			while (SDL_PollEvent(&e) != 0)
+			for (const InputEvent& event : tickEvents)
 			{
-				if (e.type == SDL_QUIT)
+				if (event.type == InputEvent::QUIT)
 				{
-					quit = true;
+					// A replay always runs to its last recorded tick
+					quit = quit || !replay;
 				}
-				else if (e.type == SDL_MOUSEMOTION)
+				else if (event.type == InputEvent::LOOK)
 				{
-					camera.m_yaw += e.motion.xrel * static_cast<float>(deltaTime) * camera.m_lookSpeed;
-					camera.m_pitch -= e.motion.yrel * static_cast<float>(deltaTime) * camera.m_lookSpeed;
+					camera.m_yaw += event.x * static_cast<float>(deltaTime) * camera.m_lookSpeed;
+					camera.m_pitch -= event.y * static_cast<float>(deltaTime) * camera.m_lookSpeed;
 
 					if (camera.m_pitch > 89.0f)
 					{
@@ -211,111 +383,208 @@ int main()
 						camera.m_pitch = -89.0f;
 					}
 				}
-				else if (e.type == SDL_MOUSEBUTTONDOWN)
+				else if (event.type == InputEvent::SHOOT)
 				{
 					shootTime = currentTime;
 
-					glm::vec3 zombieHitboxPos{ zombiePos.x, zombiePos.y + 2.0f, zombiePos.z };
-					double zombieHitboxRadius{ 1.0f };
-
-					// Trace ray against zombie hitbox to detect if shot lands
-					const glm::vec3 m{ 
-						glm::vec3{ camera.getPos().x, camera.getPos().y, camera.getPos().z } - zombieHitboxPos };
-					const double b{ glm::dot(m, camera.getForwardVec()) };
-					const double c{ glm::dot(m, m) - (zombieHitboxRadius * zombieHitboxRadius) };
-					if (!(c > 0.0 && b > 0.0))
-					{
-						const double discr{ b * b - c };
-
-						if (!(discr < 0.0))
-						{
-							zombieDead = true;
-						}
-					}
+					shots.push_back(HitboxScene::Ray{
+						glm::vec3{ camera.getPos().x, camera.getPos().y, camera.getPos().z },
+						camera.getForwardVec(), 1000.0f });
 				}
 				else
 				{
-					input.update(e);
+					input.apply(event);
 				}
 			}
 
-			if (!zombieDead)
+			if (!shots.empty())
 			{
-				if (camera.getPos().z >= zombiePos.z)
+				// Trace the shots against the zombies' hitboxes in the pose
+				// they are drawn in
+				const Renderer::Mesh& zombieMesh{ renderer.mesh(meshes[1]) };
+				FrameVector<glm::mat4> palette(zombieMesh.joints.size());
+				calculateJointMatrix(zombieMesh, palette.data());
+				crowdHitboxes.pose(zombieMesh.hitboxes, palette.data(), palette.size());
+
+				crowd.writeTransforms(crowdTransforms);
+				crowdHitboxes.setInstances(crowdTransforms.data(), crowdTransforms.size());
+				for (std::size_t i{ 0 }; i < crowd.size(); ++i)
 				{
-					zombieAngle = std::atan((camera.getPos().x - zombiePos.x) / (camera.getPos().z - zombiePos.z));
+					crowdHitboxes.setEnabled(i, !crowd.dying(static_cast<std::uint32_t>(i)));
 				}
-				else
-				{
-					zombieAngle = (std::atan(1.0f) * 4.0f) + std::atan((camera.getPos().x - zombiePos.x) / (camera.getPos().z - zombiePos.z));
-				}
-				zombiePos.x += std::sin(zombieAngle) * deltaTime;
-				zombiePos.z += std::cos(zombieAngle) * deltaTime;
 
-				if (glm::distance(glm::vec3{ camera.getPos().x, camera.getPos().y, camera.getPos().z }, zombiePos) < 3.0f)
+				shotHits.resize(shots.size());
+				crowdHitboxes.raycast(shots.data(), shotHits.data(), shots.size(), &jobSystem);
+				for (const HitboxScene::Hit& hit : shotHits)
 				{
-					// Doing this makes the screen red
-					shootTime = currentTime + 1.0f;
-					// Bounce player back
-					camera.setVel({ -camera.getForwardVec().x * 5.0f, camera.getVel().y, -camera.getForwardVec().z * 5.0f });
+					if (hit.instance >= 0)
+					{
+						crowd.kill(static_cast<std::uint32_t>(hit.instance));
+					}
 				}
+
+				shots.clear();
 			}
-			else
+
+			const glm::vec3 playerPos{ camera.getPos().x, camera.getPos().y, camera.getPos().z };
+			flowField.setTarget(playerPos);
+			flowField.update(flowFieldCellBudget);
+			crowd.update(playerPos, static_cast<float>(deltaTime), &jobSystem, &flowField);
+
+			if (crowd.anyWithin(playerPos, 3.0f))
 			{
-				// Sink zombie into ground
-				zombiePos.y -= 1.0f * deltaTime;
+				// Doing this makes the screen red
+				hurtTime = currentTime + 1.0f;
+				// Bounce player back
+				camera.setVel({ -camera.getForwardVec().x * 5.0f, camera.getVel().y, -camera.getForwardVec().z * 5.0f });
 			}
 
-			zombieTransform = glm::translate(glm::mat4{ 1.0f }, zombiePos);
-			zombieTransform = glm::rotate(zombieTransform, zombieAngle, glm::vec3{ 0.0f, 1.0f, 0.0f });
-			entities.at("zombie").setTransform(zombieTransform);
-
 			camera.calculateFrontVec();
 			camera.update(input, deltaTime);
-			physicsState.scene->simulate(deltaTime);
-			physicsState.scene->fetchResults(true);
 
-			glm::vec3 gunPos{ camera.getPos().x, camera.getPos().y, camera.getPos().z };
-			glm::mat4 gunTransform{ glm::translate(glm::mat4{ 1.0f }, gunPos) };
-			gunTransform = glm::rotate(gunTransform, glm::radians(-camera.m_yaw + 180), glm::vec3{ 0.0f, 1.0f, 0.0f });
-			gunTransform = glm::rotate(gunTransform, glm::radians(-camera.m_pitch), glm::vec3{ 0.0f, 0.0f, 1.0f });
-			gunTransform = { glm::translate(gunTransform, glm::vec3{ -0.15f, -0.55f, 0.1f }) }; // Put gun in left hand
-			gunTransform = glm::scale(gunTransform, glm::vec3{ 0.2f });
-			entities.at("gun").setTransform(gunTransform);
+			// Scene writes are batched up to here, then the step runs in the
+			// background while the snapshot is built and the next frame starts.
+			{
+				PROFILE_ZONE("Physics sync");
+				physicsStepper.sync();
+			}
+			camera.applyPendingMove();
+			crowdBodies->sync(crowd);
+			physicsStepper.kick(deltaTime);
+
+			const glm::vec3 cameraPos{ camera.getPos().x, camera.getPos().y, camera.getPos().z };
+			const glm::quat cameraRotation{
+				glm::angleAxis(glm::radians(-camera.m_yaw + 180), glm::vec3{ 0.0f, 1.0f, 0.0f })
+				* glm::angleAxis(glm::radians(-camera.m_pitch), glm::vec3{ 0.0f, 0.0f, 1.0f }) };
+			transforms.setLocal(cameraNode, cameraPos, cameraRotation, glm::vec3{ 1.0f });
+
+			if (tick % checksumInterval == 0)
+			{
+				const std::uint64_t checksum{ hashSimulation(camera, crowd) };
+				std::uint64_t recordedChecksum{};
+				if (recorder)
+				{
+					recorder->recordChecksum(tick, checksum);
+				}
+				if (replay && divergedTick < 0 && replay->checksum(tick, recordedChecksum)
+					&& recordedChecksum != checksum)
+				{
+					std::cerr << "INPUT REPLAY: ERROR: Diverged from the recording by tick " << tick << '\n';
+					divergedTick = tick;
+				}
+			}
+
+			if (replay)
+			{
+				replayTickTimes.push_back(std::chrono::duration<double, std::milli>(
+					std::chrono::steady_clock::now() - tickStart).count());
+				Profiler::endFrame();
+			}
 
+			++tick;
 			accumulator -= deltaTime;
 			drawn = false;
 		}
 
-		if (!drawn)
+		if (!drawn && !replay)
 		{
+			PROFILE_ZONE("Build snapshot");
+			MemoryTracker::Scope snapshotMemoryScope{ MemoryTracker::RENDERER };
+
 			const auto& pxCamPos{ camera.getPos() };
-			glm::vec3 cameraPosition{ pxCamPos.x, pxCamPos.y, pxCamPos.z };
 
-			renderer.setViewport(window);
-			renderer.beginRendering(cameraPosition, camera.getForwardVec(),
-				90.0f, 16.0f / 9.0f, 0.1f, 500.0f, lightColor);
+			RenderSnapshot& snapshot{ renderThread.beginSnapshot() };
+			snapshot.cameraPosition = { pxCamPos.x, pxCamPos.y, pxCamPos.z };
+			snapshot.cameraLook = camera.getForwardVec();
+			snapshot.lightColor = lightColor;
 
-			for (const auto& entity : entities)
+			constexpr float muzzleFlashDuration{ 0.1f };
+			const float flashAge{ static_cast<float>(currentTime - shootTime) };
+			if (flashAge < muzzleFlashDuration)
 			{
-				entity.second.render([&](Entity::MeshID m, const glm::mat4& tr)
-					{
-						renderer.renderMesh(m.second, tr * m.first);
-					});
+				// Just ahead of the gun, fading out over the flash
+				const glm::vec3 muzzlePosition{ snapshot.cameraPosition + snapshot.cameraLook * 1.0f
+					+ glm::vec3{ 0.0f, -0.4f, 0.0f } };
+				snapshot.lights.push_back(PointLight{ muzzlePosition, 10.0f, glm::vec3{ 1.0f, 0.6f, 0.2f },
+					40.0f * (1.0f - flashAge / muzzleFlashDuration) });
 			}
 
-			SDL_GL_SwapWindow(window);
+			transforms.update();
+			registry.each<MeshRenderer>([&](Entity entity, const MeshRenderer& mesh)
+				{
+					renderer.addDraw(snapshot, mesh.mesh, transforms.world(entity));
+				});
+
+			crowd.writeTransforms(crowdTransforms);
+			renderer.addInstancedDraw(snapshot, meshes[1], crowdTransforms.data(), crowdTransforms.size());
+
+			assignLights(snapshot.lightClusters, snapshot.lights, snapshot.viewMatrix(), snapshot.fieldOfView,
+				snapshot.aspectRatio, snapshot.nearPlane, snapshot.farPlane, &jobSystem);
+
+			renderThread.publishSnapshot();
 			drawn = true;
 		}
+
+		FrameArena::local().reset();
+
+		if (config.memoryDumpSeconds > 0.0 && currentTime - lastMemoryDump >= config.memoryDumpSeconds)
+		{
+			dumpMemory();
+			lastMemoryDump = currentTime;
+		}
+
+		// The swap paces the render thread, not this one. With the snapshot
+		// published and no tick due there is nothing to do, so give the core
+		// to the job workers and PhysX until the next tick instead of spinning.
+		// Replays stay uncapped.
+		if (!replay && drawn && accumulator <= deltaTime)
+		{
+			PROFILE_ZONE("Wait for tick");
+			std::this_thread::sleep_for(std::chrono::duration<double>{ deltaTime - accumulator });
+		}
+	}
+
+	renderThread.stop();
+
+	if (recorder && tick > 0)
+	{
+		recorder->finish(tick - 1);
 	}
 
+	if (replay && !replayTickTimes.empty())
+	{
+		std::sort(replayTickTimes.begin(), replayTickTimes.end());
+		double total{};
+		for (double tickTime : replayTickTimes)
+		{
+			total += tickTime;
+		}
+
+		std::cout << "INPUT REPLAY: " << replayTickTimes.size() << " ticks in " << total * 0.001 << " s, "
+			<< replayTickTimes.size() * 1000.0 / total << " ticks/s, p50 "
+			<< replayTickTimes[replayTickTimes.size() / 2] << " ms, p99 "
+			<< replayTickTimes[replayTickTimes.size() * 99 / 100] << " ms, max "
+			<< replayTickTimes.back() << " ms, " << (divergedTick < 0 ? "matches" : "diverged from")
+			<< " the recording\n";
+	}
+
+	dumpMemory();
+
+	physicsStepper.sync();
+	crowdBodies.reset();
+	levelCollision.reset();
 	physicsState.scene->release();
 	physicsState.physics->release();
 	physicsState.foundation->release();
 
 	renderer.cleanup();
 
+	if (!config.profileOutput.empty())
+	{
+		Profiler::exportChromeTrace(config.profileOutput);
+	}
+
 	SDL_DestroyWindow(window);
 
-	return 0;
+	return divergedTick < 0 ? 0 : 1;
 }
\ No newline at end of file
@@ -0,0 +1,127 @@
+#include "frame_arena.hpp"
+
+#include <algorithm> // for std::find, std::max
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+	// Every live arena, for totalStats()
+	std::mutex g_arenasMutex{};
+	std::vector<const FrameArena*> g_arenas{};
+}
+
+
+
+FrameArena::FrameArena(std::size_t capacity)
+{
+	capacity = std::max<std::size_t>(capacity, 64);
+	m_blocks.push_back(Block{ std::make_unique_for_overwrite<unsigned char[]>(capacity), capacity });
+	m_capacity.store(capacity, std::memory_order_relaxed);
+
+	std::lock_guard lock{ g_arenasMutex };
+	g_arenas.push_back(this);
+}
+
+FrameArena::~FrameArena()
+{
+	std::lock_guard lock{ g_arenasMutex };
+	g_arenas.erase(std::find(g_arenas.begin(), g_arenas.end(), this));
+}
+
+FrameArena& FrameArena::local()
+{
+	thread_local FrameArena arena{};
+	return arena;
+}
+
+
+
+void* FrameArena::allocateSlow(std::size_t size, std::size_t alignment)
+{
+	// Whatever is left of this block is skipped for the rest of the frame
+	m_blockBase += m_blocks[m_block].size;
+	++m_block;
+
+	// Blocks left over from a rewind are reused when they fit
+	if (m_block == m_blocks.size() || alignedOffset(m_blocks[m_block], 0, alignment) + size > m_blocks[m_block].size)
+	{
+		const std::size_t blockSize{ std::max(size + alignment, m_blocks[m_block - 1].size) };
+		m_blocks.insert(m_blocks.begin() + static_cast<std::ptrdiff_t>(m_block),
+			Block{ std::make_unique_for_overwrite<unsigned char[]>(blockSize), blockSize });
+		++m_spills;
+	}
+
+	m_offset = 0;
+	return allocate(size, alignment);
+}
+
+void FrameArena::rewind(const Marker& marker)
+{
+	m_block = marker.block;
+	m_offset = marker.offset;
+
+	m_blockBase = 0;
+	for (std::size_t i{ 0 }; i < m_block; ++i)
+	{
+		m_blockBase += m_blocks[i].size;
+	}
+}
+
+void FrameArena::reset()
+{
+	m_lastFrame.store(m_used, std::memory_order_relaxed);
+	m_highWater.store(std::max(m_highWater.load(std::memory_order_relaxed), m_used), std::memory_order_relaxed);
+	m_spillCount.store(m_spills, std::memory_order_relaxed);
+
+	// One block as large as all of them, so the next frame like this one fits
+	if (m_blocks.size() > 1)
+	{
+		std::size_t capacity{};
+		for (const Block& block : m_blocks)
+		{
+			capacity += block.size;
+		}
+
+		m_blocks.clear();
+		m_blocks.push_back(Block{ std::make_unique_for_overwrite<unsigned char[]>(capacity), capacity });
+		m_capacity.store(capacity, std::memory_order_relaxed);
+	}
+
+	m_block = 0;
+	m_offset = 0;
+	m_blockBase = 0;
+	m_used = 0;
+}
+
+
+
+FrameArena::Stats FrameArena::stats() const
+{
+	return {
+		.lastFrame{ m_lastFrame.load(std::memory_order_relaxed) },
+		.highWater{ m_highWater.load(std::memory_order_relaxed) },
+		.capacity{ m_capacity.load(std::memory_order_relaxed) },
+		.spills{ m_spillCount.load(std::memory_order_relaxed) } };
+}
+
+FrameArena::Stats FrameArena::totalStats()
+{
+	Stats total{};
+
+	std::lock_guard lock{ g_arenasMutex };
+	for (const FrameArena* arena : g_arenas)
+	{
+		const Stats stats{ arena->stats() };
+		total.lastFrame += stats.lastFrame;
+		total.highWater += stats.highWater;
+		total.capacity += stats.capacity;
+		total.spills += stats.spills;
+	}
+
+	return total;
+}
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <algorithm> // for std::max
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Bump allocator for data that only lives until the end of the frame, e.g.
+// animation scratch matrices or render graph bookkeeping. Every thread has
+// its own, from local(), so allocating is a pointer bump with no locking.
+// Memory is never freed one allocation at a time; reset() hands the whole
+// block back at once. The thread that owns an arena resets it:
+// - the simulation thread at the end of every loop iteration
+// - the render thread after every swap
+// - job workers after every job, so jobs only get scratch memory
+//
+// The arena starts with a single block. A frame that outgrows it spills into
+// extra blocks from the heap, and the next reset() replaces them all with
+// one block large enough for that frame, so a steady workload stops touching
+// the heap after its first few frames.
+class FrameArena final
+{
+public:
+
+	struct Stats
+	{
+		// Bytes handed out between the last two resets
+		std::size_t lastFrame{};
+		// Most bytes handed out between two resets so far
+		std::size_t highWater{};
+		std::size_t capacity{};
+		// Allocations that didn't fit the block and went to the heap
+		std::uint64_t spills{};
+	};
+
+	// Where allocation stood, to rewind to with FrameArenaScope
+	struct Marker
+	{
+		std::size_t block{};
+		std::size_t offset{};
+	};
+
+	explicit FrameArena(std::size_t capacity = 256 * 1024);
+	~FrameArena();
+
+	FrameArena(const FrameArena&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+
+	// The calling thread's arena
+	static FrameArena& local();
+
+	// Never null; alignment must be a power of two
+	void* allocate(std::size_t size, std::size_t alignment)
+	{
+		Block& block{ m_blocks[m_block] };
+		const std::size_t offset{ alignedOffset(block, m_offset, alignment) };
+		if (offset + size > block.size)
+		{
+			return allocateSlow(size, alignment);
+		}
+
+		m_offset = offset + size;
+		m_used = std::max(m_used, m_blockBase + m_offset);
+		return block.data.get() + offset;
+	}
+
+	// Only gives memory back when it is the most recent allocation, which is
+	// enough for a vector growing on its own
+	void deallocate(void* pointer, std::size_t size)
+	{
+		unsigned char* bytes{ static_cast<unsigned char*>(pointer) };
+		unsigned char* blockData{ m_blocks[m_block].data.get() };
+		if (bytes + size == blockData + m_offset)
+		{
+			m_offset = static_cast<std::size_t>(bytes - blockData);
+		}
+	}
+
+	Marker marker() const
+	{
+		return { m_block, m_offset };
+	}
+
+	// Frees everything allocated since the marker was taken
+	void rewind(const Marker& marker);
+
+	// Frees everything. Nothing allocated from the arena may be used after.
+	void reset();
+
+	// Safe to call from any thread
+	Stats stats() const;
+
+	// Summed over every thread's arena; highWater sums the per-thread peaks
+	static Stats totalStats();
+
+private:
+
+	struct Block
+	{
+		std::unique_ptr<unsigned char[]> data{};
+		std::size_t size{};
+	};
+
+	std::vector<Block> m_blocks{};
+	std::size_t m_block{};
+	std::size_t m_offset{};
+	// Sizes of the blocks before m_block
+	std::size_t m_blockBase{};
+	// Bytes handed out since the last reset, counting block tails skipped
+	std::size_t m_used{};
+	std::uint64_t m_spills{};
+
+	// Published on reset() for stats() from other threads
+	std::atomic<std::size_t> m_lastFrame{};
+	std::atomic<std::size_t> m_highWater{};
+	std::atomic<std::size_t> m_capacity{};
+	std::atomic<std::uint64_t> m_spillCount{};
+
+	static std::size_t alignedOffset(const Block& block, std::size_t offset, std::size_t alignment)
+	{
+		const auto address{ reinterpret_cast<std::uintptr_t>(block.data.get()) + offset };
+		return offset + (((address + alignment - 1) & ~(alignment - 1)) - address);
+	}
+
+	void* allocateSlow(std::size_t size, std::size_t alignment);
+};
+
+// Rewinds the arena when it goes out of scope, for scratch memory inside a
+// function that shouldn't stay allocated until the end of the frame
+class FrameArenaScope final
+{
+public:
+
+	explicit FrameArenaScope(FrameArena& arena = FrameArena::local())
+		: m_arena{ arena }
+		, m_marker{ arena.marker() }
+	{}
+
+	~FrameArenaScope()
+	{
+		m_arena.rewind(m_marker);
+	}
+
+	FrameArenaScope(const FrameArenaScope&) = delete;
+	FrameArenaScope& operator=(const FrameArenaScope&) = delete;
+
+private:
+
+	FrameArena& m_arena;
+	FrameArena::Marker m_marker{};
+};
+
+// std allocator over a FrameArena, by default the constructing thread's. A
+// container using it must only grow on that thread.
+template <typename T>
+class FrameAllocator
+{
+public:
+
+	using value_type = T;
+
+	FrameAllocator() noexcept
+		: m_arena{ &FrameArena::local() }
+	{}
+
+	explicit FrameAllocator(FrameArena& arena) noexcept
+		: m_arena{ &arena }
+	{}
+
+	template <typename U>
+	FrameAllocator(const FrameAllocator<U>& other) noexcept
+		: m_arena{ &other.arena() }
+	{}
+
+	T* allocate(std::size_t count)
+	{
+		return static_cast<T*>(m_arena->allocate(count * sizeof(T), alignof(T)));
+	}
+
+	void deallocate(T* pointer, std::size_t count) noexcept
+	{
+		m_arena->deallocate(pointer, count * sizeof(T));
+	}
+
+	FrameArena& arena() const
+	{
+		return *m_arena;
+	}
+
+	template <typename U>
+	bool operator==(const FrameAllocator<U>& other) const noexcept
+	{
+		return m_arena == &other.arena();
+	}
+
+private:
+
+	FrameArena* m_arena{};
+};
+
+template <typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
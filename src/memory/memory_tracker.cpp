@@ -0,0 +1,143 @@
+#include "memory_tracker.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <ostream>
+
+namespace
+{
+	// Sits right in front of every allocation. Its size keeps the default
+	// alignment of whatever follows it.
+	struct AllocationHeader
+	{
+		std::size_t size{};
+		// From the start of the malloc block to the allocation
+		std::uint32_t offset{};
+		MemoryTracker::Tag tag{ MemoryTracker::UNTAGGED };
+	};
+	static_assert(sizeof(AllocationHeader) == 16);
+
+	// Each tag on its own cache line so subsystems allocating at the same
+	// time don't contend
+	struct alignas(64) TagCounters
+	{
+		std::atomic<std::int64_t> liveBytes{ 0 };
+		std::atomic<std::int64_t> peakBytes{ 0 };
+		std::atomic<std::int64_t> liveAllocations{ 0 };
+		std::atomic<std::uint64_t> totalAllocations{ 0 };
+	};
+
+	// Constant initialised, so it is usable from allocations made before
+	// main() and during static initialisation
+	TagCounters g_counters[MemoryTracker::TAG_COUNT]{};
+
+	thread_local MemoryTracker::Tag t_tag{ MemoryTracker::UNTAGGED };
+}
+
+
+
+MemoryTracker::Tag MemoryTracker::currentTag()
+{
+	return t_tag;
+}
+
+void MemoryTracker::setCurrentTag(Tag tag)
+{
+	t_tag = tag;
+}
+
+
+
+void* MemoryTracker::allocate(std::size_t size, std::size_t alignment, Tag tag)
+{
+	// malloc only guarantees max_align_t, anything stricter needs room to
+	// slide the allocation forward
+	constexpr std::size_t mallocAlignment{ alignof(std::max_align_t) };
+	const std::size_t padding{ alignment > mallocAlignment ? alignment - mallocAlignment : 0 };
+
+	unsigned char* block{ static_cast<unsigned char*>(std::malloc(sizeof(AllocationHeader) + padding + size)) };
+	if (!block)
+	{
+		return nullptr;
+	}
+
+	const auto address{ reinterpret_cast<std::uintptr_t>(block) + sizeof(AllocationHeader) };
+	unsigned char* pointer{ block + (((address + alignment - 1) & ~(alignment - 1)) - reinterpret_cast<std::uintptr_t>(block)) };
+
+	AllocationHeader* header{ reinterpret_cast<AllocationHeader*>(pointer) - 1 };
+	header->size = size;
+	header->offset = static_cast<std::uint32_t>(pointer - block);
+	header->tag = tag;
+
+	TagCounters& counters{ g_counters[tag] };
+	const auto bytes{ static_cast<std::int64_t>(size) };
+	const std::int64_t live{ counters.liveBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes };
+	std::int64_t peak{ counters.peakBytes.load(std::memory_order_relaxed) };
+	while (live > peak && !counters.peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+	{
+	}
+	counters.liveAllocations.fetch_add(1, std::memory_order_relaxed);
+	counters.totalAllocations.fetch_add(1, std::memory_order_relaxed);
+
+	return pointer;
+}
+
+void MemoryTracker::deallocate(void* pointer)
+{
+	if (!pointer)
+	{
+		return;
+	}
+
+	const AllocationHeader* header{ static_cast<const AllocationHeader*>(pointer) - 1 };
+
+	TagCounters& counters{ g_counters[header->tag] };
+	counters.liveBytes.fetch_sub(static_cast<std::int64_t>(header->size), std::memory_order_relaxed);
+	counters.liveAllocations.fetch_sub(1, std::memory_order_relaxed);
+
+	std::free(static_cast<unsigned char*>(pointer) - header->offset);
+}
+
+
+
+MemoryTracker::TagStats MemoryTracker::stats(Tag tag)
+{
+	const TagCounters& counters{ g_counters[tag] };
+	return {
+		.liveBytes{ counters.liveBytes.load(std::memory_order_relaxed) },
+		.peakBytes{ counters.peakBytes.load(std::memory_order_relaxed) },
+		.liveAllocations{ counters.liveAllocations.load(std::memory_order_relaxed) },
+		.totalAllocations{ counters.totalAllocations.load(std::memory_order_relaxed) } };
+}
+
+const char* MemoryTracker::tagName(Tag tag)
+{
+	switch (tag)
+	{
+	case RENDERER:  return "renderer";
+	case LOADER:    return "loader";
+	case ANIMATION: return "animation";
+	case GAMEPLAY:  return "gameplay";
+	case PHYSICS:   return "physics";
+	default:        return "untagged";
+	}
+}
+
+void MemoryTracker::dump(std::ostream& out)
+{
+	for (int i{ 0 }; i < TAG_COUNT; ++i)
+	{
+		const Tag tag{ static_cast<Tag>(i) };
+		const TagStats tagStats{ stats(tag) };
+		if (tagStats.totalAllocations == 0)
+		{
+			continue;
+		}
+
+		out << "MEMORY: " << tagName(tag) << ' ' << tagStats.liveBytes / 1024 << " KiB live, "
+			<< tagStats.peakBytes / 1024 << " KiB peak, " << tagStats.liveAllocations << " live allocations, "
+			<< tagStats.totalAllocations << " total\n";
+	}
+}
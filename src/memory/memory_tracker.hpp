@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+// Attributes heap memory to the subsystem that allocated it. Every
+// allocation carries a small header with its size and tag, so it is
+// credited back to the right tag whichever thread frees it. The tag comes
+// from the innermost Scope on the allocating thread; jobs inherit the tag
+// of the thread that scheduled them.
+//
+// Allocations reach the tracker three ways:
+// - global new/delete, once tracked_new.cpp is linked into the executable
+// - PhysX, through TrackingAllocator, always under PHYSICS
+// - allocate()/deallocate() directly
+//
+// Counters are per-tag atomics, so allocating stays lock-free.
+class MemoryTracker final
+{
+public:
+
+	enum Tag : std::uint8_t
+	{
+		UNTAGGED,
+		RENDERER,
+		LOADER,
+		ANIMATION,
+		GAMEPLAY,
+		PHYSICS,
+		TAG_COUNT,
+	};
+
+	struct TagStats
+	{
+		std::int64_t liveBytes{};
+		std::int64_t peakBytes{};
+		std::int64_t liveAllocations{};
+		// Allocations ever made, to spot churn
+		std::uint64_t totalAllocations{};
+	};
+
+	// Tags everything the calling thread allocates until it goes out of scope
+	class Scope final
+	{
+	public:
+
+		explicit Scope(Tag tag)
+			: m_previous{ MemoryTracker::currentTag() }
+		{
+			MemoryTracker::setCurrentTag(tag);
+		}
+
+		~Scope()
+		{
+			MemoryTracker::setCurrentTag(m_previous);
+		}
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+	private:
+
+		Tag m_previous{ UNTAGGED };
+	};
+
+	static Tag currentTag();
+	static void setCurrentTag(Tag tag);
+
+	// Null when the system is out of memory; alignment must be a power of two
+	static void* allocate(std::size_t size, std::size_t alignment, Tag tag);
+	static void* allocate(std::size_t size, std::size_t alignment)
+	{
+		return allocate(size, alignment, currentTag());
+	}
+
+	// Only for memory from allocate(); null is ignored
+	static void deallocate(void* pointer);
+
+	static TagStats stats(Tag tag);
+	static const char* tagName(Tag tag);
+
+	// One line per tag that has ever allocated
+	static void dump(std::ostream& out);
+};
@@ -0,0 +1,148 @@
+// Routes global new/delete through MemoryTracker. Only executables that
+// compile this file are tracked; the microbenchmarks leave it out so their
+// timings match the plain allocator.
+
+#include "memory_tracker.hpp"
+
+#include <cstddef>
+#include <new>
+
+namespace
+{
+	void* allocateOrThrow(std::size_t size, std::size_t alignment)
+	{
+		while (true)
+		{
+			if (void* pointer{ MemoryTracker::allocate(size, alignment) })
+			{
+				return pointer;
+			}
+
+			const std::new_handler handler{ std::get_new_handler() };
+			if (!handler)
+			{
+				throw std::bad_alloc{};
+			}
+			handler();
+		}
+	}
+
+	void* allocateOrNull(std::size_t size, std::size_t alignment) noexcept
+	{
+		try
+		{
+			return allocateOrThrow(size, alignment);
+		}
+		catch (...)
+		{
+			return nullptr;
+		}
+	}
+
+	constexpr std::size_t defaultAlignment{ __STDCPP_DEFAULT_NEW_ALIGNMENT__ };
+}
+
+
+
+void* operator new(std::size_t size)
+{
+	return allocateOrThrow(size, defaultAlignment);
+}
+
+void* operator new[](std::size_t size)
+{
+	return allocateOrThrow(size, defaultAlignment);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	return allocateOrThrow(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+	return allocateOrThrow(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	return allocateOrNull(size, defaultAlignment);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+	return allocateOrNull(size, defaultAlignment);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return allocateOrNull(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return allocateOrNull(size, static_cast<std::size_t>(alignment));
+}
+
+
+
+// The header records everything, so every form of delete is the same
+void operator delete(void* pointer) noexcept
+{
+	MemoryTracker::deallocate(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+	MemoryTracker::deallocate(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+	MemoryTracker::deallocate(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept
+{
+	MemoryTracker::deallocate(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept
+{
+	MemoryTracker::deallocate(pointer);
+}
+
+void operator delete[](void* pointer, std::align_val_t) noexcept
+{
+	MemoryTracker::deallocate(pointer);
+}
+
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept
+{
+	MemoryTracker::deallocate(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept
+{
+	MemoryTracker::deallocate(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept
+{
+	MemoryTracker::deallocate(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept
+{
+	MemoryTracker::deallocate(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t, const std::nothrow_t&) noexcept
+{
+	MemoryTracker::deallocate(pointer);
+}
+
+void operator delete[](void* pointer, std::align_val_t, const std::nothrow_t&) noexcept
+{
+	MemoryTracker::deallocate(pointer);
+}
@@ -0,0 +1,225 @@
+#include "flow_field.hpp"
+
+#include "nav_grid.hpp"
+#include "../profiler/profiler.hpp"
+
+#include "glm/glm.hpp"
+
+#include <algorithm> // for std::push_heap, std::pop_heap, std::fill
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace
+{
+	// Orthogonal moves first, so ties between equally cheap neighbours go
+	// to the straighter step
+	constexpr int offsetX[8]{ 1, -1, 0, 0, 1, -1, 1, -1 };
+	constexpr int offsetZ[8]{ 0, 0, 1, -1, 1, 1, -1, -1 };
+
+	// Step costs scaled so diagonals approximate sqrt(2) in integers
+	constexpr std::uint32_t stepCost[8]{ 10, 10, 10, 10, 14, 14, 14, 14 };
+
+	// How far setTarget() looks for floor around a target that is off it
+	constexpr int snapRadius{ 2 };
+}
+
+
+
+FlowField::FlowField(const NavGrid& grid)
+	: m_grid{ grid }
+	, m_directions(grid.cellCount(), noDirection)
+{}
+
+void FlowField::setTarget(const glm::vec3& target)
+{
+	glm::ivec2 cell{ m_grid.cellOf(target) };
+
+	if (!m_grid.walkable(cell.x, cell.y))
+	{
+		// Nearest walkable cell in growing rings
+		bool found{ false };
+		for (int ring{ 1 }; ring <= snapRadius && !found; ++ring)
+		{
+			for (int dz{ -ring }; dz <= ring && !found; ++dz)
+			{
+				for (int dx{ -ring }; dx <= ring && !found; ++dx)
+				{
+					if (std::max(std::abs(dx), std::abs(dz)) == ring && m_grid.walkable(cell.x + dx, cell.y + dz))
+					{
+						cell += glm::ivec2{ dx, dz };
+						found = true;
+					}
+				}
+			}
+		}
+
+		if (!found)
+		{
+			// Nowhere to go; agents fall back to their own steering
+			m_requestedTarget = glm::ivec2{ -1, -1 };
+			m_pendingTarget = m_requestedTarget;
+			m_target = m_requestedTarget;
+			m_searching = false;
+			std::fill(m_directions.begin(), m_directions.end(), noDirection);
+			return;
+		}
+	}
+
+	m_requestedTarget = cell;
+
+	// A search in progress finishes first, update() moves on to this target
+	if (!m_searching && cell != m_target)
+	{
+		startSearch(cell);
+	}
+}
+
+void FlowField::startSearch(const glm::ivec2& cell)
+{
+	m_pendingTarget = cell;
+	m_searching = true;
+
+	m_costs.assign(m_grid.cellCount(), unreached);
+	m_open.clear();
+
+	const auto start{ static_cast<std::uint32_t>(m_grid.index(cell.x, cell.y)) };
+	m_costs[start] = 0;
+	m_open.push_back(Open{ 0, start });
+}
+
+bool FlowField::update(std::size_t cellBudget)
+{
+	if (!m_searching)
+	{
+		return m_target == m_requestedTarget;
+	}
+
+	PROFILE_ZONE("Flow field");
+
+	// Cost first, then cell, so the order of expansion is deterministic
+	const auto later{ [](const Open& a, const Open& b) {
+		return a.cost != b.cost ? a.cost > b.cost : a.cell > b.cell;
+		} };
+
+	const int width{ m_grid.width() };
+
+	for (std::size_t expanded{ 0 }; expanded < cellBudget && !m_open.empty(); )
+	{
+		std::pop_heap(m_open.begin(), m_open.end(), later);
+		const Open current{ m_open.back() };
+		m_open.pop_back();
+
+		// Superseded by a cheaper entry pushed later
+		if (current.cost != m_costs[current.cell])
+		{
+			continue;
+		}
+		++expanded;
+
+		const int x{ static_cast<int>(current.cell % width) };
+		const int z{ static_cast<int>(current.cell / width) };
+
+		// Moves are symmetric, so a path from the neighbour to here is the
+		// reverse of this one
+		for (int i{ 0 }; i < 8; ++i)
+		{
+			if (!m_grid.passable(x, z, offsetX[i], offsetZ[i]))
+			{
+				continue;
+			}
+
+			const auto neighbour{ static_cast<std::uint32_t>(m_grid.index(x + offsetX[i], z + offsetZ[i])) };
+			const std::uint32_t cost{ current.cost + stepCost[i] };
+			if (cost < m_costs[neighbour])
+			{
+				m_costs[neighbour] = cost;
+				m_open.push_back(Open{ cost, neighbour });
+				std::push_heap(m_open.begin(), m_open.end(), later);
+			}
+		}
+	}
+
+	if (m_open.empty())
+	{
+		publish();
+
+		if (m_target != m_requestedTarget)
+		{
+			startSearch(m_requestedTarget);
+		}
+	}
+
+	return m_target == m_requestedTarget;
+}
+
+void FlowField::publish()
+{
+	const int width{ m_grid.width() };
+	const int depth{ m_grid.depth() };
+
+	m_pendingDirections.assign(m_grid.cellCount(), noDirection);
+
+	for (int z{ 0 }; z < depth; ++z)
+	{
+		for (int x{ 0 }; x < width; ++x)
+		{
+			const std::size_t cell{ m_grid.index(x, z) };
+			const bool walkable{ m_grid.walkable(x, z) };
+
+			// The target's cell has no direction
+			if (m_costs[cell] == 0)
+			{
+				continue;
+			}
+
+			std::uint32_t best{ walkable ? m_costs[cell] : unreached };
+			for (int i{ 0 }; i < 8; ++i)
+			{
+				// Agents pushed off the floor, e.g. into the margin kept
+				// around walls, head back onto the nearest reached cell
+				const bool step{ walkable ? m_grid.passable(x, z, offsetX[i], offsetZ[i])
+					: m_grid.walkable(x + offsetX[i], z + offsetZ[i]) };
+				if (!step)
+				{
+					continue;
+				}
+
+				const std::uint32_t cost{ m_costs[m_grid.index(x + offsetX[i], z + offsetZ[i])] };
+				if (cost < best)
+				{
+					best = cost;
+					m_pendingDirections[cell] = static_cast<std::uint8_t>(i);
+				}
+			}
+		}
+	}
+
+	m_directions.swap(m_pendingDirections);
+	m_target = m_pendingTarget;
+	m_searching = false;
+}
+
+bool FlowField::sample(const glm::vec3& position, glm::vec2& direction) const
+{
+	const glm::ivec2 cell{ m_grid.cellOf(position) };
+	if (!m_grid.contains(cell.x, cell.y))
+	{
+		return false;
+	}
+
+	const std::uint8_t next{ m_directions[m_grid.index(cell.x, cell.y)] };
+	if (next == noDirection)
+	{
+		return false;
+	}
+
+	const glm::vec3 centre{ m_grid.cellCentre(cell.x + offsetX[next], cell.y + offsetZ[next]) };
+	const glm::vec2 toCentre{ centre.x - position.x, centre.z - position.z };
+	const float length{ glm::length(toCentre) };
+
+	direction = length > 1e-4f ? toCentre / length
+		: glm::normalize(glm::vec2{ static_cast<float>(offsetX[next]), static_cast<float>(offsetZ[next]) });
+	return true;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "glm/glm.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class NavGrid;
+
+// Which way to walk from every cell of a NavGrid to reach one target, shared
+// by any number of agents. Each cell stores the neighbour one step closer
+// along the cheapest path, so sampling is a lookup no matter how far the
+// target is or how many agents ask.
+//
+// The search behind it is a Dijkstra flood out from the target, spread over
+// update() calls by a budget of cells per call. Agents keep following the
+// last finished field while the next one is computed, and moving the target
+// within its cell costs nothing. A search always runs to completion: a target
+// that moves meanwhile is picked up by the next search, started from the
+// latest target as soon as this one publishes, so a target that keeps
+// moving can't starve the field of updates.
+class FlowField final
+{
+public:
+
+	// The grid must be built already, and not change while the field is
+	// alive
+	explicit FlowField(const NavGrid& grid);
+
+	FlowField(const FlowField&) = delete;
+	FlowField& operator=(const FlowField&) = delete;
+
+	// Searches again once the target has entered another cell. A target off
+	// the walkable floor snaps to a walkable cell close by, if there is one.
+	void setTarget(const glm::vec3& target);
+
+	// Expands up to cellBudget cells of the search in progress, publishing
+	// the field when it completes and then starting on the latest target if
+	// it has moved. Returns whether the published field is for the latest
+	// target.
+	bool update(std::size_t cellBudget);
+
+	// Unit direction on the XZ plane towards the next cell on the way to the
+	// target, aimed at that cell's centre so agents keep off walls. False,
+	// leaving direction alone, in the target's own cell, outside the grid
+	// and where there is no route.
+	bool sample(const glm::vec3& position, glm::vec2& direction) const;
+
+private:
+
+	static constexpr std::uint8_t noDirection{ 0xFF };
+	static constexpr std::uint32_t unreached{ 0xFFFFFFFFu };
+
+	struct Open
+	{
+		std::uint32_t cost{};
+		std::uint32_t cell{};
+	};
+
+	const NavGrid& m_grid;
+
+	// Neighbour to step to, indexing the offset tables in the .cpp
+	std::vector<std::uint8_t> m_directions{};
+
+	// Cell of the last setTarget()
+	glm::ivec2 m_requestedTarget{ -1, -1 };
+
+	// The search in progress
+	glm::ivec2 m_pendingTarget{ -1, -1 };
+	bool m_searching{ false };
+	std::vector<std::uint32_t> m_costs{};
+	std::vector<Open> m_open{};
+	std::vector<std::uint8_t> m_pendingDirections{};
+
+	// Target of m_directions
+	glm::ivec2 m_target{ -1, -1 };
+
+	void startSearch(const glm::ivec2& cell);
+	void publish();
+};
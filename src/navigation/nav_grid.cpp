@@ -0,0 +1,106 @@
+#include "nav_grid.hpp"
+
+#include "glm/glm.hpp"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring> // for std::memcpy
+#include <vector>
+
+namespace
+{
+	struct SerializedHeader
+	{
+		std::int32_t width{};
+		std::int32_t depth{};
+		float originX{};
+		float originZ{};
+		float cellSize{};
+		float maxStepHeight{};
+	};
+}
+
+
+
+void NavGrid::reset(int width, int depth, const glm::vec2& origin, float cellSize, float maxStepHeight)
+{
+	m_width = width;
+	m_depth = depth;
+	m_origin = origin;
+	m_cellSize = cellSize;
+	m_maxStepHeight = maxStepHeight;
+
+	m_walkable.assign(static_cast<std::size_t>(width) * depth, 0);
+	m_floorHeights.assign(static_cast<std::size_t>(width) * depth, 0.0f);
+}
+
+void NavGrid::setCell(int x, int z, bool walkable, float floorHeight)
+{
+	m_walkable[index(x, z)] = walkable ? 1 : 0;
+	m_floorHeights[index(x, z)] = floorHeight;
+}
+
+bool NavGrid::passable(int x, int z, int dx, int dz) const
+{
+	if (!walkable(x, z) || !walkable(x + dx, z + dz))
+	{
+		return false;
+	}
+
+	if (std::fabs(floorHeight(x + dx, z + dz) - floorHeight(x, z)) > m_maxStepHeight)
+	{
+		return false;
+	}
+
+	return dx == 0 || dz == 0 || (walkable(x + dx, z) && walkable(x, z + dz));
+}
+
+
+
+std::vector<unsigned char> NavGrid::serialize() const
+{
+	const SerializedHeader header{ m_width, m_depth, m_origin.x, m_origin.y, m_cellSize, m_maxStepHeight };
+
+	std::vector<unsigned char> data(sizeof(header) + m_floorHeights.size() * sizeof(float) + m_walkable.size());
+	unsigned char* write{ data.data() };
+
+	std::memcpy(write, &header, sizeof(header));
+	write += sizeof(header);
+	std::memcpy(write, m_floorHeights.data(), m_floorHeights.size() * sizeof(float));
+	write += m_floorHeights.size() * sizeof(float);
+	std::memcpy(write, m_walkable.data(), m_walkable.size());
+
+	return data;
+}
+
+bool NavGrid::deserialize(const std::vector<unsigned char>& data)
+{
+	SerializedHeader header{};
+	if (data.size() < sizeof(header))
+	{
+		return false;
+	}
+	std::memcpy(&header, data.data(), sizeof(header));
+
+	if (header.width < 0 || header.depth < 0)
+	{
+		return false;
+	}
+
+	const std::size_t cellCount{ static_cast<std::size_t>(header.width) * header.depth };
+	if (data.size() != sizeof(header) + cellCount * (sizeof(float) + 1))
+	{
+		return false;
+	}
+
+	reset(header.width, header.depth, glm::vec2{ header.originX, header.originZ }, header.cellSize,
+		header.maxStepHeight);
+
+	const unsigned char* read{ data.data() + sizeof(header) };
+	std::memcpy(m_floorHeights.data(), read, cellCount * sizeof(float));
+	read += cellCount * sizeof(float);
+	std::memcpy(m_walkable.data(), read, cellCount);
+
+	return true;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "glm/glm.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Walkable floor over the XZ plane as a uniform grid of cells, each with the
+// height of its floor. One floor per cell, the topmost one, so bridges over
+// walkable ground are not represented. Built from the level's collision by
+// buildNavGrid().
+class NavGrid final
+{
+public:
+
+	NavGrid() = default;
+
+	NavGrid(const NavGrid&) = delete;
+	NavGrid& operator=(const NavGrid&) = delete;
+
+	// Every cell starts unwalkable. origin is the corner of cell (0, 0) with
+	// the smallest coordinates.
+	void reset(int width, int depth, const glm::vec2& origin, float cellSize, float maxStepHeight);
+
+	void setCell(int x, int z, bool walkable, float floorHeight);
+
+	// Flat copies, for the on-disk cache
+	std::vector<unsigned char> serialize() const;
+	bool deserialize(const std::vector<unsigned char>& data);
+
+	int width() const
+	{
+		return m_width;
+	}
+
+	int depth() const
+	{
+		return m_depth;
+	}
+
+	float cellSize() const
+	{
+		return m_cellSize;
+	}
+
+	std::size_t cellCount() const
+	{
+		return m_walkable.size();
+	}
+
+	bool contains(int x, int z) const
+	{
+		return x >= 0 && z >= 0 && x < m_width && z < m_depth;
+	}
+
+	// Unclamped, so callers check contains()
+	glm::ivec2 cellOf(const glm::vec3& position) const
+	{
+		return glm::ivec2{ glm::floor((glm::vec2{ position.x, position.z } - m_origin) / m_cellSize) };
+	}
+
+	glm::vec3 cellCentre(int x, int z) const
+	{
+		return glm::vec3{ m_origin.x + (x + 0.5f) * m_cellSize, m_floorHeights[index(x, z)],
+			m_origin.y + (z + 0.5f) * m_cellSize };
+	}
+
+	std::size_t index(int x, int z) const
+	{
+		return static_cast<std::size_t>(z) * m_width + x;
+	}
+
+	bool walkable(int x, int z) const
+	{
+		return contains(x, z) && m_walkable[index(x, z)] != 0;
+	}
+
+	float floorHeight(int x, int z) const
+	{
+		return m_floorHeights[index(x, z)];
+	}
+
+	// Whether an agent can walk from (x, z) to the neighbouring cell
+	// (x + dx, z + dz). Diagonal moves need both cells they squeeze between
+	// walkable, so paths never cut a wall's corner.
+	bool passable(int x, int z, int dx, int dz) const;
+
+private:
+
+	int m_width{};
+	int m_depth{};
+	glm::vec2 m_origin{};
+	float m_cellSize{ 1.0f };
+	float m_maxStepHeight{};
+
+	std::vector<std::uint8_t> m_walkable{};
+	std::vector<float> m_floorHeights{};
+};
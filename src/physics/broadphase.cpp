@@ -0,0 +1,118 @@
+#include "broadphase.hpp"
+
+#include "PxPhysicsAPI.h"
+
+#include <algorithm> // for std::clamp
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// MBP takes at most 256 regions
+	constexpr std::uint32_t maxRegionSubdivisions{ 16 };
+}
+
+
+
+bool parseBroadphase(const std::string& name, Broadphase& broadphase)
+{
+	if (name == "sap")
+	{
+		broadphase = Broadphase::sap;
+	}
+	else if (name == "mbp")
+	{
+		broadphase = Broadphase::mbp;
+	}
+	else if (name == "abp")
+	{
+		broadphase = Broadphase::abp;
+	}
+	else
+	{
+		return false;
+	}
+
+	return true;
+}
+
+const char* broadphaseName(Broadphase broadphase)
+{
+	switch (broadphase)
+	{
+	case Broadphase::sap:
+		return "sap";
+	case Broadphase::mbp:
+		return "mbp";
+	case Broadphase::abp:
+		return "abp";
+	}
+
+	return "";
+}
+
+
+
+void applyBroadphase(physx::PxSceneDesc& sceneDesc, const BroadphaseSettings& settings)
+{
+	switch (settings.type)
+	{
+	case Broadphase::sap:
+		sceneDesc.broadPhaseType = physx::PxBroadPhaseType::eSAP;
+		break;
+	case Broadphase::mbp:
+		sceneDesc.broadPhaseType = physx::PxBroadPhaseType::eMBP;
+		break;
+	case Broadphase::abp:
+		sceneDesc.broadPhaseType = physx::PxBroadPhaseType::eABP;
+		break;
+	}
+}
+
+std::uint32_t addBroadphaseRegions(physx::PxScene& scene, const BroadphaseSettings& settings)
+{
+	if (settings.type != Broadphase::mbp)
+	{
+		return 0;
+	}
+
+	const physx::PxActorTypeFlags types{ physx::PxActorTypeFlag::eRIGID_STATIC | physx::PxActorTypeFlag::eRIGID_DYNAMIC };
+	std::vector<physx::PxActor*> actors(scene.getNbActors(types));
+	scene.getActors(types, actors.data(), static_cast<physx::PxU32>(actors.size()));
+
+	physx::PxBounds3 worldBounds{ physx::PxBounds3::empty() };
+	for (const physx::PxActor* actor : actors)
+	{
+		worldBounds.include(actor->getWorldBounds());
+	}
+
+	// An empty scene still gets regions, around the origin
+	if (worldBounds.isEmpty())
+	{
+		worldBounds = physx::PxBounds3::centerExtents(physx::PxVec3{ 0.0f }, physx::PxVec3{ 0.0f });
+	}
+	worldBounds.fattenFast(settings.mbpMargin);
+
+	const std::uint32_t subdivisions{ std::clamp(settings.mbpSubdivisions, std::uint32_t{ 1 }, maxRegionSubdivisions) };
+	std::vector<physx::PxBounds3> regions(subdivisions * subdivisions);
+	const physx::PxU32 regionCount{ physx::PxBroadPhaseExt::createRegionsFromWorldBounds(
+		regions.data(), worldBounds, subdivisions) };
+
+	std::uint32_t added{};
+	for (physx::PxU32 i{ 0 }; i < regionCount; ++i)
+	{
+		const physx::PxBroadPhaseRegion region{ regions[i], nullptr };
+		if (scene.addBroadPhaseRegion(region, true) != 0xffffffff)
+		{
+			++added;
+		}
+		else
+		{
+			std::cerr << "BROADPHASE: ERROR: Could not add MBP region " << i << '\n';
+		}
+	}
+
+	return added;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace physx
+{
+	class PxScene;
+	class PxSceneDesc;
+}
+
+// Broadphase algorithms PhysX offers on the CPU. SAP is cheapest when most
+// bodies sleep but degrades when many move or are inserted at once; MBP
+// splits the world into regions that must cover everything that collides;
+// ABP manages its regions itself. iklob_physbench compares them on a given
+// scene shape.
+enum class Broadphase
+{
+	sap,
+	mbp,
+	abp
+};
+
+struct BroadphaseSettings
+{
+	Broadphase type{ Broadphase::abp };
+
+	// MBP only: the world is split into subdivisions x subdivisions regions
+	// over XZ. PhysX allows at most 256.
+	std::uint32_t mbpSubdivisions{ 4 };
+
+	// MBP only: how far the regions reach past everything in the scene when
+	// they are built. Bodies outside every region stop colliding.
+	float mbpMargin{ 50.0f };
+};
+
+// "sap", "mbp" or "abp"; false, leaving broadphase alone, for anything else
+bool parseBroadphase(const std::string& name, Broadphase& broadphase);
+const char* broadphaseName(Broadphase broadphase);
+
+void applyBroadphase(physx::PxSceneDesc& sceneDesc, const BroadphaseSettings& settings);
+
+// MBP only, a no-op otherwise. Tiles the bounds of the actors already in the
+// scene, grown by the margin, with regions. Call once the level collision
+// has been added. Returns the number of regions added.
+std::uint32_t addBroadphaseRegions(physx::PxScene& scene, const BroadphaseSettings& settings);
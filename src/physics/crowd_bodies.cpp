@@ -0,0 +1,76 @@
+#include "crowd_bodies.hpp"
+
+#include "../crowd/crowd.hpp"
+#include "../profiler/profiler.hpp"
+
+#include "glm/glm.hpp"
+#include "PxPhysicsAPI.h"
+
+#include <cstdint>
+#include <vector>
+
+CrowdBodies::CrowdBodies(physx::PxPhysics& physics, physx::PxScene& scene, physx::PxMaterial& material,
+	float radius, float halfHeight)
+	: m_physics{ physics }
+	, m_scene{ scene }
+	, m_material{ material }
+	, m_radius{ radius }
+	, m_halfHeight{ halfHeight }
+{}
+
+CrowdBodies::~CrowdBodies()
+{
+	for (physx::PxRigidDynamic* actor : m_actors)
+	{
+		m_scene.removeActor(*actor);
+		actor->release();
+	}
+}
+
+void CrowdBodies::sync(const Crowd& crowd)
+{
+	PROFILE_ZONE("Crowd bodies");
+
+	while (m_actors.size() > crowd.size())
+	{
+		m_scene.removeActor(*m_actors.back());
+		m_actors.back()->release();
+		m_actors.pop_back();
+		m_agentIds.pop_back();
+	}
+
+	// Capsules lie along X, so stand them up
+	const physx::PxTransform upright{ physx::PxQuat{ physx::PxHalfPi, physx::PxVec3{ 0.0f, 0.0f, 1.0f } } };
+	const float centerHeight{ m_radius + m_halfHeight };
+
+	for (std::uint32_t agent{ 0 }; agent < crowd.size(); ++agent)
+	{
+		const glm::vec3 feet{ crowd.position(agent) };
+		const physx::PxTransform pose{ physx::PxVec3{ feet.x, feet.y + centerHeight, feet.z } };
+
+		if (agent == m_actors.size())
+		{
+			physx::PxRigidDynamic* actor{ m_physics.createRigidDynamic(pose) };
+			actor->setRigidBodyFlag(physx::PxRigidBodyFlag::eKINEMATIC, true);
+
+			physx::PxShape* shape{ physx::PxRigidActorExt::createExclusiveShape(*actor,
+				physx::PxCapsuleGeometry{ m_radius, m_halfHeight }, m_material) };
+			shape->setLocalPose(upright);
+
+			m_scene.addActor(*actor);
+			m_actors.push_back(actor);
+			m_agentIds.push_back(crowd.id(agent));
+		}
+		else if (m_agentIds[agent] != crowd.id(agent))
+		{
+			// A different agent now, possibly far away; a kinematic target
+			// would sweep the capsule there and shove everything on the way
+			m_actors[agent]->setGlobalPose(pose);
+			m_agentIds[agent] = crowd.id(agent);
+		}
+		else
+		{
+			m_actors[agent]->setKinematicTarget(pose);
+		}
+	}
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+
+#include <cstdint>
+#include <vector>
+
+class Crowd;
+
+// A kinematic capsule per crowd agent, so the player's controller bumps into
+// the crowd and scene queries can hit it. Agent i drives actor i; actors are
+// created and released as the crowd grows and shrinks. When a removal moves
+// another agent into index i, actor i is teleported to it rather than swept
+// across the level.
+class CrowdBodies final
+{
+public:
+
+	// The capsule stands on the agent's feet
+	CrowdBodies(physx::PxPhysics& physics, physx::PxScene& scene, physx::PxMaterial& material,
+		float radius, float halfHeight);
+	~CrowdBodies();
+
+	CrowdBodies(const CrowdBodies&) = delete;
+	CrowdBodies& operator=(const CrowdBodies&) = delete;
+
+	// Writes to the scene, so only while it isn't simulating
+	void sync(const Crowd& crowd);
+
+private:
+
+	physx::PxPhysics& m_physics;
+	physx::PxScene& m_scene;
+	physx::PxMaterial& m_material;
+
+	float m_radius{};
+	float m_halfHeight{};
+
+	std::vector<physx::PxRigidDynamic*> m_actors{};
+	// Crowd::id() of the agent each actor last followed
+	std::vector<std::uint32_t> m_agentIds{};
+};
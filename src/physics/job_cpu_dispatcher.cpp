@@ -0,0 +1,24 @@
+#include "job_cpu_dispatcher.hpp"
+
+#include "../jobs/job_system.hpp"
+#include "../profiler/profiler.hpp"
+
+#include "PxPhysicsAPI.h"
+
+#include <cstdint>
+
+void JobCpuDispatcher::submitTask(physx::PxBaseTask& task)
+{
+	// PhysX expects the dispatcher to release every task once it has run
+	m_jobSystem.schedule([&task]()
+		{
+			PROFILE_ZONE(task.getName());
+			task.run();
+			task.release();
+		});
+}
+
+std::uint32_t JobCpuDispatcher::getWorkerCount() const
+{
+	return m_jobSystem.workerCount();
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "../jobs/job_system.hpp"
+
+#include "PxPhysicsAPI.h"
+
+#include <cstdint>
+
+// Feeds PhysX tasks into the engine's job system so physics shares the pool
+// with everything else instead of spinning up its own threads.
+class JobCpuDispatcher final : public physx::PxCpuDispatcher
+{
+public:
+
+	explicit JobCpuDispatcher(JobSystem& jobSystem)
+		: m_jobSystem{ jobSystem }
+	{}
+
+	void submitTask(physx::PxBaseTask& task) override;
+
+	std::uint32_t getWorkerCount() const override;
+
+private:
+
+	JobSystem& m_jobSystem;
+};
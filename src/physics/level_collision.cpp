@@ -0,0 +1,306 @@
+#include "level_collision.hpp"
+
+#include "../io/file_cache.hpp"
+#include "../io/hash.hpp"
+#include "../profiler/profiler.hpp"
+#include "../renderer/glb_file.hpp"
+#include "../renderer/model_loader.hpp"
+
+#include "glm/glm.hpp"
+#include "PxPhysicsAPI.h"
+#include "tinygltf/json.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <utility> // for std::move
+#include <vector>
+
+namespace
+{
+	// Bump whenever the cooked data stored per entry changes
+	constexpr std::uint32_t collisionCacheVersion{ 1 };
+
+	// glTF primitive mode for triangle lists, also the default
+	constexpr int trianglesMode{ 4 };
+
+	struct CollisionNode
+	{
+		std::string name{};
+		bool convex{ false };
+		std::vector<glm::vec3> positions{};
+		std::vector<std::uint32_t> indices{};
+	};
+
+	// Appends the indices of a primitive, offset to follow the positions
+	// already in the node
+	bool appendIndices(const AccessorView& view, std::uint32_t offset, std::vector<std::uint32_t>& indices)
+	{
+		const std::size_t first{ indices.size() };
+		indices.resize(first + view.count);
+
+		for (std::size_t i{ 0 }; i < view.count; ++i)
+		{
+			std::uint32_t index{};
+			switch (view.componentType)
+			{
+			case GL_UNSIGNED_BYTE:
+				index = *view.element(i);
+				break;
+			case GL_UNSIGNED_SHORT:
+			{
+				std::uint16_t value{};
+				std::memcpy(&value, view.element(i), sizeof(value));
+				index = value;
+				break;
+			}
+			case GL_UNSIGNED_INT:
+				std::memcpy(&index, view.element(i), sizeof(index));
+				break;
+			default:
+				indices.resize(first);
+				return false;
+			}
+
+			indices[first + i] = offset + index;
+		}
+
+		return true;
+	}
+
+	void gatherNode(const GlbFile& file, const nlohmann::json& node, const glm::mat4& inheritedTransform,
+		std::vector<CollisionNode>& nodes)
+	{
+		const glm::mat4 transform{ inheritedTransform * getNodeTransform(node) };
+
+		const int meshIndex{ node.value("mesh", -1) };
+		if (meshIndex != -1)
+		{
+			CollisionNode collisionNode{ .name{ node.value("name", std::string{}) } };
+
+			for (const nlohmann::json& primitive : jsonArray(jsonArray(file.json(), "meshes")[meshIndex], "primitives"))
+			{
+				if (primitive.value("mode", trianglesMode) != trianglesMode)
+				{
+					continue;
+				}
+
+				const AccessorView positionAccessor{ file.accessor(jsonObject(primitive, "attributes").value("POSITION", -1)) };
+				const auto offset{ static_cast<std::uint32_t>(collisionNode.positions.size()) };
+
+				collisionNode.positions.resize(offset + positionAccessor.count);
+				if (!copyAccessor<glm::vec3>(positionAccessor, collisionNode.positions.data() + offset))
+				{
+					collisionNode.positions.resize(offset);
+					continue;
+				}
+
+				for (std::size_t i{ offset }; i < collisionNode.positions.size(); ++i)
+				{
+					collisionNode.positions[i] = transform * glm::vec4{ collisionNode.positions[i], 1.0f };
+				}
+
+				const AccessorView indicesAccessor{ file.accessor(primitive.value("indices", -1)) };
+				if (indicesAccessor.data)
+				{
+					if (!appendIndices(indicesAccessor, offset, collisionNode.indices))
+					{
+						std::cerr << "LEVEL COLLISION: ERROR: Unsupported index type in " << collisionNode.name << '\n';
+						collisionNode.positions.resize(offset);
+					}
+				}
+				else
+				{
+					for (std::uint32_t i{ 0 }; i < positionAccessor.count; ++i)
+					{
+						collisionNode.indices.push_back(offset + i);
+					}
+				}
+			}
+
+			if (collisionNode.indices.size() >= 3)
+			{
+				nodes.push_back(std::move(collisionNode));
+			}
+		}
+
+		for (int nodeIndex : jsonArray(node, "children"))
+		{
+			gatherNode(file, jsonArray(file.json(), "nodes")[nodeIndex], transform, nodes);
+		}
+	}
+
+	// Everything in the cooking parameters that changes the cooked output
+	std::uint64_t hashCookingParams(const physx::PxCookingParams& params)
+	{
+		std::uint64_t hash{ hashValue(hashSeed, params.scale.length) };
+		hash = hashValue(hash, params.scale.speed);
+		hash = hashValue(hash, params.areaTestEpsilon);
+		hash = hashValue(hash, params.planeTolerance);
+		hash = hashValue(hash, params.convexMeshCookingType);
+		hash = hashValue(hash, static_cast<std::uint32_t>(params.meshPreprocessParams));
+		hash = hashValue(hash, params.meshWeldTolerance);
+		hash = hashValue(hash, params.midphaseDesc.getType());
+		hash = hashValue(hash, params.buildTriangleAdjacencies);
+		hash = hashValue(hash, params.suppressTriangleMeshRemapTable);
+		return hashValue(hash, static_cast<std::uint32_t>(PX_PHYSICS_VERSION));
+	}
+
+	bool cook(const physx::PxCooking& cooking, const CollisionNode& node, physx::PxDefaultMemoryOutputStream& stream)
+	{
+		PROFILE_ZONE("Cook collision");
+
+		if (node.convex)
+		{
+			physx::PxConvexMeshDesc desc{};
+			desc.points.count = static_cast<physx::PxU32>(node.positions.size());
+			desc.points.stride = sizeof(glm::vec3);
+			desc.points.data = node.positions.data();
+			desc.flags = physx::PxConvexFlag::eCOMPUTE_CONVEX;
+
+			return cooking.cookConvexMesh(desc, stream);
+		}
+
+		physx::PxTriangleMeshDesc desc{};
+		desc.points.count = static_cast<physx::PxU32>(node.positions.size());
+		desc.points.stride = sizeof(glm::vec3);
+		desc.points.data = node.positions.data();
+		desc.triangles.count = static_cast<physx::PxU32>(node.indices.size() / 3);
+		desc.triangles.stride = 3 * sizeof(std::uint32_t);
+		desc.triangles.data = node.indices.data();
+
+		return cooking.cookTriangleMesh(desc, stream);
+	}
+
+	// Null if the stream doesn't hold a mesh of the expected kind, e.g. one
+	// cooked by another PhysX version
+	physx::PxShape* createShape(physx::PxPhysics& physics, physx::PxMaterial& material, bool convex,
+		const unsigned char* data, std::size_t size)
+	{
+		physx::PxDefaultMemoryInputData input{ const_cast<physx::PxU8*>(data), static_cast<physx::PxU32>(size) };
+
+		if (convex)
+		{
+			physx::PxConvexMesh* mesh{ physics.createConvexMesh(input) };
+			if (!mesh)
+			{
+				return nullptr;
+			}
+
+			physx::PxShape* shape{ physics.createShape(physx::PxConvexMeshGeometry{ mesh }, material, true) };
+			mesh->release();
+			return shape;
+		}
+
+		physx::PxTriangleMesh* mesh{ physics.createTriangleMesh(input) };
+		if (!mesh)
+		{
+			return nullptr;
+		}
+
+		physx::PxShape* shape{ physics.createShape(physx::PxTriangleMeshGeometry{ mesh }, material, true) };
+		mesh->release();
+		return shape;
+	}
+}
+
+
+
+LevelCollision::LevelCollision(physx::PxPhysics& physics, physx::PxCooking& cooking, physx::PxScene& scene,
+	physx::PxMaterial& material, const std::string& path, const std::string& cacheDirectory,
+	const LevelCollisionSettings& settings)
+	: m_scene{ scene }
+{
+	PROFILE_ZONE("Level collision");
+
+	const GlbFile file{ path };
+	if (!file.valid())
+	{
+		std::cerr << "LEVEL COLLISION: ERROR: Could not load " << path << '\n';
+		return;
+	}
+
+	std::vector<CollisionNode> nodes{};
+	const auto& gltfNodes{ jsonArray(file.json(), "nodes") };
+	for (const auto& gltfScene : jsonArray(file.json(), "scenes"))
+	{
+		for (int nodeIndex : jsonArray(gltfScene, "nodes"))
+		{
+			gatherNode(file, gltfNodes[nodeIndex], glm::mat4{ 1.0f }, nodes);
+		}
+	}
+
+	const auto tagged{ [](const CollisionNode& node, const std::string& tag) {
+		return !tag.empty() && node.name.find(tag) != std::string::npos;
+		} };
+
+	bool anyTagged{ false };
+	for (CollisionNode& node : nodes)
+	{
+		node.convex = tagged(node, settings.convexTag);
+		anyTagged = anyTagged || tagged(node, settings.collisionTag);
+	}
+
+	const FileCache cache{ cacheDirectory, ".ikcol", collisionCacheVersion };
+	const std::uint64_t paramsHash{ hashCookingParams(cooking.getParams()) };
+
+	std::vector<unsigned char> cached{};
+	std::size_t cookedCount{};
+
+	for (const CollisionNode& node : nodes)
+	{
+		if (anyTagged && !tagged(node, settings.collisionTag))
+		{
+			continue;
+		}
+
+		std::uint64_t key{ hashValue(paramsHash, node.convex) };
+		key = hashBytes(key, node.positions.data(), node.positions.size() * sizeof(glm::vec3));
+		key = hashBytes(key, node.indices.data(), node.indices.size() * sizeof(std::uint32_t));
+
+		physx::PxShape* shape{ cache.load(key, cached)
+			? createShape(physics, material, node.convex, cached.data(), cached.size()) : nullptr };
+
+		if (!shape)
+		{
+			physx::PxDefaultMemoryOutputStream stream{};
+			if (!cook(cooking, node, stream))
+			{
+				std::cerr << "LEVEL COLLISION: ERROR: Could not cook " << node.name << '\n';
+				continue;
+			}
+
+			++cookedCount;
+			cache.store(key, stream.getData(), stream.getSize());
+			shape = createShape(physics, material, node.convex, stream.getData(), stream.getSize());
+		}
+
+		if (!shape)
+		{
+			continue;
+		}
+
+		physx::PxRigidStatic* actor{ physics.createRigidStatic(physx::PxTransform{ physx::PxIdentity }) };
+		actor->attachShape(*shape);
+		shape->release();
+
+		m_scene.addActor(*actor);
+		m_actors.push_back(actor);
+	}
+
+	if (cookedCount != 0)
+	{
+		std::cout << "LEVEL COLLISION: Cooked " << cookedCount << " of " << m_actors.size() << " meshes\n";
+	}
+}
+
+LevelCollision::~LevelCollision()
+{
+	for (physx::PxRigidStatic* actor : m_actors)
+	{
+		m_scene.removeActor(*actor);
+		actor->release();
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+struct LevelCollisionSettings
+{
+	// When any node's name contains this, only those nodes collide;
+	// otherwise every node with a mesh does
+	std::string collisionTag{ "-col" };
+
+	// Nodes whose name contains this collide as their convex hull instead
+	// of their triangles, e.g. for props the player shouldn't snag on
+	std::string convexTag{ "-convex" };
+};
+
+// Static collision matching a glTF level. Every colliding node's triangles,
+// with the node's world transform baked in, are cooked into a triangle mesh
+// or convex mesh on a static actor of its own.
+//
+// Cooking is slow, so the cooked streams are kept in cacheDirectory under a
+// hash of the node's geometry and the cooking parameters, and a later launch
+// only cooks the nodes that changed. An empty directory disables the cache.
+class LevelCollision final
+{
+public:
+
+	LevelCollision(physx::PxPhysics& physics, physx::PxCooking& cooking, physx::PxScene& scene,
+		physx::PxMaterial& material, const std::string& path, const std::string& cacheDirectory,
+		const LevelCollisionSettings& settings = {});
+	~LevelCollision();
+
+	LevelCollision(const LevelCollision&) = delete;
+	LevelCollision& operator=(const LevelCollision&) = delete;
+
+	std::size_t actorCount() const
+	{
+		return m_actors.size();
+	}
+
+private:
+
+	physx::PxScene& m_scene;
+
+	std::vector<physx::PxRigidStatic*> m_actors{};
+};
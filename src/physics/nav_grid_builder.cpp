@@ -0,0 +1,199 @@
+#include "nav_grid_builder.hpp"
+
+#include "../io/file_cache.hpp"
+#include "../io/hash.hpp"
+#include "../jobs/job_system.hpp"
+#include "../navigation/nav_grid.hpp"
+#include "../profiler/profiler.hpp"
+
+#include "glm/glm.hpp"
+#include "PxPhysicsAPI.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// Bump whenever the probing or NavGrid's serialized layout changes
+	constexpr std::uint32_t navCacheVersion{ 1 };
+
+	// Rows of cells per job
+	constexpr std::size_t rowGrainSize{ 4 };
+
+	std::uint64_t hashGeometry(std::uint64_t hash, const physx::PxGeometryHolder& geometry)
+	{
+		switch (geometry.getType())
+		{
+		case physx::PxGeometryType::eSPHERE:
+			return hashValue(hash, geometry.sphere().radius);
+
+		case physx::PxGeometryType::eCAPSULE:
+			hash = hashValue(hash, geometry.capsule().radius);
+			return hashValue(hash, geometry.capsule().halfHeight);
+
+		case physx::PxGeometryType::eBOX:
+			return hashValue(hash, geometry.box().halfExtents);
+
+		case physx::PxGeometryType::eCONVEXMESH:
+		{
+			const physx::PxConvexMeshGeometry& convex{ geometry.convexMesh() };
+			hash = hashValue(hash, convex.scale);
+			return hashBytes(hash, convex.convexMesh->getVertices(),
+				convex.convexMesh->getNbVertices() * sizeof(physx::PxVec3));
+		}
+
+		case physx::PxGeometryType::eTRIANGLEMESH:
+		{
+			const physx::PxTriangleMeshGeometry& triangles{ geometry.triangleMesh() };
+			const physx::PxTriangleMesh& mesh{ *triangles.triangleMesh };
+			const bool shortIndices{ mesh.getTriangleMeshFlags() & physx::PxTriangleMeshFlag::e16_BIT_INDICES };
+
+			hash = hashValue(hash, triangles.scale);
+			hash = hashBytes(hash, mesh.getVertices(), mesh.getNbVertices() * sizeof(physx::PxVec3));
+			return hashBytes(hash, mesh.getTriangles(),
+				mesh.getNbTriangles() * 3 * (shortIndices ? sizeof(physx::PxU16) : sizeof(physx::PxU32)));
+		}
+
+		case physx::PxGeometryType::eHEIGHTFIELD:
+		{
+			const physx::PxHeightFieldGeometry& heightField{ geometry.heightField() };
+			const physx::PxHeightField& field{ *heightField.heightField };
+
+			hash = hashValue(hash, heightField.heightScale);
+			hash = hashValue(hash, heightField.rowScale);
+			hash = hashValue(hash, heightField.columnScale);
+
+			std::vector<physx::PxHeightFieldSample> samples(field.getNbRows() * field.getNbColumns());
+			field.saveCells(samples.data(), static_cast<physx::PxU32>(samples.size() * sizeof(physx::PxHeightFieldSample)));
+			return hashBytes(hash, samples.data(), samples.size() * sizeof(physx::PxHeightFieldSample));
+		}
+
+		default:
+			// Planes have no parameters beyond their pose
+			return hash;
+		}
+	}
+
+	void probeRow(NavGrid& grid, const physx::PxScene& scene, const NavGridSettings& settings,
+		const physx::PxBounds3& bounds, const glm::vec2& origin, int z)
+	{
+		const physx::PxQueryFilterData floorFilter{ physx::PxQueryFlag::eSTATIC };
+		const physx::PxQueryFilterData blockerFilter{ physx::PxQueryFlag::eSTATIC | physx::PxQueryFlag::eANY_HIT };
+
+		// Starts above everything, so the first hit is the topmost floor
+		const float rayStart{ bounds.maximum.y + 1.0f };
+		const float rayLength{ bounds.maximum.y - bounds.minimum.y + 2.0f };
+
+		// From just above the highest step up to the top of the agent
+		const float clearance{ settings.agentHeight - settings.maxStepHeight };
+		const physx::PxBoxGeometry agentBox{ settings.agentRadius, clearance * 0.5f, settings.agentRadius };
+
+		for (int x{ 0 }; x < grid.width(); ++x)
+		{
+			const float cellX{ origin.x + (x + 0.5f) * settings.cellSize };
+			const float cellZ{ origin.y + (z + 0.5f) * settings.cellSize };
+
+			physx::PxRaycastBuffer floorHit{};
+			if (!scene.raycast(physx::PxVec3{ cellX, rayStart, cellZ }, physx::PxVec3{ 0.0f, -1.0f, 0.0f },
+				rayLength, floorHit, physx::PxHitFlag::eDEFAULT, floorFilter)
+				|| floorHit.block.normal.y < settings.minFloorNormalY)
+			{
+				continue;
+			}
+
+			const float floor{ floorHit.block.position.y };
+
+			physx::PxOverlapBuffer blockerHit{};
+			const physx::PxTransform agentPose{
+				physx::PxVec3{ cellX, floor + settings.maxStepHeight + clearance * 0.5f, cellZ } };
+			const bool blocked{ scene.overlap(agentBox, agentPose, blockerHit, blockerFilter) };
+
+			grid.setCell(x, z, !blocked, floor);
+		}
+	}
+}
+
+
+
+void buildNavGrid(NavGrid& grid, physx::PxScene& scene, const NavGridSettings& settings,
+	const std::string& cacheDirectory, JobSystem* jobSystem)
+{
+	PROFILE_ZONE("Build nav grid");
+
+	std::vector<physx::PxActor*> actors(scene.getNbActors(physx::PxActorTypeFlag::eRIGID_STATIC));
+	scene.getActors(physx::PxActorTypeFlag::eRIGID_STATIC, actors.data(), static_cast<physx::PxU32>(actors.size()));
+
+	std::uint64_t key{ hashValue(hashSeed, settings) };
+	physx::PxBounds3 bounds{ physx::PxBounds3::empty() };
+	std::vector<physx::PxShape*> shapes{};
+
+	for (physx::PxActor* actor : actors)
+	{
+		const auto& rigid{ static_cast<const physx::PxRigidActor&>(*actor) };
+
+		shapes.resize(rigid.getNbShapes());
+		rigid.getShapes(shapes.data(), static_cast<physx::PxU32>(shapes.size()));
+
+		for (const physx::PxShape* shape : shapes)
+		{
+			const physx::PxGeometryHolder geometry{ shape->getGeometry() };
+
+			key = hashValue(key, geometry.getType());
+			key = hashValue(key, physx::PxShapeExt::getGlobalPose(*shape, rigid));
+			key = hashGeometry(key, geometry);
+
+			// Infinite, so left out of the grid's extent
+			if (geometry.getType() != physx::PxGeometryType::ePLANE)
+			{
+				bounds.include(physx::PxShapeExt::getWorldBounds(*shape, rigid));
+			}
+		}
+	}
+
+	const FileCache cache{ cacheDirectory, ".iknav", navCacheVersion };
+
+	std::vector<unsigned char> cached{};
+	if (cache.load(key, cached) && grid.deserialize(cached))
+	{
+		return;
+	}
+
+	if (bounds.isEmpty())
+	{
+		std::cerr << "NAV GRID: WARNING: No static geometry to walk on\n";
+		grid.reset(0, 0, glm::vec2{ 0.0f }, settings.cellSize, settings.maxStepHeight);
+		return;
+	}
+
+	const glm::vec2 origin{ bounds.minimum.x, bounds.minimum.z };
+	const auto width{ static_cast<int>(std::ceil((bounds.maximum.x - bounds.minimum.x) / settings.cellSize)) };
+	const auto depth{ static_cast<int>(std::ceil((bounds.maximum.z - bounds.minimum.z) / settings.cellSize)) };
+	grid.reset(width, depth, origin, settings.cellSize, settings.maxStepHeight);
+
+	// Queries from several threads at once must not be the first to see the
+	// newly added actors, or they race to update the query structures
+	scene.flushQueryUpdates();
+
+	const auto probeRows{ [&](std::size_t begin, std::size_t end) {
+		for (std::size_t z{ begin }; z < end; ++z)
+		{
+			probeRow(grid, scene, settings, bounds, origin, static_cast<int>(z));
+		}
+		} };
+
+	if (jobSystem)
+	{
+		jobSystem->parallelFor(static_cast<std::size_t>(depth), rowGrainSize, probeRows);
+	}
+	else
+	{
+		probeRows(0, static_cast<std::size_t>(depth));
+	}
+
+	const std::vector<unsigned char> data{ grid.serialize() };
+	cache.store(key, data.data(), data.size());
+}
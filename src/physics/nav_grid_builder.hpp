@@ -0,0 +1,36 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+
+#include <string>
+
+class JobSystem;
+class NavGrid;
+
+struct NavGridSettings
+{
+	// Metres per cell side
+	float cellSize{ 0.5f };
+
+	// Cells closer than agentRadius to a wall, or with less than agentHeight
+	// of headroom, are blocked
+	float agentRadius{ 0.4f };
+	float agentHeight{ 1.8f };
+
+	// Highest ledge an agent steps up or down between neighbouring cells
+	float maxStepHeight{ 0.4f };
+
+	// Floors steeper than this (the y of their normal) are not walkable
+	float minFloorNormalY{ 0.7f };
+};
+
+// Fills the grid from the static actors of the scene: a ray straight down
+// through each cell finds its floor, and a box the size of an agent stood
+// on it checks the headroom. Rows are probed in parallel when a job system
+// is given. The result is kept in cacheDirectory under a hash of the
+// settings and of every static shape, so later launches with the same level
+// load it instead; an empty directory disables the cache.
+//
+// Queries the scene, so only while it isn't simulating.
+void buildNavGrid(NavGrid& grid, physx::PxScene& scene, const NavGridSettings& settings,
+	const std::string& cacheDirectory, JobSystem* jobSystem = nullptr);
@@ -0,0 +1,36 @@
+#include "physics_stepper.hpp"
+
+#include "PxPhysicsAPI.h"
+
+void PhysicsStepper::kick(float deltaTime)
+{
+	sync();
+
+	m_scene->simulate(deltaTime);
+	m_simulating = true;
+
+	if (!m_async)
+	{
+		sync();
+	}
+}
+
+bool PhysicsStepper::poll()
+{
+	if (m_simulating && m_scene->checkResults(false))
+	{
+		m_scene->fetchResults(true);
+		m_simulating = false;
+	}
+
+	return !m_simulating;
+}
+
+void PhysicsStepper::sync()
+{
+	if (m_simulating)
+	{
+		m_scene->fetchResults(true);
+		m_simulating = false;
+	}
+}
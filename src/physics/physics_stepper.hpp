@@ -0,0 +1,48 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+
+// Drives PxScene::simulate()/fetchResults(). In async mode a step is kicked
+// off and left running on the job system while the rest of the frame goes
+// on; the results are only fetched when something needs to write to the
+// scene again, or earlier if poll() finds them ready. In sync mode every
+// kick blocks until the step is done, like a plain simulate/fetch pair.
+class PhysicsStepper final
+{
+public:
+
+	PhysicsStepper(physx::PxScene* scene, bool async)
+		: m_scene{ scene }
+		, m_async{ async }
+	{}
+
+	~PhysicsStepper()
+	{
+		sync();
+	}
+
+	PhysicsStepper(const PhysicsStepper&) = delete;
+	PhysicsStepper& operator=(const PhysicsStepper&) = delete;
+
+	void kick(float deltaTime);
+
+	// Non-blocking. Fetches the results if the step in flight has finished.
+	// Returns true when no step is in flight anymore.
+	bool poll();
+
+	// Blocks until the step in flight, if any, has been fetched. Call this
+	// before writing to the scene (controller moves, adding actors, ...).
+	void sync();
+
+	bool isSimulating() const
+	{
+		return m_simulating;
+	}
+
+private:
+
+	physx::PxScene* m_scene{};
+
+	bool m_async{ true };
+	bool m_simulating{ false };
+};
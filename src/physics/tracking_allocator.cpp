@@ -0,0 +1,17 @@
+#include "tracking_allocator.hpp"
+
+#include "../memory/memory_tracker.hpp"
+
+#include "PxPhysicsAPI.h"
+
+#include <cstddef>
+
+void* TrackingAllocator::allocate(std::size_t size, const char*, const char*, int)
+{
+	return MemoryTracker::allocate(size, 16, MemoryTracker::PHYSICS);
+}
+
+void TrackingAllocator::deallocate(void* pointer)
+{
+	MemoryTracker::deallocate(pointer);
+}
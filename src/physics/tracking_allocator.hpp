@@ -0,0 +1,18 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+
+#include <cstddef>
+
+// PhysX's allocator, charging everything it allocates to
+// MemoryTracker::PHYSICS instead of leaving it invisible behind
+// PxDefaultAllocator
+class TrackingAllocator final : public physx::PxAllocatorCallback
+{
+public:
+
+	// PhysX requires 16 byte alignment
+	void* allocate(std::size_t size, const char* typeName, const char* filename, int line) override;
+
+	void deallocate(void* pointer) override;
+};
@@ -0,0 +1,250 @@
+#include "profiler.hpp"
+
+#include "../io/json.hpp"
+
+#include <algorithm> // for std::max
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility> // for std::pair
+#include <vector>
+
+namespace
+{
+	struct Event
+	{
+		const char* name{};
+		std::int64_t start{};
+		std::int64_t end{};
+	};
+
+	// Single producer ring. Only the owning thread writes events; the
+	// exporter reads up to writeIndex. When a thread records more than
+	// ringCapacity zones between exports the oldest ones are overwritten.
+	constexpr std::size_t ringCapacity{ 1 << 16 };
+
+	struct ThreadBuffer
+	{
+		std::uint32_t threadId{};
+		std::string name{};
+
+		std::array<Event, ringCapacity> events{};
+		std::atomic<std::uint64_t> writeIndex{ 0 };
+
+		void push(const char* name, std::int64_t start, std::int64_t end)
+		{
+			const std::uint64_t index{ writeIndex.load(std::memory_order_relaxed) };
+			events[index % ringCapacity] = Event{ name, start, end };
+			writeIndex.store(index + 1, std::memory_order_release);
+		}
+	};
+
+	constexpr std::size_t frameHistoryCapacity{ 4096 };
+
+	struct Registry
+	{
+		std::mutex mutex{};
+		std::vector<std::unique_ptr<ThreadBuffer>> buffers{};
+
+		// GPU zones are only ever recorded by the render thread, but get
+		// their own track in the trace
+		std::unique_ptr<ThreadBuffer> gpuBuffer{};
+
+		std::vector<std::pair<std::int64_t, Profiler::FrameCounters>> frameHistory{};
+		std::size_t frameHistoryNext{ 0 };
+		Profiler::FrameCounters lastFrame{};
+	};
+
+	Registry& registry()
+	{
+		static Registry r{};
+		return r;
+	}
+
+	const std::chrono::steady_clock::time_point startTime{ std::chrono::steady_clock::now() };
+
+	// Zones are only recorded once someone asks for a trace
+	std::atomic<bool> enabled{ false };
+	std::array<std::atomic<std::uint64_t>, Profiler::COUNTER_COUNT> counters{};
+
+	thread_local ThreadBuffer* t_buffer{ nullptr };
+
+	ThreadBuffer& createBuffer(Registry& r, std::unique_ptr<ThreadBuffer>& slot, const std::string& name)
+	{
+		slot = std::make_unique<ThreadBuffer>();
+		slot->threadId = static_cast<std::uint32_t>(r.buffers.size() + 1);
+		slot->name = name;
+		return *slot;
+	}
+
+	ThreadBuffer& threadBuffer()
+	{
+		if (!t_buffer)
+		{
+			Registry& r{ registry() };
+			std::lock_guard lock{ r.mutex };
+
+			std::unique_ptr<ThreadBuffer> buffer{};
+			t_buffer = &createBuffer(r, buffer, "Thread " + std::to_string(r.buffers.size() + 1));
+			r.buffers.push_back(std::move(buffer));
+		}
+
+		return *t_buffer;
+	}
+
+	void writeEvents(std::ostream& out, const ThreadBuffer& buffer, bool& first)
+	{
+		out << (first ? "" : ",\n") << R"({"name":"thread_name","ph":"M","pid":1,"tid":)" << buffer.threadId
+			<< R"(,"args":{"name":")";
+		writeJsonEscaped(out, buffer.name.c_str());
+		out << "\"}}";
+		first = false;
+
+		const std::uint64_t end{ buffer.writeIndex.load(std::memory_order_acquire) };
+		const std::uint64_t begin{ end > ringCapacity ? end - ringCapacity : 0 };
+
+		for (std::uint64_t i{ begin }; i < end; ++i)
+		{
+			const Event& event{ buffer.events[i % ringCapacity] };
+
+			out << R"(,
+{"name":")";
+			writeJsonEscaped(out, event.name);
+			out << R"(","ph":"X","pid":1,"tid":)" << buffer.threadId
+				<< R"(,"ts":)" << event.start / 1000.0
+				<< R"(,"dur":)" << (event.end - event.start) / 1000.0 << '}';
+		}
+	}
+}
+
+void Profiler::setEnabled(bool enable)
+{
+	enabled.store(enable, std::memory_order_relaxed);
+}
+
+bool Profiler::isEnabled()
+{
+	return enabled.load(std::memory_order_relaxed);
+}
+
+std::int64_t Profiler::now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now() - startTime).count();
+}
+
+void Profiler::setThreadName(const std::string& name)
+{
+	ThreadBuffer& buffer{ threadBuffer() };
+
+	std::lock_guard lock{ registry().mutex };
+	buffer.name = name;
+}
+
+
+
+void Profiler::recordCpuZone(const char* name, std::int64_t start, std::int64_t end)
+{
+	threadBuffer().push(name, start, end);
+}
+
+void Profiler::recordGpuZone(const char* name, std::int64_t start, std::int64_t end)
+{
+	Registry& r{ registry() };
+
+	if (!r.gpuBuffer)
+	{
+		std::lock_guard lock{ r.mutex };
+		createBuffer(r, r.gpuBuffer, "GPU").threadId = 0;
+	}
+
+	r.gpuBuffer->push(name, start, end);
+}
+
+
+
+void Profiler::count(Counter counter, std::uint64_t amount)
+{
+	counters[counter].fetch_add(amount, std::memory_order_relaxed);
+}
+
+void Profiler::endFrame()
+{
+	FrameCounters frame{};
+	for (int i{ 0 }; i < COUNTER_COUNT; ++i)
+	{
+		frame.values[i] = counters[i].exchange(0, std::memory_order_relaxed);
+	}
+
+	Registry& r{ registry() };
+	std::lock_guard lock{ r.mutex };
+
+	r.lastFrame = frame;
+
+	if (r.frameHistory.size() < frameHistoryCapacity)
+	{
+		r.frameHistory.push_back({ now(), frame });
+	}
+	else
+	{
+		r.frameHistory[r.frameHistoryNext] = { now(), frame };
+		r.frameHistoryNext = (r.frameHistoryNext + 1) % frameHistoryCapacity;
+	}
+}
+
+Profiler::FrameCounters Profiler::lastFrameCounters()
+{
+	Registry& r{ registry() };
+	std::lock_guard lock{ r.mutex };
+
+	return r.lastFrame;
+}
+
+
+
+bool Profiler::exportChromeTrace(const std::string& path)
+{
+	std::ofstream out{ path };
+	if (!out)
+	{
+		std::cerr << "PROFILER: ERROR: Could not open " << path << " for writing\n";
+		return false;
+	}
+
+	out << std::fixed << std::setprecision(3);
+	out << "{\"traceEvents\":[\n";
+
+	Registry& r{ registry() };
+	std::lock_guard lock{ r.mutex };
+
+	bool first{ true };
+	for (const auto& buffer : r.buffers)
+	{
+		writeEvents(out, *buffer, first);
+	}
+	if (r.gpuBuffer)
+	{
+		writeEvents(out, *r.gpuBuffer, first);
+	}
+
+	for (const auto& [time, frame] : r.frameHistory)
+	{
+		out << (first ? "" : ",\n") << R"({"name":"Frame counters","ph":"C","pid":1,"ts":)" << time / 1000.0
+			<< R"(,"args":{"draws":)" << frame.values[DRAWS]
+			<< R"(,"triangles":)" << frame.values[TRIANGLES]
+			<< R"(,"uniformUploads":)" << frame.values[UNIFORM_UPLOADS] << "}}";
+		first = false;
+	}
+
+	out << "\n]}\n";
+
+	return true;
+}
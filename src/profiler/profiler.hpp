@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// In-engine frame profiler. CPU zones are recorded into a lock-free ring
+// buffer owned by the recording thread, GPU zones come in from GpuTimer a
+// few frames late, and a handful of per-frame counters are accumulated with
+// atomics. Everything can be written out as a Chrome trace
+// (chrome://tracing, Perfetto) with exportChromeTrace().
+class Profiler final
+{
+public:
+
+	enum Counter
+	{
+		DRAWS,
+		TRIANGLES,
+		UNIFORM_UPLOADS,
+		COUNTER_COUNT,
+	};
+
+	struct FrameCounters
+	{
+		std::uint64_t values[COUNTER_COUNT]{};
+	};
+
+	// Records the enclosing scope as a CPU zone. name must outlive the
+	// profiler, which string literals and PhysX task names do.
+	class ScopedZone final
+	{
+	public:
+
+		explicit ScopedZone(const char* name)
+			: m_name{ name }
+			, m_active{ Profiler::isEnabled() }
+			, m_start{ m_active ? Profiler::now() : 0 }
+		{}
+
+		~ScopedZone()
+		{
+			if (m_active)
+			{
+				Profiler::recordCpuZone(m_name, m_start, Profiler::now());
+			}
+		}
+
+		ScopedZone(const ScopedZone&) = delete;
+		ScopedZone& operator=(const ScopedZone&) = delete;
+
+	private:
+
+		const char* m_name{};
+		bool m_active{ false };
+		std::int64_t m_start{};
+	};
+
+	// Gates CPU zones only, counters are always accumulated. Off by default.
+	static void setEnabled(bool enabled);
+	static bool isEnabled();
+
+	// Nanoseconds since the profiler was first used
+	static std::int64_t now();
+
+	static void setThreadName(const std::string& name);
+
+	static void recordCpuZone(const char* name, std::int64_t start, std::int64_t end);
+	static void recordGpuZone(const char* name, std::int64_t start, std::int64_t end);
+
+	static void count(Counter counter, std::uint64_t amount = 1);
+
+	// Closes the current frame's counters. Called once per rendered frame.
+	static void endFrame();
+	static FrameCounters lastFrameCounters();
+
+	static bool exportChromeTrace(const std::string& path);
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name) Profiler::ScopedZone PROFILE_CONCAT(profileZone, __LINE__){ name }
@@ -0,0 +1,142 @@
+#include "animation.hpp"
+
+#include "renderer.hpp"
+#include "../memory/frame_arena.hpp"
+
+#include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+#include "glm/gtx/quaternion.hpp"
+
+#include <vector>
+
+glm::vec4 determineSamplerOutput(const Renderer::AnimationSampler& sampler, double time, double maxTime)
+{
+	float lesserInputValue{ -1.0f };
+	int lesserInput{};
+
+	float greaterInputValue{ static_cast<float>(maxTime) + 1.0f };
+	int greaterInput{};
+
+	for (int i{ 0 }; i < sampler.input.size(); ++i)
+	{
+		if (sampler.input[i] <= time && sampler.input[i] > lesserInputValue)
+		{
+			lesserInputValue = sampler.input[i];
+			lesserInput = i;
+		}
+
+		if (sampler.input[i] >= time && sampler.input[i] < greaterInputValue)
+		{
+			greaterInputValue = sampler.input[i];
+			greaterInput = i;
+		}
+	}
+
+	if (time == sampler.input[lesserInput])
+	{
+		return sampler.output[lesserInput];
+	}
+	else
+	{
+		const float x{ (static_cast<float>(time) - lesserInputValue) / (greaterInputValue - lesserInputValue) };
+
+		return glm::mix(sampler.output[lesserInput], sampler.output[greaterInput], x);
+	}
+}
+
+glm::mat4 calculateJointLocalTransform(const Renderer::Joint& joint, double time, double maxTime)
+{
+	glm::mat4 transform{ 1.0f };
+
+	for (const auto& sampler : joint.animationSamplers)
+	{
+		glm::vec4 output{ determineSamplerOutput(sampler.second, time, maxTime) };
+
+		switch (sampler.second.path)
+		{
+		case Renderer::AnimationSampler::TRANSLATION:
+		{
+			glm::mat4 translation{ 1.0f };
+			translation = glm::translate(translation, static_cast<glm::vec3>(output));
+			transform *= translation;
+			break;
+		}
+
+		case Renderer::AnimationSampler::ROTATION:
+		{
+			glm::quat quat{ output.w, output.x, output.y, output.z };
+			glm::mat4 rotation{ glm::toMat4(quat) };
+			transform *= rotation;
+			break;
+		}
+
+		case Renderer::AnimationSampler::SCALE:
+		{
+			glm::mat4 scale{ 1.0f };
+			scale = glm::scale(scale, static_cast<glm::vec3>(output));
+			transform *= scale;
+			break;
+		}
+		}
+	}
+
+	return transform;
+}
+
+void calculateJointChildrenGlobalTransforms(const Renderer::Mesh& mesh,
+	const Renderer::Joint& joint, const glm::mat4& jointGlobalTransform,
+	const glm::mat4* localTransforms, glm::mat4* globalTransforms)
+{
+	for (int childIndex : joint.children)
+	{
+		glm::mat4 childGlobalTransform{ jointGlobalTransform * localTransforms[childIndex] };
+
+		globalTransforms[childIndex] = childGlobalTransform;
+
+		if (mesh.joints[childIndex].children.size() != 0)
+		{
+			calculateJointChildrenGlobalTransforms(mesh, mesh.joints[childIndex], childGlobalTransform,
+				localTransforms, globalTransforms);
+		}
+	}
+}
+
+void calculateJointMatrix(const Renderer::Mesh& mesh, glm::mat4* jointMatrix)
+{
+	FrameArenaScope scratch{};
+
+	// Transform of the node that the mesh is attached to
+	glm::mat4 globalTransform{ 1.0f };
+	
+	FrameVector<glm::mat4> localTransforms(mesh.joints.size());
+	for (int i{ 0 }; i < mesh.joints.size(); ++i)
+	{
+		localTransforms[i] = calculateJointLocalTransform(mesh.joints[i], mesh.time, mesh.maxTime);
+	}
+
+	// Global transform of the joint. This needs to inherit all its transforms from
+	// parent joints.
+	FrameVector<glm::mat4> globalJointTransforms(mesh.joints.size());
+	for (int i{ 0 }; i < globalJointTransforms.size(); ++i)
+	{
+		if (!mesh.joints[i].hasJointParent)
+		{
+			globalJointTransforms[i] = localTransforms[i];
+
+			calculateJointChildrenGlobalTransforms(mesh, mesh.joints[i], localTransforms[i],
+				localTransforms.data(), globalJointTransforms.data());
+		}
+	}
+	
+	for (int i{ 0 }; i < mesh.joints.size(); ++i)
+	{
+		glm::mat4 globalTransform{ 1.0f };
+
+		jointMatrix[i] = { glm::mat4{
+			glm::inverse(globalTransform) * 
+			globalJointTransforms[i] * 
+			mesh.joints[i].inverseBindMatrix
+		} };
+	}
+}
+
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "renderer.hpp"
+
+#include "glm/glm.hpp"
+
+// Skeletal animation sampling. Pure CPU code; nothing in here touches GL, so
+// it can run on any thread and be benchmarked without a context.
+
+glm::vec4 determineSamplerOutput(const Renderer::AnimationSampler& sampler, double time, double maxTime);
+
+glm::mat4 calculateJointLocalTransform(const Renderer::Joint& joint, double time, double maxTime);
+
+void calculateJointChildrenGlobalTransforms(const Renderer::Mesh& mesh,
+	const Renderer::Joint& joint, const glm::mat4& jointGlobalTransform,
+	const glm::mat4* localTransforms, glm::mat4* globalTransforms);
+
+// Joint palette (skinning matrices) for the mesh's current animation time,
+// one per joint. Scratch space comes from the thread's FrameArena, so this
+// doesn't touch the heap.
+void calculateJointMatrix(const Renderer::Mesh& mesh, glm::mat4* jointMatrix);
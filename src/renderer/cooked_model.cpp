@@ -0,0 +1,524 @@
+#include "cooked_model.hpp"
+
+#include "model_loader.hpp"
+#include "renderer.hpp"
+#include "../io/mapped_file.hpp"
+#include "../memory/memory_tracker.hpp"
+
+#include "glad/glad.h"
+#include "glm/glm.hpp"
+
+#include <algorithm> // for std::min
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <span>
+#include <string>
+#include <utility> // for std::pair
+#include <vector>
+
+namespace
+{
+	// File layout: a Header, then each section 16 byte aligned. Every
+	// section is a flat array of one of the POD records below, so the
+	// loader only has to bounds check offsets and cast.
+
+	constexpr char magic[4]{ 'I', 'K', 'M', 'S' };
+
+	enum SectionIndex
+	{
+		VERTICES,
+		INDICES,
+		PRIMITIVES,
+		JOINTS,
+		CHILDREN,
+		SAMPLERS,
+		KEYFRAME_INPUTS,
+		KEYFRAME_OUTPUTS,
+		TEXTURES,
+		PIXELS,
+		NAMES,
+
+		SECTION_COUNT,
+	};
+
+	struct Section
+	{
+		std::uint64_t offset{};
+		std::uint64_t count{};
+	};
+
+	struct Header
+	{
+		char magic[4]{};
+		std::uint32_t version{};
+		// Guards against a Vertex layout change without a version bump
+		std::uint32_t vertexSize{};
+		std::uint32_t padding{};
+		double maxTime{};
+
+		Section sections[SECTION_COUNT]{};
+	};
+
+	struct CookedPrimitive
+	{
+		glm::mat4 transform{};
+		glm::vec4 baseColorFactor{};
+		std::int32_t baseColorTextureIndex{};
+		std::uint32_t elementOffset{};
+		std::uint32_t elementCount{};
+		std::uint32_t skinned{};
+	};
+
+	struct CookedJoint
+	{
+		glm::mat4 transform{};
+		glm::mat4 inverseBindMatrix{};
+		std::int32_t nodeIndex{};
+		std::uint32_t hasJointParent{};
+		std::uint32_t firstChild{};
+		std::uint32_t childCount{};
+		std::uint32_t firstSampler{};
+		std::uint32_t samplerCount{};
+		std::uint32_t nameOffset{};
+		std::uint32_t nameLength{};
+	};
+
+	struct CookedSampler
+	{
+		std::uint32_t path{};
+		std::uint32_t firstKeyframe{};
+		std::uint32_t keyframeCount{};
+		std::uint32_t padding{};
+	};
+
+	struct CookedTexture
+	{
+		std::int32_t width{};
+		std::int32_t height{};
+		std::int32_t bits{};
+		std::int32_t minFilter{};
+		std::int32_t magFilter{};
+		std::int32_t padding{};
+		std::uint64_t pixelOffset{};
+		std::uint64_t pixelSize{};
+	};
+
+	constexpr std::size_t sectionAlignment{ 16 };
+
+	// Whether [first, first + count) lies within size elements, without
+	// overflowing on corrupt values
+	bool inRange(std::uint64_t first, std::uint64_t count, std::size_t size)
+	{
+		return first <= size && count <= size - first;
+	}
+
+	template <typename T>
+	Section writeSection(std::ofstream& out, const std::vector<T>& data)
+	{
+		const auto position{ static_cast<std::uint64_t>(out.tellp()) };
+		const std::uint64_t offset{ (position + sectionAlignment - 1) & ~std::uint64_t{ sectionAlignment - 1 } };
+
+		const char zeros[sectionAlignment]{};
+		out.write(zeros, static_cast<std::streamsize>(offset - position));
+		out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size() * sizeof(T)));
+
+		return { offset, data.size() };
+	}
+}
+
+CookedModel::CookedModel(const std::string& path)
+	: m_file{ path }
+{
+	if (!m_file.valid() || m_file.size() < sizeof(Header))
+	{
+		return;
+	}
+
+	Header header{};
+	std::memcpy(&header, m_file.data(), sizeof(Header));
+
+	if (std::memcmp(header.magic, magic, sizeof(magic)) != 0
+		|| header.version != formatVersion || header.vertexSize != sizeof(Renderer::Vertex))
+	{
+		std::cerr << "MODEL LOADER: ERROR: " << path << " is not a cooked model of version " << formatVersion << '\n';
+		return;
+	}
+
+	constexpr std::size_t recordSizes[SECTION_COUNT]{
+		sizeof(Renderer::Vertex), sizeof(GLuint), sizeof(CookedPrimitive), sizeof(CookedJoint),
+		sizeof(std::int32_t), sizeof(CookedSampler), sizeof(float), sizeof(glm::vec4),
+		sizeof(CookedTexture), 1, 1, };
+
+	for (int i{ 0 }; i < SECTION_COUNT; ++i)
+	{
+		const Section& section{ header.sections[i] };
+		if (section.offset % sectionAlignment != 0 || section.offset > m_file.size()
+			|| section.count > (m_file.size() - section.offset) / recordSizes[i])
+		{
+			std::cerr << "MODEL LOADER: ERROR: Truncated cooked model " << path << '\n';
+			return;
+		}
+	}
+
+	// Records index into other sections; every range has to be checked
+	// before mesh() and textures() slice with it
+	m_valid = true;
+	if (!recordsInRange())
+	{
+		m_valid = false;
+		std::cerr << "MODEL LOADER: ERROR: Corrupt cooked model " << path << '\n';
+	}
+}
+
+bool CookedModel::recordsInRange() const
+{
+	const auto textures{ section<CookedTexture>(TEXTURES) };
+	const std::size_t indexCount{ section<GLuint>(INDICES).size() };
+
+	for (const CookedPrimitive& primitive : section<CookedPrimitive>(PRIMITIVES))
+	{
+		if (!inRange(primitive.elementOffset, primitive.elementCount, indexCount)
+			|| primitive.elementCount > static_cast<std::uint32_t>(std::numeric_limits<GLsizei>::max())
+			|| primitive.baseColorTextureIndex < -1
+			|| primitive.baseColorTextureIndex >= static_cast<std::int64_t>(textures.size()))
+		{
+			return false;
+		}
+	}
+
+	// Indices are relative to the model's first vertex, whichever
+	// primitive they belong to
+	const std::size_t vertexCount{ section<Renderer::Vertex>(VERTICES).size() };
+	for (const GLuint index : section<GLuint>(INDICES))
+	{
+		if (index >= vertexCount)
+		{
+			return false;
+		}
+	}
+
+	const auto joints{ section<CookedJoint>(JOINTS) };
+	const auto children{ section<std::int32_t>(CHILDREN) };
+	const auto samplers{ section<CookedSampler>(SAMPLERS) };
+	const std::size_t nameSize{ section<char>(NAMES).size() };
+	const std::size_t keyframeCount{ std::min(section<float>(KEYFRAME_INPUTS).size(),
+		section<glm::vec4>(KEYFRAME_OUTPUTS).size()) };
+
+	// The animation walks the children recursively, so they have to form a
+	// forest: every child a valid joint with exactly one parent, and no
+	// joint among its own ancestors
+	std::vector<std::int32_t> parents(joints.size(), -1);
+
+	for (std::size_t i{ 0 }; i < joints.size(); ++i)
+	{
+		const CookedJoint& joint{ joints[i] };
+		if (!inRange(joint.nameOffset, joint.nameLength, nameSize)
+			|| !inRange(joint.firstChild, joint.childCount, children.size())
+			|| !inRange(joint.firstSampler, joint.samplerCount, samplers.size()))
+		{
+			return false;
+		}
+
+		for (const std::int32_t child : children.subspan(joint.firstChild, joint.childCount))
+		{
+			if (child < 0 || static_cast<std::size_t>(child) >= joints.size() || parents[child] != -1
+				|| static_cast<std::size_t>(child) == i)
+			{
+				return false;
+			}
+			parents[child] = static_cast<std::int32_t>(i);
+		}
+	}
+
+	for (std::size_t i{ 0 }; i < joints.size(); ++i)
+	{
+		// A chain longer than the joint count has to loop
+		std::size_t depth{ 0 };
+		for (std::int32_t parent{ parents[i] }; parent != -1; parent = parents[parent])
+		{
+			if (++depth > joints.size())
+			{
+				return false;
+			}
+		}
+	}
+
+	for (const CookedSampler& sampler : samplers)
+	{
+		if (sampler.path > Renderer::AnimationSampler::SCALE
+			|| !inRange(sampler.firstKeyframe, sampler.keyframeCount, keyframeCount))
+		{
+			return false;
+		}
+	}
+
+	const std::size_t pixelSize{ section<unsigned char>(PIXELS).size() };
+	for (const CookedTexture& texture : textures)
+	{
+		// The upload reads width * height RGBA texels of bits per channel
+		if (texture.width <= 0 || texture.height <= 0 || (texture.bits != 8 && texture.bits != 16)
+			|| !inRange(texture.pixelOffset, texture.pixelSize, pixelSize)
+			|| texture.pixelSize / texture.width / texture.height / 4 < static_cast<std::uint64_t>(texture.bits / 8))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+template <typename T>
+std::span<const T> CookedModel::section(int index) const
+{
+	if (!m_valid)
+	{
+		return {};
+	}
+
+	const Header* header{ reinterpret_cast<const Header*>(m_file.data()) };
+	const Section& section{ header->sections[index] };
+
+	return { reinterpret_cast<const T*>(m_file.data() + section.offset), static_cast<std::size_t>(section.count) };
+}
+
+std::span<const Renderer::Vertex> CookedModel::vertices() const
+{
+	return section<Renderer::Vertex>(VERTICES);
+}
+
+std::span<const GLuint> CookedModel::indices() const
+{
+	return section<GLuint>(INDICES);
+}
+
+Renderer::Mesh CookedModel::mesh() const
+{
+	Renderer::Mesh ret{};
+
+	if (!m_valid)
+	{
+		return ret;
+	}
+
+	ret.maxTime = reinterpret_cast<const Header*>(m_file.data())->maxTime;
+
+	for (const CookedPrimitive& primitive : section<CookedPrimitive>(PRIMITIVES))
+	{
+		ret.primitives.push_back({
+			.material{
+				.baseColorFactor{ primitive.baseColorFactor },
+				.hasBaseColorTexture{ primitive.baseColorTextureIndex != -1 },
+				.baseColorTextureIndex{ primitive.baseColorTextureIndex },
+			},
+			.transform{ primitive.transform },
+			.elementOffset{ static_cast<GLsizei>(primitive.elementOffset) },
+			.elementCount{ static_cast<GLsizei>(primitive.elementCount) },
+			.skinned{ primitive.skinned != 0 },
+		});
+	}
+
+	const auto children{ section<std::int32_t>(CHILDREN) };
+	const auto samplers{ section<CookedSampler>(SAMPLERS) };
+	const auto inputs{ section<float>(KEYFRAME_INPUTS) };
+	const auto outputs{ section<glm::vec4>(KEYFRAME_OUTPUTS) };
+	const auto names{ section<char>(NAMES) };
+
+	// Counted as animation memory, like loadNodeSkin() does for glTF
+	MemoryTracker::Scope memoryScope{ MemoryTracker::ANIMATION };
+	ret.joints.reserve(section<CookedJoint>(JOINTS).size());
+
+	for (const CookedJoint& joint : section<CookedJoint>(JOINTS))
+	{
+		Renderer::Joint& loaded{ ret.joints.emplace_back() };
+
+		const auto name{ names.subspan(joint.nameOffset, joint.nameLength) };
+		loaded.name.assign(name.begin(), name.end());
+		loaded.nodeIndex = joint.nodeIndex;
+		loaded.hasJointParent = joint.hasJointParent != 0;
+		loaded.transform = joint.transform;
+		loaded.inverseBindMatrix = joint.inverseBindMatrix;
+
+		const auto jointChildren{ children.subspan(joint.firstChild, joint.childCount) };
+		loaded.children.assign(jointChildren.begin(), jointChildren.end());
+
+		for (const CookedSampler& sampler : samplers.subspan(joint.firstSampler, joint.samplerCount))
+		{
+			Renderer::AnimationSampler loadedSampler{ static_cast<Renderer::AnimationSampler::Path>(sampler.path) };
+
+			const auto input{ inputs.subspan(sampler.firstKeyframe, sampler.keyframeCount) };
+			const auto output{ outputs.subspan(sampler.firstKeyframe, sampler.keyframeCount) };
+			loadedSampler.input.assign(input.begin(), input.end());
+			loadedSampler.output.assign(output.begin(), output.end());
+
+			loaded.animationSamplers.insert(std::pair{ loadedSampler.path, std::move(loadedSampler) });
+		}
+	}
+
+	return ret;
+}
+
+std::vector<StagedTexture> CookedModel::textures() const
+{
+	std::vector<StagedTexture> ret{};
+
+	const auto pixels{ section<unsigned char>(PIXELS) };
+
+	for (const CookedTexture& texture : section<CookedTexture>(TEXTURES))
+	{
+		ret.push_back({
+			.mappedPixels{ pixels.subspan(texture.pixelOffset, texture.pixelSize).data() },
+			.width{ texture.width },
+			.height{ texture.height },
+			.bits{ texture.bits },
+			.minFilter{ texture.minFilter },
+			.magFilter{ texture.magFilter },
+		});
+	}
+
+	return ret;
+}
+
+
+
+bool cookModel(const std::string& sourcePath, const std::string& cookedPath)
+{
+	std::vector<Renderer::Vertex> vertices{};
+	std::vector<GLuint> indices{};
+	std::vector<StagedTexture> textures{};
+
+	const Renderer::Mesh mesh{ loadModel(sourcePath, vertices, indices, textures) };
+	if (vertices.empty())
+	{
+		std::cerr << "MODEL LOADER: ERROR: Nothing to cook in " << sourcePath << '\n';
+		return false;
+	}
+
+	std::vector<CookedPrimitive> primitives{};
+	for (const Renderer::Primitive& primitive : mesh.primitives)
+	{
+		primitives.push_back({
+			.transform{ primitive.transform },
+			.baseColorFactor{ primitive.material.baseColorFactor },
+			.baseColorTextureIndex{ primitive.material.hasBaseColorTexture ? primitive.material.baseColorTextureIndex : -1 },
+			.elementOffset{ static_cast<std::uint32_t>(primitive.elementOffset) },
+			.elementCount{ static_cast<std::uint32_t>(primitive.elementCount) },
+			.skinned{ primitive.skinned ? 1u : 0u },
+		});
+	}
+
+	std::vector<CookedJoint> joints{};
+	std::vector<std::int32_t> children{};
+	std::vector<CookedSampler> samplers{};
+	std::vector<float> inputs{};
+	std::vector<glm::vec4> outputs{};
+	std::vector<char> names{};
+
+	for (const Renderer::Joint& joint : mesh.joints)
+	{
+		joints.push_back({
+			.transform{ joint.transform },
+			.inverseBindMatrix{ joint.inverseBindMatrix },
+			.nodeIndex{ joint.nodeIndex },
+			.hasJointParent{ joint.hasJointParent },
+			.firstChild{ static_cast<std::uint32_t>(children.size()) },
+			.childCount{ static_cast<std::uint32_t>(joint.children.size()) },
+			.firstSampler{ static_cast<std::uint32_t>(samplers.size()) },
+			.samplerCount{ static_cast<std::uint32_t>(joint.animationSamplers.size()) },
+			.nameOffset{ static_cast<std::uint32_t>(names.size()) },
+			.nameLength{ static_cast<std::uint32_t>(joint.name.size()) },
+		});
+
+		children.insert(children.end(), joint.children.begin(), joint.children.end());
+		names.insert(names.end(), joint.name.begin(), joint.name.end());
+
+		for (const auto& sampler : joint.animationSamplers)
+		{
+			samplers.push_back({
+				.path{ static_cast<std::uint32_t>(sampler.second.path) },
+				.firstKeyframe{ static_cast<std::uint32_t>(inputs.size()) },
+				.keyframeCount{ static_cast<std::uint32_t>(sampler.second.input.size()) },
+			});
+
+			inputs.insert(inputs.end(), sampler.second.input.begin(), sampler.second.input.end());
+			outputs.insert(outputs.end(), sampler.second.output.begin(), sampler.second.output.end());
+		}
+	}
+
+	std::vector<CookedTexture> cookedTextures{};
+	std::vector<unsigned char> pixels{};
+	for (const StagedTexture& texture : textures)
+	{
+		cookedTextures.push_back({
+			.width{ texture.width },
+			.height{ texture.height },
+			.bits{ texture.bits },
+			.minFilter{ texture.minFilter },
+			.magFilter{ texture.magFilter },
+			.pixelOffset{ pixels.size() },
+			.pixelSize{ texture.pixels.size() },
+		});
+
+		pixels.insert(pixels.end(), texture.pixels.begin(), texture.pixels.end());
+	}
+
+	// Written to a temporary name first so a running game never maps a
+	// half written package
+	const std::string temporaryPath{ cookedPath + ".tmp" };
+	{
+		std::ofstream out{ temporaryPath, std::ios::binary };
+		if (!out)
+		{
+			std::cerr << "MODEL LOADER: ERROR: Could not open " << temporaryPath << " for writing\n";
+			return false;
+		}
+
+		Header header{};
+		std::memcpy(header.magic, magic, sizeof(magic));
+		header.version = CookedModel::formatVersion;
+		header.vertexSize = sizeof(Renderer::Vertex);
+		header.maxTime = mesh.maxTime;
+
+		out.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+
+		header.sections[VERTICES] = writeSection(out, vertices);
+		header.sections[INDICES] = writeSection(out, indices);
+		header.sections[PRIMITIVES] = writeSection(out, primitives);
+		header.sections[JOINTS] = writeSection(out, joints);
+		header.sections[CHILDREN] = writeSection(out, children);
+		header.sections[SAMPLERS] = writeSection(out, samplers);
+		header.sections[KEYFRAME_INPUTS] = writeSection(out, inputs);
+		header.sections[KEYFRAME_OUTPUTS] = writeSection(out, outputs);
+		header.sections[TEXTURES] = writeSection(out, cookedTextures);
+		header.sections[PIXELS] = writeSection(out, pixels);
+		header.sections[NAMES] = writeSection(out, names);
+
+		out.seekp(0);
+		out.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+
+		if (!out)
+		{
+			std::cerr << "MODEL LOADER: ERROR: Failed writing " << temporaryPath << '\n';
+			return false;
+		}
+	}
+
+	std::error_code error{};
+	std::filesystem::rename(temporaryPath, cookedPath, error);
+	if (error)
+	{
+		std::cerr << "MODEL LOADER: ERROR: Could not replace " << cookedPath << ": " << error.message() << '\n';
+		return false;
+	}
+
+	return true;
+}
+
+std::string cookedModelPath(const std::string& sourcePath)
+{
+	return std::filesystem::path{ sourcePath }.replace_extension(".ikmesh").string();
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "model_loader.hpp"
+#include "renderer.hpp"
+#include "../io/mapped_file.hpp"
+
+#include "glad/glad.h"
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+// A model converted ahead of time by iklob_cook into the layout the renderer
+// uploads: vertex and index blobs, primitive and material tables, skeleton,
+// animation keyframes and decoded RGBA pixels. Loading one is a mapping and a
+// few table walks; the blobs are copied straight from the mapping into GL
+// buffers.
+class CookedModel final
+{
+public:
+
+	// Bumped whenever the file layout or Renderer::Vertex changes
+	static constexpr std::uint32_t formatVersion{ 2 };
+
+	explicit CookedModel(const std::string& path);
+
+	CookedModel(const CookedModel&) = delete;
+	CookedModel& operator=(const CookedModel&) = delete;
+
+	bool valid() const
+	{
+		return m_valid;
+	}
+
+	// Indices are relative to the model's first vertex
+	std::span<const Renderer::Vertex> vertices() const;
+	std::span<const GLuint> indices() const;
+
+	Renderer::Mesh mesh() const;
+
+	// Pixels point into the mapping, which must outlive the upload
+	std::vector<StagedTexture> textures() const;
+
+private:
+
+	template <typename T>
+	std::span<const T> section(int index) const;
+
+	bool recordsInRange() const;
+
+	MappedFile m_file;
+	bool m_valid{ false };
+};
+
+// Converts a .glb file into a cooked package. Returns false on failure.
+bool cookModel(const std::string& sourcePath, const std::string& cookedPath);
+
+// Where the cooked package for a source model lives, e.g.
+// assets/zombie.glb -> assets/zombie.ikmesh
+std::string cookedModelPath(const std::string& sourcePath);
@@ -0,0 +1,61 @@
+#include "dynamic_resolution.hpp"
+
+#include <algorithm> // for std::clamp, std::min
+#include <cmath>
+
+void DynamicResolution::configure(double targetFrameMs, float minScale, float maxScale)
+{
+	m_targetFrameMs = targetFrameMs;
+	m_minScale = std::min(minScale, maxScale);
+	m_maxScale = maxScale;
+
+	m_scale = m_maxScale;
+	m_smoothedFrameMs = 0.0;
+	m_framesSinceChange = 0;
+}
+
+float DynamicResolution::update(double gpuFrameMs)
+{
+	if (m_targetFrameMs <= 0.0)
+	{
+		m_scale = m_maxScale;
+		return m_scale;
+	}
+
+	// Results from before the last change describe the old scale
+	if (++m_framesSinceChange <= settleFrames || gpuFrameMs <= 0.0)
+	{
+		return m_scale;
+	}
+
+	m_smoothedFrameMs = m_smoothedFrameMs == 0.0 ? gpuFrameMs : m_smoothedFrameMs + (gpuFrameMs - m_smoothedFrameMs) * 0.2;
+
+	// GPU time is roughly proportional to the pixel count, i.e. the square
+	// of the scale. Aim a little under the target so noise doesn't push
+	// every other frame over it.
+	constexpr double headroom{ 0.9 };
+	const double ratio{ m_targetFrameMs * headroom / m_smoothedFrameMs };
+	float wanted{ static_cast<float>(m_scale * std::sqrt(ratio)) };
+
+	// Small steps keep the image from visibly pumping
+	constexpr float maxStep{ 0.1f };
+	wanted = std::clamp(wanted, m_scale - maxStep, m_scale + maxStep);
+	wanted = std::clamp(wanted, m_minScale, m_maxScale);
+
+	// Hysteresis, so a frame time hovering around the target doesn't
+	// change the scale every few frames
+	constexpr float minChange{ 0.02f };
+	if (std::abs(wanted - m_scale) < minChange && wanted != m_minScale && wanted != m_maxScale)
+	{
+		return m_scale;
+	}
+
+	if (wanted != m_scale)
+	{
+		m_scale = wanted;
+		m_smoothedFrameMs = 0.0;
+		m_framesSinceChange = 0;
+	}
+
+	return m_scale;
+}
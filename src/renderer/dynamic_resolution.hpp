@@ -0,0 +1,36 @@
+#pragma once
+
+// Picks the fraction of the output resolution the scene is rendered at, so
+// the GPU frame time settles just under a target. Fed with GPU timer results,
+// which arrive a few frames late, so after every change it waits for frames
+// rendered at the new scale before judging again. Pure CPU code.
+class DynamicResolution final
+{
+public:
+
+	// A target of 0 disables scaling and keeps maxScale
+	void configure(double targetFrameMs, float minScale, float maxScale = 1.0f);
+
+	// Takes the latest GPU frame time (0 when none is available yet) and
+	// returns the scale for the next frame
+	float update(double gpuFrameMs);
+
+	float scale() const
+	{
+		return m_scale;
+	}
+
+private:
+
+	// Longer than GpuTimer's read back delay
+	static constexpr int settleFrames{ 4 };
+
+	double m_targetFrameMs{ 0.0 };
+	float m_minScale{ 1.0f };
+	float m_maxScale{ 1.0f };
+
+	float m_scale{ 1.0f };
+
+	double m_smoothedFrameMs{ 0.0 };
+	int m_framesSinceChange{ 0 };
+};
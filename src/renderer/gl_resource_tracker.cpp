@@ -0,0 +1,143 @@
+#include "gl_resource_tracker.hpp"
+
+#include "glad/glad.h"
+
+#include <algorithm> // for std::max
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <unordered_map>
+
+namespace
+{
+	struct Tracked
+	{
+		std::unordered_map<GLuint, std::size_t> sizes{};
+		GlResourceTracker::KindStats stats{};
+	};
+
+	// Resources are only created on the render thread, the lock is for
+	// queries from elsewhere
+	std::mutex g_mutex{};
+	Tracked g_tracked[GlResourceTracker::KIND_COUNT]{};
+
+	void track(GlResourceTracker::Kind kind, GLuint name, std::size_t bytes)
+	{
+		std::lock_guard lock{ g_mutex };
+		Tracked& tracked{ g_tracked[kind] };
+
+		const auto [entry, added]{ tracked.sizes.try_emplace(name, 0) };
+		if (added)
+		{
+			++tracked.stats.liveObjects;
+		}
+		tracked.stats.liveBytes += static_cast<std::int64_t>(bytes) - static_cast<std::int64_t>(entry->second);
+		tracked.stats.peakBytes = std::max(tracked.stats.peakBytes, tracked.stats.liveBytes);
+		entry->second = bytes;
+	}
+
+	void release(GlResourceTracker::Kind kind, GLuint name)
+	{
+		std::lock_guard lock{ g_mutex };
+		Tracked& tracked{ g_tracked[kind] };
+
+		const auto found{ tracked.sizes.find(name) };
+		if (found == tracked.sizes.end())
+		{
+			return;
+		}
+
+		tracked.stats.liveBytes -= static_cast<std::int64_t>(found->second);
+		--tracked.stats.liveObjects;
+		tracked.sizes.erase(found);
+	}
+
+	std::size_t bytesPerPixel(GLenum format)
+	{
+		switch (format)
+		{
+		case GL_R8:
+			return 1;
+		case GL_RG8:
+		case GL_R16F:
+		case GL_DEPTH_COMPONENT16:
+			return 2;
+		case GL_RGBA16:
+		case GL_RGBA16F:
+		case GL_RG32F:
+		case GL_DEPTH32F_STENCIL8:
+			return 8;
+		case GL_RGBA32F:
+			return 16;
+		// RGB8 and 24 bit depth are padded to 32 bits by every driver
+		default:
+			return 4;
+		}
+	}
+}
+
+
+
+void GlResourceTracker::trackBuffer(GLuint buffer, std::size_t bytes)
+{
+	track(BUFFER, buffer, bytes);
+}
+
+void GlResourceTracker::trackTexture(GLuint texture, GLenum format, GLsizei width, GLsizei height,
+	GLsizei levels, GLsizei samples)
+{
+	track(TEXTURE, texture, textureBytes(format, width, height, levels, samples));
+}
+
+void GlResourceTracker::releaseBuffer(GLuint buffer)
+{
+	release(BUFFER, buffer);
+}
+
+void GlResourceTracker::releaseTexture(GLuint texture)
+{
+	release(TEXTURE, texture);
+}
+
+
+
+GlResourceTracker::KindStats GlResourceTracker::stats(Kind kind)
+{
+	std::lock_guard lock{ g_mutex };
+	return g_tracked[kind].stats;
+}
+
+const char* GlResourceTracker::kindName(Kind kind)
+{
+	switch (kind)
+	{
+	case BUFFER:  return "buffers";
+	case TEXTURE: return "textures";
+	default:      return "unknown";
+	}
+}
+
+void GlResourceTracker::dump(std::ostream& out)
+{
+	for (int i{ 0 }; i < KIND_COUNT; ++i)
+	{
+		const Kind kind{ static_cast<Kind>(i) };
+		const KindStats kindStats{ stats(kind) };
+
+		out << "GPU MEMORY: " << kindName(kind) << ' ' << kindStats.liveBytes / 1024 << " KiB live, "
+			<< kindStats.peakBytes / 1024 << " KiB peak, " << kindStats.liveObjects << " objects\n";
+	}
+}
+
+std::size_t GlResourceTracker::textureBytes(GLenum format, GLsizei width, GLsizei height, GLsizei levels,
+	GLsizei samples)
+{
+	std::size_t bytes{};
+	for (GLsizei level{ 0 }; level < levels; ++level)
+	{
+		bytes += static_cast<std::size_t>(std::max(width >> level, 1)) * std::max(height >> level, 1);
+	}
+
+	return bytes * bytesPerPixel(format) * std::max(samples, 1);
+}
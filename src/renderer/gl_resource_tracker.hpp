@@ -0,0 +1,47 @@
+#pragma once
+
+#include "glad/glad.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+// Video memory held by GL buffers and textures, as far as the engine can
+// tell from the sizes it asks for. Drivers add their own padding and
+// orphaned buffer copies on top, so treat this as a lower bound. Callers
+// report every storage allocation and deletion; queries are safe from any
+// thread.
+class GlResourceTracker final
+{
+public:
+
+	enum Kind
+	{
+		BUFFER,
+		TEXTURE,
+		KIND_COUNT,
+	};
+
+	struct KindStats
+	{
+		std::int64_t liveBytes{};
+		std::int64_t peakBytes{};
+		std::int64_t liveObjects{};
+	};
+
+	// Also for resizes, e.g. re-specifying with glNamedBufferData()
+	static void trackBuffer(GLuint buffer, std::size_t bytes);
+	static void trackTexture(GLuint texture, GLenum format, GLsizei width, GLsizei height,
+		GLsizei levels = 1, GLsizei samples = 1);
+
+	// Untracked names are ignored
+	static void releaseBuffer(GLuint buffer);
+	static void releaseTexture(GLuint texture);
+
+	static KindStats stats(Kind kind);
+	static const char* kindName(Kind kind);
+
+	static void dump(std::ostream& out);
+
+	static std::size_t textureBytes(GLenum format, GLsizei width, GLsizei height, GLsizei levels, GLsizei samples);
+};
@@ -1,11 +1,15 @@
 #include "gl_utils.hpp"
 
+#include "gl_resource_tracker.hpp"
+
 #include "glad/glad.h"
 
+#include <cstddef>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <vector>
 
 // Thanks to fendevel for this function
 void debugMessageCallback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, GLchar const* message, void const* user_param)
@@ -44,7 +48,7 @@ void debugMessageCallback(GLenum source, GLenum type, GLuint id, GLenum severity
 	std::cerr << src_str << ", " << type_str << ", " << severity_str << ", " << id << ": " << message << '\n';
 }
 
-GLuint compileShader(const std::string& filename, GLenum type)
+std::string loadShaderSource(const std::string& filename, const std::vector<std::string>& defines)
 {
 	std::ifstream inputStream{ filename };
 
@@ -52,6 +56,28 @@ GLuint compileShader(const std::string& filename, GLenum type)
 	stringStream << inputStream.rdbuf();
 
 	std::string srcStr{ stringStream.str() };
+
+	if (!defines.empty())
+	{
+		// #version has to stay the first statement
+		const std::size_t versionLine{ srcStr.find("#version") };
+		const std::size_t insertAt{ versionLine == std::string::npos ? 0 : srcStr.find('\n', versionLine) + 1 };
+
+		std::string defineLines{};
+		for (const std::string& define : defines)
+		{
+			defineLines += "#define " + define + '\n';
+		}
+
+		srcStr.insert(insertAt, defineLines);
+	}
+
+	return srcStr;
+}
+
+GLuint compileShader(const std::string& filename, GLenum type, const std::vector<std::string>& defines)
+{
+	const std::string srcStr{ loadShaderSource(filename, defines) };
 	const char* srcCStr{ srcStr.c_str() };
 
 	GLuint shader{ glCreateShader(type) };
@@ -97,6 +123,7 @@ GLuint createTexture(const void* pixels, GLsizei width, GLsizei height, GLint mi
 		}() };
 
 	glTextureStorage2D(texture, 1, format, width, height);
+	GlResourceTracker::trackTexture(texture, format, width, height);
 	glTextureSubImage2D(texture, 0, 0, 0, width, height, GL_RGBA, type, pixels);
 	glGenerateTextureMipmap(texture);
 
@@ -3,9 +3,13 @@
 #include "glad/glad.h"
 
 #include <string>
+#include <vector>
 
 void debugMessageCallback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, GLchar const* message, void const* user_param);
 
-GLuint compileShader(const std::string& filename, GLenum type);
+// Each define is inserted as "#define <define>" right after the #version line
+std::string loadShaderSource(const std::string& filename, const std::vector<std::string>& defines = {});
+
+GLuint compileShader(const std::string& filename, GLenum type, const std::vector<std::string>& defines = {});
 
 GLuint createTexture(const void* pixels, GLsizei width, GLsizei height, GLint minFilter, GLint magFilter, int bits);
\ No newline at end of file
@@ -0,0 +1,213 @@
+#include "glb_file.hpp"
+
+#include "../io/mapped_file.hpp"
+
+#include "glad/glad.h"
+#include "tinygltf/json.hpp"
+
+#include <algorithm> // for std::min
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+namespace
+{
+	constexpr std::uint32_t glbMagic{ 0x46546C67 };     // "glTF"
+	constexpr std::uint32_t jsonChunkType{ 0x4E4F534A }; // "JSON"
+	constexpr std::uint32_t binChunkType{ 0x004E4942 };  // "BIN\0"
+
+	std::uint32_t readU32(const unsigned char* data)
+	{
+		std::uint32_t value{};
+		std::memcpy(&value, data, sizeof(value));
+		return value;
+	}
+
+	std::size_t componentSize(GLenum componentType)
+	{
+		switch (componentType)
+		{
+		case GL_BYTE:
+		case GL_UNSIGNED_BYTE:  return 1;
+		case GL_SHORT:
+		case GL_UNSIGNED_SHORT: return 2;
+		case GL_UNSIGNED_INT:
+		case GL_FLOAT:          return 4;
+		default:                return 0;
+		}
+	}
+
+	int componentCount(const std::string& type)
+	{
+		if (type == "SCALAR") return 1;
+		if (type == "VEC2")   return 2;
+		if (type == "VEC3")   return 3;
+		if (type == "VEC4")   return 4;
+		if (type == "MAT2")   return 4;
+		if (type == "MAT3")   return 9;
+		if (type == "MAT4")   return 16;
+		return 0;
+	}
+}
+
+GlbFile::GlbFile(const std::string& path)
+	: m_file{ path }
+{
+	if (!m_file.valid())
+	{
+		return;
+	}
+
+	const unsigned char* data{ m_file.data() };
+	const std::size_t size{ m_file.size() };
+
+	// 12 byte header followed by the JSON chunk's 8 byte header
+	if (size < 20 || readU32(data) != glbMagic)
+	{
+		std::cerr << "MODEL LOADER: ERROR: " << path << " is not a binary glTF file\n";
+		return;
+	}
+
+	const std::size_t length{ std::min<std::size_t>(readU32(data + 8), size) };
+
+	std::size_t offset{ 12 };
+	while (offset + 8 <= length)
+	{
+		const std::size_t chunkLength{ readU32(data + offset) };
+		const std::uint32_t chunkType{ readU32(data + offset + 4) };
+		const unsigned char* chunk{ data + offset + 8 };
+
+		if (offset + 8 + chunkLength > length)
+		{
+			std::cerr << "MODEL LOADER: ERROR: Truncated chunk in " << path << '\n';
+			return;
+		}
+
+		if (chunkType == jsonChunkType)
+		{
+			m_json = nlohmann::json::parse(chunk, chunk + chunkLength, nullptr, false);
+		}
+		else if (chunkType == binChunkType && !m_binary)
+		{
+			m_binary = chunk;
+			m_binarySize = chunkLength;
+		}
+
+		// Chunks are 4 byte aligned
+		offset += 8 + ((chunkLength + 3) & ~std::size_t{ 3 });
+	}
+
+	if (!m_json.is_object())
+	{
+		std::cerr << "MODEL LOADER: ERROR: Missing or malformed JSON chunk in " << path << '\n';
+		return;
+	}
+
+	for (const auto& buffer : jsonArray(m_json, "buffers"))
+	{
+		if (buffer.contains("uri"))
+		{
+			std::cerr << "MODEL LOADER: ERROR: External buffers are not supported in " << path << '\n';
+			return;
+		}
+	}
+
+	m_valid = true;
+}
+
+AccessorView GlbFile::accessor(int index) const
+{
+	const auto& accessors{ jsonArray(m_json, "accessors") };
+	if (index < 0 || index >= static_cast<int>(accessors.size()))
+	{
+		return {};
+	}
+
+	const auto& accessor{ accessors[index] };
+
+	AccessorView view{};
+	view.count = accessor.value("count", std::size_t{ 0 });
+	view.componentType = accessor.value("componentType", GLenum{ 0 });
+	view.componentCount = componentCount(accessor.value("type", std::string{}));
+	view.normalized = accessor.value("normalized", false);
+	view.elementSize = componentSize(view.componentType) * view.componentCount;
+
+	if (accessor.contains("sparse"))
+	{
+		std::cerr << "MODEL LOADER: ERROR: Sparse accessors are not supported\n";
+		return {};
+	}
+
+	// Accessors without a buffer view are all zeros; callers keep their defaults
+	const int bufferViewIndex{ accessor.value("bufferView", -1) };
+	if (bufferViewIndex == -1 || view.elementSize == 0)
+	{
+		return {};
+	}
+
+	const auto& bufferViews{ jsonArray(m_json, "bufferViews") };
+	if (bufferViewIndex >= static_cast<int>(bufferViews.size()))
+	{
+		return {};
+	}
+
+	const auto& bufferView{ bufferViews[bufferViewIndex] };
+
+	view.stride = bufferView.value("byteStride", view.elementSize);
+
+	const std::size_t begin{ bufferView.value("byteOffset", std::size_t{ 0 }) + accessor.value("byteOffset", std::size_t{ 0 }) };
+	const std::size_t end{ view.count == 0 ? begin : begin + view.stride * (view.count - 1) + view.elementSize };
+
+	if (bufferView.value("buffer", 0) != 0 || end > m_binarySize)
+	{
+		std::cerr << "MODEL LOADER: ERROR: Accessor " << index << " is outside the binary chunk\n";
+		return {};
+	}
+
+	view.data = m_binary + begin;
+
+	return view;
+}
+
+const unsigned char* GlbFile::bufferViewData(int index, std::size_t& size) const
+{
+	const auto& bufferViews{ jsonArray(m_json, "bufferViews") };
+	if (index < 0 || index >= static_cast<int>(bufferViews.size()))
+	{
+		size = 0;
+		return nullptr;
+	}
+
+	const auto& bufferView{ bufferViews[index] };
+
+	const std::size_t begin{ bufferView.value("byteOffset", std::size_t{ 0 }) };
+	size = bufferView.value("byteLength", std::size_t{ 0 });
+
+	if (begin + size > m_binarySize)
+	{
+		std::cerr << "MODEL LOADER: ERROR: Buffer view " << index << " is outside the binary chunk\n";
+		size = 0;
+		return nullptr;
+	}
+
+	return m_binary + begin;
+}
+
+const nlohmann::json& jsonArray(const nlohmann::json& object, const char* key)
+{
+	// Braces would make an array holding an empty array
+	static const nlohmann::json empty = nlohmann::json::array();
+
+	const auto it{ object.find(key) };
+	return (it != object.end() && it->is_array()) ? *it : empty;
+}
+
+const nlohmann::json& jsonObject(const nlohmann::json& object, const char* key)
+{
+	static const nlohmann::json empty = nlohmann::json::object();
+
+	const auto it{ object.find(key) };
+	return (it != object.end() && it->is_object()) ? *it : empty;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "../io/mapped_file.hpp"
+
+#include "glad/glad.h"
+#include "tinygltf/json.hpp"
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+// Elements of one glTF accessor inside the mapped binary chunk. Elements are
+// stride bytes apart, which is larger than elementSize for interleaved
+// buffer views.
+struct AccessorView
+{
+	const unsigned char* data{ nullptr };
+	std::size_t count{};
+	std::size_t stride{};
+	std::size_t elementSize{};
+
+	// glTF reuses the GL enums, e.g. GL_FLOAT or GL_UNSIGNED_SHORT
+	GLenum componentType{};
+	int componentCount{};
+	bool normalized{ false };
+
+	const unsigned char* element(std::size_t index) const
+	{
+		return data + index * stride;
+	}
+};
+
+// A binary glTF file mapped into memory. Only the JSON chunk is parsed;
+// accessors point straight into the mapped BIN chunk, so geometry is copied
+// exactly once, into its final destination.
+class GlbFile final
+{
+public:
+
+	explicit GlbFile(const std::string& path);
+
+	GlbFile(const GlbFile&) = delete;
+	GlbFile& operator=(const GlbFile&) = delete;
+
+	bool valid() const
+	{
+		return m_valid;
+	}
+
+	const nlohmann::json& json() const
+	{
+		return m_json;
+	}
+
+	// Empty view (count 0) if the accessor is missing, sparse or out of bounds
+	AccessorView accessor(int index) const;
+
+	// Raw bytes of a buffer view, e.g. an embedded PNG
+	const unsigned char* bufferViewData(int index, std::size_t& size) const;
+
+private:
+
+	MappedFile m_file;
+	nlohmann::json m_json{};
+
+	const unsigned char* m_binary{ nullptr };
+	std::size_t m_binarySize{};
+
+	bool m_valid{ false };
+};
+
+// Member array or object of a JSON object, or an empty one if it isn't there.
+// Both return references; note that brace-initialising a json value from
+// another wraps it in an array.
+const nlohmann::json& jsonArray(const nlohmann::json& object, const char* key);
+const nlohmann::json& jsonObject(const nlohmann::json& object, const char* key);
+
+// Copies sizeof(T) bytes per element into destination, destinationStride
+// bytes apart. Tightly packed sources and destinations become one memcpy.
+template <typename T>
+bool copyAccessor(const AccessorView& view, void* destination, std::size_t destinationStride = sizeof(T))
+{
+	if (view.elementSize != sizeof(T))
+	{
+		return false;
+	}
+
+	auto out{ static_cast<unsigned char*>(destination) };
+
+	if (view.stride == sizeof(T) && destinationStride == sizeof(T))
+	{
+		std::memcpy(out, view.data, view.count * sizeof(T));
+		return true;
+	}
+
+	const unsigned char* in{ view.data };
+	for (std::size_t i{ 0 }; i < view.count; ++i)
+	{
+		std::memcpy(out, in, sizeof(T));
+		in += view.stride;
+		out += destinationStride;
+	}
+
+	return true;
+}
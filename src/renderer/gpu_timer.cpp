@@ -0,0 +1,133 @@
+#include "gpu_timer.hpp"
+
+#include "../profiler/profiler.hpp"
+
+#include "glad/glad.h"
+
+#include <cstdint>
+
+void GpuTimer::init()
+{
+	for (Frame& frame : m_frames)
+	{
+		glGenQueries(static_cast<GLsizei>(frame.queries.size()), frame.queries.data());
+	}
+
+	m_initialized = true;
+}
+
+void GpuTimer::cleanup()
+{
+	if (!m_initialized)
+	{
+		return;
+	}
+
+	for (Frame& frame : m_frames)
+	{
+		glDeleteQueries(static_cast<GLsizei>(frame.queries.size()), frame.queries.data());
+		frame.pending = false;
+	}
+
+	m_initialized = false;
+}
+
+
+
+void GpuTimer::beginFrame()
+{
+	if (!m_initialized)
+	{
+		return;
+	}
+
+	Frame& frame{ m_frames[m_frameIndex] };
+	if (frame.pending)
+	{
+		readBack(frame);
+	}
+
+	frame.zoneCount = 0;
+	m_openZoneCount = 0;
+
+	glQueryCounter(frame.queries[0], GL_TIMESTAMP);
+	frame.cpuStart = Profiler::now();
+}
+
+void GpuTimer::endFrame()
+{
+	if (!m_initialized)
+	{
+		return;
+	}
+
+	Frame& frame{ m_frames[m_frameIndex] };
+	glQueryCounter(frame.queries[1], GL_TIMESTAMP);
+	frame.pending = true;
+
+	m_frameIndex = (m_frameIndex + 1) % framesInFlight;
+}
+
+void GpuTimer::beginZone(const char* name)
+{
+	Frame& frame{ m_frames[m_frameIndex] };
+
+	// Dropped zones still go on the stack so begin/end stay balanced
+	int zone{ -1 };
+	if (m_initialized && frame.zoneCount < maxZonesPerFrame)
+	{
+		zone = frame.zoneCount++;
+		frame.names[zone] = name;
+		glQueryCounter(frame.queries[2 + zone * 2], GL_TIMESTAMP);
+	}
+
+	if (m_openZoneCount < maxZonesPerFrame)
+	{
+		m_openZones[m_openZoneCount] = zone;
+	}
+	++m_openZoneCount;
+}
+
+void GpuTimer::endZone()
+{
+	if (m_openZoneCount == 0)
+	{
+		return;
+	}
+
+	--m_openZoneCount;
+	if (m_openZoneCount < maxZonesPerFrame && m_openZones[m_openZoneCount] != -1)
+	{
+		const int zone{ m_openZones[m_openZoneCount] };
+		glQueryCounter(m_frames[m_frameIndex].queries[3 + zone * 2], GL_TIMESTAMP);
+	}
+}
+
+
+
+void GpuTimer::readBack(Frame& frame)
+{
+	// Blocks only if the GPU is more than framesInFlight frames behind
+	GLuint64 frameStart{};
+	GLuint64 frameEnd{};
+	glGetQueryObjectui64v(frame.queries[0], GL_QUERY_RESULT, &frameStart);
+	glGetQueryObjectui64v(frame.queries[1], GL_QUERY_RESULT, &frameEnd);
+
+	m_lastFrameTimeMs = static_cast<double>(frameEnd - frameStart) / 1'000'000.0;
+
+	for (int i{ 0 }; i < frame.zoneCount; ++i)
+	{
+		GLuint64 zoneStart{};
+		GLuint64 zoneEnd{};
+		glGetQueryObjectui64v(frame.queries[2 + i * 2], GL_QUERY_RESULT, &zoneStart);
+		glGetQueryObjectui64v(frame.queries[3 + i * 2], GL_QUERY_RESULT, &zoneEnd);
+
+		// Place GPU zones on the CPU timeline relative to when the frame
+		// was submitted
+		Profiler::recordGpuZone(frame.names[i],
+			frame.cpuStart + static_cast<std::int64_t>(zoneStart - frameStart),
+			frame.cpuStart + static_cast<std::int64_t>(zoneEnd - frameStart));
+	}
+
+	frame.pending = false;
+}
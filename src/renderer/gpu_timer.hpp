@@ -0,0 +1,83 @@
+#pragma once
+
+#include "glad/glad.h"
+
+#include <array>
+#include <cstdint>
+
+// GL timestamp queries around render passes. Queries for a frame are only
+// read back when their slot comes around again, framesInFlight frames
+// later, so reading them never stalls the pipeline. Results are forwarded to
+// the Profiler and the total frame time is kept for anyone who wants to
+// react to GPU load.
+class GpuTimer final
+{
+public:
+
+	class ScopedZone final
+	{
+	public:
+
+		ScopedZone(GpuTimer& timer, const char* name)
+			: m_timer{ timer }
+		{
+			m_timer.beginZone(name);
+		}
+
+		~ScopedZone()
+		{
+			m_timer.endZone();
+		}
+
+		ScopedZone(const ScopedZone&) = delete;
+		ScopedZone& operator=(const ScopedZone&) = delete;
+
+	private:
+
+		GpuTimer& m_timer;
+	};
+
+	void init();
+	void cleanup();
+
+	void beginFrame();
+	void endFrame();
+
+	// Zones may nest. Zones past maxZonesPerFrame in one frame are dropped.
+	void beginZone(const char* name);
+	void endZone();
+
+	// GPU time of the most recent frame whose queries have been read back
+	double lastFrameTimeMs() const
+	{
+		return m_lastFrameTimeMs;
+	}
+
+private:
+
+	static constexpr int framesInFlight{ 3 };
+	static constexpr int maxZonesPerFrame{ 32 };
+
+	struct Frame
+	{
+		// [0] and [1] bracket the whole frame, zone i uses [2 + 2i] and [3 + 2i]
+		std::array<GLuint, 2 + maxZonesPerFrame * 2> queries{};
+		std::array<const char*, maxZonesPerFrame> names{};
+		int zoneCount{ 0 };
+
+		std::int64_t cpuStart{};
+		bool pending{ false };
+	};
+
+	std::array<Frame, framesInFlight> m_frames{};
+	int m_frameIndex{ 0 };
+
+	std::array<int, maxZonesPerFrame> m_openZones{};
+	int m_openZoneCount{ 0 };
+
+	double m_lastFrameTimeMs{ 0.0 };
+
+	bool m_initialized{ false };
+
+	void readBack(Frame& frame);
+};
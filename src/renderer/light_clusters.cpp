@@ -0,0 +1,334 @@
+#include "light_clusters.hpp"
+
+#include "../jobs/job_system.hpp"
+#include "../profiler/profiler.hpp"
+
+#include "glm/glm.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IKLOB_LIGHT_CLUSTERS_SSE
+#include <emmintrin.h>
+#endif
+
+#include <algorithm> // for std::max, std::min, std::clamp
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace
+{
+	// Tile boundaries are planes through the eye. Plane i of an axis holds
+	// the points where x / depth (or y / depth) equals the NDC boundary
+	// -1 + 2i / count scaled by the frustum's half extent, and its normal
+	// points towards larger i.
+	struct ClusterFrustum
+	{
+		std::array<float, clusterCountX + 1> xNormalX{};
+		std::array<float, clusterCountX + 1> xNormalZ{};
+		std::array<float, clusterCountY + 1> yNormalY{};
+		std::array<float, clusterCountY + 1> yNormalZ{};
+
+		float nearPlane{};
+		float farPlane{};
+		// Slice of a view depth d is log(d / near) * sliceScale
+		float sliceScale{};
+	};
+
+	ClusterFrustum makeClusterFrustum(float fieldOfView, float aspectRatio, float nearPlane, float farPlane)
+	{
+		ClusterFrustum frustum{};
+
+		const float tanHalfY{ std::tan(glm::radians(fieldOfView) * 0.5f) };
+		const float tanHalfX{ tanHalfY * aspectRatio };
+
+		for (int i{ 0 }; i <= clusterCountX; ++i)
+		{
+			const float k{ (-1.0f + 2.0f * i / clusterCountX) * tanHalfX };
+			const float inverseLength{ 1.0f / std::sqrt(1.0f + k * k) };
+			frustum.xNormalX[i] = inverseLength;
+			frustum.xNormalZ[i] = k * inverseLength;
+		}
+
+		for (int i{ 0 }; i <= clusterCountY; ++i)
+		{
+			const float k{ (-1.0f + 2.0f * i / clusterCountY) * tanHalfY };
+			const float inverseLength{ 1.0f / std::sqrt(1.0f + k * k) };
+			frustum.yNormalY[i] = inverseLength;
+			frustum.yNormalZ[i] = k * inverseLength;
+		}
+
+		frustum.nearPlane = nearPlane;
+		frustum.farPlane = farPlane;
+		frustum.sliceScale = clusterCountZ / std::log(farPlane / nearPlane);
+
+		return frustum;
+	}
+
+	int depthSlice(const ClusterFrustum& frustum, float depth)
+	{
+		const int slice{ static_cast<int>(std::floor(std::log(depth / frustum.nearPlane) * frustum.sliceScale)) };
+		return std::clamp(slice, 0, clusterCountZ - 1);
+	}
+
+	// Turns the plane counts into a tile range. fullyAfter is the number of
+	// planes the sphere lies entirely on the positive side of, fullyBefore
+	// the number it lies entirely behind. Returns false when the sphere is
+	// outside the outermost planes.
+	bool tileRange(int fullyAfter, int fullyBefore, int count, std::uint8_t& first, std::uint8_t& last)
+	{
+		if (fullyAfter > count || fullyBefore > count)
+		{
+			return false;
+		}
+
+		first = static_cast<std::uint8_t>(std::max(fullyAfter, 1) - 1);
+		last = static_cast<std::uint8_t>(count - std::max(fullyBefore, 1));
+		return true;
+	}
+
+	// Depth range and tile ranges from the view space position
+	LightClusters::Bounds finishBounds(const ClusterFrustum& frustum, float viewZ, float radius,
+		int fullyRightOf, int fullyLeftOf, int fullyAbove, int fullyBelow)
+	{
+		LightClusters::Bounds bounds{};
+
+		const float depth{ -viewZ };
+		if (depth + radius <= frustum.nearPlane || depth - radius >= frustum.farPlane)
+		{
+			return bounds;
+		}
+
+		if (!tileRange(fullyRightOf, fullyLeftOf, clusterCountX, bounds.x0, bounds.x1)
+			|| !tileRange(fullyAbove, fullyBelow, clusterCountY, bounds.y0, bounds.y1))
+		{
+			return bounds;
+		}
+
+		bounds.z0 = static_cast<std::uint8_t>(depthSlice(frustum, std::max(depth - radius, frustum.nearPlane)));
+		bounds.z1 = static_cast<std::uint8_t>(depthSlice(frustum, std::min(depth + radius, frustum.farPlane)));
+		bounds.visible = true;
+
+		return bounds;
+	}
+
+	LightClusters::Bounds lightBounds(const ClusterFrustum& frustum, const PointLight& light, const glm::mat4& view)
+	{
+		// Spelled out in the same order as the SIMD path, so both agree
+		// bit for bit
+		const glm::vec3& p{ light.position };
+		const float viewX{ view[0][0] * p.x + view[1][0] * p.y + view[2][0] * p.z + view[3][0] };
+		const float viewY{ view[0][1] * p.x + view[1][1] * p.y + view[2][1] * p.z + view[3][1] };
+		const float viewZ{ view[0][2] * p.x + view[1][2] * p.y + view[2][2] * p.z + view[3][2] };
+
+		int fullyRightOf{}, fullyLeftOf{};
+		for (int i{ 0 }; i <= clusterCountX; ++i)
+		{
+			const float distance{ viewX * frustum.xNormalX[i] + viewZ * frustum.xNormalZ[i] };
+			fullyRightOf += distance > light.radius;
+			fullyLeftOf += distance < -light.radius;
+		}
+
+		int fullyAbove{}, fullyBelow{};
+		for (int i{ 0 }; i <= clusterCountY; ++i)
+		{
+			const float distance{ viewY * frustum.yNormalY[i] + viewZ * frustum.yNormalZ[i] };
+			fullyAbove += distance > light.radius;
+			fullyBelow += distance < -light.radius;
+		}
+
+		return finishBounds(frustum, viewZ, light.radius, fullyRightOf, fullyLeftOf, fullyAbove, fullyBelow);
+	}
+
+#ifdef IKLOB_LIGHT_CLUSTERS_SSE
+	// Four lights per iteration, one per lane. The plane tests are where the
+	// time goes (one per tile boundary), so they run on the whole batch and
+	// only the slice logarithms are left to scalar code.
+	void lightBounds4(const ClusterFrustum& frustum, const PointLight* lights, const glm::mat4& view,
+		LightClusters::Bounds* bounds)
+	{
+		const __m128 px{ _mm_setr_ps(lights[0].position.x, lights[1].position.x, lights[2].position.x, lights[3].position.x) };
+		const __m128 py{ _mm_setr_ps(lights[0].position.y, lights[1].position.y, lights[2].position.y, lights[3].position.y) };
+		const __m128 pz{ _mm_setr_ps(lights[0].position.z, lights[1].position.z, lights[2].position.z, lights[3].position.z) };
+		const __m128 radius{ _mm_setr_ps(lights[0].radius, lights[1].radius, lights[2].radius, lights[3].radius) };
+		const __m128 negativeRadius{ _mm_sub_ps(_mm_setzero_ps(), radius) };
+
+		const auto transformRow{ [&](int row) {
+			__m128 v{ _mm_mul_ps(_mm_set1_ps(view[0][row]), px) };
+			v = _mm_add_ps(v, _mm_mul_ps(_mm_set1_ps(view[1][row]), py));
+			v = _mm_add_ps(v, _mm_mul_ps(_mm_set1_ps(view[2][row]), pz));
+			return _mm_add_ps(v, _mm_set1_ps(view[3][row]));
+			} };
+
+		const __m128 viewX{ transformRow(0) };
+		const __m128 viewY{ transformRow(1) };
+		const __m128 viewZ{ transformRow(2) };
+
+		// Comparisons yield all ones (-1) per passing lane, so subtracting
+		// the masks counts passes
+		__m128i fullyRightOf{ _mm_setzero_si128() };
+		__m128i fullyLeftOf{ _mm_setzero_si128() };
+		for (int i{ 0 }; i <= clusterCountX; ++i)
+		{
+			const __m128 distance{ _mm_add_ps(_mm_mul_ps(viewX, _mm_set1_ps(frustum.xNormalX[i])),
+				_mm_mul_ps(viewZ, _mm_set1_ps(frustum.xNormalZ[i]))) };
+			fullyRightOf = _mm_sub_epi32(fullyRightOf, _mm_castps_si128(_mm_cmpgt_ps(distance, radius)));
+			fullyLeftOf = _mm_sub_epi32(fullyLeftOf, _mm_castps_si128(_mm_cmplt_ps(distance, negativeRadius)));
+		}
+
+		__m128i fullyAbove{ _mm_setzero_si128() };
+		__m128i fullyBelow{ _mm_setzero_si128() };
+		for (int i{ 0 }; i <= clusterCountY; ++i)
+		{
+			const __m128 distance{ _mm_add_ps(_mm_mul_ps(viewY, _mm_set1_ps(frustum.yNormalY[i])),
+				_mm_mul_ps(viewZ, _mm_set1_ps(frustum.yNormalZ[i]))) };
+			fullyAbove = _mm_sub_epi32(fullyAbove, _mm_castps_si128(_mm_cmpgt_ps(distance, radius)));
+			fullyBelow = _mm_sub_epi32(fullyBelow, _mm_castps_si128(_mm_cmplt_ps(distance, negativeRadius)));
+		}
+
+		alignas(16) float z[4]{};
+		alignas(16) std::int32_t right[4]{}, left[4]{}, above[4]{}, below[4]{};
+		_mm_store_ps(z, viewZ);
+		_mm_store_si128(reinterpret_cast<__m128i*>(right), fullyRightOf);
+		_mm_store_si128(reinterpret_cast<__m128i*>(left), fullyLeftOf);
+		_mm_store_si128(reinterpret_cast<__m128i*>(above), fullyAbove);
+		_mm_store_si128(reinterpret_cast<__m128i*>(below), fullyBelow);
+
+		for (int lane{ 0 }; lane < 4; ++lane)
+		{
+			bounds[lane] = finishBounds(frustum, z[lane], lights[lane].radius,
+				right[lane], left[lane], above[lane], below[lane]);
+		}
+	}
+#endif
+
+	template <typename Function>
+	void parallelFor(JobSystem* jobSystem, std::size_t count, std::size_t grainSize, Function&& function)
+	{
+		if (jobSystem)
+		{
+			jobSystem->parallelFor(count, grainSize, function);
+		}
+		else if (count != 0)
+		{
+			function(std::size_t{ 0 }, count);
+		}
+	}
+}
+
+
+
+LightClusters::Bounds calculateLightBounds(const PointLight& light, const glm::mat4& view,
+	float fieldOfView, float aspectRatio, float nearPlane, float farPlane)
+{
+	return lightBounds(makeClusterFrustum(fieldOfView, aspectRatio, nearPlane, farPlane), light, view);
+}
+
+void assignLights(LightClusters& clusters, const std::vector<PointLight>& lights, const glm::mat4& view,
+	float fieldOfView, float aspectRatio, float nearPlane, float farPlane, JobSystem* jobSystem)
+{
+	PROFILE_ZONE("Assign lights");
+
+	const ClusterFrustum frustum{ makeClusterFrustum(fieldOfView, aspectRatio, nearPlane, farPlane) };
+
+	// Pass 1: the froxel range of every light
+	clusters.bounds.resize(lights.size());
+	{
+		constexpr std::size_t batchSize{ 4 };
+		const std::size_t batchCount{ (lights.size() + batchSize - 1) / batchSize };
+
+		parallelFor(jobSystem, batchCount, 64, [&](std::size_t begin, std::size_t end) {
+			for (std::size_t batch{ begin }; batch < end; ++batch)
+			{
+				const std::size_t first{ batch * batchSize };
+				const std::size_t last{ std::min(first + batchSize, lights.size()) };
+
+#ifdef IKLOB_LIGHT_CLUSTERS_SSE
+				if (last - first == batchSize)
+				{
+					lightBounds4(frustum, lights.data() + first, view, clusters.bounds.data() + first);
+					continue;
+				}
+#endif
+				for (std::size_t i{ first }; i < last; ++i)
+				{
+					clusters.bounds[i] = lightBounds(frustum, lights[i], view);
+				}
+			}
+			});
+	}
+
+	// Pass 2: counting sort of the lights into every froxel, one depth slice
+	// per job so no two jobs ever write the same cluster. Lights stay in
+	// scene order within a cluster.
+	constexpr std::size_t clustersPerSlice{ clusterCountX * clusterCountY };
+	clusters.ranges.resize(clusterCount);
+	clusters.sliceIndices.resize(clusterCountZ);
+
+	parallelFor(jobSystem, clusterCountZ, 2, [&](std::size_t begin, std::size_t end) {
+		for (std::size_t z{ begin }; z < end; ++z)
+		{
+			glm::uvec2* ranges{ clusters.ranges.data() + z * clustersPerSlice };
+			std::fill(ranges, ranges + clustersPerSlice, glm::uvec2{ 0 });
+
+			const auto forEachCluster{ [&](auto&& visit) {
+				for (std::uint32_t i{ 0 }; i < lights.size(); ++i)
+				{
+					const LightClusters::Bounds& bounds{ clusters.bounds[i] };
+					if (!bounds.visible || z < bounds.z0 || z > bounds.z1)
+					{
+						continue;
+					}
+
+					for (int y{ bounds.y0 }; y <= bounds.y1; ++y)
+					{
+						for (int x{ bounds.x0 }; x <= bounds.x1; ++x)
+						{
+							visit(ranges[y * clusterCountX + x], i);
+						}
+					}
+				}
+				} };
+
+			forEachCluster([](glm::uvec2& range, std::uint32_t) { ++range.y; });
+
+			std::uint32_t offset{};
+			for (std::size_t c{ 0 }; c < clustersPerSlice; ++c)
+			{
+				ranges[c].x = offset;
+				offset += ranges[c].y;
+				ranges[c].y = 0;
+			}
+
+			std::vector<std::uint32_t>& indices{ clusters.sliceIndices[z] };
+			indices.resize(offset);
+			forEachCluster([&indices](glm::uvec2& range, std::uint32_t light) { indices[range.x + range.y++] = light; });
+		}
+		});
+
+	// Pass 3: concatenate the slices and rebase their offsets
+	std::array<std::uint32_t, clusterCountZ> sliceOffsets{};
+	std::uint32_t indexCount{};
+	for (int z{ 0 }; z < clusterCountZ; ++z)
+	{
+		sliceOffsets[z] = indexCount;
+		indexCount += static_cast<std::uint32_t>(clusters.sliceIndices[z].size());
+	}
+
+	clusters.lightIndices.resize(indexCount);
+
+	parallelFor(jobSystem, clusterCountZ, 4, [&](std::size_t begin, std::size_t end) {
+		for (std::size_t z{ begin }; z < end; ++z)
+		{
+			const std::vector<std::uint32_t>& indices{ clusters.sliceIndices[z] };
+			std::copy(indices.begin(), indices.end(), clusters.lightIndices.begin() + sliceOffsets[z]);
+
+			glm::uvec2* ranges{ clusters.ranges.data() + z * clustersPerSlice };
+			for (std::size_t c{ 0 }; c < clustersPerSlice; ++c)
+			{
+				ranges[c].x += sliceOffsets[z];
+			}
+		}
+		});
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "glm/glm.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+// Clustered forward shading. The view frustum is split into a grid of
+// froxels: clusterCountX by clusterCountY screen tiles, and clusterCountZ
+// depth slices spaced exponentially between the near and far plane.
+// assignLights() bins point lights into every froxel their sphere touches
+// and the fragment shader only walks the list of the froxel it lands in, so
+// shading cost follows the lights per cluster, not the lights in the scene.
+// Pure CPU code, like animation.hpp. Must match the constants in uber.frag.
+
+constexpr int clusterCountX{ 16 };
+constexpr int clusterCountY{ 9 };
+constexpr int clusterCountZ{ 24 };
+constexpr int clusterCount{ clusterCountX * clusterCountY * clusterCountZ };
+
+// Element of the Lights storage buffer in uber.frag (std430). World space.
+struct PointLight
+{
+	glm::vec3 position{};
+	// Light falls off to exactly zero here
+	float radius{ 1.0f };
+	glm::vec3 color{ 1.0f };
+	float intensity{ 1.0f };
+};
+
+struct LightClusters
+{
+	// Froxel a light's sphere touches, inclusive on both ends
+	struct Bounds
+	{
+		std::uint8_t x0{}, x1{};
+		std::uint8_t y0{}, y1{};
+		std::uint8_t z0{}, z1{};
+		bool visible{ false };
+	};
+
+	// (offset, count) into lightIndices for every cluster, x fastest, then
+	// y, then z. Uploaded as is to the Clusters storage buffer.
+	std::vector<glm::uvec2> ranges{};
+	std::vector<std::uint32_t> lightIndices{};
+
+	// Scratch space, kept to reuse the allocations every frame
+	std::vector<Bounds> bounds{};
+	std::vector<std::vector<std::uint32_t>> sliceIndices{};
+};
+
+// Bins lights for a camera using the same perspective as
+// Renderer::beginRendering(). The per light bounds are computed four lights
+// at a time with SSE where available, and both passes are spread over the
+// job system when one is given.
+void assignLights(LightClusters& clusters, const std::vector<PointLight>& lights, const glm::mat4& view,
+	float fieldOfView, float aspectRatio, float nearPlane, float farPlane, JobSystem* jobSystem = nullptr);
+
+// Scalar reference for the bounds, also used for the lights left over after
+// the SIMD batches
+LightClusters::Bounds calculateLightBounds(const PointLight& light, const glm::mat4& view,
+	float fieldOfView, float aspectRatio, float nearPlane, float farPlane);
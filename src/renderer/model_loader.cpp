@@ -1,150 +1,142 @@
 #include "model_loader.hpp"
 
+#include "cooked_model.hpp"
+#include "glb_file.hpp"
 #include "renderer.hpp"
 #include "gl_utils.hpp"
+#include "../jobs/job_system.hpp"
+#include "../memory/memory_tracker.hpp"
+#include "../profiler/profiler.hpp"
 
 #include "glad/glad.h"
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 #include "glm/gtx/quaternion.hpp"
-#define TINYGLTF_IMPLEMENTATION
+#include "tinygltf/json.hpp"
 #define STB_IMAGE_IMPLEMENTATION
-#define STB_IMAGE_WRITE_IMPLEMENTATION
-#include "tinygltf/tiny_gltf.h"
+#include "tinygltf/stb_image.h"
 
-#include <algorithm> // for std::find and std::max
+#include <algorithm> // for std::find, std::max_element and std::nth_element
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <filesystem>
 #include <iostream>
 #include <iterator> // for std::distance
+#include <memory>
+#include <span>
 #include <string>
 #include <utility> // for std::pair
 
 template <typename T>
-std::vector<T> loadBuffer(const tinygltf::Accessor& accessor, const tinygltf::BufferView& bufferView, const tinygltf::Buffer& buffer)
+std::vector<T> loadBuffer(const AccessorView& accessor)
 {
-	std::vector<T> r(bufferView.byteLength / sizeof(T));
+	std::vector<T> r(accessor.count);
 
-	auto data{ buffer.data.data() + bufferView.byteOffset + accessor.byteOffset };
-	
-	for (int i{ 0 }; i < bufferView.byteLength / accessor.ByteStride(bufferView); ++i)
+	if (!copyAccessor<T>(accessor, r.data()))
 	{
-		T t{};
-		std::memcpy(&t, data, sizeof(T));
-		data += sizeof(T);
-
-		r[i] = t;
+		std::cerr << "MODEL LOADER: ERROR: Accessor element size does not match " << sizeof(T) << " bytes\n";
+		r.clear();
 	}
 
 	return r;
 }
 
-Renderer::Material loadPrimitiveMaterial(const tinygltf::Model& model, const tinygltf::Primitive& primitive)
+Renderer::Material loadPrimitiveMaterial(const GlbFile& file, const nlohmann::json& primitive)
 {
 	Renderer::Material ret{};
 
-	if (primitive.material != -1)
+	const int materialIndex{ primitive.value("material", -1) };
+	if (materialIndex != -1)
 	{
-		const tinygltf::Material& material{ model.materials[primitive.material] };
-
-		ret.baseColorFactor = {
-			material.pbrMetallicRoughness.baseColorFactor[0],
-			material.pbrMetallicRoughness.baseColorFactor[1], 
-			material.pbrMetallicRoughness.baseColorFactor[2], 
-			material.pbrMetallicRoughness.baseColorFactor[3], };
+		const nlohmann::json& material{ jsonArray(file.json(), "materials")[materialIndex] };
+		const nlohmann::json& pbrMetallicRoughness{ jsonObject(material, "pbrMetallicRoughness") };
 
-		const tinygltf::TextureInfo& baseColorTextureInfo{ material.pbrMetallicRoughness.baseColorTexture };
-		if (baseColorTextureInfo.index != -1)
+		const auto& baseColorFactor{ jsonArray(pbrMetallicRoughness, "baseColorFactor") };
+		if (baseColorFactor.size() == 4)
 		{
-			const tinygltf::Texture& baseColorTexture{ model.textures[baseColorTextureInfo.index] };
-			const tinygltf::Image& baseColorTextureImage{ model.images[baseColorTexture.source] };
-			const tinygltf::Sampler& baseColorTextureSampler{ model.samplers[baseColorTexture.sampler] };
-
-			GLint minFilter{ [&]() { 
-				switch (baseColorTextureSampler.minFilter)
-				{
-				case TINYGLTF_TEXTURE_FILTER_NEAREST: return GL_NEAREST;
-				case TINYGLTF_TEXTURE_FILTER_LINEAR: return GL_LINEAR;
-				default: return GL_LINEAR_MIPMAP_LINEAR;
-				} }() };
-
-			GLint magFilter{ [&]() {
-				switch (baseColorTextureSampler.magFilter)
-				{
-				case TINYGLTF_TEXTURE_FILTER_NEAREST: return GL_NEAREST;
-				default: return GL_LINEAR;
-				} }() };
+			ret.baseColorFactor = {
+				baseColorFactor[0].get<float>(),
+				baseColorFactor[1].get<float>(),
+				baseColorFactor[2].get<float>(),
+				baseColorFactor[3].get<float>(), };
+		}
 
+		const int baseColorTextureIndex{
+			jsonObject(pbrMetallicRoughness, "baseColorTexture").value("index", -1) };
+		if (baseColorTextureIndex != -1)
+		{
+			// Staged by loadModel(), one per glTF texture
 			ret.hasBaseColorTexture = true;
-			ret.baseColorTexture = createTexture(baseColorTextureImage.image.data(),
-				baseColorTextureImage.width, baseColorTextureImage.height,
-				minFilter, magFilter, baseColorTextureImage.bits);
+			ret.baseColorTextureIndex = baseColorTextureIndex;
 		}
 	}
 
 	return ret;
 }
 
-glm::mat4 getNodeTransform(const tinygltf::Node& node)
+glm::mat4 getNodeTransform(const nlohmann::json& node)
 {
 
 	glm::mat4 translationMatrix{ 1.0f };
-	if (node.translation.size() != 0)
+	const auto& translation{ jsonArray(node, "translation") };
+	if (translation.size() == 3)
 	{
-		glm::vec3 translation{ 
-			static_cast<float>(node.translation[0]),
-			static_cast<float>(node.translation[1]),
-			static_cast<float>(node.translation[2]) };
-		translationMatrix = glm::translate(translationMatrix, translation);
+		translationMatrix = glm::translate(translationMatrix, glm::vec3{
+			translation[0].get<float>(),
+			translation[1].get<float>(),
+			translation[2].get<float>() });
 	}
 
 	glm::mat4 rotationMatrix{ 1.0f };
-	if (node.rotation.size() != 0)
+	const auto& rotation{ jsonArray(node, "rotation") };
+	if (rotation.size() == 4)
 	{
 		// glm quaternions are in WXYZ
-		glm::quat rotation{
-			static_cast<float>(node.rotation[3]),
-			static_cast<float>(node.rotation[0]),
-			static_cast<float>(node.rotation[1]),
-			static_cast<float>(node.rotation[2]), };
-		rotationMatrix = glm::toMat4(rotation);
+		glm::quat quat{
+			rotation[3].get<float>(),
+			rotation[0].get<float>(),
+			rotation[1].get<float>(),
+			rotation[2].get<float>(), };
+		rotationMatrix = glm::toMat4(quat);
 	}
 
 	glm::mat4 scaleMatrix{ 1.0f };
-	if (node.scale.size() != 0)
+	const auto& scale{ jsonArray(node, "scale") };
+	if (scale.size() == 3)
 	{
-		glm::vec3 scale{
-			static_cast<float>(node.scale[0]),
-			static_cast<float>(node.scale[1]),
-			static_cast<float>(node.scale[2]) };
-		scaleMatrix = glm::scale(scaleMatrix, scale);
+		scaleMatrix = glm::scale(scaleMatrix, glm::vec3{
+			scale[0].get<float>(),
+			scale[1].get<float>(),
+			scale[2].get<float>() });
 	}
 
 	return translationMatrix * rotationMatrix * scaleMatrix;
 }
 
-void loadNodeSkin(const tinygltf::Model& model, const::tinygltf::Node& node, Renderer::Mesh& ret)
+void loadNodeSkin(const GlbFile& file, const nlohmann::json& node, Renderer::Mesh& ret)
 {
-	const auto& skin{ model.skins[node.skin] };
+	// Joints and keyframes are the animation system's, however they got loaded
+	MemoryTracker::Scope memoryScope{ MemoryTracker::ANIMATION };
 
-	std::vector<glm::mat4> inverseBindMatrices{};
-	if (skin.inverseBindMatrices != -1)
-	{
-		const auto& inverseBindMatricesAccessor{ model.accessors[skin.inverseBindMatrices] };
-		const auto& inverseBindMatricesBufView{ model.bufferViews[inverseBindMatricesAccessor.bufferView] };
-		const auto& inverseBindMatricesBuf{ model.buffers[inverseBindMatricesBufView.buffer] };
+	const auto& skin{ jsonArray(file.json(), "skins")[node["skin"].get<int>()] };
 
-		auto data{ inverseBindMatricesBuf.data.data() + inverseBindMatricesBufView.byteOffset };
-		const std::size_t count{ inverseBindMatricesBufView.byteLength / sizeof(glm::mat4) };
+	const std::vector<int> skinJoints{ jsonArray(skin, "joints").get<std::vector<int>>() };
 
-		inverseBindMatrices = loadBuffer<glm::mat4>(inverseBindMatricesAccessor, inverseBindMatricesBufView, inverseBindMatricesBuf);
+	std::vector<glm::mat4> inverseBindMatrices{};
+	const AccessorView inverseBindMatricesAccessor{ file.accessor(skin.value("inverseBindMatrices", -1)) };
+	if (inverseBindMatricesAccessor.data)
+	{
+		inverseBindMatrices = loadBuffer<glm::mat4>(inverseBindMatricesAccessor);
 	}
 	else
 	{
 		std::cerr << "MODEL LOADER: ERROR: Inverse bind matrices expected but not found\n";
 	}
 
+	// Identity is the glTF default for missing matrices
+	inverseBindMatrices.resize(skinJoints.size(), glm::mat4{ 1.0f });
+
 	// Create table of known child indices
 	// Check if table contains index of joint being loaded
 
@@ -154,31 +146,35 @@ void loadNodeSkin(const tinygltf::Model& model, const::tinygltf::Node& node, Ren
 	// this but it's probably bikeshedding
 	std::vector<int> globalChildrenIndices{};
 
+	const auto& nodes{ jsonArray(file.json(), "nodes") };
+
+	ret.joints.reserve(skinJoints.size());
+
 	int i{ 0 };
-	for (const auto& jointIndex : skin.joints)
+	for (const auto& jointIndex : skinJoints)
 	{
-		const auto& joint{ model.nodes[jointIndex] };
+		const auto& joint{ nodes[jointIndex] };
 
-		std::vector<int> children{ joint.children };
+		std::vector<int> children{ jsonArray(joint, "children").get<std::vector<int>>() };
 		// Convert the children node (GLTF) indices into children joint (engine) indices
 		for (int& child : children)
 		{
-			auto childIt{ std::find(skin.joints.begin(), skin.joints.end(), child) };
+			auto childIt{ std::find(skinJoints.begin(), skinJoints.end(), child) };
 
-			if (childIt != skin.joints.end())
+			if (childIt != skinJoints.end())
 			{
-				child = std::distance(skin.joints.begin(), childIt);
+				child = std::distance(skinJoints.begin(), childIt);
 
 				globalChildrenIndices.push_back(child);
 			}
 		}
 
 		ret.joints.push_back({
-			.name{ joint.name },
+			.name{ joint.value("name", std::string{}) },
 			.nodeIndex{ jointIndex },
 			.hasJointParent{ std::find(globalChildrenIndices.begin(), globalChildrenIndices.end(),
 				i) != globalChildrenIndices.end() },
-			.children{ children },
+			.children{ std::move(children) },
 			.transform{ getNodeTransform(joint) },
 			.inverseBindMatrix{ inverseBindMatrices[i] },
 		});
@@ -187,11 +183,16 @@ void loadNodeSkin(const tinygltf::Model& model, const::tinygltf::Node& node, Ren
 	}
 
 
-	if (model.animations.size() != 0)
+	const auto& animations{ jsonArray(file.json(), "animations") };
+	if (animations.size() != 0)
 	{
-		for (const auto& channel : model.animations[0].channels)
+		const auto& samplers{ jsonArray(animations[0], "samplers") };
+
+		for (const auto& channel : jsonArray(animations[0], "channels"))
 		{
-			int targetNode{ channel.target_node };
+			const nlohmann::json& target{ jsonObject(channel, "target") };
+			const int targetNode{ target.value("node", -1) };
+			const std::string targetPath{ target.value("path", std::string{}) };
 
 			auto node{ std::find_if(ret.joints.begin(), ret.joints.end(),
 				[targetNode](const Renderer::Joint& i) {
@@ -202,64 +203,51 @@ void loadNodeSkin(const tinygltf::Model& model, const::tinygltf::Node& node, Ren
 			{
 				Renderer::AnimationSampler animationSampler{};
 
-				if (channel.target_path == "translation")
+				if (targetPath == "translation")
 				{
 					animationSampler.path = Renderer::AnimationSampler::TRANSLATION;
 				}
-				else if (channel.target_path == "rotation")
+				else if (targetPath == "rotation")
 				{
 					animationSampler.path = Renderer::AnimationSampler::ROTATION;
 				}
-				else if (channel.target_path == "scale")
+				else if (targetPath == "scale")
 				{
 					animationSampler.path = Renderer::AnimationSampler::SCALE;
 				}
-				else if (channel.target_path == "weights")
+				else if (targetPath == "weights")
 				{
 					std::cerr << "MODEL LOADER: ERROR: Weights animation target detected but not supported\n";
 				}
 
-				const auto& inputAccessor{ model.accessors[model.animations[0].samplers[channel.sampler].input] };
-				const auto& inputBufferView{ model.bufferViews[inputAccessor.bufferView] };
-				const auto& inputBuffer{ model.buffers[inputBufferView.buffer] };
+				const auto& sampler{ samplers[channel["sampler"].get<int>()] };
+
+				const AccessorView inputAccessor{ file.accessor(sampler.value("input", -1)) };
+				animationSampler.input = loadBuffer<float>(inputAccessor);
 
-				if (inputAccessor.maxValues[0] > ret.maxTime)
+				if (animationSampler.input.size() != 0)
 				{
-					ret.maxTime = inputAccessor.maxValues[0];
+					ret.maxTime = std::max(ret.maxTime,
+						static_cast<double>(*std::max_element(animationSampler.input.begin(), animationSampler.input.end())));
 				}
 
-				auto inputData{ inputBuffer.data.data() + inputBufferView.byteOffset + inputAccessor.byteOffset };
+				const AccessorView outputAccessor{ file.accessor(sampler.value("output", -1)) };
 
-				for (int i{ 0 }; i < inputBufferView.byteLength / sizeof(float); ++i)
+				if (outputAccessor.componentCount == 3)
 				{
-					float inputValue{};
-					std::memcpy(&inputValue, inputData, sizeof(float));
-					inputData += sizeof(float);
-
-					animationSampler.input.push_back(inputValue);
+					// Widen in place; the fourth component stays 0
+					animationSampler.output.resize(outputAccessor.count, glm::vec4{ 0.0f });
+					copyAccessor<glm::vec3>(outputAccessor, animationSampler.output.data(), sizeof(glm::vec4));
 				}
-
-				const auto& outputAccessor{ model.accessors[model.animations[0].samplers[channel.sampler].output] };
-				const auto& outputBufferView{ model.bufferViews[outputAccessor.bufferView] };
-				const auto& outputBuffer{ model.buffers[outputBufferView.buffer] };
-
-				auto outputData{ outputBuffer.data.data() + outputBufferView.byteOffset + outputAccessor.byteOffset };
-
-				
-				if (outputAccessor.type == TINYGLTF_TYPE_VEC3)
+				else if (outputAccessor.componentCount == 4)
 				{
-					for (int i{ 0 }; i < outputBufferView.byteLength / outputAccessor.ByteStride(outputBufferView); ++i)
-					{
-						glm::vec3 outputValue{ 0.0f };
-						std::memcpy(&outputValue, outputData, sizeof(glm::vec3));
-						outputData += sizeof(glm::vec3);
-
-						animationSampler.output.push_back(glm::vec4{ outputValue, 0.0f });
-					}
+					animationSampler.output = loadBuffer<glm::vec4>(outputAccessor);
 				}
-				else if (outputAccessor.type == TINYGLTF_TYPE_VEC4)
+
+				if (animationSampler.input.size() == 0 || animationSampler.output.size() != animationSampler.input.size())
 				{
-					animationSampler.output = loadBuffer<glm::vec4>(outputAccessor, outputBufferView, outputBuffer);
+					std::cerr << "MODEL LOADER: ERROR: Skipping animation channel with mismatched keyframes\n";
+					continue;
 				}
 
 				node->animationSamplers.insert(std::pair{ animationSampler.path, animationSampler });
@@ -272,193 +260,553 @@ void loadNodeSkin(const tinygltf::Model& model, const::tinygltf::Node& node, Ren
 	}
 }
 
-Renderer::Primitive loadPrimitive(const tinygltf::Model& model, const tinygltf::Primitive& primitive,
+Renderer::Primitive loadPrimitive(const GlbFile& file, const nlohmann::json& primitive,
 	const glm::mat4& nodeTransform, std::vector<Renderer::Vertex>& vertices, std::vector<GLuint>& indices)
 {
 	Renderer::Primitive ret
 	{
-		.material{ loadPrimitiveMaterial(model, primitive) },
+		.material{ loadPrimitiveMaterial(file, primitive) },
 		.transform     { nodeTransform },
 		.elementOffset { static_cast<GLsizei>(indices.size()) },
 	};
 
-	const tinygltf::Accessor   indicesAccessor   { model.accessors[primitive.indices] };
-	const tinygltf::BufferView indicesBufferView { model.bufferViews[indicesAccessor.bufferView] };
-	const tinygltf::Buffer     indicesBuffer     { model.buffers[indicesBufferView.buffer] };
+	const nlohmann::json& attributes{ jsonObject(primitive, "attributes") };
+
+	const AccessorView positionAccessor{ file.accessor(attributes.value("POSITION", -1)) };
+	if (!positionAccessor.data)
+	{
+		std::cerr << "MODEL LOADER: ERROR: Primitive has no positions\n";
+		return ret;
+	}
 
-	const unsigned char* indexData{ indicesBuffer.data.data() };
-	indexData += indicesBufferView.byteOffset;
+	const std::size_t vertexCount{ positionAccessor.count };
+	const std::size_t firstVertex{ vertices.size() };
+	const std::uint32_t indexOffset{ static_cast<std::uint32_t>(firstVertex) };
 
-	const std::uint32_t indexOffset{ static_cast<std::uint32_t>(vertices.size()) };
+	const AccessorView indicesAccessor{ file.accessor(primitive.value("indices", -1)) };
+	const std::size_t firstIndex{ indices.size() };
 
-	switch (indicesAccessor.componentType)
+	if (indicesAccessor.data)
 	{
-	case (TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT):
-		for (int i{ 0 }; i < indicesBufferView.byteLength / sizeof(std::uint16_t); ++i)
+		indices.resize(firstIndex + indicesAccessor.count);
+		GLuint* out{ indices.data() + firstIndex };
+
+		// Indices are always tightly packed
+		switch (indicesAccessor.componentType)
 		{
-			std::uint16_t index{};
-			std::memcpy(&index, indexData, sizeof(std::uint16_t));
-			indexData += sizeof(std::uint16_t);
+		case GL_UNSIGNED_BYTE:
+			for (std::size_t i{ 0 }; i < indicesAccessor.count; ++i)
+			{
+				out[i] = indicesAccessor.data[i] + indexOffset;
+			}
+			break;
+
+		case GL_UNSIGNED_SHORT:
+			for (std::size_t i{ 0 }; i < indicesAccessor.count; ++i)
+			{
+				std::uint16_t index{};
+				std::memcpy(&index, indicesAccessor.data + i * sizeof(std::uint16_t), sizeof(std::uint16_t));
+				out[i] = index + indexOffset;
+			}
+			break;
+
+		case GL_UNSIGNED_INT:
+			std::memcpy(out, indicesAccessor.data, indicesAccessor.count * sizeof(std::uint32_t));
+			if (indexOffset != 0)
+			{
+				for (std::size_t i{ 0 }; i < indicesAccessor.count; ++i)
+				{
+					out[i] += indexOffset;
+				}
+			}
+			break;
+
+		default:
+			std::cerr << "MODEL LOADER: ERROR: Unrecognized index buffer accessor component type: " << indicesAccessor.componentType << '\n';
+			indices.resize(firstIndex);
+			break;
+		}
+	}
+	else
+	{
+		// Non-indexed primitives draw their vertices in order
+		indices.resize(firstIndex + vertexCount);
+		for (std::size_t i{ 0 }; i < vertexCount; ++i)
+		{
+			indices[firstIndex + i] = static_cast<GLuint>(i) + indexOffset;
+		}
+	}
+
+	ret.elementCount = static_cast<GLsizei>(indices.size()) - ret.elementOffset;
+
+	// A joint of -1 denotes that there is no bone or weight to account for;
+	// such primitives stay unskinned and are drawn without a palette.
+	vertices.resize(firstVertex + vertexCount, Renderer::Vertex{
+		.normal{ 0.0f, 1.0f, 0.0f },
+		.joints{ -1, -1, -1, -1 },
+	});
+	Renderer::Vertex* out{ vertices.data() + firstVertex };
+
+	const auto attribute{ [&](const char* name) {
+		const AccessorView accessor{ file.accessor(attributes.value(name, -1)) };
+		if (accessor.data && accessor.count != vertexCount)
+		{
+			std::cerr << "MODEL LOADER: ERROR: " << name << " count does not match POSITION count\n";
+			return AccessorView{};
+		}
+		return accessor;
+	} };
+
+	copyAccessor<glm::vec3>(positionAccessor, &out->position, sizeof(Renderer::Vertex));
+
+	if (const AccessorView normalAccessor{ attribute("NORMAL") }; normalAccessor.data)
+	{
+		copyAccessor<glm::vec3>(normalAccessor, &out->normal, sizeof(Renderer::Vertex));
+	}
 
-			indices.push_back(static_cast<std::uint32_t>(index) + indexOffset);
+	if (const AccessorView texCoordAccessor{ attribute("TEXCOORD_0") }; texCoordAccessor.data)
+	{
+		if (!copyAccessor<glm::vec2>(texCoordAccessor, &out->texCoord, sizeof(Renderer::Vertex)))
+		{
+			std::cerr << "MODEL LOADER: ERROR: Only float texture coordinates are supported\n";
 		}
-		break;
+	}
 
-	case (TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT):
-		for (int i{ 0 }; i < indicesBufferView.byteLength / sizeof(std::uint32_t); ++i)
+	if (const AccessorView jointAccessor{ attribute("JOINTS_0") }; jointAccessor.data)
+	{
+		switch (jointAccessor.componentType)
 		{
-			std::uint32_t index{};
-			std::memcpy(&index, indexData, sizeof(std::uint32_t));
-			indexData += sizeof(std::uint32_t);
+		case GL_UNSIGNED_BYTE:
+			for (std::size_t i{ 0 }; i < vertexCount; ++i)
+			{
+				glm::u8vec4 joints{};
+				std::memcpy(&joints, jointAccessor.element(i), sizeof(glm::u8vec4));
+				out[i].joints = joints;
+			}
+			ret.skinned = true;
+			break;
+
+		case GL_UNSIGNED_SHORT:
+			for (std::size_t i{ 0 }; i < vertexCount; ++i)
+			{
+				glm::u16vec4 joints{};
+				std::memcpy(&joints, jointAccessor.element(i), sizeof(glm::u16vec4));
+				out[i].joints = joints;
+			}
+			ret.skinned = true;
+			break;
 
-			indices.push_back(index + indexOffset);
+		default:
+			std::cerr << "MODEL LOADER: ERROR: Unrecognized joint accessor component type: " << jointAccessor.componentType << '\n';
+			break;
 		}
-		break;
+	}
 
-	default:
-		std::cerr << "MODEL LOADER: ERROR: Unrecognized index buffer accessor component type: " << indicesAccessor.componentType << '\n';
-		break;
+	if (const AccessorView weightAccessor{ attribute("WEIGHTS_0") }; weightAccessor.data)
+	{
+		if (!copyAccessor<glm::vec4>(weightAccessor, &out->weights, sizeof(Renderer::Vertex)))
+		{
+			std::cerr << "MODEL LOADER: ERROR: Only float joint weights are supported\n";
+		}
 	}
 
-	ret.elementCount = static_cast<GLsizei>(indices.size()) - ret.elementOffset;
+	return ret;
+}
 
-	const unsigned char* positionData { nullptr };
-	const unsigned char* normalData   { nullptr };
-	const unsigned char* texCoordData { nullptr };
-	const unsigned char* jointData    { nullptr };
-	const unsigned char* weightData   { nullptr };
+void countNode(const GlbFile& file, const nlohmann::json& node,
+	std::size_t& vertexCount, std::size_t& indexCount)
+{
+	const int meshIndex{ node.value("mesh", -1) };
+	if (meshIndex != -1)
+	{
+		for (const auto& primitive : jsonArray(jsonArray(file.json(), "meshes")[meshIndex], "primitives"))
+		{
+			const nlohmann::json& attributes{ jsonObject(primitive, "attributes") };
+			const AccessorView positionAccessor{ file.accessor(attributes.value("POSITION", -1)) };
+			const AccessorView indicesAccessor{ file.accessor(primitive.value("indices", -1)) };
 
-	std::size_t vertexCount{};
+			vertexCount += positionAccessor.count;
+			indexCount += indicesAccessor.data ? indicesAccessor.count : positionAccessor.count;
+		}
+	}
 
-	for (const auto& attribute : primitive.attributes)
+	for (int nodeIndex : jsonArray(node, "children"))
 	{
-		const tinygltf::Accessor& accessor     { model.accessors[attribute.second] };
-		const tinygltf::BufferView& bufferView { model.bufferViews[accessor.bufferView] };
-		const tinygltf::Buffer& buffer         { model.buffers[bufferView.buffer] };
-		
-		if (attribute.first == "POSITION")
+		countNode(file, jsonArray(file.json(), "nodes")[nodeIndex], vertexCount, indexCount);
+	}
+}
+
+void loadNode(const GlbFile& file, const nlohmann::json& node,
+	const glm::mat4& inheritedTransform, std::vector<Renderer::Vertex>& vertices, 
+	std::vector<GLuint>& indices, Renderer::Mesh& ret)
+{
+	// Todo: test if this works as intended
+	glm::mat4 transform{ inheritedTransform * getNodeTransform(node) };
+
+	// IMPORTANT: This is only prepared for models with one or fewer skins.
+	// Any more skins will result in UB
+	if (node.value("skin", -1) != -1)
+	{
+		loadNodeSkin(file, node, ret);
+	}
+
+	const int meshIndex{ node.value("mesh", -1) };
+	if (meshIndex != -1)
+	{
+		const nlohmann::json& mesh{ jsonArray(file.json(), "meshes")[meshIndex] };
+
+		for (const nlohmann::json& primitive : jsonArray(mesh, "primitives"))
 		{
-			vertexCount = bufferView.byteLength / sizeof(glm::vec3);
-			positionData = buffer.data.data() + bufferView.byteOffset;
+			ret.primitives.push_back(loadPrimitive(file, primitive, transform, vertices, indices));
 		}
-		else if (attribute.first == "NORMAL")
+	}
+
+	for (int nodeIndex : jsonArray(node, "children"))
+	{
+		loadNode(file, jsonArray(file.json(), "nodes")[nodeIndex], transform, vertices, indices, ret);
+	}
+}
+
+StagedTexture stageTexture(const GlbFile& file, const nlohmann::json& texture)
+{
+	StagedTexture ret{};
+
+	const int samplerIndex{ texture.value("sampler", -1) };
+	if (samplerIndex != -1)
+	{
+		const nlohmann::json& sampler{ jsonArray(file.json(), "samplers")[samplerIndex] };
+
+		// glTF filters are GL enums
+		ret.minFilter = [&]() {
+			switch (sampler.value("minFilter", 0))
+			{
+			case GL_NEAREST: return GL_NEAREST;
+			case GL_LINEAR: return GL_LINEAR;
+			default: return GL_LINEAR_MIPMAP_LINEAR;
+			} }();
+
+		ret.magFilter = [&]() {
+			switch (sampler.value("magFilter", 0))
+			{
+			case GL_NEAREST: return GL_NEAREST;
+			default: return GL_LINEAR;
+			} }();
+	}
+
+	const int sourceIndex{ texture.value("source", -1) };
+	if (sourceIndex != -1)
+	{
+		const nlohmann::json& image{ jsonArray(file.json(), "images")[sourceIndex] };
+
+		std::size_t size{};
+		const unsigned char* data{ file.bufferViewData(image.value("bufferView", -1), size) };
+		if (!data)
 		{
-			normalData = buffer.data.data() + bufferView.byteOffset;
+			std::cerr << "MODEL LOADER: ERROR: Only images embedded in the binary chunk are supported\n";
+			return ret;
 		}
-		else if (attribute.first == "TEXCOORD_0")
+
+		// Decoded straight from the mapping, always as RGBA
+		const int length{ static_cast<int>(size) };
+		int channels{};
+		void* pixels{ nullptr };
+
+		if (stbi_is_16_bit_from_memory(data, length))
 		{
-			texCoordData = buffer.data.data() + bufferView.byteOffset;
+			pixels = stbi_load_16_from_memory(data, length, &ret.width, &ret.height, &channels, 4);
+			ret.bits = 16;
 		}
-		else if (attribute.first == "JOINTS_0")
+		else
 		{
-			jointData = buffer.data.data() + bufferView.byteOffset;
+			pixels = stbi_load_from_memory(data, length, &ret.width, &ret.height, &channels, 4);
+			ret.bits = 8;
 		}
-		else if (attribute.first == "WEIGHTS_0")
+
+		if (!pixels)
 		{
-			weightData = buffer.data.data() + bufferView.byteOffset;
+			std::cerr << "MODEL LOADER: ERROR: Could not decode image " << sourceIndex << ": " << stbi_failure_reason() << '\n';
+			ret.width = 0;
+			ret.height = 0;
+			return ret;
 		}
+
+		const auto begin{ static_cast<const unsigned char*>(pixels) };
+		ret.pixels.assign(begin, begin + static_cast<std::size_t>(ret.width) * ret.height * 4 * (ret.bits / 8));
+
+		stbi_image_free(pixels);
+	}
+
+	return ret;
+}
+
+Renderer::Mesh loadModel(const std::string& path, std::vector<Renderer::Vertex>& vertices,
+	std::vector<GLuint>& indices, std::vector<StagedTexture>& textures, JobSystem* jobSystem)
+{
+	PROFILE_ZONE("Load model");
+
+	Renderer::Mesh ret{};
+
+	const GlbFile file{ path };
+	if (!file.valid())
+	{
+		return ret;
 	}
 
-	for (std::size_t i{ 0 }; i < vertexCount; ++i)
+	// Image decoding is usually the bulk of the work, so it goes to the pool
+	// first and overlaps with the geometry conversion below. Each job writes
+	// only its own slot.
+	const auto& gltfTextures{ jsonArray(file.json(), "textures") };
+	const int textureOffset{ static_cast<int>(textures.size()) };
+	textures.resize(textureOffset + gltfTextures.size());
+
+	JobCounter textureCounter{};
+	for (std::size_t i{ 0 }; i < gltfTextures.size(); ++i)
 	{
-		glm::vec3 position{};
-		std::memcpy(&position, positionData, sizeof(glm::vec3));
-		positionData += sizeof(glm::vec3);
+		auto stage{ [&file, &gltfTextures, &textures, textureOffset, i]() {
+			PROFILE_ZONE("Decode image");
+			textures[textureOffset + i] = stageTexture(file, gltfTextures[i]);
+		} };
 
-		glm::vec3 normal{ 0.0f, 1.0f, 0.0f };
-		if (normalData)
+		if (jobSystem)
+		{
+			jobSystem->schedule(stage, &textureCounter);
+		}
+		else
 		{
-			std::memcpy(&normal, normalData, sizeof(glm::vec3));
-			normalData += sizeof(glm::vec3);
+			stage();
 		}
+	}
+
+	const auto& nodes{ jsonArray(file.json(), "nodes") };
+	const auto& scenes{ jsonArray(file.json(), "scenes") };
 
-		glm::vec2 texCoord{ 0.0f, 0.0f };
-		if (texCoordData)
+	// Size the destination arrays once so appending primitives never
+	// reallocates and moves what is already loaded
+	std::size_t vertexCount{ vertices.size() };
+	std::size_t indexCount{ indices.size() };
+	for (const auto& scene : scenes)
+	{
+		for (int nodeIndex : jsonArray(scene, "nodes"))
 		{
-			std::memcpy(&texCoord, texCoordData, sizeof(glm::vec2));
-			texCoordData += sizeof(glm::vec2);
+			countNode(file, nodes[nodeIndex], vertexCount, indexCount);
 		}
+	}
+	vertices.reserve(vertexCount);
+	indices.reserve(indexCount);
 
-		// A joint of -1 denotes that there is no bone or weight to account for.
-		glm::ivec4 joints{ -1, -1, -1, -1 };
-		if (jointData)
+	for (const auto& scene : scenes)
+	{
+		for (int nodeIndex : jsonArray(scene, "nodes"))
 		{
-			glm::u8vec4 u8joints{};
+			loadNode(file, nodes[nodeIndex], glm::mat4{ 1.0f }, vertices, indices, ret);
+		}
+	}
 
-			std::memcpy(&u8joints, jointData, sizeof(glm::u8vec4));
-			jointData += sizeof(glm::u8vec4);
+	if (jobSystem)
+	{
+		jobSystem->wait(textureCounter);
+	}
 
-			joints = u8joints;
+	// Materials refer to glTF texture indices so far; make them relative to
+	// the caller's staging array
+	for (Renderer::Primitive& primitive : ret.primitives)
+	{
+		if (primitive.material.hasBaseColorTexture)
+		{
+			primitive.material.baseColorTextureIndex += textureOffset;
 		}
-		
-		glm::vec4 weights{ 0.0f, 0.0f, 0.0f, 0.0f };
-		if (weightData)
+	}
+
+	return ret;
+}
+
+StagedModel stageModel(const std::string& path, JobSystem* jobSystem)
+{
+	MemoryTracker::Scope memoryScope{ MemoryTracker::LOADER };
+
+	StagedModel ret{};
+
+	const std::string cookedPath{ cookedModelPath(path) };
+
+	std::error_code error{};
+	const auto cookedTime{ std::filesystem::last_write_time(cookedPath, error) };
+	const bool haveCooked{ !error };
+	const auto sourceTime{ std::filesystem::last_write_time(path, error) };
+
+	// A missing source is fine as long as it was cooked, e.g. in a shipped build
+	if (haveCooked && (error || cookedTime >= sourceTime))
+	{
+		auto cooked{ std::make_shared<const CookedModel>(cookedPath) };
+		if (cooked->valid())
 		{
-			std::memcpy(&weights, weightData, sizeof(glm::vec4));
-			weightData += sizeof(glm::vec4);
+			ret.mesh = cooked->mesh();
+			ret.textures = cooked->textures();
+			ret.cooked = std::move(cooked);
 		}
+	}
 
-		vertices.push_back(Renderer::Vertex{ position, normal, texCoord, joints, weights });
+	if (!ret.cooked)
+	{
+		ret.mesh = loadModel(path, ret.ownedVertices, ret.ownedIndices, ret.textures, jobSystem);
 	}
 
+	ret.mesh.hitboxes = fitHitboxes(ret.mesh, ret.vertices(), ret.indices());
+
 	return ret;
 }
 
-void loadNode(const tinygltf::Model& model, const tinygltf::Node& node, 
-	const glm::mat4& inheritedTransform, std::vector<Renderer::Vertex>& vertices, 
-	std::vector<GLuint>& indices, Renderer::Mesh& ret)
+std::span<const Renderer::Vertex> StagedModel::vertices() const
 {
-	// Todo: test if this works as intended
-	glm::mat4 transform{ inheritedTransform * getNodeTransform(node) };
+	return cooked ? cooked->vertices() : std::span<const Renderer::Vertex>{ ownedVertices };
+}
 
-	// IMPORTANT: This is only prepared for models with one or fewer skins.
-	// Any more skins will result in UB
-	if (node.skin != -1)
+std::span<const GLuint> StagedModel::indices() const
+{
+	return cooked ? cooked->indices() : std::span<const GLuint>{ ownedIndices };
+}
+
+std::vector<Renderer::Hitbox> fitHitboxes(const Renderer::Mesh& mesh, std::span<const Renderer::Vertex> vertices,
+	std::span<const GLuint> indices)
+{
+	std::vector<Renderer::Hitbox> ret{};
+	if (mesh.joints.empty())
 	{
-		loadNodeSkin(model, node, ret);
+		return ret;
 	}
 
-	if (node.mesh != -1)
+	// Vertices by the joint with the largest weight, each counted once even
+	// when several primitives share it
+	std::vector<std::vector<glm::vec3>> jointVertices(mesh.joints.size());
+	std::vector<std::uint8_t> seen(vertices.size(), 0);
+
+	for (const Renderer::Primitive& primitive : mesh.primitives)
 	{
-		const tinygltf::Mesh& mesh{ model.meshes[node.mesh] };
+		if (primitive.elementOffset < 0 || primitive.elementCount < 0
+			|| static_cast<std::size_t>(primitive.elementOffset) + primitive.elementCount > indices.size())
+		{
+			continue;
+		}
 
-		for (const tinygltf::Primitive& primitive : mesh.primitives)
+		for (GLsizei i{ 0 }; i < primitive.elementCount; ++i)
 		{
-			ret.primitives.push_back(loadPrimitive(model, primitive, transform, vertices, indices));
+			const std::size_t vertex{ static_cast<std::size_t>(primitive.baseVertex)
+				+ indices[static_cast<std::size_t>(primitive.elementOffset) + i] };
+			if (vertex >= vertices.size() || seen[vertex])
+			{
+				continue;
+			}
+			seen[vertex] = 1;
+
+			const Renderer::Vertex& v{ vertices[vertex] };
+			int strongest{ 0 };
+			for (int j{ 1 }; j < 4; ++j)
+			{
+				if (v.weights[j] > v.weights[strongest])
+				{
+					strongest = j;
+				}
+			}
+
+			const int joint{ v.joints[strongest] };
+			if (v.weights[strongest] > 0.0f && joint >= 0 && joint < static_cast<int>(jointVertices.size()))
+			{
+				jointVertices[joint].push_back(v.position);
+			}
 		}
 	}
 
-	for (int nodeIndex : node.children)
+	// Share of a joint's vertices the capsule has to reach around; the rest
+	// are outliers that would fatten it everywhere else
+	constexpr float radiusPercentile{ 0.9f };
+
+	for (std::size_t joint{ 0 }; joint < jointVertices.size(); ++joint)
 	{
-		loadNode(model, model.nodes[nodeIndex], transform, vertices, indices, ret);
-	}
-}
+		const std::vector<glm::vec3>& points{ jointVertices[joint] };
+		if (points.size() < 4)
+		{
+			continue;
+		}
 
-Renderer::Mesh loadModel(const std::string& path, std::vector<Renderer::Vertex>& vertices, std::vector<GLuint>& indices)
-{
-	Renderer::Mesh ret{};
+		glm::vec3 mean{ 0.0f };
+		for (const glm::vec3& point : points)
+		{
+			mean += point;
+		}
+		mean /= static_cast<float>(points.size());
 
-	tinygltf::Model    model{};
-	tinygltf::TinyGLTF loader{};
-	std::string        warning{};
-	std::string        error{};
+		glm::mat3 covariance{ 0.0f };
+		for (const glm::vec3& point : points)
+		{
+			const glm::vec3 offset{ point - mean };
+			covariance += glm::outerProduct(offset, offset);
+		}
 
-	loader.LoadBinaryFromFile(&model, &error, &warning, path);
+		// The capsule runs along the direction the vertices spread the most,
+		// found by power iteration from the widest axis
+		glm::vec3 axis{ 0.0f };
+		const int widest{ covariance[0][0] >= covariance[1][1] && covariance[0][0] >= covariance[2][2] ? 0
+			: covariance[1][1] >= covariance[2][2] ? 1 : 2 };
+		axis[widest] = 1.0f;
+		for (int iteration{ 0 }; iteration < 16; ++iteration)
+		{
+			const glm::vec3 next{ covariance * axis };
+			const float length{ glm::length(next) };
+			if (length < 1e-12f)
+			{
+				break;
+			}
+			axis = next / length;
+		}
 
-	if (!error.empty())
-	{
-		std::cerr << error << '\n';
+		float minimum{ 0.0f };
+		float maximum{ 0.0f };
+		std::vector<float> distances(points.size());
+		for (std::size_t i{ 0 }; i < points.size(); ++i)
+		{
+			const glm::vec3 offset{ points[i] - mean };
+			const float along{ glm::dot(offset, axis) };
+			minimum = std::min(minimum, along);
+			maximum = std::max(maximum, along);
+			distances[i] = glm::length(offset - axis * along);
+		}
+
+		const auto percentile{ distances.begin()
+			+ static_cast<std::ptrdiff_t>(radiusPercentile * static_cast<float>(distances.size() - 1)) };
+		std::nth_element(distances.begin(), percentile, distances.end());
+		const float radius{ *percentile };
+
+		// Vertices bunched on a line or a point give nothing worth shooting
+		if (radius < 1e-3f)
+		{
+			continue;
+		}
+
+		// Pulled in by the radius, so the caps end where the vertices do
+		const float start{ std::min(minimum + radius, (minimum + maximum) * 0.5f) };
+		const float end{ std::max(maximum - radius, (minimum + maximum) * 0.5f) };
+
+		ret.push_back(Renderer::Hitbox{ static_cast<int>(joint), mean + axis * start, mean + axis * end, radius });
 	}
-	if (!warning.empty())
+
+	return ret;
+}
+
+std::vector<GLuint> uploadTextures(Renderer::Mesh& mesh, const std::vector<StagedTexture>& textures)
+{
+	std::vector<GLuint> ret(textures.size());
+
+	for (std::size_t i{ 0 }; i < textures.size(); ++i)
 	{
-		std::cerr << warning << '\n';
+		const StagedTexture& texture{ textures[i] };
+		ret[i] = createTexture(texture.data(), texture.width, texture.height,
+			texture.minFilter, texture.magFilter, texture.bits);
 	}
 
-	for (const tinygltf::Scene& scene : model.scenes)
+	for (Renderer::Primitive& primitive : mesh.primitives)
 	{
-		for (int nodeIndex : scene.nodes)
+		if (primitive.material.hasBaseColorTexture)
 		{
-			loadNode(model, model.nodes[nodeIndex], glm::mat4{ 1.0f }, vertices, indices, ret);
+			primitive.material.baseColorTexture = ret[primitive.material.baseColorTextureIndex];
 		}
 	}
 
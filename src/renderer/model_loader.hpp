@@ -1,10 +1,82 @@
 #pragma once
 
+#include "glb_file.hpp"
 #include "renderer.hpp"
 
 #include "glad/glad.h"
+#include "glm/glm.hpp"
+#include "tinygltf/json.hpp"
 
+#include <memory>
+#include <span>
 #include <string>
 #include <vector>
 
-Renderer::Mesh loadModel(const std::string& path, std::vector<Renderer::Vertex>& vertices, std::vector<GLuint>& indices);
\ No newline at end of file
+class CookedModel;
+class JobSystem;
+
+// Decoded image waiting to be uploaded on the thread that owns the GL context
+struct StagedTexture
+{
+	std::vector<unsigned char> pixels{};
+	// Used instead of pixels for textures in a mapped cooked model
+	const unsigned char* mappedPixels{ nullptr };
+	int width{};
+	int height{};
+	int bits{ 8 };
+
+	GLint minFilter{ GL_LINEAR_MIPMAP_LINEAR };
+	GLint magFilter{ GL_LINEAR };
+
+	const unsigned char* data() const
+	{
+		return mappedPixels ? mappedPixels : pixels.data();
+	}
+};
+
+// One model ready for the GL thread. Geometry is either owned, for models
+// converted from glTF, or lives in a cooked model's mapping, which is kept
+// alive here until the upload is done. Indices and element offsets are
+// relative to the model's own vertices.
+struct StagedModel
+{
+	Renderer::Mesh mesh{};
+	std::vector<StagedTexture> textures{};
+
+	std::vector<Renderer::Vertex> ownedVertices{};
+	std::vector<GLuint> ownedIndices{};
+	std::shared_ptr<const CookedModel> cooked{};
+
+	std::span<const Renderer::Vertex> vertices() const;
+	std::span<const GLuint> indices() const;
+};
+
+// Uses the cooked package next to path if it is at least as new as path,
+// otherwise converts path with loadModel(). Makes no GL calls.
+StagedModel stageModel(const std::string& path, JobSystem* jobSystem = nullptr);
+
+// Maps a .glb file and converts geometry, skins, animation and images. Makes
+// no GL calls and is safe to run on several threads at once. Materials refer
+// to the staged textures appended to textures through
+// Material::baseColorTextureIndex. With a job system, images are decoded on
+// the pool while the calling thread converts geometry.
+Renderer::Mesh loadModel(const std::string& path, std::vector<Renderer::Vertex>& vertices,
+	std::vector<GLuint>& indices, std::vector<StagedTexture>& textures, JobSystem* jobSystem = nullptr);
+
+// Local transform of a node from its translation, rotation and scale
+glm::mat4 getNodeTransform(const nlohmann::json& node);
+
+// Appends one primitive's vertices and indices. Exposed for benchmarking.
+Renderer::Primitive loadPrimitive(const GlbFile& file, const nlohmann::json& primitive,
+	const glm::mat4& nodeTransform, std::vector<Renderer::Vertex>& vertices, std::vector<GLuint>& indices);
+
+// One capsule per joint around the vertices it moves the most, or none for
+// joints with too few, or with all of them on a line. Skinned primitives are
+// taken to have no transform of their own, as glTF requires. Runs on every
+// staged model, cooked or not.
+std::vector<Renderer::Hitbox> fitHitboxes(const Renderer::Mesh& mesh, std::span<const Renderer::Vertex> vertices,
+	std::span<const GLuint> indices);
+
+// Needs the GL context. Creates the staged textures and points the mesh's
+// materials at them. Returns the created textures so they can be deleted.
+std::vector<GLuint> uploadTextures(Renderer::Mesh& mesh, const std::vector<StagedTexture>& textures);
@@ -1,19 +1,36 @@
 #include "pipeline.hpp"
 
 #include "gl_utils.hpp"
+#include "../profiler/profiler.hpp"
 
 #include "glm/glm.hpp"
 #include "glm/gtc/type_ptr.hpp"
 
+#include <cstddef>
 #include <iostream>
 #include <string>
 #include <utility>
 #include <vector>
 
-Pipeline::Pipeline(const std::string& vertexShaderPath, const std::string& fragmentShaderPath)
+std::vector<std::string> shaderFeatureDefines(unsigned features)
 {
-	GLuint vertexShader{ compileShader(vertexShaderPath, GL_VERTEX_SHADER) };
-	GLuint fragmentShader{ compileShader(fragmentShaderPath, GL_FRAGMENT_SHADER) };
+	std::vector<std::string> defines{};
+
+	if (features & SHADER_SKINNED)   defines.push_back("SKINNED");
+	if (features & SHADER_TEXTURED)  defines.push_back("TEXTURED");
+	if (features & SHADER_INSTANCED) defines.push_back("INSTANCED");
+
+	return defines;
+}
+
+
+
+Pipeline::Pipeline(const std::string& vertexShaderPath, const std::string& fragmentShaderPath, unsigned features)
+{
+	const std::vector<std::string> defines{ shaderFeatureDefines(features) };
+
+	GLuint vertexShader{ compileShader(vertexShaderPath, GL_VERTEX_SHADER, defines) };
+	GLuint fragmentShader{ compileShader(fragmentShaderPath, GL_FRAGMENT_SHADER, defines) };
 
 	m_program = glCreateProgram();
 	glAttachShader(m_program, vertexShader);
@@ -35,6 +52,11 @@ Pipeline::Pipeline(const std::string& vertexShaderPath, const std::string& fragm
 	m_initialized = true;
 }
 
+Pipeline::Pipeline(GLuint program)
+	: m_program{ program }
+	, m_initialized{ true }
+{}
+
 Pipeline::Pipeline(Pipeline&& p) noexcept
 {
 	moveFrom(std::move(p));
@@ -63,24 +85,49 @@ void Pipeline::setUniformInt(const std::string& name, int value)
 {
 	GLint location{ glGetUniformLocation(m_program, name.c_str()) };
 	glUniform1i(location, value);
+	Profiler::count(Profiler::UNIFORM_UPLOADS);
+}
+
+void Pipeline::setUniformMat3(const std::string& name, const glm::mat3& value)
+{
+	GLint location{ glGetUniformLocation(m_program, name.c_str()) };
+	glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(value));
+	Profiler::count(Profiler::UNIFORM_UPLOADS);
 }
 
 void Pipeline::setUniformMat4(const std::string& name, const glm::mat4& value)
 {
 	GLint location{ glGetUniformLocation(m_program, name.c_str()) };
 	glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+	Profiler::count(Profiler::UNIFORM_UPLOADS);
 }
 
 void Pipeline::setUniformMat4Array(const std::string& name, const std::vector<glm::mat4>& matrices)
 {
 	GLint location{ glGetUniformLocation(m_program, name.c_str()) };
 	glUniformMatrix4fv(location, matrices.size(), GL_FALSE, glm::value_ptr(matrices[0]));
+	Profiler::count(Profiler::UNIFORM_UPLOADS);
+}
+
+void Pipeline::setUniformMat4Array(const std::string& name, const glm::mat4* matrices, std::size_t count)
+{
+	GLint location{ glGetUniformLocation(m_program, name.c_str()) };
+	glUniformMatrix4fv(location, static_cast<GLsizei>(count), GL_FALSE, glm::value_ptr(*matrices));
+	Profiler::count(Profiler::UNIFORM_UPLOADS);
 }
 
 void Pipeline::setUniformVec3(const std::string& name, const glm::vec3& value)
 {
 	GLint location{ glGetUniformLocation(m_program, name.c_str()) };
 	glUniform3fv(location, 1, glm::value_ptr(value));
+	Profiler::count(Profiler::UNIFORM_UPLOADS);
+}
+
+void Pipeline::setUniformVec4(const std::string& name, const glm::vec4& value)
+{
+	GLint location{ glGetUniformLocation(m_program, name.c_str()) };
+	glUniform4fv(location, 1, glm::value_ptr(value));
+	Profiler::count(Profiler::UNIFORM_UPLOADS);
 }
 
 
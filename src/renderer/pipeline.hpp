@@ -3,14 +3,34 @@
 #include "glad/glad.h"
 #include "glm/glm.hpp"
 
+#include <cstddef>
 #include <string>
 #include <vector>
 
+// Compile-time shader features. A pipeline is built for a combination of
+// these; each set bit is injected into both stages as a #define of the name
+// without the prefix, e.g. #define SKINNED.
+enum ShaderFeature : unsigned
+{
+	SHADER_SKINNED   = 1u << 0,
+	SHADER_TEXTURED  = 1u << 1,
+	SHADER_INSTANCED = 1u << 2,
+};
+
+// Number of feature combinations, for tables indexed by feature bits
+constexpr unsigned shaderVariantCount{ 1u << 3 };
+
+// The defines a feature combination injects, e.g. { "SKINNED", "TEXTURED" }
+std::vector<std::string> shaderFeatureDefines(unsigned features);
+
 class Pipeline final
 {
 public:
 	Pipeline() = default;
-	Pipeline(const std::string& vertexShaderPath, const std::string& fragmentShaderPath);
+	Pipeline(const std::string& vertexShaderPath, const std::string& fragmentShaderPath, unsigned features = 0);
+	// Takes ownership of a program linked (or still linking) elsewhere, e.g.
+	// by ProgramCache
+	explicit Pipeline(GLuint program);
 
 	Pipeline(const Pipeline&) = delete;
 	Pipeline& operator=(const Pipeline&) = delete;
@@ -23,9 +43,12 @@ public:
 	void bind();
 
 	void setUniformInt(const std::string& name, int value);
+	void setUniformMat3(const std::string& name, const glm::mat3& value);
 	void setUniformMat4(const std::string& name, const glm::mat4& value);
 	void setUniformMat4Array(const std::string& name, const std::vector<glm::mat4>& matrices);
+	void setUniformMat4Array(const std::string& name, const glm::mat4* matrices, std::size_t count);
 	void setUniformVec3(const std::string& name, const glm::vec3& value);
+	void setUniformVec4(const std::string& name, const glm::vec4& value);
 
 private:
 	GLuint m_program{};
@@ -0,0 +1,298 @@
+#include "program_cache.hpp"
+
+#include "gl_utils.hpp"
+#include "../profiler/profiler.hpp"
+
+#include "glad/glad.h"
+
+#include <algorithm> // for std::copy
+#include <cstddef>
+#include <cstdint>
+#include <cstdio> // for std::snprintf
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator> // for std::begin, std::end
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace
+{
+	// KHR_parallel_shader_compile (and its ARB twin) is not in the generated
+	// loader, so its one entry point is resolved here
+	using PFNGLMAXSHADERCOMPILERTHREADSKHRPROC_ = void (APIENTRYP)(GLuint count);
+
+	constexpr char binaryMagic[4]{ 'I', 'K', 'P', 'B' };
+
+	struct BinaryHeader
+	{
+		char magic[4]{};
+		std::uint32_t format{};
+		std::uint64_t key{};
+		std::uint32_t length{};
+		std::uint32_t padding{};
+	};
+
+	// FNV-1a, the keys only have to tell driver and source revisions apart
+	std::uint64_t hashBytes(std::uint64_t hash, const std::string& bytes)
+	{
+		for (unsigned char c : bytes)
+		{
+			hash ^= c;
+			hash *= 0x100000001b3ull;
+		}
+		// Separator, so "ab" + "c" and "a" + "bc" hash differently
+		hash ^= 0xff;
+		hash *= 0x100000001b3ull;
+		return hash;
+	}
+
+	bool hasExtension(const char* name)
+	{
+		GLint count{};
+		glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+		for (GLint i{ 0 }; i < count; ++i)
+		{
+			const char* extension{ reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i)) };
+			if (extension && std::string{ extension } == name)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	std::string glString(GLenum name)
+	{
+		const char* str{ reinterpret_cast<const char*>(glGetString(name)) };
+		return str ? str : "";
+	}
+
+	void printShaderLog(GLuint shader)
+	{
+		GLint success{};
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+		if (!success)
+		{
+			GLchar infoLog[1024]{};
+			glGetShaderInfoLog(shader, 1024, nullptr, infoLog);
+			std::cerr << infoLog << '\n';
+		}
+	}
+}
+
+
+
+ProgramCache::ProgramCache(const std::string& directory, GLADloadproc loadProc)
+	: m_directory{ directory }
+	, m_driver{ glString(GL_VENDOR) + '\n' + glString(GL_RENDERER) + '\n' + glString(GL_VERSION) }
+{
+	GLint formatCount{};
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+	m_binariesSupported = formatCount > 0;
+
+	if (!m_directory.empty() && m_binariesSupported)
+	{
+		std::error_code error{};
+		std::filesystem::create_directories(m_directory, error);
+		if (error)
+		{
+			std::cerr << "PROGRAM CACHE: ERROR: Could not create " << m_directory << ": " << error.message() << '\n';
+			m_directory.clear();
+		}
+	}
+
+	if (hasExtension("GL_KHR_parallel_shader_compile") || hasExtension("GL_ARB_parallel_shader_compile"))
+	{
+		void* proc{ loadProc("glMaxShaderCompilerThreadsKHR") };
+		if (!proc)
+		{
+			proc = loadProc("glMaxShaderCompilerThreadsARB");
+		}
+		if (proc)
+		{
+			// All threads the driver is willing to use
+			reinterpret_cast<PFNGLMAXSHADERCOMPILERTHREADSKHRPROC_>(proc)(0xFFFFFFFF);
+		}
+	}
+}
+
+Pipeline ProgramCache::request(const std::string& vertexShaderPath, const std::string& fragmentShaderPath, unsigned features)
+{
+	PROFILE_ZONE("Request program");
+
+	const std::vector<std::string> defines{ shaderFeatureDefines(features) };
+	const std::string vertexSource{ loadShaderSource(vertexShaderPath, defines) };
+	const std::string fragmentSource{ loadShaderSource(fragmentShaderPath, defines) };
+
+	std::uint64_t key{ 0xcbf29ce484222325ull };
+	key = hashBytes(key, m_driver);
+	key = hashBytes(key, vertexSource);
+	key = hashBytes(key, fragmentSource);
+
+	GLuint program{ glCreateProgram() };
+
+	if (loadBinary(program, key))
+	{
+		return Pipeline{ program };
+	}
+
+	const char* vertexCStr{ vertexSource.c_str() };
+	const char* fragmentCStr{ fragmentSource.c_str() };
+
+	GLuint vertexShader{ glCreateShader(GL_VERTEX_SHADER) };
+	glShaderSource(vertexShader, 1, &vertexCStr, nullptr);
+	glCompileShader(vertexShader);
+
+	GLuint fragmentShader{ glCreateShader(GL_FRAGMENT_SHADER) };
+	glShaderSource(fragmentShader, 1, &fragmentCStr, nullptr);
+	glCompileShader(fragmentShader);
+
+	// No status queries until finish(), any of them would wait for the
+	// driver's compiler threads
+	if (m_binariesSupported && !m_directory.empty())
+	{
+		glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+	glAttachShader(program, vertexShader);
+	glAttachShader(program, fragmentShader);
+	glLinkProgram(program);
+
+	m_pending.push_back(PendingProgram{ program, vertexShader, fragmentShader, key });
+
+	return Pipeline{ program };
+}
+
+void ProgramCache::finish()
+{
+	PROFILE_ZONE("Finish programs");
+
+	for (const PendingProgram& pending : m_pending)
+	{
+		GLint success{};
+		glGetProgramiv(pending.program, GL_LINK_STATUS, &success);
+		if (success)
+		{
+			storeBinary(pending.program, pending.key);
+		}
+		else
+		{
+			printShaderLog(pending.vertexShader);
+			printShaderLog(pending.fragmentShader);
+
+			GLchar infoLog[1024]{};
+			glGetProgramInfoLog(pending.program, 1024, nullptr, infoLog);
+			std::cerr << infoLog << '\n';
+		}
+
+		glDeleteShader(pending.vertexShader);
+		glDeleteShader(pending.fragmentShader);
+	}
+
+	m_pending.clear();
+}
+
+
+
+std::string ProgramCache::binaryPath(std::uint64_t key) const
+{
+	char name[32]{};
+	std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+	return (std::filesystem::path{ m_directory } / name).string();
+}
+
+bool ProgramCache::loadBinary(GLuint program, std::uint64_t key) const
+{
+	if (m_directory.empty() || !m_binariesSupported)
+	{
+		return false;
+	}
+
+	std::ifstream inputStream{ binaryPath(key), std::ios::binary };
+	if (!inputStream)
+	{
+		return false;
+	}
+
+	BinaryHeader header{};
+	inputStream.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (!inputStream || std::string(header.magic, 4) != std::string(binaryMagic, 4) || header.key != key)
+	{
+		return false;
+	}
+
+	// Same as FileCache: a length that disagrees with the file is a miss,
+	// not an allocation of whatever the corrupt header asks for
+	const std::streamoff dataStart{ inputStream.tellg() };
+	inputStream.seekg(0, std::ios::end);
+	const std::streamoff dataLength{ inputStream.tellg() - dataStart };
+	if (!inputStream || dataLength < 0 || header.length != static_cast<std::uint64_t>(dataLength))
+	{
+		return false;
+	}
+	inputStream.seekg(dataStart);
+
+	std::vector<char> binary(header.length);
+	inputStream.read(binary.data(), static_cast<std::streamsize>(binary.size()));
+	if (!inputStream)
+	{
+		return false;
+	}
+
+	glProgramBinary(program, header.format, binary.data(), static_cast<GLsizei>(binary.size()));
+
+	// Drivers reject binaries they no longer understand through the link
+	// status; the program is then rebuilt from source and the file replaced
+	GLint success{};
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	return success != GL_FALSE;
+}
+
+void ProgramCache::storeBinary(GLuint program, std::uint64_t key) const
+{
+	if (m_directory.empty() || !m_binariesSupported)
+	{
+		return;
+	}
+
+	GLint length{};
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+	{
+		return;
+	}
+
+	std::vector<char> binary(static_cast<std::size_t>(length));
+	GLenum format{};
+	glGetProgramBinary(program, length, &length, &format, binary.data());
+
+	BinaryHeader header{};
+	std::copy(std::begin(binaryMagic), std::end(binaryMagic), header.magic);
+	header.format = format;
+	header.key = key;
+	header.length = static_cast<std::uint32_t>(length);
+
+	// Written next to the final name and renamed, so another instance
+	// starting at the same time never reads half a file
+	const std::string path{ binaryPath(key) };
+	const std::string temporaryPath{ path + ".tmp" };
+	{
+		std::ofstream outputStream{ temporaryPath, std::ios::binary | std::ios::trunc };
+		outputStream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		outputStream.write(binary.data(), length);
+		if (!outputStream)
+		{
+			std::cerr << "PROGRAM CACHE: ERROR: Could not write " << temporaryPath << '\n';
+			return;
+		}
+	}
+
+	std::error_code error{};
+	std::filesystem::rename(temporaryPath, path, error);
+	if (error)
+	{
+		std::cerr << "PROGRAM CACHE: ERROR: Could not write " << path << ": " << error.message() << '\n';
+		std::filesystem::remove(temporaryPath, error);
+	}
+}
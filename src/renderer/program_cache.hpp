@@ -0,0 +1,59 @@
+#pragma once
+
+#include "pipeline.hpp"
+
+#include "glad/glad.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Builds pipelines, reusing program binaries from earlier runs. Binaries are
+// keyed by a hash of the final shader sources (defines included) and the GL
+// vendor, renderer and version strings, so editing a shader or updating the
+// driver misses the cache instead of loading a stale binary.
+//
+// request() only starts the work: cached binaries are loaded right away and
+// everything else is compiled and linked without checking the result, which
+// lets drivers with KHR_parallel_shader_compile build all programs on their
+// own threads at once. finish() waits for the links, reports errors and
+// stores the new binaries.
+class ProgramCache final
+{
+public:
+
+	// An empty directory disables the on-disk part; programs are then still
+	// compiled in parallel
+	ProgramCache(const std::string& directory, GLADloadproc loadProc);
+
+	ProgramCache(const ProgramCache&) = delete;
+	ProgramCache& operator=(const ProgramCache&) = delete;
+
+	// The pipeline must not be used before finish()
+	Pipeline request(const std::string& vertexShaderPath, const std::string& fragmentShaderPath, unsigned features = 0);
+
+	void finish();
+
+private:
+
+	struct PendingProgram
+	{
+		GLuint program{};
+		GLuint vertexShader{};
+		GLuint fragmentShader{};
+		std::uint64_t key{};
+	};
+
+	std::string m_directory{};
+	// Vendor, renderer and version, part of every key
+	std::string m_driver{};
+
+	bool m_binariesSupported{ false };
+
+	std::vector<PendingProgram> m_pending{};
+
+	std::string binaryPath(std::uint64_t key) const;
+
+	bool loadBinary(GLuint program, std::uint64_t key) const;
+	void storeBinary(GLuint program, std::uint64_t key) const;
+};
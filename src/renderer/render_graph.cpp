@@ -0,0 +1,465 @@
+#include "render_graph.hpp"
+
+#include "gl_resource_tracker.hpp"
+#include "gpu_timer.hpp"
+#include "../memory/frame_arena.hpp"
+#include "../profiler/profiler.hpp"
+
+#include "glad/glad.h"
+
+#include <algorithm> // for std::find, std::max
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <utility> // for std::move
+#include <vector>
+
+namespace
+{
+	GLenum attachmentPoint(GLenum format)
+	{
+		switch (format)
+		{
+		case GL_DEPTH_COMPONENT16:
+		case GL_DEPTH_COMPONENT24:
+		case GL_DEPTH_COMPONENT32:
+		case GL_DEPTH_COMPONENT32F:
+			return GL_DEPTH_ATTACHMENT;
+		case GL_DEPTH24_STENCIL8:
+		case GL_DEPTH32F_STENCIL8:
+			return GL_DEPTH_STENCIL_ATTACHMENT;
+		default:
+			return GL_COLOR_ATTACHMENT0;
+		}
+	}
+
+	void addUnique(std::vector<int>& list, int value)
+	{
+		if (std::find(list.begin(), list.end(), value) == list.end())
+		{
+			list.push_back(value);
+		}
+	}
+}
+
+
+
+RenderGraph::Resource RenderGraph::Builder::create(const std::string& name, const TextureDesc& desc)
+{
+	m_graph.m_resources.push_back(ResourceNode{ .name{ name }, .desc{ desc } });
+	return Resource{ static_cast<int>(m_graph.m_resources.size()) - 1 };
+}
+
+RenderGraph::Resource RenderGraph::Builder::read(Resource resource)
+{
+	addUnique(m_graph.m_passes[m_pass].reads, resource.index);
+	addUnique(m_graph.m_resources[resource.index].readers, m_pass);
+	return resource;
+}
+
+RenderGraph::Resource RenderGraph::Builder::write(Resource resource)
+{
+	addUnique(m_graph.m_passes[m_pass].writes, resource.index);
+	addUnique(m_graph.m_resources[resource.index].writers, m_pass);
+	return resource;
+}
+
+void RenderGraph::Builder::setSideEffect()
+{
+	m_graph.m_passes[m_pass].sideEffect = true;
+}
+
+
+
+GLuint RenderGraph::Context::texture(Resource resource) const
+{
+	const ResourceNode& node{ m_graph.m_resources[resource.index] };
+	return node.texture >= 0 ? m_graph.m_pool[node.texture].texture : 0;
+}
+
+GLuint RenderGraph::Context::readFramebuffer(Resource resource) const
+{
+	return m_graph.framebufferFor({ resource.index });
+}
+
+
+
+void RenderGraph::reset()
+{
+	m_passes.clear();
+	m_resources.clear();
+	m_order.clear();
+	m_texturesInUse = 0;
+}
+
+RenderGraph::Resource RenderGraph::importFramebuffer(const std::string& name, GLuint framebuffer)
+{
+	m_resources.push_back(ResourceNode{ .name{ name }, .imported{ true }, .importedFramebuffer{ framebuffer } });
+	return Resource{ static_cast<int>(m_resources.size()) - 1 };
+}
+
+void RenderGraph::addPass(const char* name, const Setup& setup, Execute execute)
+{
+	m_passes.push_back(PassNode{ .name{ name }, .execute{ std::move(execute) } });
+
+	Builder builder{ *this, static_cast<int>(m_passes.size()) - 1 };
+	setup(builder);
+}
+
+void RenderGraph::compile()
+{
+	PROFILE_ZONE("Compile render graph");
+
+	++m_frame;
+
+	// The passes' bookkeeping is scratch from the frame arena
+	FrameArenaScope scratch{};
+	cullPasses();
+	orderPasses();
+	assignTextures();
+}
+
+void RenderGraph::execute(GpuTimer* gpuTimer)
+{
+	PROFILE_ZONE("Execute render graph");
+
+	for (int passIndex : m_order)
+	{
+		PassNode& pass{ m_passes[passIndex] };
+
+		const GLuint framebuffer{ pass.writes.empty() ? 0 : framebufferFor(pass.writes) };
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+		Context context{ *this, framebuffer };
+		if (gpuTimer)
+		{
+			GpuTimer::ScopedZone gpuZone{ *gpuTimer, pass.name };
+			pass.execute(context);
+		}
+		else
+		{
+			pass.execute(context);
+		}
+	}
+}
+
+void RenderGraph::cleanup()
+{
+	for (const auto& [attachments, framebuffer] : m_framebuffers)
+	{
+		glDeleteFramebuffers(1, &framebuffer);
+	}
+	m_framebuffers.clear();
+
+	for (const PooledTexture& texture : m_pool)
+	{
+		glDeleteTextures(1, &texture.texture);
+		GlResourceTracker::releaseTexture(texture.texture);
+	}
+	m_pool.clear();
+
+	reset();
+}
+
+
+
+void RenderGraph::cullPasses()
+{
+	// Walk backwards from the passes with visible results: anything writing
+	// an imported target or flagged as a side effect, then every writer of
+	// whatever a live pass reads
+	FrameVector<int> stack{};
+	for (int i{ 0 }; i < static_cast<int>(m_passes.size()); ++i)
+	{
+		PassNode& pass{ m_passes[i] };
+		pass.alive = pass.sideEffect;
+		for (int resource : pass.writes)
+		{
+			pass.alive = pass.alive || m_resources[resource].imported;
+		}
+
+		if (pass.alive)
+		{
+			stack.push_back(i);
+		}
+	}
+
+	while (!stack.empty())
+	{
+		const int passIndex{ stack.back() };
+		stack.pop_back();
+
+		for (int resource : m_passes[passIndex].reads)
+		{
+			for (int writer : m_resources[resource].writers)
+			{
+				if (!m_passes[writer].alive)
+				{
+					m_passes[writer].alive = true;
+					stack.push_back(writer);
+				}
+			}
+		}
+	}
+}
+
+void RenderGraph::orderPasses()
+{
+	// Writers of a target run in declaration order, and all of them before
+	// any pass that only reads it. Passes may be declared in any order as
+	// long as that is consistent; ties keep declaration order.
+	const std::size_t passCount{ m_passes.size() };
+	FrameVector<FrameVector<int>> successors(passCount);
+	FrameVector<int> predecessorCounts(passCount);
+
+	const auto addEdge{ [&](int from, int to) {
+		if (from != to && m_passes[from].alive && m_passes[to].alive)
+		{
+			successors[from].push_back(to);
+			++predecessorCounts[to];
+		}
+		} };
+
+	for (const ResourceNode& resource : m_resources)
+	{
+		for (std::size_t i{ 1 }; i < resource.writers.size(); ++i)
+		{
+			addEdge(resource.writers[i - 1], resource.writers[i]);
+		}
+
+		for (int reader : resource.readers)
+		{
+			if (std::find(resource.writers.begin(), resource.writers.end(), reader) != resource.writers.end())
+			{
+				continue;
+			}
+
+			for (int writer : resource.writers)
+			{
+				addEdge(writer, reader);
+			}
+		}
+	}
+
+	// Kahn's algorithm, always taking the earliest declared ready pass
+	m_order.clear();
+	FrameVector<bool> scheduled(passCount);
+	for (std::size_t step{ 0 }; step < passCount; ++step)
+	{
+		int next{ -1 };
+		for (int i{ 0 }; i < static_cast<int>(passCount); ++i)
+		{
+			if (m_passes[i].alive && !scheduled[i] && predecessorCounts[i] == 0)
+			{
+				next = i;
+				break;
+			}
+		}
+
+		if (next < 0)
+		{
+			break;
+		}
+
+		scheduled[next] = true;
+		m_order.push_back(next);
+		for (int successor : successors[next])
+		{
+			--predecessorCounts[successor];
+		}
+	}
+
+	for (int i{ 0 }; i < static_cast<int>(passCount); ++i)
+	{
+		if (m_passes[i].alive && !scheduled[i])
+		{
+			std::cerr << "RENDER GRAPH: ERROR: Pass " << m_passes[i].name
+				<< " is part of a dependency cycle and is skipped\n";
+		}
+	}
+}
+
+void RenderGraph::assignTextures()
+{
+	// Lifetime of every transient target, in positions of m_order
+	FrameVector<int> firstUse(m_resources.size(), -1);
+	FrameVector<int> lastUse(m_resources.size(), -1);
+	for (int position{ 0 }; position < static_cast<int>(m_order.size()); ++position)
+	{
+		const PassNode& pass{ m_passes[m_order[position]] };
+		for (const std::vector<int>* resources : { &pass.reads, &pass.writes })
+		{
+			for (int resource : *resources)
+			{
+				if (firstUse[resource] < 0)
+				{
+					firstUse[resource] = position;
+				}
+				lastUse[resource] = std::max(lastUse[resource], position);
+			}
+		}
+	}
+
+	// A pooled texture is free again after the last use of whichever target
+	// holds it, so later targets with the same description share it
+	FrameVector<int> busyUntil(m_pool.size(), -1);
+	m_texturesInUse = 0;
+
+	for (int position{ 0 }; position < static_cast<int>(m_order.size()); ++position)
+	{
+		for (int resourceIndex{ 0 }; resourceIndex < static_cast<int>(m_resources.size()); ++resourceIndex)
+		{
+			ResourceNode& resource{ m_resources[resourceIndex] };
+			if (resource.imported || firstUse[resourceIndex] != position)
+			{
+				continue;
+			}
+
+			int texture{ -1 };
+			for (int i{ 0 }; i < static_cast<int>(m_pool.size()); ++i)
+			{
+				if (m_pool[i].desc == resource.desc && busyUntil[i] < position)
+				{
+					texture = i;
+					break;
+				}
+			}
+
+			if (texture < 0)
+			{
+				PooledTexture pooled{ .desc{ resource.desc } };
+				if (resource.desc.samples > 1)
+				{
+					glCreateTextures(GL_TEXTURE_2D_MULTISAMPLE, 1, &pooled.texture);
+					glTextureStorage2DMultisample(pooled.texture, resource.desc.samples, resource.desc.format,
+						resource.desc.width, resource.desc.height, GL_TRUE);
+				}
+				else
+				{
+					glCreateTextures(GL_TEXTURE_2D, 1, &pooled.texture);
+					glTextureStorage2D(pooled.texture, 1, resource.desc.format, resource.desc.width, resource.desc.height);
+					glTextureParameteri(pooled.texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+					glTextureParameteri(pooled.texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+					glTextureParameteri(pooled.texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+					glTextureParameteri(pooled.texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+				}
+				GlResourceTracker::trackTexture(pooled.texture, resource.desc.format, resource.desc.width,
+					resource.desc.height, 1, resource.desc.samples);
+
+				m_pool.push_back(pooled);
+				busyUntil.push_back(-1);
+				texture = static_cast<int>(m_pool.size()) - 1;
+			}
+
+			if (busyUntil[texture] < 0)
+			{
+				++m_texturesInUse;
+			}
+
+			resource.texture = texture;
+			busyUntil[texture] = lastUse[resourceIndex];
+			m_pool[texture].lastUsedFrame = m_frame;
+		}
+	}
+
+	// Drop textures nobody asked for lately, along with their framebuffers
+	bool released{ false };
+	for (std::size_t i{ m_pool.size() }; i-- > 0;)
+	{
+		if (m_frame - m_pool[i].lastUsedFrame > textureRetainFrames)
+		{
+			glDeleteTextures(1, &m_pool[i].texture);
+			GlResourceTracker::releaseTexture(m_pool[i].texture);
+			m_pool.erase(m_pool.begin() + i);
+			released = true;
+
+			for (ResourceNode& resource : m_resources)
+			{
+				if (resource.texture > static_cast<int>(i))
+				{
+					--resource.texture;
+				}
+			}
+		}
+	}
+
+	if (released)
+	{
+		for (const auto& [attachments, framebuffer] : m_framebuffers)
+		{
+			glDeleteFramebuffers(1, &framebuffer);
+		}
+		m_framebuffers.clear();
+	}
+}
+
+GLuint RenderGraph::framebufferFor(const std::vector<int>& resources)
+{
+	// A pass writing to an imported framebuffer draws into that one
+	for (int resource : resources)
+	{
+		if (m_resources[resource].imported)
+		{
+			return m_resources[resource].importedFramebuffer;
+		}
+	}
+
+	std::vector<GLuint> key{ 0 };
+	for (int resource : resources)
+	{
+		const ResourceNode& node{ m_resources[resource] };
+		const GLuint texture{ node.texture >= 0 ? m_pool[node.texture].texture : 0 };
+		if (attachmentPoint(node.desc.format) == GL_COLOR_ATTACHMENT0)
+		{
+			key.push_back(texture);
+		}
+		else
+		{
+			key[0] = texture;
+		}
+	}
+
+	auto found{ m_framebuffers.find(key) };
+	if (found != m_framebuffers.end())
+	{
+		return found->second;
+	}
+
+	GLuint framebuffer{};
+	glCreateFramebuffers(1, &framebuffer);
+
+	std::vector<GLenum> drawBuffers{};
+	for (int resource : resources)
+	{
+		const ResourceNode& node{ m_resources[resource] };
+		const GLuint texture{ node.texture >= 0 ? m_pool[node.texture].texture : 0 };
+
+		GLenum attachment{ attachmentPoint(node.desc.format) };
+		if (attachment == GL_COLOR_ATTACHMENT0)
+		{
+			attachment = static_cast<GLenum>(GL_COLOR_ATTACHMENT0 + drawBuffers.size());
+			drawBuffers.push_back(attachment);
+		}
+
+		glNamedFramebufferTexture(framebuffer, attachment, texture, 0);
+	}
+
+	if (drawBuffers.empty())
+	{
+		glNamedFramebufferDrawBuffer(framebuffer, GL_NONE);
+		glNamedFramebufferReadBuffer(framebuffer, GL_NONE);
+	}
+	else
+	{
+		glNamedFramebufferDrawBuffers(framebuffer, static_cast<GLsizei>(drawBuffers.size()), drawBuffers.data());
+	}
+
+	if (glCheckNamedFramebufferStatus(framebuffer, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cerr << "RENDER GRAPH: ERROR: Incomplete framebuffer for " << m_resources[resources.front()].name << '\n';
+	}
+
+	m_framebuffers.emplace(std::move(key), framebuffer);
+	return framebuffer;
+}
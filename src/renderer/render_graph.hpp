@@ -0,0 +1,204 @@
+#pragma once
+
+#include "gpu_timer.hpp"
+
+#include "glad/glad.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional> // for std::function
+#include <map>
+#include <string>
+#include <vector>
+
+// Frame graph. Every frame the renderer declares its passes along with the
+// render targets they create, read and write. compile() then
+// - culls passes whose results nothing reads,
+// - orders the rest so every target is written before it is read, and
+// - gives each transient target a texture from a pool, handing one texture
+//   to several targets of the same kind whose lifetimes don't overlap.
+// execute() runs the passes with a framebuffer for their outputs bound.
+//
+// Textures and framebuffers are kept across frames, so a graph that looks
+// the same every frame allocates nothing after the first one.
+class RenderGraph final
+{
+public:
+
+	struct TextureDesc
+	{
+		GLsizei width{};
+		GLsizei height{};
+		GLenum format{ GL_RGBA8 };
+		// More than 1 creates a multisampled texture
+		GLsizei samples{ 1 };
+
+		bool operator==(const TextureDesc&) const = default;
+	};
+
+	// Refers to a target of the graph being built, until the next reset()
+	struct Resource
+	{
+		int index{ -1 };
+
+		bool valid() const
+		{
+			return index >= 0;
+		}
+	};
+
+	class Builder final
+	{
+	public:
+
+		// A transient target, only alive between its first and last use
+		Resource create(const std::string& name, const TextureDesc& desc);
+
+		Resource read(Resource resource);
+		Resource write(Resource resource);
+
+		// Keeps the pass even if nothing reads what it writes
+		void setSideEffect();
+
+	private:
+
+		friend class RenderGraph;
+
+		Builder(RenderGraph& graph, int pass)
+			: m_graph{ graph }
+			, m_pass{ pass }
+		{}
+
+		RenderGraph& m_graph;
+		int m_pass{};
+	};
+
+	class Context final
+	{
+	public:
+
+		GLuint texture(Resource resource) const;
+
+		// Framebuffer with just this target attached, e.g. as a blit source
+		GLuint readFramebuffer(Resource resource) const;
+
+		// Framebuffer with the pass's outputs attached. Already bound when
+		// the pass runs.
+		GLuint framebuffer() const
+		{
+			return m_framebuffer;
+		}
+
+	private:
+
+		friend class RenderGraph;
+
+		Context(RenderGraph& graph, GLuint framebuffer)
+			: m_graph{ graph }
+			, m_framebuffer{ framebuffer }
+		{}
+
+		RenderGraph& m_graph;
+		GLuint m_framebuffer{};
+	};
+
+	using Setup = std::function<void(Builder&)>;
+	using Execute = std::function<void(Context&)>;
+
+	RenderGraph() = default;
+	~RenderGraph() = default;
+
+	RenderGraph(const RenderGraph&) = delete;
+	RenderGraph& operator=(const RenderGraph&) = delete;
+
+	// Forgets the previous frame's passes and targets; pooled textures stay
+	void reset();
+
+	// An existing framebuffer, e.g. the window's. Passes writing to it are
+	// never culled.
+	Resource importFramebuffer(const std::string& name, GLuint framebuffer);
+
+	// setup runs right away and declares the pass's targets. execute runs
+	// in execute(), if the pass survives culling.
+	void addPass(const char* name, const Setup& setup, Execute execute);
+
+	void compile();
+
+	// Each pass gets a GPU timer zone under its name when a timer is given
+	void execute(GpuTimer* gpuTimer = nullptr);
+
+	// Deletes every pooled texture and framebuffer. Needs the context.
+	void cleanup();
+
+	// Valid after compile()
+	std::size_t executedPassCount() const
+	{
+		return m_order.size();
+	}
+
+	// Textures the current frame's transient targets were packed into
+	std::size_t textureCount() const
+	{
+		return m_texturesInUse;
+	}
+
+private:
+
+	// Textures unused for this many frames are deleted, so resizes don't
+	// leave every old size behind
+	static constexpr std::uint64_t textureRetainFrames{ 3 };
+
+	struct ResourceNode
+	{
+		std::string name{};
+		TextureDesc desc{};
+
+		bool imported{ false };
+		GLuint importedFramebuffer{};
+
+		// Passes in declaration order
+		std::vector<int> writers{};
+		std::vector<int> readers{};
+
+		// Index into m_pool, for transient targets of the compiled graph
+		int texture{ -1 };
+	};
+
+	struct PassNode
+	{
+		const char* name{};
+		Execute execute{};
+
+		std::vector<int> reads{};
+		std::vector<int> writes{};
+
+		bool sideEffect{ false };
+		bool alive{ false };
+	};
+
+	struct PooledTexture
+	{
+		TextureDesc desc{};
+		GLuint texture{};
+		std::uint64_t lastUsedFrame{};
+	};
+
+	std::vector<PassNode> m_passes{};
+	std::vector<ResourceNode> m_resources{};
+
+	// Surviving passes in execution order
+	std::vector<int> m_order{};
+
+	std::vector<PooledTexture> m_pool{};
+	std::size_t m_texturesInUse{};
+	std::uint64_t m_frame{};
+
+	// Keyed by the attached textures, depth (or 0) first
+	std::map<std::vector<GLuint>, GLuint> m_framebuffers{};
+
+	void cullPasses();
+	void orderPasses();
+	void assignTextures();
+
+	GLuint framebufferFor(const std::vector<int>& resources);
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "light_clusters.hpp"
+#include "resource_pool.hpp"
+
+#include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+
+#include <cstddef>
+#include <vector>
+
+// Everything the render thread needs to draw one frame. The simulation fills
+// a snapshot, publishes it, and never touches it again until it is handed
+// back as a free slot, so the render thread can read it without locking.
+struct RenderSnapshot
+{
+	struct Draw
+	{
+		MeshHandle mesh{};
+		glm::mat4 transform{ 1.0f };
+
+		// Range into RenderSnapshot::palettes. A count of 0 means the mesh
+		// is drawn unskinned.
+		std::size_t paletteOffset{};
+		std::size_t paletteCount{};
+	};
+
+	// One mesh drawn at many transforms, all sharing a palette
+	struct InstancedDraw
+	{
+		MeshHandle mesh{};
+
+		// Range into RenderSnapshot::instanceTransforms
+		std::size_t transformOffset{};
+		std::size_t transformCount{};
+
+		std::size_t paletteOffset{};
+		std::size_t paletteCount{};
+	};
+
+	glm::vec3 cameraPosition{};
+	glm::vec3 cameraLook{ 0.0f, 0.0f, -1.0f };
+
+	float fieldOfView{ 90.0f };
+	float aspectRatio{ 16.0f / 9.0f };
+	float nearPlane{ 0.1f };
+	float farPlane{ 500.0f };
+
+	glm::vec3 lightColor{ 1.0f };
+
+	std::vector<Draw> draws{};
+	std::vector<InstancedDraw> instancedDraws{};
+	std::vector<glm::mat4> instanceTransforms{};
+	std::vector<glm::mat4> palettes{};
+
+	// Filled by the simulation, then binned with assignLights() before the
+	// snapshot is published
+	std::vector<PointLight> lights{};
+	LightClusters lightClusters{};
+
+	// Same view as Renderer::beginRendering() builds
+	glm::mat4 viewMatrix() const
+	{
+		return glm::lookAt(cameraPosition, cameraPosition + cameraLook, glm::vec3{ 0.0f, 1.0f, 0.0f });
+	}
+
+	// Slots are reused every frame, so keep the allocations around
+	void clear()
+	{
+		draws.clear();
+		instancedDraws.clear();
+		instanceTransforms.clear();
+		palettes.clear();
+		lights.clear();
+	}
+};
@@ -0,0 +1,107 @@
+#include "render_thread.hpp"
+
+#include "render_snapshot.hpp"
+#include "renderer.hpp"
+#include "../memory/frame_arena.hpp"
+#include "../memory/memory_tracker.hpp"
+#include "../profiler/profiler.hpp"
+
+#define SDL_MAIN_HANDLED
+#include "SDL/SDL.h"
+
+#include <mutex>
+#include <thread>
+#include <utility> // for std::swap
+
+RenderThread::RenderThread(SDL_Window* window, SDL_GLContext glContext, Renderer& renderer)
+	: m_window{ window }
+	, m_glContext{ glContext }
+	, m_renderer{ renderer }
+{
+	SDL_GL_MakeCurrent(m_window, nullptr);
+
+	m_thread = std::thread{ &RenderThread::run, this };
+}
+
+RenderThread::~RenderThread()
+{
+	stop();
+}
+
+
+
+RenderSnapshot& RenderThread::beginSnapshot()
+{
+	// m_writeSlot is only ever changed by this thread, so no lock is needed
+	RenderSnapshot& snapshot{ m_snapshots[m_writeSlot] };
+	snapshot.clear();
+
+	return snapshot;
+}
+
+void RenderThread::publishSnapshot()
+{
+	{
+		std::lock_guard lock{ m_mutex };
+		std::swap(m_writeSlot, m_readySlot);
+		m_snapshotReady = true;
+	}
+
+	m_condition.notify_one();
+}
+
+void RenderThread::stop()
+{
+	if (!m_thread.joinable())
+	{
+		return;
+	}
+
+	{
+		std::lock_guard lock{ m_mutex };
+		m_quit = true;
+	}
+	m_condition.notify_one();
+
+	m_thread.join();
+
+	SDL_GL_MakeCurrent(m_window, m_glContext);
+}
+
+
+
+void RenderThread::run()
+{
+	SDL_GL_MakeCurrent(m_window, m_glContext);
+	Profiler::setThreadName("Render");
+	MemoryTracker::Scope memoryScope{ MemoryTracker::RENDERER };
+
+	while (true)
+	{
+		{
+			std::unique_lock lock{ m_mutex };
+			m_condition.wait(lock, [this]() { return m_snapshotReady || m_quit; });
+
+			if (m_quit)
+			{
+				break;
+			}
+
+			std::swap(m_readSlot, m_readySlot);
+			m_snapshotReady = false;
+		}
+
+		m_renderer.setViewport(m_window);
+		m_renderer.renderSnapshot(m_snapshots[m_readSlot]);
+
+		{
+			PROFILE_ZONE("Swap");
+			SDL_GL_SwapWindow(m_window);
+		}
+
+		Profiler::endFrame();
+		FrameArena::local().reset();
+	}
+
+	SDL_GL_MakeCurrent(m_window, nullptr);
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "render_snapshot.hpp"
+#include "renderer.hpp"
+
+#define SDL_MAIN_HANDLED
+#include "SDL/SDL.h"
+
+#include <array>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Owns the GL context on a dedicated thread and draws whatever snapshot the
+// simulation published most recently. Snapshots are triple buffered: the
+// simulation writes one slot, the render thread reads another, and the third
+// holds the newest finished snapshot, so neither side ever waits on the other.
+// Stale snapshots are simply overwritten.
+class RenderThread final
+{
+public:
+
+	// Must be called on the thread the context is current on. The context
+	// is released here and made current on the render thread.
+	RenderThread(SDL_Window* window, SDL_GLContext glContext, Renderer& renderer);
+
+	~RenderThread();
+
+	RenderThread(const RenderThread&) = delete;
+	RenderThread& operator=(const RenderThread&) = delete;
+
+	// The slot returned here belongs to the caller until publishSnapshot()
+	RenderSnapshot& beginSnapshot();
+	void publishSnapshot();
+
+	// Joins the render thread and makes the GL context current on the
+	// calling thread again, so GL resources can be cleaned up there.
+	void stop();
+
+private:
+
+	SDL_Window* m_window{};
+	SDL_GLContext m_glContext{};
+	Renderer& m_renderer;
+
+	std::array<RenderSnapshot, 3> m_snapshots{};
+	int m_writeSlot{ 0 };
+	int m_readySlot{ 1 };
+	int m_readSlot{ 2 };
+	bool m_snapshotReady{ false };
+
+	bool m_quit{ false };
+
+	std::mutex m_mutex{};
+	std::condition_variable m_condition{};
+
+	std::thread m_thread{};
+
+	void run();
+};
@@ -1,7 +1,13 @@
 #include "renderer.hpp"
 
+#include "animation.hpp"
+#include "gl_resource_tracker.hpp"
 #include "gl_utils.hpp"
 #include "model_loader.hpp"
+#include "program_cache.hpp"
+#include "../jobs/job_system.hpp"
+#include "../memory/memory_tracker.hpp"
+#include "../profiler/profiler.hpp"
 
 #include "glad/glad.h"
 #include "glm/glm.hpp"
@@ -10,42 +16,100 @@
 #define SDL_MAIN_HANDLED
 #include "SDL.h"
 
-#include <exception>
-#include <string> // Todo: consider using string_view for renderMesh() parameter
+#include <algorithm> // for std::clamp, std::max
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <utility> // for std::move
+#include <string>
 #include <vector>
 
 
 
-void Renderer::init()
+void Renderer::init(const std::string& programCacheDirectory)
 {
-	if (!gladLoadGLLoader(SDL_GL_GetProcAddress))
+	init(SDL_GL_GetProcAddress, programCacheDirectory);
+}
+
+void Renderer::init(GLADloadproc loadProc, const std::string& programCacheDirectory)
+{
+	MemoryTracker::Scope memoryScope{ MemoryTracker::RENDERER };
+
+	if (!gladLoadGLLoader(loadProc))
 	{
-		throw std::exception{ "failure loading OpenGL functions" };
+		throw std::runtime_error{ "failure loading OpenGL functions" };
 	}
 
 	glEnable(GL_DEBUG_OUTPUT);
 	glDebugMessageCallback(debugMessageCallback, nullptr);
 	glDebugMessageControl(GL_DONT_CARE, GL_DEBUG_TYPE_OTHER, GL_DONT_CARE, 0, nullptr, GL_FALSE);
 
-	m_uberPipeline = Pipeline{ "src/shaders/uber.vert", "src/shaders/uber.frag" };
+	// All variants are requested before any is waited on, so uncached ones
+	// compile in parallel where the driver supports it
+	ProgramCache programCache{ programCacheDirectory, loadProc };
+	for (unsigned features{ 0 }; features < shaderVariantCount; ++features)
+	{
+		m_uberPipelines[features] = programCache.request("src/shaders/uber.vert", "src/shaders/uber.frag", features);
+	}
+	programCache.finish();
+
+	for (unsigned features{ 0 }; features < shaderVariantCount; ++features)
+	{
+		if (features & SHADER_TEXTURED)
+		{
+			m_uberPipelines[features].bind();
+			m_uberPipelines[features].setUniformInt("texture0", 0);
+		}
+	}
+
+	glCreateBuffers(1, &m_frameUniformBuffer);
+	glNamedBufferStorage(m_frameUniformBuffer, sizeof(FrameUniforms), nullptr, GL_DYNAMIC_STORAGE_BIT);
+	GlResourceTracker::trackBuffer(m_frameUniformBuffer, sizeof(FrameUniforms));
+
+	glCreateBuffers(1, &m_instanceBuffer);
+
+	glCreateBuffers(1, &m_lightBuffer);
+	glCreateBuffers(1, &m_clusterBuffer);
+	glCreateBuffers(1, &m_lightIndexBuffer);
+	// No lights until the first setLights()
+	setLights({}, LightClusters{});
+
+	m_gpuTimer.init();
 
 }
 
 void Renderer::cleanup()
 {
-	m_uberPipeline = Pipeline{};
+	for (Pipeline& pipeline : m_uberPipelines)
+	{
+		pipeline = Pipeline{};
+	}
 
-	for (const auto& mesh : meshes)
+	for (GLuint buffer : { m_frameUniformBuffer, m_instanceBuffer, m_lightBuffer, m_clusterBuffer, m_lightIndexBuffer,
+		m_vertexBuffer, m_elementBuffer })
 	{
-		for (const auto& primitive : mesh.second.primitives)
-		{
-			if (primitive.material.hasBaseColorTexture)
-			{
-				glDeleteTextures(1, &primitive.material.baseColorTexture);
-			}
-		}
+		GlResourceTracker::releaseBuffer(buffer);
 	}
 
+	glDeleteBuffers(1, &m_frameUniformBuffer);
+	glDeleteBuffers(1, &m_instanceBuffer);
+	glDeleteBuffers(1, &m_lightBuffer);
+	glDeleteBuffers(1, &m_clusterBuffer);
+	glDeleteBuffers(1, &m_lightIndexBuffer);
+
+	m_gpuTimer.cleanup();
+
+	m_renderGraph.cleanup();
+
+	m_textures.each([](TextureHandle, Texture& texture) {
+		glDeleteTextures(1, &texture.texture);
+		GlResourceTracker::releaseTexture(texture.texture);
+		});
+	m_textures.clear();
+	m_meshes.clear();
+
 	glDeleteBuffers(1, &m_elementBuffer);
 	glDeleteVertexArrays(1, &m_vertexArray);
 	glDeleteBuffers(1, &m_vertexBuffer);
@@ -59,216 +123,439 @@ void Renderer::beginRendering(const glm::vec3& cameraPosition, const glm::vec3&
 	glm::mat4 view{ glm::lookAt(cameraPosition, cameraPosition + cameraLook, glm::vec3{ 0.0f, 1.0f, 0.0f }) };
 	glm::mat4 projection{ glm::perspective(glm::radians(fieldOfView), aspectRatio, nearPlane, farPlane) };
 
-	glViewport(0, 0, m_viewportWidth, m_viewportHeight);
+	glViewport(0, 0, m_renderWidth, m_renderHeight);
 
 	glEnable(GL_DEPTH_TEST);
 
 	glClearColor(0.9f, 0.9f, 1.0f, 1.0f);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	m_uberPipeline.bind();
-	m_uberPipeline.setUniformMat4("projection", projection);
-	m_uberPipeline.setUniformMat4("view", view);
+	// Shared by every variant
+	const glm::vec4 clusterScale{
+		static_cast<float>(clusterCountX) / m_renderWidth,
+		static_cast<float>(clusterCountY) / m_renderHeight,
+		clusterCountZ / std::log(farPlane / nearPlane),
+		nearPlane };
+	const FrameUniforms frameUniforms{ projection, view, glm::vec4{ lightColor, 0.0f }, clusterScale };
+	glNamedBufferSubData(m_frameUniformBuffer, 0, sizeof(FrameUniforms), &frameUniforms);
+	glBindBufferBase(GL_UNIFORM_BUFFER, 0, m_frameUniformBuffer);
 
-	m_uberPipeline.setUniformVec3("lightColor", lightColor);
+	m_boundVariant = shaderVariantCount;
+	m_uploadedPalettes.fill(nullptr);
 
 	glBindVertexArray(m_vertexArray);
 }
 
-void Renderer::renderMesh(const std::string& mesh, const glm::mat4& transform)
+void Renderer::renderMesh(MeshHandle mesh, const glm::mat4& transform,
+	const glm::mat4* jointMatrix, std::size_t jointCount)
 {
-	if (meshes.at(mesh).joints.size() != 0)
+	const Mesh& renderedMesh{ m_meshes.get(mesh) };
+
+	for (const Primitive& primitive : renderedMesh.primitives)
 	{
-		auto jointMatrix{ calculateJointMatrix(meshes.at(mesh)) };
-		jointMatrix.resize(32);
-		m_uberPipeline.setUniformMat4Array("jointMatrix", jointMatrix);
+		const unsigned features{ (jointCount != 0 && primitive.skinned ? SHADER_SKINNED : 0u)
+			| (primitive.material.hasBaseColorTexture ? SHADER_TEXTURED : 0u) };
+		Pipeline& pipeline{ bindVariant(features) };
+
+		if (jointCount != 0 && m_uploadedPalettes[features] != jointMatrix)
+		{
+			pipeline.setUniformMat4Array("jointMatrix", jointMatrix, jointCount);
+			m_uploadedPalettes[features] = jointMatrix;
+		}
+
+		const glm::mat4 model{ transform * primitive.transform };
+		pipeline.setUniformMat4("model", model);
+		// Once per draw here instead of once per vertex in the shader
+		pipeline.setUniformMat3("normalMatrix", glm::transpose(glm::inverse(glm::mat3{ model })));
+		pipeline.setUniformVec4("baseColorFactor", primitive.material.baseColorFactor);
+
+		if (primitive.material.hasBaseColorTexture)
+		{
+			glBindTextureUnit(0, primitive.material.baseColorTexture);
+		}
+
+		glDrawElementsBaseVertex(GL_TRIANGLES, primitive.elementCount, GL_UNSIGNED_INT,
+			reinterpret_cast<const void*>(sizeof(GLuint) * primitive.elementOffset), primitive.baseVertex);
+
+		Profiler::count(Profiler::DRAWS);
+		Profiler::count(Profiler::TRIANGLES, primitive.elementCount / 3);
 	}
+}
 
-	for (const Primitive& primitive : meshes.at(mesh).primitives)
+void Renderer::renderMeshInstanced(MeshHandle mesh, const glm::mat4* transforms, std::size_t instanceCount,
+	const glm::mat4* jointMatrix, std::size_t jointCount)
+{
+	if (instanceCount == 0)
 	{
-		m_uberPipeline.setUniformMat4("model", transform * primitive.transform);
+		return;
+	}
 
-		glBindTextureUnit(0, primitive.material.baseColorTexture);
-		m_uberPipeline.setUniformInt("texture0", 0);
+	const Mesh& renderedMesh{ m_meshes.get(mesh) };
 
-		glDrawElements(GL_TRIANGLES, primitive.elementCount, GL_UNSIGNED_INT,
-			reinterpret_cast<const void*>(sizeof(GLuint) * primitive.elementOffset));
+	// Shared by every primitive; each one's own transform goes in a uniform
+	m_instances.resize(instanceCount);
+	for (std::size_t i{ 0 }; i < instanceCount; ++i)
+	{
+		m_instances[i] = { transforms[i], glm::mat4{ glm::transpose(glm::inverse(glm::mat3{ transforms[i] })) } };
 	}
-}
 
+	// Orphaned every call so the driver never waits on the previous one
+	glNamedBufferData(m_instanceBuffer, sizeof(Instance) * instanceCount, m_instances.data(), GL_STREAM_DRAW);
+	GlResourceTracker::trackBuffer(m_instanceBuffer, sizeof(Instance) * instanceCount);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_instanceBuffer);
 
+	for (const Primitive& primitive : renderedMesh.primitives)
+	{
+		const unsigned features{ SHADER_INSTANCED
+			| (jointCount != 0 && primitive.skinned ? SHADER_SKINNED : 0u)
+			| (primitive.material.hasBaseColorTexture ? SHADER_TEXTURED : 0u) };
+		Pipeline& pipeline{ bindVariant(features) };
 
-void Renderer::setViewport(SDL_Window* window)
-{
-	SDL_GL_GetDrawableSize(window, &m_viewportWidth, &m_viewportHeight);
+		if (jointCount != 0 && m_uploadedPalettes[features] != jointMatrix)
+		{
+			pipeline.setUniformMat4Array("jointMatrix", jointMatrix, jointCount);
+			m_uploadedPalettes[features] = jointMatrix;
+		}
+
+		pipeline.setUniformMat4("primitiveTransform", primitive.transform);
+		pipeline.setUniformMat3("primitiveNormalMatrix", glm::transpose(glm::inverse(glm::mat3{ primitive.transform })));
+		pipeline.setUniformVec4("baseColorFactor", primitive.material.baseColorFactor);
+
+		if (primitive.material.hasBaseColorTexture)
+		{
+			glBindTextureUnit(0, primitive.material.baseColorTexture);
+		}
+
+		glDrawElementsInstancedBaseVertex(GL_TRIANGLES, primitive.elementCount, GL_UNSIGNED_INT,
+			reinterpret_cast<const void*>(sizeof(GLuint) * primitive.elementOffset),
+			static_cast<GLsizei>(instanceCount), primitive.baseVertex);
+
+		Profiler::count(Profiler::DRAWS);
+		Profiler::count(Profiler::TRIANGLES, primitive.elementCount / 3 * instanceCount);
+	}
 }
 
+void Renderer::setLights(const std::vector<PointLight>& lights, const LightClusters& clusters)
+{
+	// Orphaned like the instance buffer. Empty buffers can't be bound, so
+	// those get a single zeroed element instead; the shader ignores clusters
+	// past the end of the buffer, which covers lights never assigned.
+	const auto upload{ [](GLuint buffer, GLuint binding, const void* data, std::size_t size, std::size_t elementSize) {
+		const std::array<std::byte, sizeof(PointLight)> zeros{};
+		if (size == 0)
+		{
+			glNamedBufferData(buffer, elementSize, zeros.data(), GL_STREAM_DRAW);
+		}
+		else
+		{
+			glNamedBufferData(buffer, size, data, GL_STREAM_DRAW);
+		}
+		GlResourceTracker::trackBuffer(buffer, size == 0 ? elementSize : size);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, buffer);
+		} };
 
+	upload(m_lightBuffer, 1, lights.data(), sizeof(PointLight) * lights.size(), sizeof(PointLight));
+	upload(m_clusterBuffer, 2, clusters.ranges.data(), sizeof(glm::uvec2) * clusters.ranges.size(), sizeof(glm::uvec2));
+	upload(m_lightIndexBuffer, 3, clusters.lightIndices.data(),
+		sizeof(std::uint32_t) * clusters.lightIndices.size(), sizeof(std::uint32_t));
+}
 
-void Renderer::loadScene(int modelPathCount, std::pair<std::string, std::string>* modelPaths)
+void Renderer::renderSnapshot(const RenderSnapshot& snapshot)
 {
-	for (int i{ 0 }; i < modelPathCount; ++i)
+	PROFILE_ZONE("Render snapshot");
+	MemoryTracker::Scope memoryScope{ MemoryTracker::RENDERER };
+	m_gpuTimer.beginFrame();
+
+	GLint outputFramebuffer{};
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &outputFramebuffer);
+
+	const float scale{ m_dynamicResolution.scale() };
+	m_renderWidth = std::max(1, static_cast<int>(m_viewportWidth * scale + 0.5f));
+	m_renderHeight = std::max(1, static_cast<int>(m_viewportHeight * scale + 0.5f));
+
+	// Targets cover the whole viewport and the scene only draws into the
+	// scaled corner, so the scale changes without reallocating
+	const GLsizei targetWidth{ std::max(m_viewportWidth, 1) };
+	const GLsizei targetHeight{ std::max(m_viewportHeight, 1) };
+
+	m_renderGraph.reset();
+	const RenderGraph::Resource output{
+		m_renderGraph.importFramebuffer("Output", static_cast<GLuint>(outputFramebuffer)) };
+
+	RenderGraph::Resource sceneColor{};
+	m_renderGraph.addPass("Scene pass",
+		[&](RenderGraph::Builder& builder) {
+			sceneColor = builder.write(builder.create("Scene color",
+				{ targetWidth, targetHeight, GL_RGBA8, m_msaaSamples }));
+			builder.write(builder.create("Scene depth",
+				{ targetWidth, targetHeight, GL_DEPTH_COMPONENT24, m_msaaSamples }));
+		},
+		[&](RenderGraph::Context&) {
+			beginRendering(snapshot.cameraPosition, snapshot.cameraLook, snapshot.fieldOfView,
+				snapshot.aspectRatio, snapshot.nearPlane, snapshot.farPlane, snapshot.lightColor);
+			setLights(snapshot.lights, snapshot.lightClusters);
+
+			for (const RenderSnapshot::Draw& draw : snapshot.draws)
+			{
+				renderMesh(draw.mesh, draw.transform,
+					snapshot.palettes.data() + draw.paletteOffset, draw.paletteCount);
+			}
+
+			for (const RenderSnapshot::InstancedDraw& draw : snapshot.instancedDraws)
+			{
+				renderMeshInstanced(draw.mesh, snapshot.instanceTransforms.data() + draw.transformOffset,
+					draw.transformCount, snapshot.palettes.data() + draw.paletteOffset, draw.paletteCount);
+			}
+		});
+
+	// Multisampled blits can't scale, so resolving and upscaling are
+	// separate passes
+	RenderGraph::Resource resolvedColor{ sceneColor };
+	if (m_msaaSamples > 1)
 	{
-		meshes[modelPaths[i].second] = loadModel(modelPaths[i].first, m_sceneVertices, m_sceneIndices);
+		m_renderGraph.addPass("Resolve",
+			[&](RenderGraph::Builder& builder) {
+				builder.read(sceneColor);
+				resolvedColor = builder.write(builder.create("Resolved color",
+					{ targetWidth, targetHeight, GL_RGBA8, 1 }));
+			},
+			[&](RenderGraph::Context& context) {
+				glBlitNamedFramebuffer(context.readFramebuffer(sceneColor), context.framebuffer(),
+					0, 0, m_renderWidth, m_renderHeight, 0, 0, m_renderWidth, m_renderHeight,
+					GL_COLOR_BUFFER_BIT, GL_NEAREST);
+			});
 	}
 
-	glCreateBuffers(1, &m_vertexBuffer);
-	glNamedBufferStorage(m_vertexBuffer, sizeof(Vertex) * m_sceneVertices.size(), m_sceneVertices.data(), 0);
-
-	glCreateBuffers(1, &m_elementBuffer);
-	glNamedBufferStorage(m_elementBuffer, sizeof(GLuint) * m_sceneIndices.size(), m_sceneIndices.data(), 0);
-	m_elementBufferElementCount = static_cast<GLsizei>(m_sceneIndices.size());
+	m_renderGraph.addPass("Upscale",
+		[&](RenderGraph::Builder& builder) {
+			builder.read(resolvedColor);
+			builder.write(output);
+		},
+		[&](RenderGraph::Context& context) {
+			const bool scaled{ m_renderWidth != m_viewportWidth || m_renderHeight != m_viewportHeight };
+			glBlitNamedFramebuffer(context.readFramebuffer(resolvedColor), context.framebuffer(),
+				0, 0, m_renderWidth, m_renderHeight, 0, 0, m_viewportWidth, m_viewportHeight,
+				GL_COLOR_BUFFER_BIT, scaled ? GL_LINEAR : GL_NEAREST);
+		});
 
-	glCreateVertexArrays(1, &m_vertexArray);
+	m_renderGraph.compile();
+	m_renderGraph.execute(&m_gpuTimer);
 
-	glVertexArrayVertexBuffer(m_vertexArray, 0, m_vertexBuffer, 0, sizeof(Vertex));
-	glVertexArrayElementBuffer(m_vertexArray, m_elementBuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, outputFramebuffer);
 
-	glEnableVertexArrayAttrib(m_vertexArray, 0);
-	glEnableVertexArrayAttrib(m_vertexArray, 1);
-	glEnableVertexArrayAttrib(m_vertexArray, 2);
-	glEnableVertexArrayAttrib(m_vertexArray, 3);
-	glEnableVertexArrayAttrib(m_vertexArray, 4);
+	m_gpuTimer.endFrame();
 
-	glVertexArrayAttribFormat(m_vertexArray, 0, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, position));
-	glVertexArrayAttribFormat(m_vertexArray, 1, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, normal));
-	glVertexArrayAttribFormat(m_vertexArray, 2, 2, GL_FLOAT, GL_FALSE, offsetof(Vertex, texCoord));
-	glVertexArrayAttribIFormat(m_vertexArray, 3, 4, GL_INT,   offsetof(Vertex, joints));
-	glVertexArrayAttribFormat(m_vertexArray, 4, 4, GL_FLOAT, GL_FALSE, offsetof(Vertex, weights));
+	m_dynamicResolution.update(m_gpuTimer.lastFrameTimeMs());
 
-	glVertexArrayAttribBinding(m_vertexArray, 0, 0);
-	glVertexArrayAttribBinding(m_vertexArray, 1, 0);
-	glVertexArrayAttribBinding(m_vertexArray, 2, 0);
-	glVertexArrayAttribBinding(m_vertexArray, 3, 0);
-	glVertexArrayAttribBinding(m_vertexArray, 4, 0);
+	// Direct beginRendering() calls draw at the full viewport again
+	m_renderWidth = m_viewportWidth;
+	m_renderHeight = m_viewportHeight;
 }
 
+void Renderer::setMsaaSamples(int samples)
+{
+	GLint maxSamples{};
+	glGetIntegerv(GL_MAX_SAMPLES, &maxSamples);
 
+	m_msaaSamples = std::clamp(samples, 1, std::max(maxSamples, 1));
+}
 
-glm::vec4 Renderer::determineSamplerOutput(const AnimationSampler& sampler, double time, double maxTime)
+void Renderer::setDynamicResolution(double targetFrameMs, float minScale)
 {
-	float lesserInputValue{ -1.0f };
-	int lesserInput{};
-
-	float greaterInputValue{ static_cast<float>(maxTime) + 1.0f };
-	int greaterInput{};
+	m_dynamicResolution.configure(targetFrameMs, minScale);
+}
 
-	for (int i{ 0 }; i < sampler.input.size(); ++i)
-	{
-		if (sampler.input[i] <= time && sampler.input[i] > lesserInputValue)
-		{
-			lesserInputValue = sampler.input[i];
-			lesserInput = i;
-		}
+void Renderer::addDraw(RenderSnapshot& snapshot, MeshHandle mesh, const glm::mat4& transform) const
+{
+	RenderSnapshot::Draw draw{ .mesh{ mesh }, .transform{ transform } };
+	appendPalette(snapshot, m_meshes.get(mesh), draw.paletteOffset, draw.paletteCount);
 
-		if (sampler.input[i] >= time && sampler.input[i] < greaterInputValue)
-		{
-			greaterInputValue = sampler.input[i];
-			greaterInput = i;
-		}
-	}
+	snapshot.draws.push_back(draw);
+}
 
-	if (time == sampler.input[lesserInput])
+void Renderer::addInstancedDraw(RenderSnapshot& snapshot, MeshHandle mesh, const glm::mat4* transforms,
+	std::size_t transformCount) const
+{
+	if (transformCount == 0)
 	{
-		return sampler.output[lesserInput];
+		return;
 	}
-	else
-	{
-		const float x{ (static_cast<float>(time) - lesserInputValue) / (greaterInputValue - lesserInputValue) };
 
-		return glm::mix(sampler.output[lesserInput], sampler.output[greaterInput], x);
+	RenderSnapshot::InstancedDraw draw{ .mesh{ mesh },
+		.transformOffset{ snapshot.instanceTransforms.size() }, .transformCount{ transformCount } };
+	snapshot.instanceTransforms.insert(snapshot.instanceTransforms.end(), transforms, transforms + transformCount);
+	appendPalette(snapshot, m_meshes.get(mesh), draw.paletteOffset, draw.paletteCount);
+
+	snapshot.instancedDraws.push_back(draw);
+}
+
+void Renderer::appendPalette(RenderSnapshot& snapshot, const Mesh& mesh, std::size_t& offset,
+	std::size_t& count) const
+{
+	if (mesh.joints.size() != 0)
+	{
+		offset = snapshot.palettes.size();
+		count = mesh.joints.size();
+		snapshot.palettes.resize(offset + count);
+		calculateJointMatrix(mesh, snapshot.palettes.data() + offset);
 	}
 }
 
-glm::mat4 Renderer::calculateJointLocalTransform(const Joint& joint, double time, double maxTime)
+
+
+Pipeline& Renderer::bindVariant(unsigned features)
 {
-	glm::mat4 transform{ 1.0f };
+	Pipeline& pipeline{ m_uberPipelines[features] };
 
-	for (const auto& sampler : joint.animationSamplers)
+	if (m_boundVariant != features)
 	{
-		glm::vec4 output{ determineSamplerOutput(sampler.second, time, maxTime) };
-
-		switch (sampler.second.path)
-		{
-		case AnimationSampler::TRANSLATION:
-			glm::mat4 translation{ 1.0f };
-			translation = glm::translate(translation, static_cast<glm::vec3>(output));
-			transform *= translation;
-			break;
-
-		case AnimationSampler::ROTATION:
-			glm::quat quat{ output.w, output.x, output.y, output.z };
-			glm::mat4 rotation{ glm::toMat4(quat) };
-			transform *= rotation;
-			break;
-
-		case AnimationSampler::SCALE:
-			glm::mat4 scale{ 1.0f };
-			scale = glm::scale(scale, static_cast<glm::vec3>(output));
-			transform *= scale;
-			break;
-		}
+		pipeline.bind();
+		m_boundVariant = features;
 	}
 
-	return transform;
+	return pipeline;
 }
 
-void Renderer::calculateJointChildrenGlobalTransforms(const Mesh& mesh,
-	const Joint& joint, const glm::mat4& jointGlobalTransform,
-	const std::vector<glm::mat4>& localTransforms, std::vector<glm::mat4>& globalTransforms)
+
+
+void Renderer::setViewport(SDL_Window* window)
 {
-	for (int childIndex : joint.children)
-	{
-		glm::mat4 childGlobalTransform{ jointGlobalTransform * localTransforms[childIndex] };
+	SDL_GL_GetDrawableSize(window, &m_viewportWidth, &m_viewportHeight);
+	m_renderWidth = m_viewportWidth;
+	m_renderHeight = m_viewportHeight;
+}
+
+void Renderer::setViewport(int width, int height)
+{
+	m_viewportWidth = width;
+	m_viewportHeight = height;
+	m_renderWidth = width;
+	m_renderHeight = height;
+}
+
+
 
-		globalTransforms[childIndex] = childGlobalTransform;
+std::vector<MeshHandle> Renderer::loadScene(const std::vector<ModelSource>& sources, JobSystem& jobSystem)
+{
+	PROFILE_ZONE("Load scene");
+	MemoryTracker::Scope memoryScope{ MemoryTracker::LOADER };
+
+	std::vector<StagedModel> models(sources.size());
+
+	// File I/O, parsing, image decoding and vertex conversion for all models
+	// at once; stageModel() fans each model's images out further
+	{
+		PROFILE_ZONE("Stage models");
 
-		if (mesh.joints[childIndex].children.size() != 0)
+		JobCounter counter{};
+		for (std::size_t i{ 0 }; i < sources.size(); ++i)
 		{
-			calculateJointChildrenGlobalTransforms(mesh, mesh.joints[childIndex], childGlobalTransform,
-				localTransforms, globalTransforms);
+			jobSystem.schedule([&models, &jobSystem, &sources, i]() {
+				models[i] = stageModel(sources[i].path, &jobSystem);
+			}, &counter);
 		}
+		jobSystem.wait(counter);
 	}
-}
 
-std::vector<glm::mat4> Renderer::calculateJointMatrix(const Mesh& mesh)
-{
-	std::vector<glm::mat4> jointMatrix(mesh.joints.size());
+	PROFILE_ZONE("Upload scene");
 
-	// Transform of the node that the mesh is attached to
-	glm::mat4 globalTransform{ 1.0f };
-	
-	std::vector<glm::mat4> localTransforms(mesh.joints.size());
-	for (int i{ 0 }; i < mesh.joints.size(); ++i)
+	std::size_t vertexCount{};
+	std::size_t indexCount{};
+	for (const StagedModel& model : models)
 	{
-		localTransforms[i] = calculateJointLocalTransform(mesh.joints[i], mesh.time, mesh.maxTime);
+		vertexCount += model.vertices().size();
+		indexCount += model.indices().size();
 	}
 
-	// Global transform of the joint. This needs to inherit all its transforms from
-	// parent joints.
-	std::vector<glm::mat4> globalJointTransforms(mesh.joints.size());
-	for (int i{ 0 }; i < globalJointTransforms.size(); ++i)
+	glCreateBuffers(1, &m_vertexBuffer);
+	glNamedBufferStorage(m_vertexBuffer, sizeof(Vertex) * vertexCount, nullptr, GL_DYNAMIC_STORAGE_BIT);
+	GlResourceTracker::trackBuffer(m_vertexBuffer, sizeof(Vertex) * vertexCount);
+
+	glCreateBuffers(1, &m_elementBuffer);
+	glNamedBufferStorage(m_elementBuffer, sizeof(GLuint) * indexCount, nullptr, GL_DYNAMIC_STORAGE_BIT);
+	GlResourceTracker::trackBuffer(m_elementBuffer, sizeof(GLuint) * indexCount);
+	m_elementBufferElementCount = static_cast<GLsizei>(indexCount);
+
+	// Geometry goes straight from where it was staged (for cooked models,
+	// the file mapping) into the shared buffers
+	std::size_t firstVertex{};
+	std::size_t firstIndex{};
+
+	std::vector<MeshHandle> ret{};
+	ret.reserve(sources.size());
+
+	for (std::size_t i{ 0 }; i < sources.size(); ++i)
 	{
-		if (!mesh.joints[i].hasJointParent)
+		StagedModel& model{ models[i] };
+		const auto vertices{ model.vertices() };
+		const auto indices{ model.indices() };
+
+		glNamedBufferSubData(m_vertexBuffer, sizeof(Vertex) * firstVertex, vertices.size_bytes(), vertices.data());
+		glNamedBufferSubData(m_elementBuffer, sizeof(GLuint) * firstIndex, indices.size_bytes(), indices.data());
+
+		Mesh mesh{ std::move(model.mesh) };
+
+		for (Primitive& primitive : mesh.primitives)
 		{
-			globalJointTransforms[i] = localTransforms[i];
+			primitive.elementOffset += static_cast<GLsizei>(firstIndex);
+			primitive.baseVertex = static_cast<GLint>(firstVertex);
+		}
 
-			calculateJointChildrenGlobalTransforms(mesh, mesh.joints[i], localTransforms[i],
-				localTransforms, globalJointTransforms);
+		const auto createdTextures{ uploadTextures(mesh, model.textures) };
+		for (std::size_t texture{ 0 }; texture < createdTextures.size(); ++texture)
+		{
+			mesh.textures.push_back(m_textures.add(sources[i].path + '#' + std::to_string(texture),
+				Texture{ createdTextures[texture] }));
 		}
-	}
-	
-	for (int i{ 0 }; i < mesh.joints.size(); ++i)
-	{
-		glm::mat4 globalTransform{ 1.0f };
 
-		jointMatrix[i] = { glm::mat4{
-			glm::inverse(globalTransform) * 
-			globalJointTransforms[i] * 
-			mesh.joints[i].inverseBindMatrix
-		} };
+		ret.push_back(m_meshes.add(sources[i].name, std::move(mesh)));
+
+		firstVertex += vertices.size();
+		firstIndex += indices.size();
 	}
 
-	return jointMatrix;
+	glCreateVertexArrays(1, &m_vertexArray);
+
+	glVertexArrayVertexBuffer(m_vertexArray, 0, m_vertexBuffer, 0, sizeof(Vertex));
+	glVertexArrayElementBuffer(m_vertexArray, m_elementBuffer);
+
+	glEnableVertexArrayAttrib(m_vertexArray, 0);
+	glEnableVertexArrayAttrib(m_vertexArray, 1);
+	glEnableVertexArrayAttrib(m_vertexArray, 2);
+	glEnableVertexArrayAttrib(m_vertexArray, 3);
+	glEnableVertexArrayAttrib(m_vertexArray, 4);
+
+	glVertexArrayAttribFormat(m_vertexArray, 0, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, position));
+	glVertexArrayAttribFormat(m_vertexArray, 1, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, normal));
+	glVertexArrayAttribFormat(m_vertexArray, 2, 2, GL_FLOAT, GL_FALSE, offsetof(Vertex, texCoord));
+	glVertexArrayAttribIFormat(m_vertexArray, 3, 4, GL_INT,   offsetof(Vertex, joints));
+	glVertexArrayAttribFormat(m_vertexArray, 4, 4, GL_FLOAT, GL_FALSE, offsetof(Vertex, weights));
+
+	glVertexArrayAttribBinding(m_vertexArray, 0, 0);
+	glVertexArrayAttribBinding(m_vertexArray, 1, 0);
+	glVertexArrayAttribBinding(m_vertexArray, 2, 0);
+	glVertexArrayAttribBinding(m_vertexArray, 3, 0);
+	glVertexArrayAttribBinding(m_vertexArray, 4, 0);
+
+	return ret;
 }
 
+void Renderer::releaseMesh(MeshHandle mesh)
+{
+	if (const auto released{ m_meshes.release(mesh) })
+	{
+		for (TextureHandle texture : released->textures)
+		{
+			releaseTexture(texture);
+		}
+	}
+}
+
+void Renderer::releaseTexture(TextureHandle texture)
+{
+	if (auto released{ m_textures.release(texture) })
+	{
+		glDeleteTextures(1, &released->texture);
+		GlResourceTracker::releaseTexture(released->texture);
+	}
+}
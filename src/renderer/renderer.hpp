@@ -1,17 +1,26 @@
 #pragma once
 
+#include "dynamic_resolution.hpp"
+#include "gpu_timer.hpp"
+#include "light_clusters.hpp"
 #include "pipeline.hpp"
+#include "render_graph.hpp"
+#include "render_snapshot.hpp"
+#include "resource_pool.hpp"
 
 #include "glad/glad.h"
 #include "glm/glm.hpp"
 #define SDL_MAIN_HANDLED
 #include "SDL/SDL.h"
 
+#include <array>
+#include <cstddef>
 #include <map>
 #include <string>
-#include <unordered_map>
 #include <vector>
 
+class JobSystem;
+
 class Renderer
 {
 public:
@@ -29,6 +38,9 @@ public:
 	{
 		glm::vec4 baseColorFactor{ 1.0f, 1.0f, 1.0f, 1.0f };
 		bool hasBaseColorTexture{ false };
+		// Index into the staged textures returned by loadModel(), resolved
+		// to baseColorTexture when they are uploaded
+		int baseColorTextureIndex{ -1 };
 		GLuint baseColorTexture{};
 	};
 
@@ -40,6 +52,12 @@ public:
 
 		GLsizei elementOffset{};
 		GLsizei elementCount{};
+		// Added to every index, so models keep their own 0 based indices
+		// inside the shared buffers
+		GLint baseVertex{};
+
+		// Has joints to skin with; the rest of a skinned mesh is drawn rigid
+		bool skinned{ false };
 	};
 
 	struct AnimationSampler
@@ -70,62 +88,214 @@ public:
 		std::multimap<AnimationSampler::Path, AnimationSampler> animationSamplers{};
 	};
 
+	// Capsule following a joint, in the bind pose, for hit detection.
+	// Posed by the joint's palette matrix like the vertices it covers.
+	struct Hitbox
+	{
+		int joint{};
+		glm::vec3 start{};
+		glm::vec3 end{};
+		float radius{};
+	};
+
 	struct Mesh
 	{
 		std::vector<Primitive> primitives{};
 		std::vector<Joint> joints{};
+		// Fitted to the skinned vertices by fitHitboxes() when staged
+		std::vector<Hitbox> hitboxes{};
 
 		double time{ 0.0f };
 		double maxTime{ 1.0f };
+
+		// Textures the materials sample, released along with the mesh
+		std::vector<TextureHandle> textures{};
 	};
 
-	void init();
+	struct Texture
+	{
+		GLuint texture{};
+	};
+
+	// A model file and the name its mesh is registered under
+	struct ModelSource
+	{
+		std::string path{};
+		std::string name{};
+	};
+
+	// Program binaries are cached in programCacheDirectory across runs; an
+	// empty path disables the cache
+	void init(const std::string& programCacheDirectory);
+	// For contexts not created through SDL, e.g. headless EGL
+	void init(GLADloadproc loadProc, const std::string& programCacheDirectory);
 	void cleanup();
 
 	void beginRendering(const glm::vec3& cameraPosition, const glm::vec3& cameraLook,
 		float fieldOfView, float aspectRatio, float nearPlane, float farPlane, const glm::vec3& lightColor);
 
-	void renderMesh(const std::string& mesh, const glm::mat4& transform);
+	// Picks the shader variant per primitive: skinned only when a palette is
+	// given and the primitive has joints, textured only when the material
+	// has a base color texture
+	void renderMesh(MeshHandle mesh, const glm::mat4& transform,
+		const glm::mat4* jointMatrix, std::size_t jointCount);
+
+	// One instanced draw per primitive, all reading the same uploaded
+	// instance transforms. Every instance shares the palette, if there is
+	// one.
+	void renderMeshInstanced(MeshHandle mesh, const glm::mat4* transforms, std::size_t instanceCount,
+		const glm::mat4* jointMatrix, std::size_t jointCount);
+
+	// Point lights for the following draws, binned by assignLights() for the
+	// camera passed to the next beginRendering()
+	void setLights(const std::vector<PointLight>& lights, const LightClusters& clusters);
+
+	// Draws a snapshot produced by the simulation. Safe to call from the
+	// thread that owns the GL context while the simulation keeps running,
+	// since only the immutable mesh data is read.
+	// The scene is rendered offscreen at renderScale() of the viewport, with
+	// the configured MSAA, then resolved and upscaled into whatever
+	// framebuffer is bound when this is called.
+	void renderSnapshot(const RenderSnapshot& snapshot);
+
+	// Samples per pixel of the offscreen scene, clamped to what the driver
+	// supports. 1 or less disables MSAA.
+	void setMsaaSamples(int samples);
+
+	// Adjusts the render scale every frame so the GPU frame time approaches
+	// targetFrameMs, never going below minScale. A target of 0 renders at
+	// full resolution.
+	void setDynamicResolution(double targetFrameMs, float minScale);
+
+	float renderScale() const
+	{
+		return m_dynamicResolution.scale();
+	}
+
+	// Called by the simulation. Evaluates the mesh's current animation pose
+	// into the snapshot so the render thread never reads Mesh::time.
+	void addDraw(RenderSnapshot& snapshot, MeshHandle mesh, const glm::mat4& transform) const;
+
+	// Like addDraw(), but the transforms become a single instanced draw per
+	// primitive, every instance in the current pose
+	void addInstancedDraw(RenderSnapshot& snapshot, MeshHandle mesh, const glm::mat4* transforms,
+		std::size_t transformCount) const;
 
 	void setViewport(SDL_Window* window);
+	void setViewport(int width, int height);
+
+	// Stages every model concurrently on the job system, then concatenates
+	// them into the shared buffers and uploads on the calling thread, which
+	// must own the GL context. Returns a handle per model, in order, each
+	// holding one reference.
+	std::vector<MeshHandle> loadScene(const std::vector<ModelSource>& models, JobSystem& jobSystem);
+
+	// Name lookups are for load time; the invalid handle when not loaded.
+	// acquireMesh() adds a reference, to be dropped with releaseMesh().
+	MeshHandle findMesh(const std::string& name) const
+	{
+		return m_meshes.find(name);
+	}
 
-	void loadScene(int modelPathCount, std::pair<std::string, std::string>* modelPaths);
+	MeshHandle acquireMesh(const std::string& name)
+	{
+		return m_meshes.acquire(name);
+	}
+
+	// Frees the mesh's textures along with the last reference. Its geometry
+	// stays in the shared buffers until cleanup(). Must not run while a
+	// snapshot drawing the mesh is in flight.
+	void releaseMesh(MeshHandle mesh);
 
-	const std::vector<Vertex>& sceneVertices() const
+	Mesh& mesh(MeshHandle mesh)
 	{
-		return m_sceneVertices;
+		return m_meshes.get(mesh);
 	}
-	const std::vector<GLuint>& sceneIndices() const
+
+	const Mesh& mesh(MeshHandle mesh) const
 	{
-		return m_sceneIndices;
+		return m_meshes.get(mesh);
 	}
 
-	std::unordered_map<std::string, Mesh> meshes{};
+	// Calls function(handle, mesh) for every loaded mesh
+	template <typename Function>
+	void eachMesh(Function&& function)
+	{
+		m_meshes.each(function);
+	}
+
+	const GpuTimer& gpuTimer() const
+	{
+		return m_gpuTimer;
+	}
 
 private:
 
 	int m_viewportWidth{};
 	int m_viewportHeight{};
 
+	// Size beginRendering() draws at; the scaled viewport inside
+	// renderSnapshot(), the whole viewport otherwise
+	int m_renderWidth{};
+	int m_renderHeight{};
+
+	// Rebuilt every frame by renderSnapshot(); owns the offscreen targets
+	RenderGraph m_renderGraph{};
+
+	int m_msaaSamples{ 1 };
+	DynamicResolution m_dynamicResolution{};
+
 	GLuint  m_vertexBuffer{};
 	GLuint  m_vertexArray{};
 	GLuint  m_elementBuffer{};
 	GLsizei m_elementBufferElementCount{};
 
-	std::vector<Vertex> m_sceneVertices{};
-	std::vector<GLuint> m_sceneIndices{};
+	ResourcePool<Mesh, MeshHandle> m_meshes{};
+	ResourcePool<Texture, TextureHandle> m_textures{};
+
+	void releaseTexture(TextureHandle texture);
+
+	// Layout of the Frame uniform block in uber.vert/uber.frag (std140)
+	struct FrameUniforms
+	{
+		glm::mat4 projection{};
+		glm::mat4 view{};
+		glm::vec4 lightColor{};
+		// xy: clusters per pixel, z: depth slices per log depth, w: near plane
+		glm::vec4 clusterScale{};
+	};
+
+	// Element of the Instances storage buffer in uber.vert (std430)
+	struct Instance
+	{
+		glm::mat4 model{};
+		glm::mat4 normalMatrix{};
+	};
+
+	// Indexed by ShaderFeature bits
+	std::array<Pipeline, shaderVariantCount> m_uberPipelines{};
+	unsigned m_boundVariant{ shaderVariantCount };
+
+	// Palette last uploaded to each variant this frame. Consecutive
+	// primitives of a skinned draw often share a variant.
+	std::array<const glm::mat4*, shaderVariantCount> m_uploadedPalettes{};
 
-	Pipeline m_uberPipeline{};
+	GLuint m_frameUniformBuffer{};
 
+	GLuint m_instanceBuffer{};
+	std::vector<Instance> m_instances{};
 
-	glm::vec4 determineSamplerOutput(const AnimationSampler& sampler, double time, double maxTime);
+	// Lights, Clusters and LightIndices storage buffers in uber.frag
+	GLuint m_lightBuffer{};
+	GLuint m_clusterBuffer{};
+	GLuint m_lightIndexBuffer{};
 
-	glm::mat4 calculateJointLocalTransform(const Joint& joint, double time, double maxTime);
+	Pipeline& bindVariant(unsigned features);
 
-	void calculateJointChildrenGlobalTransforms(const Mesh& mesh,
-		const Joint& joint, const glm::mat4& jointGlobalTransform,
-		const std::vector<glm::mat4>& localTransforms, std::vector<glm::mat4>& globalTransforms);
+	// Evaluates the mesh's pose into snapshot.palettes; a count of 0 for
+	// meshes without joints
+	void appendPalette(RenderSnapshot& snapshot, const Mesh& mesh, std::size_t& offset, std::size_t& count) const;
 
-	std::vector<glm::mat4> calculateJointMatrix(const Mesh& mesh);
+	GpuTimer m_gpuTimer{};
 
 };
\ No newline at end of file
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility> // for std::move
+#include <vector>
+
+// Refers to a resource in a ResourcePool. The tag keeps handles of different
+// resource types apart; the generation makes a handle to a released slot
+// invalid even after the slot is reused.
+template <typename Tag>
+struct ResourceHandle
+{
+	std::uint32_t index{};
+	// 0 is never handed out, so default handles are invalid
+	std::uint32_t generation{};
+
+	bool operator==(const ResourceHandle&) const = default;
+};
+
+using MeshHandle = ResourceHandle<struct MeshTag>;
+using TextureHandle = ResourceHandle<struct TextureTag>;
+
+// Resources indexed by handle, with names only looked up while loading.
+// Every add() or acquire() holds a reference; release() hands the resource
+// back once the last one is gone, so the owner can free what it holds.
+// Handle is the ResourceHandle type for this kind of resource.
+template <typename Resource, typename Handle>
+class ResourcePool final
+{
+public:
+
+	ResourcePool() = default;
+
+	ResourcePool(const ResourcePool&) = delete;
+	ResourcePool& operator=(const ResourcePool&) = delete;
+
+	// Starts with one reference. If the name is taken, find() returns the
+	// new resource from now on and the old one lives until it is released.
+	Handle add(const std::string& name, Resource resource)
+	{
+		std::uint32_t index{};
+		if (!m_freeIndices.empty())
+		{
+			index = m_freeIndices.back();
+			m_freeIndices.pop_back();
+			m_resources[index] = std::move(resource);
+		}
+		else
+		{
+			index = static_cast<std::uint32_t>(m_resources.size());
+			m_resources.push_back(std::move(resource));
+			m_slots.push_back(Slot{});
+		}
+
+		Slot& slot{ m_slots[index] };
+		slot.name = name;
+		slot.refCount = 1;
+		m_names[name] = index;
+
+		return Handle{ index, slot.generation };
+	}
+
+	// Invalid handle when nothing is loaded under the name. Doesn't add a
+	// reference.
+	Handle find(const std::string& name) const
+	{
+		const auto found{ m_names.find(name) };
+		return found != m_names.end() ? Handle{ found->second, m_slots[found->second].generation } : Handle{};
+	}
+
+	// find() plus a reference, if found
+	Handle acquire(const std::string& name)
+	{
+		const Handle handle{ find(name) };
+		addReference(handle);
+		return handle;
+	}
+
+	void addReference(Handle handle)
+	{
+		if (valid(handle))
+		{
+			++m_slots[handle.index].refCount;
+		}
+	}
+
+	// Returns the resource when this was the last reference. The handle and
+	// every copy of it are invalid from then on.
+	std::optional<Resource> release(Handle handle)
+	{
+		if (!valid(handle) || --m_slots[handle.index].refCount != 0)
+		{
+			return std::nullopt;
+		}
+
+		Slot& slot{ m_slots[handle.index] };
+		const auto named{ m_names.find(slot.name) };
+		if (named != m_names.end() && named->second == handle.index)
+		{
+			m_names.erase(named);
+		}
+		slot.name.clear();
+		// Skips 0 on wrap around
+		slot.generation = slot.generation + 1 != 0 ? slot.generation + 1 : 1;
+		m_freeIndices.push_back(handle.index);
+
+		std::optional<Resource> ret{ std::move(m_resources[handle.index]) };
+		m_resources[handle.index] = Resource{};
+		return ret;
+	}
+
+	bool valid(Handle handle) const
+	{
+		return handle.index < m_slots.size() && handle.generation == m_slots[handle.index].generation
+			&& m_slots[handle.index].refCount != 0;
+	}
+
+	// Plain indexing for the per draw paths; the handle must be valid
+	Resource& get(Handle handle)
+	{
+		return m_resources[handle.index];
+	}
+
+	const Resource& get(Handle handle) const
+	{
+		return m_resources[handle.index];
+	}
+
+	// Calls function(handle, resource) for every live resource
+	template <typename Function>
+	void each(Function&& function)
+	{
+		for (std::size_t i{ 0 }; i < m_slots.size(); ++i)
+		{
+			if (m_slots[i].refCount != 0)
+			{
+				function(Handle{ static_cast<std::uint32_t>(i), m_slots[i].generation }, m_resources[i]);
+			}
+		}
+	}
+
+	std::size_t size() const
+	{
+		return m_slots.size() - m_freeIndices.size();
+	}
+
+	// Forgets every resource regardless of references. Free them first.
+	void clear()
+	{
+		for (std::size_t i{ 0 }; i < m_slots.size(); ++i)
+		{
+			if (m_slots[i].refCount != 0)
+			{
+				m_slots[i].refCount = 1;
+				release(Handle{ static_cast<std::uint32_t>(i), m_slots[i].generation });
+			}
+		}
+	}
+
+private:
+
+	struct Slot
+	{
+		std::string name{};
+		std::uint32_t generation{ 1 };
+		std::uint32_t refCount{};
+	};
+
+	// Kept apart from the slots so lookups by handle only touch resources
+	std::vector<Resource> m_resources{};
+	std::vector<Slot> m_slots{};
+	std::vector<std::uint32_t> m_freeIndices{};
+
+	std::unordered_map<std::string, std::uint32_t> m_names{};
+};
@@ -1,25 +1,110 @@
-#version 460 core
+#version 450 core
 
 out vec4 fragColor;
 
 layout (location = 0) in vec3 inNorm;
 layout (location = 1) in vec2 inTex;
+layout (location = 2) in vec3 inWorldPos;
 
+layout (std140, binding = 0) uniform Frame
+{
+	mat4 projection;
+	mat4 view;
+	vec4 lightColor;
+	// xy: clusters per pixel, z: depth slices per log depth, w: near plane
+	vec4 clusterScale;
+};
+
+// Clustered point lights, binned on the CPU by assignLights(). Must match
+// light_clusters.hpp.
+const int clusterCountX = 16;
+const int clusterCountY = 9;
+const int clusterCountZ = 24;
+
+struct PointLight
+{
+	vec4 positionRadius;
+	vec4 colorIntensity;
+};
+
+layout (std430, binding = 1) readonly buffer Lights
+{
+	PointLight lights[];
+};
+
+// (offset, count) into lightIndices per cluster, x fastest
+layout (std430, binding = 2) readonly buffer Clusters
+{
+	uvec2 clusterRanges[];
+};
+
+layout (std430, binding = 3) readonly buffer LightIndices
+{
+	uint lightIndices[];
+};
+
+#ifdef TEXTURED
 uniform sampler2D texture0;
+#endif
+
+uniform vec4 baseColorFactor;
 
-uniform vec3 lightColor;
+// normalize(vec3(-2.0f, 8.0f, -1.0f))
+const vec3 lightDir = vec3(-0.2407717f, 0.9630868f, -0.1203859f);
+
+vec3 pointLighting(vec3 normal)
+{
+	float depth = -(view * vec4(inWorldPos, 1.0f)).z;
+
+	ivec3 cluster = ivec3(gl_FragCoord.xy * clusterScale.xy, log(depth / clusterScale.w) * clusterScale.z);
+	cluster = clamp(cluster, ivec3(0), ivec3(clusterCountX - 1, clusterCountY - 1, clusterCountZ - 1));
+	uint clusterIndex = uint(cluster.x + clusterCountX * (cluster.y + clusterCountY * cluster.z));
+
+	// Lights were never assigned for this frame
+	if (clusterIndex >= uint(clusterRanges.length()))
+	{
+		return vec3(0.0f);
+	}
+
+	uvec2 range = clusterRanges[clusterIndex];
+
+	vec3 lighting = vec3(0.0f);
+	for (uint i = 0; i < range.y; ++i)
+	{
+		PointLight light = lights[lightIndices[range.x + i]];
+
+		vec3 toLight = light.positionRadius.xyz - inWorldPos;
+		float distanceSquared = dot(toLight, toLight);
+		float radius = light.positionRadius.w;
+
+		// Inverse square, windowed to reach zero at the radius
+		float window = clamp(1.0f - pow(distanceSquared / (radius * radius), 2.0f), 0.0f, 1.0f);
+		float attenuation = window * window / (distanceSquared + 1.0f);
+
+		float diffuse = max(dot(normal, toLight * inversesqrt(max(distanceSquared, 1e-8f))), 0.0f);
+
+		lighting += light.colorIntensity.rgb * light.colorIntensity.w * diffuse * attenuation;
+	}
+
+	return lighting;
+}
 
 void main()
 {
-	const vec3 lightDir = normalize(const vec3(-2.0f, 8.0f, -1.0f));
-	const vec3 lightCol = const vec3(lightColor);
+	vec3 lightCol = lightColor.rgb;
 
 	const float ambientStrength = 0.4f;
-	const vec3 ambient = ambientStrength * lightCol;
+	vec3 ambient = ambientStrength * lightCol;
+
+	vec3 normal = normalize(inNorm);
+	float diffuse = max(dot(normal, lightDir), 0.0f);
 
-	float diffuse = max(dot(normalize(inNorm), lightDir), 0.0f);
+	vec4 baseColor = baseColorFactor;
+#ifdef TEXTURED
+	baseColor *= texture(texture0, inTex);
+#endif
 
-	fragColor = vec4((diffuse * lightCol + ambient), 1.0f) * vec4(texture(texture0, inTex));
+	fragColor = vec4((diffuse * lightCol + ambient + pointLighting(normal)), 1.0f) * baseColor;
 
 	//fragColor = vec4(inTex / 10.0f, 0.0f, 1.0f);
-}
\ No newline at end of file
+}
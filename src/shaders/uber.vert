@@ -1,4 +1,7 @@
-#version 460 core
+#version 450 core
+
+// Variants are selected by defines injected after the #version line:
+// SKINNED, TEXTURED and INSTANCED (see ShaderFeature in pipeline.hpp)
 
 layout (location = 0) in vec3 inPos;
 layout (location = 1) in vec3 inNorm;
@@ -8,11 +11,38 @@ layout (location = 4) in vec4 inWeights;
 
 layout (location = 0) out vec3 outNorm;
 layout (location = 1) out vec2 outTex;
+layout (location = 2) out vec3 outWorldPos;
+
+layout (std140, binding = 0) uniform Frame
+{
+	mat4 projection;
+	mat4 view;
+	vec4 lightColor;
+	vec4 clusterScale;
+};
 
-uniform mat4 projection;
-uniform mat4 view;
+#ifdef INSTANCED
+struct Instance
+{
+	mat4 model;
+	// mat3 in the upper left; mat4 keeps the std430 layout simple
+	mat4 normalMatrix;
+};
+
+layout (std430, binding = 0) readonly buffer Instances
+{
+	Instance instances[];
+};
+
+// Applied before the instance transform, so all primitives share the buffer
+uniform mat4 primitiveTransform;
+uniform mat3 primitiveNormalMatrix;
+#else
 uniform mat4 model;
+uniform mat3 normalMatrix;
+#endif
 
+#ifdef SKINNED
 uniform mat4 jointMatrix[32];
 
 mat4 calculateSkinMatrix()
@@ -24,20 +54,24 @@ mat4 calculateSkinMatrix()
 
 	return skinMatrix;
 }
+#endif
 
 void main()
 {
-	
-	if (inJoints.x == -1)
-	{
-	gl_Position = projection * view * model * vec4(inPos, 1.0f);
-	}
-	else
-	{
-	gl_Position = projection * view * model * calculateSkinMatrix() * vec4(inPos, 1.0f);
-	}
-
-	mat3 normalTransform = inverse(transpose(mat3(model)));
-	outNorm = normalTransform * inNorm;
+#ifdef INSTANCED
+	mat4 model = instances[gl_InstanceID].model * primitiveTransform;
+	mat3 normalMatrix = mat3(instances[gl_InstanceID].normalMatrix) * primitiveNormalMatrix;
+#endif
+
+#ifdef SKINNED
+	vec4 worldPos = model * calculateSkinMatrix() * vec4(inPos, 1.0f);
+#else
+	vec4 worldPos = model * vec4(inPos, 1.0f);
+#endif
+	gl_Position = projection * view * worldPos;
+	outWorldPos = worldPos.xyz;
+
+	outNorm = normalMatrix * inNorm;
+
 	outTex = inTex;
-}
\ No newline at end of file
+}
@@ -0,0 +1,38 @@
+// Converts .glb models into cooked packages next to them (see
+// cooked_model.hpp). The game picks a package up instead of the .glb as
+// long as it is at least as new.
+//
+//   iklob_cook assets/demo.glb assets/zombie.glb assets/gun.glb
+
+#include "../renderer/cooked_model.hpp"
+
+#include <iostream>
+#include <string>
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::cerr << "usage: iklob_cook model.glb...\n";
+		return 1;
+	}
+
+	int failures{};
+
+	for (int i{ 1 }; i < argc; ++i)
+	{
+		const std::string sourcePath{ argv[i] };
+		const std::string cookedPath{ cookedModelPath(sourcePath) };
+
+		if (cookModel(sourcePath, cookedPath))
+		{
+			std::cout << sourcePath << " -> " << cookedPath << '\n';
+		}
+		else
+		{
+			++failures;
+		}
+	}
+
+	return failures == 0 ? 0 : 1;
+}